@@ -0,0 +1,1013 @@
+/**
+ * @file KitchenBench.cpp
+ * @brief Замеры производительности: примитивы кухни, рецепты и движок заказов.
+ *
+ * Результаты печатаются в stdout в машиночитаемом виде (CSV по умолчанию,
+ * JSON с ключом --json), ход замеров — в stderr. Ключи:
+ * - --json        вывод в JSON;
+ * - --quick       короткие замеры (для проверки в CI);
+ * - --out <файл>  записать результаты в файл вместо stdout.
+ *
+ * Каждый замер повторяется несколько раз, в отчёт идёт медиана.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kitchen.hpp"
+#include "engine.hpp"
+#include "inventory.hpp"
+#include "eventlog.hpp"
+#include "recipe.hpp"
+#include "cotask.hpp"
+#include "world.hpp"
+#include "tools.hpp"
+#include "planner.hpp"
+#include "timers.hpp"
+#include "metrics.hpp"
+#include "snapshot.hpp"
+#include "feasibility.hpp"
+#include "montecarlo.hpp"
+#include "ledger.hpp"
+#include "expiry.hpp"
+#include "intake.hpp"
+#include "synthetic.hpp"
+#include "session.hpp"
+#include "costmodel.hpp"
+#include "versions.hpp"
+#include "federation.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+/**
+ * @struct BenchResult
+ * @brief Итог одного замера.
+ */
+struct BenchResult {
+    string    name;      ///< Название замера.
+    int       threads;   ///< Число потоков.
+    long long ops;       ///< Операций в одном повторе.
+    double    nsPerOp;   ///< Медиана наносекунд на операцию.
+    double    opsPerSec; ///< Операций в секунду (по медиане).
+};
+
+/**
+ * @class NullBuffer
+ * @brief streambuf, который выбрасывает весь вывод (для рукописных рецептов).
+ */
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+/// Глушит cout на время жизни объекта.
+class MuteCout {
+private:
+    NullBuffer buffer;
+    streambuf* saved;
+
+public:
+    MuteCout() : buffer(), saved(cout.rdbuf(&buffer)) {}
+    ~MuteCout() { cout.rdbuf(saved); }
+};
+
+int  repeats = 5;       ///< Повторов каждого замера.
+long long scale = 1;    ///< Делитель объёма работы (--quick).
+
+double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+/**
+ * @brief Меряет op() порциями по batch вызовов, вызывая setup() между порциями.
+ *
+ * Время setup() в замер не входит: так можно обновлять инструменты,
+ * которые изнашиваются (KitchenTool::durability), не искажая результат.
+ */
+template <typename Setup, typename Op>
+BenchResult measure(const string& name, long long ops, long long batch, Setup setup, Op op) {
+    ops = max(1LL, ops / scale);
+    batch = max(1LL, min(batch, ops));
+    vector<double> samples;
+    for (int r = 0; r < repeats; ++r) {
+        double ns = 0.0;
+        for (long long done = 0; done < ops; done += batch) {
+            long long n = min(batch, ops - done);
+            setup();
+            auto t0 = chrono::steady_clock::now();
+            for (long long i = 0; i < n; ++i) op(i);
+            auto t1 = chrono::steady_clock::now();
+            ns += static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+        }
+        samples.push_back(ns / static_cast<double>(ops));
+    }
+    double m = median(samples);
+    cerr << "  " << name << ": " << m << " нс/оп\n";
+    return BenchResult{name, 1, ops, m, m > 0.0 ? 1e9 / m : 0.0};
+}
+
+/* ===== Примитивы ===== */
+
+void benchPrimitives(vector<BenchResult>& out) {
+    static Unit gram("g", 1.0, false, 1);
+
+    Quantity q(250.0, &gram);
+    volatile double sink = 0.0;
+    out.push_back(measure("Quantity::toGrams", 20000000, 20000000, [] {}, [&](long long) {
+        sink = sink + q.toGrams();
+    }));
+
+    Ingredient flour("flour", Quantity(1e9, &gram), 0.0, false);
+    out.push_back(measure("Ingredient::useAmount", 10000000, 10000000, [] {}, [&](long long) {
+        flour.useAmount(0.5);
+    }));
+    out.push_back(measure("Ingredient::useAmount+addAmount", 10000000, 10000000, [] {}, [&](long long) {
+        flour.useAmount(0.5);
+        flour.addAmount(0.5);
+    }));
+    Grams half(0.5);
+    out.push_back(measure("Amount<Gram>::toGrams", 20000000, 20000000, [] {}, [&](long long) {
+        sink = sink + Grams(250).toGrams();
+    }));
+    out.push_back(measure("Ingredient::useAmount(Grams)+addAmount(Grams)", 10000000, 10000000, [] {}, [&](long long) {
+        flour.useAmount(half);
+        flour.addAmount(half);
+    }));
+
+    Timer timer;
+    out.push_back(measure("Timer::tick", 50000000, 1000000,
+                          [&] { timer.start(INT_MAX / 2); },
+                          [&](long long) { timer.tick(1); }));
+
+    Oven oven;
+    out.push_back(measure("Oven::tick", 20000000, 1000000,
+                          [&] { oven.preheat(180.0); oven.setTimerMinutes(100000); },
+                          [&](long long) { oven.tick(1); }));
+
+    Oven curved;
+    curved.setHeatCurve(HeatCurve::exponential(3.0));
+    out.push_back(measure("Oven::tick (exponential curve)", 20000000, 1000000,
+                          [&] { curved.preheat(180.0, 2000000); curved.setTimerMinutes(100000); },
+                          [&](long long) { curved.tick(1); }));
+    volatile int reach = 0;
+    out.push_back(measure("Oven::secondsUntilTemperature (curve)", 10000000, 1000000, [] {},
+                          [&](long long i) { reach = reach + curved.secondsUntilTemperature(30.0 + (i & 127)); }));
+}
+
+/* ===== Рукописные рецепты Cook::cookXxx ===== */
+
+/**
+ * @struct LegacyKitchen
+ * @brief Кухня со всеми 25 рукописными блюдами.
+ */
+struct LegacyKitchen {
+    Unit g{"g", 1.0, false, 1};
+    Ingredient chicken{"chicken", Quantity(1e9, &g), 0, true};
+    Ingredient beef{"beef", Quantity(1e9, &g), 0, true};
+    Ingredient veggies{"veggies", Quantity(1e9, &g), 0, true};
+    Ingredient tomatoes{"tomatoes", Quantity(1e9, &g), 0, true};
+    Ingredient potatoes{"potatoes", Quantity(1e9, &g), 0, true};
+    Ingredient rice{"rice", Quantity(1e9, &g), 0, false};
+    Ingredient pasta{"pasta", Quantity(1e9, &g), 0, false};
+    Ingredient oil{"oil", Quantity(1e9, &g), 0, false};
+    Ingredient milk{"milk", Quantity(1e9, &g), 0, true};
+    Ingredient cream{"cream", Quantity(1e9, &g), 0, true};
+    Ingredient flour{"flour", Quantity(1e9, &g), 0, false};
+    Ingredient sugar{"sugar", Quantity(1e9, &g), 0, false};
+    Ingredient eggs{"eggs", Quantity(1e9, &g), 0, true};
+    Ingredient bread{"bread", Quantity(1e9, &g), 0, true};
+    Ingredient cheese{"cheese", Quantity(1e9, &g), 0, true};
+    Ingredient sauce{"sauce", Quantity(1e9, &g), 0, true};
+    Ingredient fruits{"fruits", Quantity(1e9, &g), 0, true};
+    Ingredient garlic{"garlic", Quantity(1e9, &g), 0, true};
+    Ingredient base{"base", Quantity(1e9, &g), 0, false};
+    Ingredient fish{"fish", Quantity(1e9, &g), 0, true};
+    Ingredient oats{"oats", Quantity(1e9, &g), 0, false};
+    Ingredient sausage{"sausage", Quantity(1e9, &g), 0, true};
+    Ingredient mushrooms{"mushrooms", Quantity(1e9, &g), 0, true};
+
+    Knife        knife{"knife"};
+    CuttingBoard board{"board"};
+    Pan          pan{"pan", 26.0};
+    Pot          pot{"pot", 5.0};
+    PotatoMasher masher{"masher"};
+    Mixer        mixer{"mixer"};
+    Oven         oven;
+    Stove        stove;
+    Timer        timer;
+    Cook         cook{"bench"};
+
+    vector<unique_ptr<Dish>> dishes;
+
+    LegacyKitchen() {
+        Cook* c = &cook;
+        dishes.emplace_back(new ChickenSoupDish("ChickenSoup", &chicken, &veggies, &pot, &stove, &timer, c));
+        dishes.emplace_back(new SaladDish("Salad", &veggies, &oil, &knife, &board, c));
+        dishes.emplace_back(new BakedMeatDish("BakedMeat", &beef, &oven, c));
+        dishes.emplace_back(new PancakeDish("Pancakes", &flour, &eggs, &sugar, &milk, &pan, &stove, &timer, &mixer, c));
+        dishes.emplace_back(new PastaDish("Pasta", &pasta, &sauce, &pot, &stove, &timer, c));
+        dishes.emplace_back(new ScrambledEggsDish("ScrambledEggs", &eggs, &milk, &pan, &stove, &timer, &mixer, c));
+        dishes.emplace_back(new VegGrillDish("VegGrill", &veggies, &pan, &stove, &timer, &knife, &board, c));
+        dishes.emplace_back(new MeatStewDish("MeatStew", &beef, &veggies, &pot, &stove, &timer, &knife, &board, c));
+        dishes.emplace_back(new SandwichDish("Sandwich", &bread, &cheese, &beef, &knife, &board, c));
+        dishes.emplace_back(new CookieDish("Cookies", &flour, &eggs, &milk, &sugar, &oven, &mixer, c));
+        dishes.emplace_back(new RiceDish("Rice", &rice, &pot, &stove, &timer, c));
+        dishes.emplace_back(new BoiledEggDish("BoiledEggs", &eggs, &pot, &stove, &timer, c));
+        dishes.emplace_back(new MashedPotatoDish("MashedPotato", &potatoes, &milk, &pot, &stove, &timer, &masher, c));
+        dishes.emplace_back(new GrilledCheeseDish("GrilledCheese", &bread, &cheese, &pan, &stove, &timer, &knife, &board, c));
+        dishes.emplace_back(new FriedFishDish("FriedFish", &fish, &pan, &stove, &timer, c));
+        dishes.emplace_back(new FruitSaladDish("FruitSalad", &fruits, &knife, &board, c));
+        dishes.emplace_back(new PorridgeDish("Porridge", &oats, &milk, &pot, &stove, &timer, c));
+        dishes.emplace_back(new SteakDish("Steak", &beef, &pan, &stove, &timer, c));
+        dishes.emplace_back(new HotDogDish("HotDog", &bread, &sausage, &pan, &stove, &timer, c));
+        dishes.emplace_back(new SauteedMushroomsDish("SauteedMushrooms", &mushrooms, &pan, &stove, &timer, c));
+        dishes.emplace_back(new FriedPotatoDish("FriedPotato", &potatoes, &pan, &stove, &timer, &knife, &board, c));
+        dishes.emplace_back(new TomatoSoupDish("TomatoSoup", &tomatoes, &veggies, &pot, &stove, &timer, &knife, &board, c));
+        dishes.emplace_back(new VegOmeletteDish("VegOmelette", &eggs, &veggies, &milk, &pan, &stove, &timer, &knife, &board, &mixer, c));
+        dishes.emplace_back(new GarlicBreadDish("GarlicBread", &bread, &garlic, &oven, &knife, &board, c));
+        dishes.emplace_back(new SimpleSauceDish("SimpleSauce", &base, &cream, &pan, &stove, &timer, &mixer, c));
+    }
+};
+
+void benchLegacyRecipes(vector<BenchResult>& out) {
+    MuteCout mute;
+    unique_ptr<LegacyKitchen> k(new LegacyKitchen());
+    size_t count = k->dishes.size();
+    const long long batch = 40;   // инструменты выдерживают 100 использований
+
+    for (size_t d = 0; d < count; ++d) {
+        string name = string("Cook::cook") + k->dishes[d]->getName();
+        out.push_back(measure(name, 2000, batch,
+                              [&] { k.reset(new LegacyKitchen()); },
+                              [&](long long) { k->dishes[d]->cook(); }));
+    }
+}
+
+/* ===== Табличные рецепты и движок ===== */
+
+/**
+ * @struct Station
+ * @brief Рабочее место для замера движка: своя кастрюля, плита и таймер.
+ */
+struct Station {
+    Pot   pot{"pot", 5.0};
+    Stove stove{1};
+    Timer timer;
+};
+
+/**
+ * @struct EngineWorld
+ * @brief Общие запасы и stations рабочих мест с рецептом пасты на каждом.
+ */
+struct EngineWorld {
+    Unit                        g{"g", 1.0, false, 1};
+    Ingredient                  pasta{"pasta", Quantity(1e9, &g), 0, false};
+    Ingredient                  sauce{"sauce", Quantity(1e9, &g), 0, false};
+    vector<unique_ptr<Station>> stations;
+    RecipeKitchen               kitchen;
+    RecipeBook                  book{&kitchen};
+    vector<unique_ptr<RecipeDish>> dishes;
+
+    explicit EngineWorld(int count) {
+        kitchen.add("pasta", &pasta);
+        kitchen.add("sauce", &sauce);
+        string text;
+        for (int i = 0; i < count; ++i) {
+            stations.emplace_back(new Station());
+            string id = to_string(i);
+            kitchen.add(("pot" + id).c_str(), &stations.back()->pot);
+            kitchen.add(("stove" + id).c_str(), &stations.back()->stove);
+            kitchen.add(("timer" + id).c_str(), &stations.back()->timer);
+            text += "recipe Pasta " + id + "\n"
+                    "    lease pot" + id + "\n    lease stove" + id + "\n    acquire\n"
+                    "    reserve pasta 100\n    reserve sauce 50\n    take\n"
+                    "    burner_on stove" + id + "\n    boil pot" + id + "\n"
+                    "    hold timer" + id + " 600\n    say | Прошло %m мин\n    commit\n"
+                    "    unboil pot" + id + "\n    burner_off stove" + id + "\nend\n";
+        }
+        book.loadString(text.c_str());
+        for (int i = 0; i < book.size(); ++i) {
+            dishes.emplace_back(new RecipeDish(&book, i, nullptr));
+        }
+    }
+};
+
+void benchRecipeProgram(vector<BenchResult>& out) {
+    NullSink none;
+    unique_ptr<EngineWorld> w;
+    Cook ck("bench");
+    ck.setSink(&none);
+    out.push_back(measure("Cook::cookRecipe(pasta)", 20000, 80,
+                          [&] { w.reset(new EngineWorld(1)); },
+                          [&](long long) { ck.cookRecipe(w->book, 0); }));
+    out.push_back(measure("Cook::cookBatch(pasta,x10)", 2000, 8,
+                          [&] { w.reset(new EngineWorld(1)); },
+                          [&](long long) { ck.cookBatch(w->book, 0, 10); }));
+}
+
+/// Та же кухня, что EngineWorld(1), в описании для KitchenWorld.
+const char* const WORLD_CONFIG =
+    "unit g 1\n"
+    "ingredient pasta 1000000000 g 0\n"
+    "ingredient sauce 1000000000 g 0\n"
+    "pot pot0 5\nstove stove0 1\ntimer timer0\n";
+
+const char* const WORLD_RECIPE =
+    "recipe Pasta 0\n"
+    "    lease pot0\n    lease stove0\n    acquire\n"
+    "    reserve pasta 100\n    reserve sauce 50\n    take\n"
+    "    burner_on stove0\n    boil pot0\n"
+    "    hold timer0 600\n    say | Прошло %m мин\n    commit\n"
+    "    unboil pot0\n    burner_off stove0\nend\n";
+
+void benchWorld(vector<BenchResult>& out) {
+    volatile size_t sink = 0;
+    out.push_back(measure("EngineWorld(1) new/delete", 20000, 20000, [] {}, [&](long long) {
+        unique_ptr<EngineWorld> w(new EngineWorld(1));
+        sink = sink + w->dishes.size();
+    }));
+    KitchenWorld world;
+    out.push_back(measure("KitchenWorld::build", 20000, 20000, [] {}, [&](long long) {
+        world.build(WORLD_CONFIG, WORLD_RECIPE);
+        sink = sink + world.size();
+    }));
+}
+
+void benchToolScan(vector<BenchResult>& out) {
+    // 4096 сковород, пригодна только последняя: худший случай поиска.
+    const int count = 4096;
+    vector<unique_ptr<Pan>> pans;
+    for (int i = 0; i < count; ++i) {
+        pans.emplace_back(new Pan("pan"));
+        if (i + 1 < count) pans.back()->tryLease();
+    }
+    volatile size_t sink = 0;
+    out.push_back(measure("KitchenTool scan (4096)", 20000, 20000, [] {}, [&](long long) {
+        for (const unique_ptr<Pan>& p : pans) {
+            if (p->isAvailable() && !p->isBusy() && p->getDurability() >= 50) {
+                sink = sink + 1;
+                break;
+            }
+        }
+    }));
+
+    ToolRegistry reg(static_cast<size_t>(count));
+    for (const unique_ptr<Pan>& p : pans) reg.attach(p.get(), ResourceKind::Pan);
+    const ToolQuery q = ToolQuery::of(ResourceKind::Pan, 50);
+    out.push_back(measure("ToolRegistry::findFirst (4096)", 20000, 20000, [] {}, [&](long long) {
+        sink = sink + (reg.findFirst(q) != nullptr);
+    }));
+    out.push_back(measure("ToolRegistry::wear pass (4096)", 20000, 1000,
+                          [&] { reg.cleanAll(); for (auto& p : pans) p->releaseLease(); },
+                          [&](long long) { sink = sink + reg.wear(ToolQuery::any(), 0); }));
+}
+
+void benchTimers(vector<BenchResult>& out) {
+    // 4096 таймеров, запущена половина; на каждом шаге ищем сработавшие.
+    const int count = 4096;
+    vector<unique_ptr<Timer>> timers;
+    for (int i = 0; i < count; ++i) timers.emplace_back(new Timer(0, false, 0, i));
+    auto restart = [&] {
+        for (int i = 0; i < count; i += 2) timers[static_cast<size_t>(i)]->start(1000000 + i);
+    };
+    volatile size_t sink = 0;
+    out.push_back(measure("Timer::tick x4096 + isFinished", 20000, 1000, restart, [&](long long) {
+        size_t fired = 0;
+        for (const unique_ptr<Timer>& t : timers) {
+            t->tick(1);
+            fired += t->isFinished();
+        }
+        sink = sink + fired;
+    }));
+
+    TimerBank bank(static_cast<size_t>(count));
+    for (const unique_ptr<Timer>& t : timers) bank.attach(t.get());
+    out.push_back(measure("TimerBank::tickAll (4096)", 20000, 1000, restart, [&](long long) {
+        sink = sink + bank.tickAll(1);
+    }));
+    out.push_back(measure("TimerBank::nextFinish (4096)", 20000, 1000, restart, [&](long long) {
+        sink = sink + static_cast<size_t>(bank.nextFinish());
+    }));
+}
+
+void benchPlanner(vector<BenchResult>& out) {
+    KitchenWorld world;
+    world.build(WORLD_CONFIG, WORLD_RECIPE);
+    PlannerCapacity cap = PlannerCapacity::of(world.getBook().getKitchen(), 4);
+    cap[PlanResource::Burner] = 4;
+    cap[PlanResource::Pot]    = 4;
+    CapacityPlanner planner(world.getBook(), cap);
+    // Тысяча заказов со сроками вразнобой, поступают по одному в минуту.
+    vector<PlanOrder> orders;
+    for (int i = 0; i < 1000; ++i) {
+        orders.push_back(PlanOrder{0, i * 60LL, i * 60LL + 600 + (i * 7919 % 1800)});
+    }
+    volatile long long sink = 0;
+    out.push_back(measure("CapacityPlanner::plan (1000 orders)", 200, 200, [] {}, [&](long long) {
+        sink = sink + planner.plan(orders).makespan;
+    }));
+}
+
+void benchSnapshot(vector<BenchResult>& out) {
+    // Крупная кухня: 2000 ингредиентов, 1000 кастрюль, 500 таймеров.
+    string config = "unit g 1\n";
+    for (int i = 0; i < 2000; ++i) config += "ingredient i" + to_string(i) + " 1000 g\n";
+    for (int i = 0; i < 1000; ++i) config += "pot p" + to_string(i) + " 3\n";
+    for (int i = 0; i < 500; ++i)  config += "timer t" + to_string(i) + "\n";
+    config += "oven oven\nstove stove 4\n";
+
+    KitchenWorld world;
+    out.push_back(measure("KitchenWorld::build (3500 objects)", 200, 200, [] {}, [&](long long) {
+        world.build(config.c_str(), nullptr);
+    }));
+    vector<unsigned char> image = WorldSnapshot::capture(world);
+    volatile size_t sink = 0;
+    out.push_back(measure("WorldSnapshot::capture (3500 objects)", 2000, 2000, [] {}, [&](long long) {
+        sink = sink + WorldSnapshot::capture(world).size();
+    }));
+    out.push_back(measure("WorldSnapshot::apply (3500 objects)", 2000, 2000, [] {}, [&](long long) {
+        sink = sink + WorldSnapshot::apply(world, image.data(), image.size());
+    }));
+    world.ingredient(world.find("i7"))->useAmount(Grams(10));
+    vector<unsigned char> next = WorldSnapshot::capture(world);
+    out.push_back(measure("WorldSnapshot::diff (1 change)", 2000, 2000, [] {}, [&](long long) {
+        sink = sink + WorldSnapshot::diff(image, next, 0).size();
+    }));
+}
+
+void benchFeasibility(vector<BenchResult>& out) {
+    NullSink none;
+    Cook ck("bench");
+    ck.setSink(&none);
+    EngineWorld w(8);
+    volatile long long sink = 0;
+    out.push_back(measure("Ingredient::tryReserve + restore", 10000000, 10000000, [] {}, [&](long long) {
+        sink = sink + w.pasta.tryReserve(100000);
+        w.pasta.restore(100000);
+    }));
+    FeasibilityIndex index(w.book);
+    out.push_back(measure("Ingredient::tryReserve + restore (indexed)", 10000000, 10000000, [] {}, [&](long long) {
+        sink = sink + w.pasta.tryReserve(100000);
+        w.pasta.restore(100000);
+    }));
+    out.push_back(measure("FeasibilityIndex::canCook", 10000000, 10000000, [] {}, [&](long long i) {
+        sink = sink + index.canCook(static_cast<int>(i & 7));
+    }));
+
+    // Продуктов нет: узнать это попыткой или по индексу.
+    w.pasta.tryReserve(w.pasta.getMilligrams() - 50000);
+    out.push_back(measure("Cook::tryCookRecipe(pasta), out of stock", 200000, 200000, [] {}, [&](long long i) {
+        sink = sink + static_cast<long long>(ck.tryCookRecipe(w.book, static_cast<int>(i & 7)).error);
+    }));
+    out.push_back(measure("RecipeDish::canCook, out of stock", 10000000, 10000000, [] {}, [&](long long i) {
+        sink = sink + w.dishes[static_cast<size_t>(i & 7)]->canCook();
+    }));
+}
+
+void benchLedger(vector<BenchResult>& out) {
+    EngineWorld w(1);
+    auto reserveCommit = [&](long long) {
+        StockReservation stock;
+        stock.add(&w.pasta, Grams(100)).add(&w.sauce, Grams(50));
+        stock.reserve();
+        stock.commit();
+        w.pasta.restore(100000);
+        w.sauce.restore(50000);
+    };
+    out.push_back(measure("StockReservation commit", 2000000, 2000000, [] {}, reserveCommit));
+    ShiftLedger ledger(8);
+    {
+        LedgerScope scope(&ledger, nullptr);
+        LedgerDish dish(0);
+        out.push_back(measure("StockReservation commit (ledger)", 2000000, 2000000, [] {}, reserveCommit));
+    }
+    volatile long long sink = 0;
+    out.push_back(measure("ShiftLedger::shift", 10000000, 10000000, [] {}, [&](long long) {
+        sink = sink + ledger.shift().milliKcal;
+    }));
+}
+
+void benchExpiry(vector<BenchResult>& out) {
+    const int skus = 500;
+    Unit g("g", 1.0, false, 1);
+    vector<unique_ptr<Ingredient>> items;
+    ExpiryIndex index;
+    for (int i = 0; i < skus; ++i) {
+        items.emplace_back(new Ingredient("sku", Quantity(1000.0, &g), 100.0, true));
+        index.track(*items.back(), 1000000000LL);
+    }
+    volatile size_t sink = 0;
+    out.push_back(measure("ExpiryIndex::expire (500 SKU, nothing due)", 10000000, 10000000, [] {}, [&](long long i) {
+        sink = sink + index.expire(i);
+    }));
+    // Установившийся режим: на каждом шаге одна поставка и одна истёкшая партия.
+    out.push_back(measure("ExpiryIndex receive+expire (500 SKU)", 2000000, 2000000, [] {}, [&](long long i) {
+        long long now = index.now() + 1;
+        index.receive(*items[static_cast<size_t>(i % skus)], 1000, now + skus);
+        sink = sink + index.expire(now);
+    }));
+    out.push_back(measure("Ingredient::tryReserve+restore (lots)", 10000000, 10000000, [] {}, [&](long long i) {
+        Ingredient& ing = *items[static_cast<size_t>(i % skus)];
+        if (ing.tryReserve(100)) ing.restore(100);
+    }));
+}
+
+/**
+ * @struct EggLine
+ * @brief dishes блюд варёных яиц: у каждого своя кастрюля и таймер, плита общая.
+ */
+struct EggLine {
+    Unit                              g{"g", 1.0, false, 1};
+    Ingredient                        eggs{"eggs", Quantity(1e9, &g), 0, false};
+    Stove                             stove{4};
+    Cook                              cook{"bench"};
+    vector<unique_ptr<Pot>>           pots;
+    vector<unique_ptr<Timer>>         timers;
+    vector<unique_ptr<BoiledEggDish>> dishes;
+
+    explicit EggLine(int count) {
+        for (int i = 0; i < count; ++i) {
+            pots.emplace_back(new Pot("pot", 2.0));
+            timers.emplace_back(new Timer());
+            dishes.emplace_back(new BoiledEggDish("eggs", &eggs, pots.back().get(), &stove,
+                                                  timers.back().get(), &cook));
+        }
+    }
+};
+
+void benchCoroutines(vector<BenchResult>& out) {
+    MuteCout mute;
+    const int count = 64;
+    const long long batch = 40;   // инструменты выдерживают 100 использований
+    unique_ptr<EggLine> line;
+    out.push_back(measure("Cook::cookBoiledEggs x64 (one by one)", 400, batch,
+                          [&] { line.reset(new EggLine(count)); },
+                          [&](long long) {
+                              for (auto& d : line->dishes) line->cook.cookBoiledEggs(d.get());
+                          }));
+    out.push_back(measure("DishInterleaver x64 (4 burners)", 400, batch,
+                          [&] { line.reset(new EggLine(count)); },
+                          [&](long long) {
+                              DishInterleaver batchOfDishes(line->cook);
+                              for (auto& d : line->dishes) {
+                                  batchOfDishes.spawn(line->cook.cookBoiledEggsTask(d.get()));
+                              }
+                              batchOfDishes.run();
+                          }));
+}
+
+void benchMetrics(vector<BenchResult>& out) {
+    out.push_back(measure("Metrics::count", 10000000, 10000000, [] {}, [](long long) {
+        Metrics::count(MetricCounter::StepsRun);
+    }));
+    NullSink none;
+    unique_ptr<EngineWorld> w;
+    Cook ck("bench");
+    ck.setSink(&none);
+    Metrics::setStepTiming(true);
+    out.push_back(measure("Cook::cookRecipe(pasta), step timing", 20000, 80,
+                          [&] { w.reset(new EngineWorld(1)); },
+                          [&](long long) { ck.cookRecipe(w->book, 0); }));
+    Metrics::setStepTiming(false);
+    volatile uint64_t sink = 0;
+    out.push_back(measure("Metrics::snapshot", 2000, 2000, [] {}, [&](long long) {
+        sink = sink + Metrics::snapshot()[MetricCounter::StepsRun];
+    }));
+}
+
+void benchEngine(vector<BenchResult>& out) {
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw < 1) hw = 1;
+    vector<int> counts;
+    for (int n = 1; n < hw; n *= 2) counts.push_back(n);
+    counts.push_back(hw);
+
+    NullSink none;
+    for (int threads : counts) {
+        const int stations = threads * 2;
+        const long long perStation = max(1LL, 80 / scale);   // ресурс кастрюли — 100 варок
+        const long long orders = stations * perStation;
+        vector<double> samples;
+        for (int r = 0; r < repeats; ++r) {
+            EngineWorld w(stations);
+            KitchenEngine engine(threads, 4096);
+            engine.setSink(&none);
+            auto t0 = chrono::steady_clock::now();
+            for (long long i = 0; i < orders; ++i) {
+                engine.submit(w.dishes[static_cast<size_t>(i % stations)].get());
+            }
+            engine.waitAll();
+            auto t1 = chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+        }
+        double m = median(samples);
+        cerr << "  KitchenEngine x" << threads << ": " << m << " нс/заказ\n";
+        out.push_back(BenchResult{"KitchenEngine::orders", threads, orders, m, m > 0.0 ? 1e9 / m : 0.0});
+    }
+}
+
+void benchIntake(vector<BenchResult>& out) {
+    NullSink none;
+    const int stations = 8;
+    const long long orders = stations * max(1LL, 80 / scale);   // ресурс кастрюли — 100 варок
+    string request;
+    for (long long i = 0; i < orders; ++i) request += to_string(i % stations + 1) + "\n";
+    vector<double> samples;
+    HistogramSnapshot latency{};
+    for (int r = 0; r < repeats; ++r) {
+        EngineWorld w(stations);
+        Menu menu;
+        for (auto& d : w.dishes) menu.addDish(d.get());
+        KitchenEngine engine(2, 4096);
+        engine.setSink(&none);
+        OrderServer server(menu, engine);
+        unsigned short port = server.listen("127.0.0.1", 0);
+        thread loop([&] { server.run(); });
+
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        auto t0 = chrono::steady_clock::now();
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            send(fd, request.data(), request.size(), 0);
+            shutdown(fd, SHUT_WR);
+            char buf[64 * 1024];
+            while (recv(fd, buf, sizeof(buf), 0) > 0) {}
+        }
+        auto t1 = chrono::steady_clock::now();
+        close(fd);
+        server.stop();
+        loop.join();
+        latency = server.intakeLatency();
+        samples.push_back(static_cast<double>(
+            chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+    }
+    double m = median(samples);
+    cerr << "  OrderServer (TCP, 2 workers): " << m << " нс/заказ, приём p99 "
+         << latency.percentile(0.99) / 1000.0 << " мкс на пачку\n";
+    out.push_back(BenchResult{"OrderServer::orders", 2, orders, m, m > 0.0 ? 1e9 / m : 0.0});
+}
+
+void benchSynthetic(vector<BenchResult>& out) {
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw < 1) hw = 1;
+    vector<int> counts;
+    for (int n = 1; n < hw; n *= 2) counts.push_back(n);
+    counts.push_back(hw);
+
+    SyntheticSpec spec = SyntheticSpec::standard();
+    string kitchen = SyntheticKitchen::kitchen(spec, 1);
+    string recipes = SyntheticKitchen::recipes(spec, 1);
+    TraceSpec ts = TraceSpec::standard(spec.dishes);
+    ts.horizon = max(600LL, ts.horizon / scale);
+    ostringstream traceText;
+    const long long orders = OrderTraceGenerator::write(ts, 1, traceText);
+    const string trace = traceText.str();
+
+    vector<double> build;
+    for (int r = 0; r < repeats; ++r) {
+        KitchenWorld w;
+        auto t0 = chrono::steady_clock::now();
+        w.build(kitchen.c_str(), recipes.c_str());
+        auto t1 = chrono::steady_clock::now();
+        build.push_back(static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()));
+    }
+    double b = median(build);
+    cerr << "  KitchenWorld::build (" << spec.ingredients << " ингредиентов, " << spec.dishes
+         << " блюд): " << b / 1e6 << " мс\n";
+    out.push_back(BenchResult{"Synthetic::build", 1, 1, b, b > 0.0 ? 1e9 / b : 0.0});
+
+    // Мир собирается заново на каждый повтор: трасса расходует запасы.
+    NullSink none;
+    for (int threads : counts) {
+        vector<double> samples;
+        long long done = 0;
+        for (int r = 0; r < repeats; ++r) {
+            KitchenWorld w;
+            w.build(kitchen.c_str(), recipes.c_str());
+            Menu menu;
+            for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+            KitchenEngine engine(threads, 4096);
+            engine.setSink(&none);
+            OrderStream stream(menu, engine);
+            auto t0 = chrono::steady_clock::now();
+            OrderStreamReport report = stream.run(trace.data(), trace.size());
+            auto t1 = chrono::steady_clock::now();
+            done = report.done;
+            samples.push_back(static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+        }
+        double m = median(samples);
+        cerr << "  OrderStream x" << threads << " (" << orders << " заказов, приготовлено " << done
+             << "): " << m << " нс/заказ\n";
+        out.push_back(BenchResult{"Synthetic::orders", threads, orders, m, m > 0.0 ? 1e9 / m : 0.0});
+    }
+}
+
+void benchSession(vector<BenchResult>& out) {
+    const char* path = "kitchen_bench_session.log";
+    {
+        KitchenWorld w;
+        w.build(WORLD_CONFIG, WORLD_RECIPE);
+        Menu menu;
+        for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+        SessionRecorder rec(path, WORLD_CONFIG, WORLD_RECIPE, w, menu, 1);
+        OrderResult r{1, "", true, nullptr, 0, 0, CookStatus::success(), NutritionTotals{0, 0}};
+        Dish* d = menu.dishAt(1);
+        out.push_back(measure("SessionRecorder started+finished", 4000000, 4000000, [] {}, [&](long long i) {
+            rec.started(0, static_cast<int>(i), d, i);
+            rec.finished(0, r, i + 1);
+        }));
+    }
+
+    // Тот же синтетический поток с записью сеанса и без неё.
+    SyntheticSpec spec = SyntheticSpec::standard();
+    string kitchen = SyntheticKitchen::kitchen(spec, 1);
+    string recipes = SyntheticKitchen::recipes(spec, 1);
+    TraceSpec ts = TraceSpec::standard(spec.dishes);
+    ts.horizon = max(600LL, ts.horizon / scale);
+    ostringstream traceText;
+    const long long orders = OrderTraceGenerator::write(ts, 1, traceText);
+    const string trace = traceText.str();
+    NullSink none;
+    for (int recording = 0; recording < 2; ++recording) {
+        vector<double> samples;
+        for (int r = 0; r < repeats; ++r) {
+            KitchenWorld w;
+            w.build(kitchen.c_str(), recipes.c_str());
+            Menu menu;
+            for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+            unique_ptr<SessionRecorder> rec;
+            if (recording) rec.reset(new SessionRecorder(path, kitchen.c_str(), recipes.c_str(), w, menu, 1));
+            KitchenEngine engine(1, 4096);
+            engine.setSink(&none);
+            engine.setRecorder(rec.get());
+            OrderStream stream(menu, engine);
+            auto t0 = chrono::steady_clock::now();
+            stream.run(trace.data(), trace.size());
+            if (rec) rec->flush();
+            auto t1 = chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+        }
+        double m = median(samples);
+        const char* name = recording ? "OrderStream (recorded)" : "OrderStream";
+        cerr << "  " << name << ": " << m << " нс/заказ\n";
+        out.push_back(BenchResult{recording ? "Session::recorded" : "Session::plain", 1, orders, m,
+                                  m > 0.0 ? 1e9 / m : 0.0});
+    }
+
+    SessionLog log = SessionLog::read(path);
+    vector<double> samples;
+    for (int r = 0; r < repeats; ++r) {
+        auto t0 = chrono::steady_clock::now();
+        SessionReplay::run(log);
+        auto t1 = chrono::steady_clock::now();
+        samples.push_back(static_cast<double>(
+            chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+    }
+    double m = median(samples);
+    cerr << "  SessionReplay::run: " << m << " нс/заказ\n";
+    out.push_back(BenchResult{"SessionReplay::orders", 1, orders, m, m > 0.0 ? 1e9 / m : 0.0});
+    remove(path);
+}
+
+void benchCostModel(vector<BenchResult>& out) {
+    SyntheticSpec spec = SyntheticSpec::standard();
+    string kitchen = SyntheticKitchen::kitchen(spec, 1);
+    string recipes = SyntheticKitchen::recipes(spec, 1);
+    KitchenWorld w;
+    w.build(kitchen.c_str(), recipes.c_str());
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    CostModel m(w.getBook(), menu, 4);
+    const int items = static_cast<int>(menu.size());
+    volatile long long sink = 0;
+    out.push_back(measure("CostModel::readyIn", 4000000, 4000000, [] {}, [&](long long i) {
+        sink = sink + m.readyIn(static_cast<int>(i % items) + 1);
+    }));
+    out.push_back(measure("CostModel admit+finished", 4000000, 4000000, [] {}, [&](long long i) {
+        int item = static_cast<int>(i % items) + 1;
+        long long cost = 0;
+        if (m.admit(item, CostModel::UNREACHABLE - 1, cost)) {
+            m.finished(menu.dishAt(item), cost, m.estimate(item), true);
+        }
+    }));
+}
+
+void benchVersions(vector<BenchResult>& out) {
+    SyntheticSpec spec = SyntheticSpec::standard();
+    string kitchen = SyntheticKitchen::kitchen(spec, 1);
+    string recipes = SyntheticKitchen::recipes(spec, 1);
+    KitchenWorld w;
+    w.build(kitchen.c_str(), recipes.c_str());
+    Ingredient* a = w.getKitchen().ingredient(0);
+    Ingredient* b = w.getKitchen().ingredient(1);
+    auto reserveCancel = [&](long long) {
+        StockReservation stock;
+        stock.add(a, Grams(1)).add(b, Grams(1));
+        stock.tryReserve();
+    };
+    out.push_back(measure("StockReservation cancel", 2000000, 2000000, [] {}, reserveCancel));
+    InventoryVersions versions(w);
+    out.push_back(measure("StockReservation cancel (versions)", 2000000, 2000000, [] {}, reserveCancel));
+    volatile long long sink = 0;
+    out.push_back(measure("InventoryView pin+read", 4000000, 4000000, [] {}, [&](long long) {
+        InventoryView v(versions);
+        sink = sink + v->milligrams(0);
+    }));
+    out.push_back(measure("InventoryVersions::publish", 20000, 20000, [] {}, [&](long long) {
+        sink = sink + static_cast<long long>(versions.publish());
+    }));
+}
+
+void benchFederation(vector<BenchResult>& out) {
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw < 1) hw = 1;
+    vector<int> counts;
+    for (int n = 1; n < hw; n *= 2) counts.push_back(n);
+    counts.push_back(hw);
+
+    NullSink none;
+    for (int shards : counts) {
+        // По одному повару на участок; заказов на участок поровну (ресурс кастрюли — 100 варок).
+        const long long orders = shards * max(1LL, 80 / scale);
+        vector<double> samples;
+        for (int r = 0; r < repeats; ++r) {
+            KitchenFederation fed;
+            for (int s = 0; s < shards; ++s) {
+                fed.addShard(WORLD_CONFIG, WORLD_RECIPE, 1, {s});
+                fed.shard(s).getEngine().setSink(&none);
+            }
+            auto t0 = chrono::steady_clock::now();
+            for (long long i = 0; i < orders; ++i) fed.route(1);
+            fed.waitAll();
+            auto t1 = chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(orders));
+        }
+        double m = median(samples);
+        cerr << "  KitchenFederation x" << shards << ": " << m << " нс/заказ\n";
+        out.push_back(BenchResult{"KitchenFederation::orders", shards, orders, m, m > 0.0 ? 1e9 / m : 0.0});
+    }
+    KitchenFederation fed;
+    for (int s = 0; s < 4; ++s) fed.addShard(WORLD_CONFIG, WORLD_RECIPE, 1);
+    out.push_back(measure("StockTransfer::tryMove (2 lines)", 1000000, 1000000, [] {}, [&](long long i) {
+        StockTransfer t(fed.shard(static_cast<int>(i & 3)), fed.shard(static_cast<int>((i + 1) & 3)));
+        t.add("pasta", 1.0).add("sauce", 1.0);
+        t.tryMove();
+    }));
+}
+
+void benchWhatIf(vector<BenchResult>& out) {
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw < 1) hw = 1;
+    vector<int> counts;
+    for (int n = 1; n < hw; n *= 2) counts.push_back(n);
+    counts.push_back(hw);
+
+    WhatIfScenario sc = WhatIfScenario::standard(WORLD_CONFIG, WORLD_RECIPE);
+    WhatIfSimulator sim(sc);
+    volatile long long sink = 0;
+    for (int threads : counts) {
+        // Реплик на поток поровну: при линейном масштабировании время не растёт.
+        const int replicas = threads * static_cast<int>(max(1LL, 400 / scale));
+        vector<double> samples;
+        for (int r = 0; r < repeats; ++r) {
+            auto t0 = chrono::steady_clock::now();
+            sink = sink + sim.run(replicas, static_cast<uint64_t>(r + 1), threads).done;
+            auto t1 = chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) / static_cast<double>(replicas));
+        }
+        double m = median(samples);
+        cerr << "  WhatIfSimulator x" << threads << ": " << m << " нс/реплика\n";
+        out.push_back(BenchResult{"WhatIfSimulator::replicas", threads, replicas, m, m > 0.0 ? 1e9 / m : 0.0});
+    }
+}
+
+/* ===== Вывод ===== */
+
+void writeCsv(ostream& os, const vector<BenchResult>& rs) {
+    os << "benchmark,threads,ops,ns_per_op,ops_per_sec\n";
+    for (const auto& r : rs) {
+        os << r.name << ',' << r.threads << ',' << r.ops << ','
+           << r.nsPerOp << ',' << r.opsPerSec << '\n';
+    }
+}
+
+void writeJson(ostream& os, const vector<BenchResult>& rs) {
+    os << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < rs.size(); ++i) {
+        const auto& r = rs[i];
+        os << "    {\"benchmark\": \"" << r.name << "\", \"threads\": " << r.threads
+           << ", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.nsPerOp
+           << ", \"ops_per_sec\": " << r.opsPerSec << "}"
+           << (i + 1 < rs.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            scale = 20;
+            repeats = 3;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            cerr << "Использование: KitchenBench [--json] [--quick] [--out файл]\n";
+            return 2;
+        }
+    }
+
+    vector<BenchResult> results;
+    try {
+        cerr << "Примитивы:\n";
+        benchPrimitives(results);
+        cerr << "Рукописные рецепты:\n";
+        benchLegacyRecipes(results);
+        cerr << "Табличные рецепты:\n";
+        benchRecipeProgram(results);
+        cerr << "Сборка кухни:\n";
+        benchWorld(results);
+        cerr << "Реестр инструментов:\n";
+        benchToolScan(results);
+        cerr << "Банк таймеров:\n";
+        benchTimers(results);
+        cerr << "Планирование заказов:\n";
+        benchPlanner(results);
+        cerr << "Снимки состояния:\n";
+        benchSnapshot(results);
+        cerr << "Выполнимость блюд:\n";
+        benchFeasibility(results);
+        cerr << "Калорийность и себестоимость:\n";
+        benchLedger(results);
+        cerr << "Сроки годности:\n";
+        benchExpiry(results);
+        cerr << "Сопрограммы:\n";
+        benchCoroutines(results);
+        cerr << "Метрики:\n";
+        benchMetrics(results);
+        cerr << "Движок заказов:\n";
+        benchEngine(results);
+        cerr << "Приём заказов по сети:\n";
+        benchIntake(results);
+        cerr << "Синтетическая кухня:\n";
+        benchSynthetic(results);
+        cerr << "Запись и воспроизведение сеанса:\n";
+        benchSession(results);
+        cerr << "Модель стоимости:\n";
+        benchCostModel(results);
+        cerr << "Версии запасов:\n";
+        benchVersions(results);
+        cerr << "Федерация кухонь:\n";
+        benchFederation(results);
+        cerr << "Симуляция смен:\n";
+        benchWhatIf(results);
+    } catch (const exception& ex) {
+        cerr << "Замер прерван: " << ex.what() << "\n";
+        return 1;
+    }
+
+    ofstream file;
+    if (outPath) {
+        file.open(outPath);
+        if (!file) {
+            cerr << "Не удалось открыть " << outPath << "\n";
+            return 1;
+        }
+    }
+    ostream& os = outPath ? static_cast<ostream&>(file) : cout;
+    if (json) writeJson(os, results);
+    else      writeCsv(os, results);
+    return 0;
+}
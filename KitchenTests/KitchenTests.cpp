@@ -1,7 +1,37 @@
 #include <UnitTest++/UnitTest++.h>
+#include <cstring>
 #include <sstream>
 #include <iostream>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include "kitchen.hpp"
+#include "engine.hpp"
+#include "inventory.hpp"
+#include "recipe.hpp"
+#include "eventlog.hpp"
+#include "orders.hpp"
+#include "world.hpp"
+#include "tools.hpp"
+#include "schedule.hpp"
+#include "planner.hpp"
+#include "timers.hpp"
+#include "metrics.hpp"
+#include "snapshot.hpp"
+#include "feasibility.hpp"
+#include "smallvec.hpp"
+#include "montecarlo.hpp"
+#include "ledger.hpp"
+#include "expiry.hpp"
+#include "cotask.hpp"
+#include "intake.hpp"
+#include "synthetic.hpp"
+#include "session.hpp"
+#include "costmodel.hpp"
+#include "versions.hpp"
+#include "federation.hpp"
 
 using namespace std;
 
@@ -1143,8 +1173,3268 @@ TEST(Menu_Run_InvalidInput_Break) {
 }
 
 
+// ---------------------------------------------------------
+// SIMCLOCK (108–112)
+// ---------------------------------------------------------
+
+// 108
+TEST(SimClock_EventsRunInTimeOrder) {
+    SimClock clock;
+    vector<int> order;
+    clock.schedule(30, [&] { order.push_back(3); });
+    clock.schedule(10, [&] { order.push_back(1); });
+    clock.schedule(10, [&] { order.push_back(2); });
+    clock.run();
+    CHECK_EQUAL(3u, order.size());
+    CHECK_EQUAL(1, order[0]);
+    CHECK_EQUAL(2, order[1]);
+    CHECK_EQUAL(3, order[2]);
+    CHECK_EQUAL(30, clock.now());
+}
+
+// 109
+TEST(SimClock_TimerFinishesInOneEvent) {
+    SimClock clock;
+    Timer t;
+    t.start(30 * 60);
+    bool done = false;
+    clock.onTimerFinished(&t, [&] { done = true; });
+    CHECK(clock.step());
+    CHECK(done);
+    CHECK(t.isFinished());
+    CHECK_EQUAL(30 * 60, clock.now());
+    CHECK(!clock.step());
+}
+
+// 110
+TEST(SimClock_OvenTemperatureThenOff) {
+    SimClock clock;
+    Oven ov;
+    ov.closeDoor();
+    ov.preheat(180.0, 10);
+    ov.setTimerMinutes(30);
+    long long reachedAt = -1;
+    clock.onOvenTemperature(&ov, 180.0, [&] { reachedAt = clock.now(); });
+    clock.onOvenOff(&ov, nullptr);
+    clock.run();
+    CHECK_EQUAL(10 * 60, reachedAt);
+    CHECK_EQUAL(30 * 60, clock.now());
+    CHECK(!ov.isOn());
+}
+
+// 111
+TEST(TemperatureProfile_SecondsToReach) {
+    TemperatureProfile tp(20.0, 180.0, 100, true);
+    CHECK_EQUAL(0, tp.secondsToReach(10.0));
+    CHECK_EQUAL(50, tp.secondsToReach(100.0));
+    CHECK_EQUAL(100, tp.secondsToReach(180.0));
+    CHECK_EQUAL(-1, tp.secondsToReach(200.0));
+    CHECK(tp.currentTemp(tp.secondsToReach(123.4)) >= 123.4);
+}
+
+// 112
+TEST(Cook_WaitsOnClockInsteadOfTicking) {
+    Ingredient pasta = makeIngredient("pasta", 1000.0);
+    Ingredient sauce = makeIngredient("sauce", 1000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    Cook ck("cook");
+    PastaDish dish("Pasta", &pasta, &sauce, &pot, &stove, &t, &ck);
+    dish.cook();
+    CHECK(t.isFinished());
+    CHECK_EQUAL(10 * 60, ck.getClock().now());
+}
+
+
+// ---------------------------------------------------------
+// ENGINE (113–116)
+// ---------------------------------------------------------
+
+// 113
+TEST(MpmcQueue_FifoAndCapacity) {
+    MpmcQueue<int> q(4);
+    CHECK_EQUAL(4u, q.capacity());
+    for (int i = 0; i < 4; ++i) CHECK(q.tryPush(i));
+    CHECK(!q.tryPush(99));
+    int v = -1;
+    for (int i = 0; i < 4; ++i) {
+        CHECK(q.tryPop(v));
+        CHECK_EQUAL(i, v);
+    }
+    CHECK(!q.tryPop(v));
+}
+
+// 114
+TEST(EquipmentLease_AllOrNothing) {
+    Pan pan("pan");
+    Pot pot("pot");
+    Stove stove(1, 0, true, false);
+    {
+        EquipmentLease first;
+        first.add(&pan).add(&stove);
+        CHECK(first.tryAcquire());
+
+        EquipmentLease second;
+        second.add(&pot).add(&stove);
+        CHECK(!second.tryAcquire());
+        CHECK(!pot.isBusy());   // откат: кастрюля не осталась занятой
+    }
+    CHECK(!pan.isBusy());
+    EquipmentLease third;
+    third.add(&pot).add(&stove);
+    CHECK(third.tryAcquire());
+    // Таймер арендуется как остальное оборудование; повтор в наборе не мешает.
+    Timer shared;
+    EquipmentLease holder;
+    holder.add(&shared).add(&shared);
+    CHECK(holder.tryAcquire());
+    EquipmentLease other;
+    other.add(&pan).add(&shared);
+    CHECK(!other.tryAcquire());
+    CHECK(!pan.isBusy());
+    holder.release();
+    CHECK(other.tryAcquire());
+}
+
+// 115
+TEST(KitchenEngine_ParallelOrdersShareStock) {
+    static Unit g("g", 1.0, false, 1);
+    Ingredient fruits("fruits", Quantity(1000.0, &g), 0.0, true);
+    Knife knife("knife");
+    CuttingBoard board("board");
+    Cook ck("cook");
+    FruitSaladDish dish("Fruit salad", &fruits, &knife, &board, &ck);
+
+    KitchenEngine engine(4);
+    for (int i = 0; i < 7; ++i) engine.submit(&dish);
+    engine.waitAll();
+    vector<OrderResult> res = engine.collectResults();
+
+    CHECK_EQUAL(7u, res.size());
+    int ok = 0;
+    for (const auto& r : res) if (r.ok) ok++;
+    CHECK_EQUAL(5, ok);   // 1000 г / 200 г на порцию
+}
+
+// 116
+TEST(KitchenEngine_SharedPotIsSerialized) {
+    Ingredient pasta = makeIngredient("pasta", 10000.0);
+    Ingredient sauce = makeIngredient("sauce", 10000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    Cook ck("cook");
+    PastaDish dish("Pasta", &pasta, &sauce, &pot, &stove, &t, &ck);
+
+    KitchenEngine engine(3);
+    for (int i = 0; i < 6; ++i) engine.submit(&dish);
+    engine.shutdown();
+    vector<OrderResult> res = engine.collectResults();
+
+    CHECK_EQUAL(6u, res.size());
+    for (const auto& r : res) {
+        CHECK(r.ok);
+        CHECK_EQUAL(10 * 60, r.simSeconds);
+    }
+    CHECK(!pot.isBusy());
+    CHECK_EQUAL(4, stove.freeBurners());
+    // Разные кастрюли, но общий таймер: запускает его только арендатор.
+    Pot other("pot 2", 3.0, true, false);
+    PastaDish second("Pasta 2", &pasta, &sauce, &other, &stove, &t, &ck);
+    KitchenWorld w;
+    w.build("unit g 1\ntimer t\ncook chef\n",
+            "recipe Rest\n    hold t 300\nend\nrecipe Proof\n    hold t 300\n    hold t 60\nend\n");
+    KitchenEngine shared(3);
+    for (int i = 0; i < 4; ++i) {
+        shared.submit(&dish);
+        shared.submit(&second);
+        shared.submit(w.dishAt(0));
+        shared.submit(w.dishAt(1));
+    }
+    shared.shutdown();
+    res = shared.collectResults();
+    CHECK_EQUAL(16u, res.size());
+    for (const auto& r : res) {
+        CHECK(r.ok);
+        long long expect = strcmp(r.dishName, "Rest") == 0 ? 300 : strcmp(r.dishName, "Proof") == 0 ? 360 : 10 * 60;
+        CHECK_EQUAL(expect, r.simSeconds);
+    }
+    CHECK(!other.isBusy());
+}
+
+// ---------------------------------------------------------
+// INVENTORY (117–121)
+// ---------------------------------------------------------
+
+// 117
+TEST(Ingredient_FixedPointHasNoDrift) {
+    Ingredient flour = makeIngredient("flour", 1000.0);
+    for (int i = 0; i < 10000; ++i) flour.useAmount(0.1);
+    CHECK_EQUAL(0LL, flour.getMilligrams());
+    CHECK_THROW(flour.useAmount(0.001), NotEnoughIngredientException);
+}
+
+// 118
+TEST(Ingredient_TryReserveAndRestore) {
+    Ingredient sugar = makeIngredient("sugar", 10.0);
+    CHECK(sugar.tryReserve(4000));
+    CHECK(!sugar.tryReserve(7000));
+    CHECK_EQUAL(6000LL, sugar.getMilligrams());
+    sugar.restore(4000);
+    CHECK_CLOSE(10.0, sugar.getGrams(), 1e-9);
+}
+
+// 119
+TEST(StockReservation_AllOrNothing) {
+    Ingredient eggs = makeIngredient("eggs", 100.0);
+    Ingredient milk = makeIngredient("milk", 10.0);
+    StockReservation r;
+    r.add(&eggs, 50.0).add(&milk, 20.0);
+    CHECK(!r.tryReserve());
+    CHECK(r.getShortage() == &milk);
+    CHECK_EQUAL(100000LL, eggs.getMilligrams());   // откат
+    CHECK_THROW(r.reserve(), NotEnoughIngredientException);
+
+    StockReservation broken;
+    broken.add(&eggs, 1.0).add(nullptr, 1.0);
+    CHECK_THROW(broken.reserve(), IngredientNotFoundException);
+}
+
+// 120
+TEST(StockReservation_CancelledUnlessCommitted) {
+    Ingredient rice = makeIngredient("rice", 300.0);
+    {
+        StockReservation r;
+        r.add(&rice, 120.0);
+        r.reserve();
+        CHECK_EQUAL(180000LL, rice.getMilligrams());
+    }
+    CHECK_EQUAL(300000LL, rice.getMilligrams());
+    {
+        StockReservation r;
+        r.add(&rice, 120.0);
+        r.reserve();
+        r.commit();
+    }
+    CHECK_EQUAL(180000LL, rice.getMilligrams());
+}
+
+// 121
+TEST(StockReservation_ConcurrentReservers) {
+    Ingredient beans = makeIngredient("beans", 1000.0);
+    Ingredient salt  = makeIngredient("salt", 10000.0);
+    atomic<int> ok(0);
+    vector<thread> th;
+    for (int t = 0; t < 8; ++t) {
+        th.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                StockReservation r;
+                r.add(&salt, 1.0).add(&beans, 0.7);
+                if (r.tryReserve()) {
+                    r.commit();
+                    ok++;
+                }
+            }
+        });
+    }
+    for (auto& x : th) x.join();
+    CHECK_EQUAL(1428, ok.load());   // floor(1000 / 0.7)
+    CHECK_EQUAL(1000000LL - 1428LL * 700LL, beans.getMilligrams());
+    CHECK_EQUAL(10000000LL - 1428LL * 1000LL, salt.getMilligrams());
+}
+
+// ---------------------------------------------------------
+// RECIPE ENGINE (122–126)
+// ---------------------------------------------------------
+
+static const char* const TEST_PASTA_RECIPE = R"(
+recipe Pasta
+    require pot 2
+    lease pot
+    lease stove
+    acquire
+    reserve pasta 100
+    reserve sauce 50
+    take
+    burner_on stove
+    boil pot
+    hold timer 600
+    say | Прошло %m мин
+    commit
+    unboil pot
+    burner_off stove
+end
+)";
+
+// 122
+TEST(RecipeBook_RunsPastaProgram) {
+    Ingredient pasta = makeIngredient("pasta", 300.0);
+    Ingredient sauce = makeIngredient("sauce", 300.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+
+    RecipeBook book(&k);
+    CHECK_EQUAL(1, book.loadString(TEST_PASTA_RECIPE));
+    CHECK_EQUAL(0, book.find("Pasta"));
+    CHECK_EQUAL(14u, book.stepCount(0));
+
+    Cook ck("cook");
+    RecipeDish dish(&book, 0, &ck);
+    dish.cook();
+    CHECK_EQUAL(600, ck.getClock().now());
+    CHECK_CLOSE(200.0, pasta.getGrams(), 1e-9);
+    CHECK_CLOSE(250.0, sauce.getGrams(), 1e-9);
+    CHECK(!pot.isBusy());
+    CHECK_EQUAL(4, stove.freeBurners());
+}
+
+// 123
+TEST(RecipeBook_RejectsBadText) {
+    Ingredient pasta = makeIngredient("pasta", 300.0);
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+
+    CHECK_THROW(book.loadString("recipe A\n    fry pasta\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n    reserve rice 10\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n    hold pasta 10\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n    reserve pasta\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n    take\n"), RecipeFormatException);
+    CHECK_EQUAL(0, book.size());   // неудачная загрузка книгу не меняет
+}
+
+// 124
+TEST(RecipeBook_RepeatIsUnrolled) {
+    Timer t;
+    RecipeKitchen k;
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString("recipe Pancakes\n"
+                    "    repeat 3\n"
+                    "        hold timer 120\n"
+                    "        say | Блин %i\n"
+                    "    done\n"
+                    "end\n");
+    CHECK_EQUAL(6u, book.stepCount(0));
+    const RecipeStep* s = book.stepsOf(0);
+    CHECK(s[5].op == RecipeOp::Say);
+    CHECK_EQUAL(string("Блин 3"), string(book.textOf(s[5])));
+
+    Cook ck("cook");
+    ck.cookRecipe(book, 0);
+    CHECK_EQUAL(360, ck.getClock().now());
+}
+
+// 125
+TEST(RecipeBook_ShortageKeepsStockAndFreesTools) {
+    Ingredient pasta = makeIngredient("pasta", 300.0);
+    Ingredient sauce = makeIngredient("sauce", 10.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+
+    Cook ck("cook");
+    CHECK_THROW(ck.cookRecipe(book, 0), NotEnoughIngredientException);
+    CHECK_CLOSE(300.0, pasta.getGrams(), 1e-9);
+    CHECK(!pot.isBusy());
+    CHECK(stove.tryLeaseBurner());
+}
+
+// 126
+TEST(RecipeDish_RunsOnKitchenEngine) {
+    Ingredient pasta = makeIngredient("pasta", 10000.0);
+    Ingredient sauce = makeIngredient("sauce", 10000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+    RecipeDish dish(&book, 0, nullptr);
+
+    KitchenEngine engine(3);
+    for (int i = 0; i < 6; ++i) engine.submit(&dish);
+    engine.shutdown();
+    vector<OrderResult> res = engine.collectResults();
+
+    CHECK_EQUAL(6u, res.size());
+    for (const auto& r : res) {
+        CHECK(r.ok);
+        CHECK_EQUAL(10 * 60, r.simSeconds);
+    }
+    CHECK_CLOSE(9400.0, pasta.getGrams(), 1e-9);
+}
+
+// ---------------------------------------------------------
+// BATCH COOKING (127–129)
+// ---------------------------------------------------------
+
+// 127
+TEST(CookBatch_SplitsByPotVolume) {
+    Ingredient pasta = makeIngredient("pasta", 1000.0);
+    Ingredient sauce = makeIngredient("sauce", 1000.0);
+    Pot pot("pot", 4.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+
+    Cook ck("cook");
+    BatchResult r = ck.cookBatch(book, 0, 5);   // по 2 порции на закладку
+    CHECK_EQUAL(5, r.portions);
+    CHECK_EQUAL(3, r.passes);
+    CHECK_EQUAL(1800, r.totalSeconds);
+    CHECK_EQUAL(5u, r.readySeconds.size());
+    CHECK_EQUAL(600, r.readySeconds[1]);
+    CHECK_EQUAL(1200, r.readySeconds[2]);
+    CHECK_EQUAL(1800, r.readySeconds[4]);
+    CHECK_CLOSE(500.0, pasta.getGrams(), 1e-9);
+    CHECK_CLOSE(750.0, sauce.getGrams(), 1e-9);
+    CHECK_EQUAL(4, stove.freeBurners());
+    CHECK(!pot.isBusy());
+}
+
+// 128
+TEST(CookBatch_OneSetupAndOneWaitWithoutVolumeLimit) {
+    Ingredient beef = makeIngredient("beef", 5000.0);
+    Pan pan("pan");
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("beef", &beef);
+    k.add("pan", &pan);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString("recipe Steak\n"
+                    "    lease pan\n    lease stove\n    acquire\n"
+                    "    reserve beef 180\n    take\n"
+                    "    burner_on stove\n    heat pan\n"
+                    "    hold timer 480\n    commit\n"
+                    "    cool pan\n    burner_off stove\n"
+                    "end\n");
+
+    Cook ck("cook");
+    BatchResult r = ck.cookBatch(book, 0, 20);
+    CHECK_EQUAL(1, r.passes);
+    CHECK_EQUAL(480, r.totalSeconds);
+    CHECK_EQUAL(480, r.readySeconds[19]);
+    CHECK_CLOSE(5000.0 - 20 * 180.0, beef.getGrams(), 1e-9);
+    CHECK_EQUAL(4, stove.freeBurners());
+}
+
+// 129
+TEST(CookBatch_ShortageForWholeBatchTakesNothing) {
+    Ingredient pasta = makeIngredient("pasta", 450.0);
+    Ingredient sauce = makeIngredient("sauce", 1000.0);
+    Pot pot("pot", 10.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+
+    Cook ck("cook");
+    CHECK_THROW(ck.cookBatch(book, 0, 5), NotEnoughIngredientException);
+    CHECK_CLOSE(450.0, pasta.getGrams(), 1e-9);
+    CHECK_CLOSE(1000.0, sauce.getGrams(), 1e-9);
+    CHECK_EQUAL(0, ck.cookBatch(book, 0, 0).portions);
+}
+
+// ---------------------------------------------------------
+// EVENT LOG (130–132)
+// ---------------------------------------------------------
+
+static const char* const TEST_SAUCE_RECIPE = R"(
+recipe Sauce
+    lease mixer
+    lease stove
+    acquire
+    plug mixer
+    reserve base 50
+    take
+    say | Смешиваем...
+    mix mixer
+    burner_on stove
+    hold timer 240
+    say | Прошло %m мин
+    commit
+    burner_off stove
+    say | Готово!
+end
+)";
+
+// 130
+TEST(EventLog_RenderMatchesDirectOutput) {
+    Ingredient base = makeIngredient("base", 500.0);
+    Mixer mixer("mixer");
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("base", &base);
+    k.add("mixer", &mixer);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_SAUCE_RECIPE);
+    Cook ck("cook");
+
+    ostringstream direct;
+    streambuf* old = cout.rdbuf(direct.rdbuf());
+    ck.cookRecipe(book, 0);
+    cout.rdbuf(old);
+
+    ostringstream binary;
+    ostringstream quiet;
+    {
+        RingBufferSink sink(&binary, 64);
+        ck.setSink(&sink);
+        old = cout.rdbuf(quiet.rdbuf());
+        ck.cookRecipe(book, 0);
+        cout.rdbuf(old);
+        sink.flush();
+        CHECK_EQUAL(0LL, sink.getDropped());
+        CHECK_EQUAL(sink.getRecorded(), sink.getWritten());
+    }
+    ck.setSink(nullptr);
+    CHECK(quiet.str().empty());
+
+    istringstream in(binary.str());
+    ostringstream rendered;
+    CHECK(EventLog::render(in, rendered, &book) > 0);
+    CHECK_EQUAL(direct.str(), rendered.str());
+    CHECK_CLOSE(400.0, base.getGrams(), 1e-9);
+}
+
+// 131
+TEST(EventLog_NullSinkSilencesRecipe) {
+    Ingredient base = makeIngredient("base", 500.0);
+    Mixer mixer("mixer");
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("base", &base);
+    k.add("mixer", &mixer);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_SAUCE_RECIPE);
+    NullSink none;
+    Cook ck("cook");
+    ck.setSink(&none);
+
+    ostringstream out;
+    streambuf* old = cout.rdbuf(out.rdbuf());
+    ck.cookRecipe(book, 0);
+    mixer.unplug();   // вне рецепта журнал не подключён
+    cout.rdbuf(old);
+
+    CHECK_EQUAL(string("Миксер выключен из сети.\n"), out.str());
+    CHECK_EQUAL(240, ck.getClock().now());
+}
+
+// 132
+TEST(RingBufferSink_CountsAndBinaryLayout) {
+    CHECK_EQUAL(24u, sizeof(KitchenEvent));
+    ostringstream binary;
+    {
+        RingBufferSink sink(&binary, 1024);
+        for (int i = 0; i < 500; ++i) {
+            sink.record(KitchenEvent{i, 1.5, 7, static_cast<unsigned short>(i), EventKind::WaitDone, 0});
+        }
+        sink.flush();
+        CHECK_EQUAL(500LL, sink.getWritten());
+    }
+    CHECK_EQUAL(500u * sizeof(KitchenEvent), binary.str().size());
+    KitchenEvent last;
+    memcpy(&last, binary.str().data() + 499 * sizeof(KitchenEvent), sizeof(last));
+    CHECK_EQUAL(499LL, last.simTime);
+    CHECK_EQUAL(7u, last.dish);
+}
+
+// ---------------------------------------------------------
+// STATUS API (133–136)
+// ---------------------------------------------------------
+
+// 133
+TEST(TryCookRecipe_ReportsShortageWithoutThrow) {
+    Ingredient pasta = makeIngredient("pasta", 300.0);
+    Ingredient sauce = makeIngredient("sauce", 10.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+
+    Cook ck("cook");
+    NullSink none;
+    ck.setSink(&none);
+    CookStatus st = ck.tryCookRecipe(book, 0);
+    CHECK(!st.ok());
+    CHECK(st.error == KitchenError::NotEnoughIngredient);
+    CHECK(st.kind == ResourceKind::Ingredient);
+    ResourceKind kind;
+    unsigned short sauceId = 0;
+    CHECK(k.find("sauce", kind, sauceId));
+    CHECK_EQUAL(sauceId, st.culprit);
+    CHECK_EQUAL(6, st.step);   // шаг take
+    CHECK_CLOSE(300.0, pasta.getGrams(), 1e-9);
+    CHECK(!pot.isBusy());
+    CHECK_EQUAL(16u, sizeof(CookStatus));
+}
+
+// 134
+TEST(TryCookRecipe_ReportsDirtyToolAndOvercook) {
+    Ingredient base = makeIngredient("base", 500.0);
+    Pan pan("pan");
+    Timer t;
+    RecipeKitchen k;
+    k.add("base", &base);
+    k.add("pan", &pan);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString("recipe A\n    use pan\nend\n"
+                    "recipe B\n    hold timer 600\n    overcooked 5 | Сгорело\nend\n");
+    unsigned short panId = 0;
+    ResourceKind kind;
+    k.find("pan", kind, panId);
+
+    Cook ck("cook");
+    NullSink none;
+    ck.setSink(&none);
+    pan.breakTool();
+    CookStatus st = ck.tryCookRecipe(book, 0);
+    CHECK(st.error == KitchenError::ToolNotAvailable);
+    CHECK(st.kind == ResourceKind::Pan);
+    CHECK_EQUAL(panId, st.culprit);
+
+    st = ck.tryCookRecipe(book, 1);
+    CHECK(st.error == KitchenError::Overcooked);
+    CHECK_EQUAL(CookStatus::NO_CULPRIT, st.culprit);
+    CHECK_EQUAL(string("Сгорело"), string(st.message));
+    CHECK_THROW(st.throwIfFailed(), OvercookedDishException);
+    CHECK_THROW(ck.cookRecipe(book, 1), OvercookedDishException);
+}
+
+// 135
+TEST(TryCookBatch_PotTooSmallIsStatus) {
+    Ingredient pasta = makeIngredient("pasta", 300.0);
+    Ingredient sauce = makeIngredient("sauce", 300.0);
+    Pot pot("pot", 1.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+
+    Cook ck("cook");
+    BatchResult res{0, 0, 0, {}};
+    CookStatus st = ck.tryCookBatch(book, 0, 3, res);
+    CHECK(st.error == KitchenError::NotEnoughIngredient);
+    CHECK(st.kind == ResourceKind::Pot);
+    CHECK_EQUAL(0, res.portions);
+    CHECK_EQUAL(0, ck.getClock().now());
+    CHECK_THROW(ck.cookBatch(book, 0, 3), NotEnoughIngredientException);
+}
+
+// 136
+TEST(TryCookWith_LegacyDishMapsException) {
+    Ingredient veg = makeIngredient("veg", 1.0);
+    Ingredient oil = makeIngredient("oil", 100.0);
+    Knife knife("knife");
+    CuttingBoard board("board");
+    Cook ck("cook");
+    SaladDish salad("Salad", &veg, &oil, &knife, &board, &ck);
+
+    ostringstream out;
+    streambuf* old = cout.rdbuf(out.rdbuf());
+    CookStatus st = salad.tryCookWith(&ck);
+    cout.rdbuf(old);
+    CHECK(st.error == KitchenError::NotEnoughIngredient);
+    CHECK_EQUAL(CookStatus::NO_CULPRIT, st.culprit);
+}
+
+// ---------------------------------------------------------
+// ORDER STREAM (137–139)
+// ---------------------------------------------------------
+
+// 137
+TEST(OrderStream_ParsesAndValidates) {
+    Ingredient pasta = makeIngredient("pasta", 10000.0);
+    Ingredient sauce = makeIngredient("sauce", 10000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+    RecipeDish dish(&book, 0, nullptr);
+    Menu menu;
+    menu.addDish(&dish);
+
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+    OrderStream stream(menu, engine);
+    const char text[] = "# заказы\n1, 1x3\n2 abc 1*0\n1;0\n1\n";
+    OrderStreamReport r = stream.run(text, sizeof(text) - 1);
+
+    CHECK_EQUAL(8u, r.orders.size());
+    CHECK_EQUAL(5LL, r.done);
+    CHECK_EQUAL(0LL, r.failed);
+    CHECK_EQUAL(3LL, r.rejected);
+    CHECK(r.orders[4].reject == OrderReject::NoSuchDish);
+    CHECK_EQUAL(3u, r.orders[4].line);
+    CHECK(r.orders[5].reject == OrderReject::Syntax);
+    CHECK(r.orders[6].reject == OrderReject::BadCount);
+    CHECK_EQUAL(4u, r.orders[7].line);
+    CHECK_EQUAL(600LL, r.orders[7].simSeconds);
+    CHECK_CLOSE(9500.0, pasta.getGrams(), 1e-6);
+}
+
+// 138
+TEST(OrderStream_TokenAcrossChunkBoundary) {
+    Ingredient pasta = makeIngredient("pasta", 10000.0);
+    Ingredient sauce = makeIngredient("sauce", 10000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+    RecipeDish dish(&book, 0, nullptr);
+    Menu menu;
+    menu.addDish(&dish);
+
+    KitchenEngine engine(1);
+    NullSink none;
+    engine.setSink(&none);
+    OrderStream stream(menu, engine);
+    string text(OrderStream::CHUNK - 2, ' ');
+    text += "1x2\n";
+    istringstream in(text);
+    OrderStreamReport r = stream.run(in);
+    CHECK_EQUAL(2u, r.orders.size());
+    CHECK_EQUAL(2LL, r.done);
+}
+
+// 139
+TEST(OrderStream_ReportsCookingFailures) {
+    Ingredient pasta = makeIngredient("pasta", 150.0);
+    Ingredient sauce = makeIngredient("sauce", 1000.0);
+    Pot pot("pot", 3.0, true, false);
+    Stove stove;
+    Timer t;
+    RecipeKitchen k;
+    k.add("pasta", &pasta);
+    k.add("sauce", &sauce);
+    k.add("pot", &pot);
+    k.add("stove", &stove);
+    k.add("timer", &t);
+    RecipeBook book(&k);
+    book.loadString(TEST_PASTA_RECIPE);
+    RecipeDish dish(&book, 0, nullptr);
+    Menu menu;
+    menu.addDish(&dish);
+
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+    OrderStream stream(menu, engine);
+    OrderStreamReport r = stream.run("1x3", 3);
+    CHECK_EQUAL(1LL, r.done);
+    CHECK_EQUAL(2LL, r.failed);
+
+    ostringstream out;
+    OrderStream::writeSummary(r, out);
+    CHECK(out.str().find("not_enough_ingredient") != string::npos);
+    CHECK(out.str().find("Итого: приготовлено 1, не удалось 2, отклонено 0") != string::npos);
+}
+
+
+// ---------------------------------------------------------
+// KITCHEN WORLD (140–142)
+// ---------------------------------------------------------
+
+static const char* const TEST_WORLD = R"(
+unit g 1 | г
+ingredient pasta 1000 g 340 | Паста     # без perishable
+ingredient sauce 500 g 80 perishable
+pot   pot 3
+stove stove 2
+timer timer
+cook  chef | Повар
+)";
+
+// 140
+TEST(KitchenWorld_BuildsFromConfig) {
+    KitchenWorld w;
+    w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    CHECK_EQUAL(8, static_cast<int>(w.size()));
+    CHECK_EQUAL(1, w.dishCount());
+    CHECK(w.arenaUsed() <= w.arenaCapacity());
+
+    WorldHandle h = w.find("pasta");
+    CHECK(h != KitchenWorld::NO_HANDLE);
+    CHECK(w.kindOf(h) == WorldEntity::Ingredient);
+    CHECK(strcmp(w.ingredient(h)->getName(), "Паста") == 0);
+    CHECK_CLOSE(1000.0, w.ingredient(h)->getGrams(), 1e-9);
+    CHECK(!w.ingredient(h)->isPerishable());
+    CHECK(w.ingredient(w.find("sauce"))->isPerishable());
+    CHECK(w.tool(h) == nullptr);
+    CHECK(w.tool(w.find("pot")) != nullptr);
+    CHECK(w.getCook() == w.cook(w.find("chef")));
+    CHECK(w.find("nothing") == KitchenWorld::NO_HANDLE);
+
+    CHECK(w.dishAt(0) == w.dish(w.find("Pasta")));
+    CHECK(w.dishAt(0)->tryCookWith(w.getCook()).ok());
+    CHECK_CLOSE(900.0, w.ingredient(h)->getGrams(), 1e-9);
+}
+
+// 141
+TEST(KitchenWorld_RebuildReusesArena) {
+    KitchenWorld w;
+    w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    WorldHandle old = w.find("pasta");
+    size_t capacity = w.arenaCapacity();
+    const void* first = w.ingredient(old);
+
+    for (int i = 0; i < 100; ++i) {
+        w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    }
+    CHECK_EQUAL(capacity, w.arenaCapacity());
+    CHECK(w.ingredient(w.find("pasta")) == first);
+
+    // Дескриптор прежней сборки недействителен.
+    CHECK(w.ingredient(old) == nullptr);
+    CHECK_THROW(w.kindOf(old), StorageException);
+
+    w.teardown();
+    CHECK_EQUAL(0, static_cast<int>(w.size()));
+    CHECK_EQUAL(0, static_cast<int>(w.arenaUsed()));
+    CHECK_EQUAL(capacity, w.arenaCapacity());
+}
+
+// 142
+TEST(KitchenWorld_RejectsBadConfig) {
+    KitchenWorld w;
+    CHECK_THROW(w.build("ingredient rice 100 kg\n"), RecipeFormatException);
+    CHECK_THROW(w.build("unit g 1\nunit g 2\n"), RecipeFormatException);
+    CHECK_THROW(w.build("spoon s\n"), RecipeFormatException);
+    CHECK_THROW(w.build("pan p wide\n"), RecipeFormatException);
+    CHECK_EQUAL(0, static_cast<int>(w.size()));
+
+    try {
+        w.build("unit g 1\n\nknife k extra\n");
+        CHECK(false);
+    } catch (const RecipeFormatException& e) {
+        CHECK(strstr(e.what(), "строка 3") != nullptr);
+    }
+
+    // Рецепт ссылается на ресурс, которого нет в описании, — мир пуст.
+    CHECK_THROW(w.build(TEST_WORLD, "recipe R\n    lease oven\nend\n"), RecipeFormatException);
+    CHECK_EQUAL(0, static_cast<int>(w.size()));
+}
+
+
+// ---------------------------------------------------------
+// TOOL REGISTRY (143–145)
+// ---------------------------------------------------------
+
+// 143
+TEST(ToolRegistry_ToolBecomesView) {
+    KitchenTool t("t", false, true, 2);
+    {
+        ToolRegistry reg(10);
+        CHECK_EQUAL(64, static_cast<int>(reg.capacity()));
+        unsigned slot = reg.attach(&t, ResourceKind::Tool);
+        CHECK(t.getRegistry() == &reg);
+        CHECK(reg.toolAt(slot) == &t);
+        CHECK(!t.isAvailable());
+        CHECK_THROW(reg.attach(&t, ResourceKind::Tool), StorageException);
+
+        t.cleanTool();
+        CHECK(reg.isClean(slot));
+        t.useTool();
+        CHECK_EQUAL(1, reg.durabilityOf(slot));
+        CHECK(t.tryLease());
+        CHECK(!t.tryLease());
+        t.releaseLease();
+    }
+    // Реестр разрушен — состояние вернулось в объект.
+    CHECK(t.getRegistry() == nullptr);
+    CHECK(t.isClean());
+    CHECK_EQUAL(1, t.getDurability());
+    CHECK(!t.isBusy());
+}
+
+// 144
+TEST(ToolRegistry_FindsMatchingTools) {
+    ToolRegistry reg(200);
+    vector<unique_ptr<Pan>> pans;
+    Pot pot("pot");
+    reg.attach(&pot, ResourceKind::Pot);
+    for (int i = 0; i < 150; ++i) {
+        pans.emplace_back(new Pan("pan"));
+        reg.attach(pans.back().get(), ResourceKind::Pan);
+    }
+    CHECK_EQUAL(151, static_cast<int>(reg.countMatching(ToolQuery::any())));
+    CHECK_EQUAL(150, static_cast<int>(reg.countMatching(ToolQuery::of(ResourceKind::Pan))));
+    CHECK(reg.findFirst(ToolQuery::of(ResourceKind::Pot)) == &pot);
+    CHECK(reg.findFirst(ToolQuery::of(ResourceKind::Knife)) == nullptr);
+
+    // Прочность выше 100 только у одной сковороды за вторым словом.
+    for (int i = 0; i < 130; ++i) pans[static_cast<size_t>(i)]->tryLease();
+    CHECK_EQUAL(20, static_cast<int>(reg.countMatching(ToolQuery::of(ResourceKind::Pan))));
+    pans[140]->useTool();
+    CHECK(reg.findFirst(ToolQuery::of(ResourceKind::Pan, 100)) == pans[130].get());
+    vector<KitchenTool*> worn;
+    ToolQuery q = ToolQuery::of(ResourceKind::Pan, 100);
+    q.onlyFree = false;
+    CHECK_EQUAL(149, static_cast<int>(reg.collect(q, worn)));
+
+    pans.pop_back();   // разрушенный инструмент освобождает слот
+    CHECK_EQUAL(150, static_cast<int>(reg.size()));
+}
+
+// 145
+TEST(ToolRegistry_BulkCleanAndWear) {
+    ToolRegistry reg(4);
+    KitchenTool a("a", false, true, 3);
+    KitchenTool b("b", false, true, 10);
+    reg.attach(&a, ResourceKind::Tool);
+    reg.attach(&b, ResourceKind::Tool);
+    CHECK_EQUAL(0, static_cast<int>(reg.countMatching(ToolQuery::any())));
+
+    reg.cleanAll();
+    CHECK_EQUAL(2, static_cast<int>(reg.wear(ToolQuery::any(), 5)));
+    CHECK_EQUAL(0, a.getDurability());
+    CHECK(!a.isAvailable());
+    CHECK_EQUAL(5, b.getDurability());
+    CHECK(b.isAvailable());
+
+    EquipmentLease lease;
+    lease.add(&b);
+    CHECK(lease.tryAcquire());
+    CHECK(b.isBusy());
+    CHECK(reg.findFirst(ToolQuery::any()) == nullptr);
+    lease.release();
+    CHECK(reg.findFirst(ToolQuery::any()) == &b);
+}
+
+
+// ---------------------------------------------------------
+// RECIPE SCHEDULER (146–148)
+// ---------------------------------------------------------
+
+static const char* const TEST_STAGE_WORLD = R"(
+unit g 1
+ingredient pasta 1000 g
+pot   pot 3
+pan   pan
+knife knife
+stove stove 4
+timer potTimer
+timer panTimer
+timer knifeTimer
+cook  chef
+)";
+
+// 146
+TEST(RecipePlan_CriticalPathAndOverlap) {
+    KitchenWorld w;
+    w.build(TEST_STAGE_WORLD, R"(
+recipe Staged
+    lease pot
+    lease stove
+    lease stove
+    acquire
+    reserve pasta 100
+    take
+    stage chop
+        use knife
+        hold knifeTimer 240
+    stage boil
+        burner_on stove
+        boil pot
+        hold potTimer 600
+    stage sauce after chop
+        burner_on stove
+        heat pan
+        hold panTimer 300
+    stage serve after boil sauce
+        say | Подаём
+    join
+    commit
+end
+)");
+    CHECK_EQUAL(4u, w.getBook().stageCount(0));
+    RecipePlan plan(w.getBook(), 0);
+    CHECK_EQUAL(600LL, plan.criticalPath());
+    CHECK_EQUAL(1140LL, plan.sequentialSeconds());
+    CHECK(plan.stages()[1].critical);
+    CHECK(!plan.stages()[2].critical);
+    CHECK_EQUAL(240LL, plan.stages()[2].earliestStart);
+
+    ScheduleReport r = w.getCook()->cookScheduled(w.getBook(), 0);
+    CHECK_EQUAL(600LL, r.predictedMakespan);
+    CHECK_EQUAL(600LL, r.actualMakespan);
+    CHECK_EQUAL(240LL, r.stages[2].start);
+    CHECK_EQUAL(600LL, r.stages[3].start);
+    CHECK_CLOSE(900.0, w.ingredient(w.find("pasta"))->getGrams(), 1e-9);
+}
+
+// 147
+TEST(RecipeScheduler_SerializesSharedEquipment) {
+    KitchenWorld w;
+    // Оба этапа греют одну сковороду, а конфорка арендована одна: этапы идут друг за другом.
+    w.build(TEST_STAGE_WORLD, R"(
+recipe Shared
+    lease stove
+    acquire
+    stage first
+        heat pan
+        hold panTimer 300
+        cool pan
+    stage second
+        heat pan
+        hold potTimer 200
+    stage burners
+        burner_on stove
+        hold knifeTimer 100
+    stage burners2
+        burner_on stove
+        hold knifeTimer 100
+end
+)");
+    ScheduleReport r = w.getCook()->cookScheduled(w.getBook(), 0);
+    CHECK_EQUAL(300LL, r.predictedMakespan);
+    CHECK_EQUAL(500LL, r.actualMakespan);
+    CHECK_EQUAL(300LL, r.stages[1].start);
+    CHECK(r.stages[3].start >= r.stages[2].finish);
+
+    // RecipeDish с этапами готовится по плану автоматически.
+    SimClock& clock = w.getCook()->getClock();
+    long long before = clock.now();
+    CHECK(w.dishAt(0)->tryCookWith(w.getCook()).ok());
+    CHECK_EQUAL(500LL, clock.now() - before);
+}
+
+// 148
+TEST(RecipeScheduler_FailuresAndFormat) {
+    KitchenWorld w;
+    w.build(TEST_STAGE_WORLD, R"(
+recipe Broken
+    stage ok
+        hold potTimer 100
+    stage bad
+        hold panTimer 50
+        undercooked 5 | Недоварено
+    join
+    say | не дойдём
+end
+)");
+    ScheduleReport r;
+    CookStatus st = w.getCook()->tryCookScheduled(w.getBook(), 0, r);
+    CHECK(st.error == KitchenError::Undercooked);
+    CHECK_EQUAL(4, static_cast<int>(st.step));
+    CHECK_EQUAL(w.getCook()->getClock().pending(), static_cast<size_t>(0));
+
+    RecipeBook& book = w.getBook();
+    CHECK_THROW(book.loadString("recipe A\n stage x after y\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n stage x\n stage x\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n join\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n stage x\n lease pot\nend\n"), RecipeFormatException);
+    CHECK_THROW(book.loadString("recipe A\n stage x\n join\n stage y\nend\n"), RecipeFormatException);
+    CHECK_EQUAL(1, book.size());
+}
+
+
+// ---------------------------------------------------------
+// CAPACITY PLANNER (149–151)
+// ---------------------------------------------------------
+
+static const char* const TEST_PLAN_WORLD = R"(
+unit g 1
+pot   pot 3
+pot   pot2 3
+pan   pan
+oven  oven
+stove stove 2
+timer t
+cook  chef
+)";
+
+static const char* const TEST_PLAN_RECIPES = R"(
+recipe Soup
+    lease pot
+    lease stove
+    acquire
+    hold t 600
+end
+recipe Roast
+    lease oven
+    acquire
+    hold t 1200
+end
+recipe Fry
+    lease pan
+    lease stove
+    acquire
+    hold t 300
+end
+)";
+
+// 149
+TEST(CapacityPlanner_DemandsAndCapacity) {
+    KitchenWorld w;
+    w.build(TEST_PLAN_WORLD, TEST_PLAN_RECIPES);
+    PlannerCapacity cap = PlannerCapacity::of(w.getBook().getKitchen(), 3);
+    CHECK_EQUAL(3, cap[PlanResource::Cook]);
+    CHECK_EQUAL(2, cap[PlanResource::Burner]);
+    CHECK_EQUAL(1, cap[PlanResource::Oven]);
+    CHECK_EQUAL(1, cap[PlanResource::Pan]);
+    CHECK_EQUAL(2, cap[PlanResource::Pot]);
+
+    CapacityPlanner planner(w.getBook(), cap);
+    const RecipeDemand& fry = planner.demandOf(2);
+    CHECK_EQUAL(300LL, fry.seconds);
+    CHECK_EQUAL(1, fry.units[static_cast<unsigned>(PlanResource::Pan)]);
+    CHECK_EQUAL(1, fry.units[static_cast<unsigned>(PlanResource::Burner)]);
+    CHECK_EQUAL(0, fry.units[static_cast<unsigned>(PlanResource::Oven)]);
+
+    Stove st(1);
+    CHECK(st.turnOnBurner());
+    CHECK(!st.turnOnBurner());
+    CHECK_EQUAL(1, st.getBurners());
+}
+
+// 150
+TEST(CapacityPlanner_EarliestDeadlineListScheduling) {
+    KitchenWorld w;
+    w.build(TEST_PLAN_WORLD, TEST_PLAN_RECIPES);
+    CapacityPlanner planner(w.getBook(), PlannerCapacity::of(w.getBook().getKitchen(), 3));
+    vector<PlanOrder> orders;
+    for (int i = 0; i < 6; ++i) orders.push_back(PlanOrder{i % 3, 0, 900 + i * 300});
+
+    CapacityPlan p = planner.plan(orders);
+    CHECK_EQUAL(0LL, p.orders[2].start);       // Fry занимает вторую конфорку сразу
+    CHECK_EQUAL(300LL, p.orders[3].start);     // второй Soup ждёт конфорку
+    CHECK_EQUAL(1200LL, p.orders[4].start);    // второй Roast ждёт духовку
+    CHECK(p.orders[4].late);
+    CHECK_EQUAL(1, p.missed);
+    CHECK_EQUAL(2400LL, p.makespan);
+    CHECK_EQUAL(1200LL, p[PlanResource::Oven].waitSeconds);
+    CHECK_EQUAL(2, p[PlanResource::Burner].peakInUse);
+    CHECK_CLOSE(1.0, p[PlanResource::Oven].utilization(p.makespan), 1e-9);
+
+    // Вторая духовка снимает опоздание, лишняя конфорка — нет.
+    CapacityPlan oven = planner.planWithExtra(orders, PlanResource::Oven, 1);
+    CHECK_EQUAL(0, oven.missed);
+    CHECK_EQUAL(1800LL, oven.makespan);
+    CapacityPlan burner = planner.planWithExtra(orders, PlanResource::Burner, 1);
+    CHECK_EQUAL(1, burner.missed);
+    CHECK_EQUAL(0LL, burner[PlanResource::Burner].waitSeconds);
+}
+
+// 151
+TEST(CapacityPlanner_InfeasibleAndReleases) {
+    KitchenWorld w;
+    w.build(TEST_PLAN_WORLD, TEST_PLAN_RECIPES);
+    PlannerCapacity cap = PlannerCapacity::of(w.getBook().getKitchen(), 1);
+    cap[PlanResource::Oven] = 0;
+    CapacityPlanner planner(w.getBook(), cap);
+
+    vector<PlanOrder> orders;
+    orders.push_back(PlanOrder{1, 0, 5000});    // духовки нет
+    orders.push_back(PlanOrder{7, 0, 5000});    // нет такого рецепта
+    orders.push_back(PlanOrder{0, 1000, 1700}); // поступает позже
+    orders.push_back(PlanOrder{2, 1000, 1400}); // срок раньше — идёт первым
+    CapacityPlan p = planner.plan(orders);
+    CHECK_EQUAL(2, p.infeasible);
+    CHECK(!p.orders[0].feasible);
+    CHECK_EQUAL(-1LL, p.orders[1].start);
+    CHECK_EQUAL(1000LL, p.orders[3].start);
+    CHECK_EQUAL(1300LL, p.orders[2].start);
+    CHECK_EQUAL(1900LL, p.makespan);
+    CHECK_EQUAL(1, p.missed);
+    CHECK_EQUAL(200LL, p.totalLateness);
+    CHECK(p.bottleneck() == PlanResource::Cook);
+    CHECK_CLOSE(2 * 3600.0 / 1900.0, p.ordersPerHour(), 1e-9);
+}
+
+
+// ---------------------------------------------------------
+// HEAT CURVES (152–154)
+// ---------------------------------------------------------
+
+// 152
+TEST(HeatCurve_ExponentialAndPiecewise) {
+    shared_ptr<const HeatCurve> e = HeatCurve::exponential(3.0);
+    CHECK_CLOSE(0.0, e->progress(0.0), 1e-12);
+    CHECK_CLOSE(1.0, e->progress(1.0), 1e-12);
+    double exact = (1.0 - exp(-1.5)) / (1.0 - exp(-3.0));
+    CHECK_CLOSE(exact, e->progress(0.5), 1e-3);
+    CHECK(e->progress(0.25) > 0.25); // быстрее линейного вначале
+    CHECK_CLOSE(0.5, e->timeFor(e->progress(0.5)), 1e-9);
+
+    // Половина нагрева за первую четверть времени, дальше медленно.
+    vector<pair<double, double>> pts;
+    pts.push_back(make_pair(0.25, 0.5));
+    shared_ptr<const HeatCurve> p = HeatCurve::piecewise(pts);
+    CHECK_CLOSE(0.5, p->progress(0.25), 1e-12);
+    CHECK_CLOSE(0.75, p->progress(0.625), 1e-12);
+    CHECK_CLOSE(0.125, p->timeFor(0.25), 1e-12);
+
+    CHECK_THROW(HeatCurve::exponential(0.0), InvalidTemperatureException);
+    pts.push_back(make_pair(0.5, 0.4));
+    CHECK_THROW(HeatCurve::piecewise(pts), InvalidTemperatureException);
+}
+
+// 153
+TEST(TemperatureProfile_CurveInverseIsExact) {
+    TemperatureProfile tp(20.0, 220.0, 600, true);
+    tp.setCurve(HeatCurve::exponential(4.0));
+    CHECK(tp.getCurve() != nullptr);
+    for (double temp = 25.0; temp <= 220.0; temp += 15.0) {
+        int s = tp.secondsToReach(temp);
+        CHECK(s >= 0);
+        CHECK(tp.currentTemp(s) >= temp);
+        CHECK(s == 0 || tp.currentTemp(s - 1) < temp);
+    }
+    tp.reset(20.0, 180.0, 300);
+    CHECK(tp.getCurve() != nullptr); // reset сохраняет кривую
+    CHECK_EQUAL(-1, tp.secondsToReach(200.0));
+}
+
+// 154
+TEST(Oven_StateAtMatchesTick) {
+    Oven ov(20.0);
+    ov.setHeatCurve(HeatCurve::exponential(2.5));
+    ov.preheat(200.0, 10);
+    ov.setTimerMinutes(30);
+
+    int reach = ov.secondsUntilTemperature(150.0);
+    OvenState at = ov.stateAt(reach);
+    CHECK(at.on);
+    CHECK(at.temperature >= 150.0);
+    CHECK(ov.stateAt(reach - 1).temperature < 150.0);
+    CHECK_EQUAL(1800 - reach, at.timerRemaining);
+    CHECK_CLOSE(20.0, ov.getTemperature(), 1e-12); // духовка не изменилась
+
+    OvenState off = ov.stateAt(ov.secondsUntilOff());
+    CHECK(!off.on);
+    CHECK_EQUAL(0, off.timerRemaining);
+
+    ov.tick(reach);
+    CHECK_CLOSE(at.temperature, ov.getTemperature(), 1e-12);
+    ov.tick(1800 - reach);
+    CHECK(!ov.isOn());
+    CHECK_CLOSE(off.temperature, ov.getTemperature(), 1e-12);
+}
+
+
+// ---------------------------------------------------------
+// TIMER BANK (155–157)
+// ---------------------------------------------------------
+
+// 155
+TEST(TimerBank_AttachedTimerIsAView) {
+    TimerBank bank(3);
+    CHECK_EQUAL(static_cast<size_t>(64), bank.capacity());
+    Timer t(10, true, 4, 1);
+    bank.attach(&t);
+    CHECK(t.getBank() == &bank);
+    CHECK_EQUAL(6, t.remaining());
+    t.tick(6);
+    CHECK(t.isFinished());
+    t.start(30);
+    CHECK_EQUAL(30, bank.remaining(0));
+    CHECK_THROW(bank.attach(&t), StorageException);
+
+    bank.tickAll(12);
+    bank.detach(&t);
+    CHECK(t.getBank() == nullptr);
+    CHECK_EQUAL(18, t.remaining());
+    CHECK_EQUAL(static_cast<size_t>(0), bank.size());
+
+    TimerBank small(1);
+    vector<unique_ptr<Timer>> many;
+    for (int i = 0; i < 64; ++i) {
+        many.emplace_back(new Timer());
+        small.attach(many.back().get());
+    }
+    Timer extra;
+    CHECK_THROW(small.attach(&extra), StorageException);
+}
+
+// 156
+TEST(TimerBank_TickAllReportsFinishedMask) {
+    const int count = 200;
+    TimerBank bank(count);
+    vector<unique_ptr<Timer>> timers;
+    for (int i = 0; i < count; ++i) {
+        timers.emplace_back(new Timer(0, false, 0, i));
+        bank.attach(timers.back().get());
+        if (i % 3 != 0) timers.back()->start(10 + i % 7); // каждый третий стоит
+    }
+    CHECK_EQUAL(10, bank.nextFinish());
+    size_t running = bank.runningCount();
+
+    size_t fired = bank.tickAll(bank.nextFinish());
+    vector<Timer*> done;
+    CHECK_EQUAL(fired, bank.collectFinished(done));
+    for (int i = 0; i < count; ++i) {
+        bool expect = i % 3 != 0 && i % 7 == 0;
+        bool inMask = (bank.finishedWord(static_cast<size_t>(i) / 64) >> (i % 64)) & 1;
+        CHECK_EQUAL(expect, inMask);
+        CHECK_EQUAL(expect, timers[static_cast<size_t>(i)]->isFinished());
+    }
+    CHECK_EQUAL(running - fired, bank.runningCount());
+    CHECK_EQUAL(1, bank.nextFinish());
+
+    bank.tickAll(1000);
+    CHECK_EQUAL(static_cast<size_t>(0), bank.runningCount());
+    CHECK_EQUAL(-1, bank.nextFinish());
+    CHECK_EQUAL(0, timers[1]->remaining());
+    bank.tickAll(0);
+    CHECK_EQUAL(static_cast<uint64_t>(0), bank.finishedWord(0));
+}
+
+// 157
+TEST(TimerBank_WorldTimersUseBank) {
+    KitchenWorld w;
+    w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    TimerBank& bank = w.getTimerBank();
+    CHECK(bank.size() > 0);
+    Timer* t = bank.timerAt(0);
+    CHECK(t != nullptr);
+    CHECK(t->getBank() == &bank);
+
+    // Часы продвигают таймер мира через банк.
+    SimClock clock;
+    t->start(90);
+    bool fired = false;
+    clock.onTimerFinished(t, [&] { fired = true; });
+    clock.run();
+    CHECK(fired);
+    CHECK_EQUAL(90LL, clock.now());
+    CHECK(t->isFinished());
+}
+
+
+// ---------------------------------------------------------
+// METRICS (158–160)
+// ---------------------------------------------------------
+
+// 158
+TEST(Metrics_HistogramBuckets) {
+    CHECK_EQUAL(5u, HistogramSnapshot::bucketOf(5));
+    CHECK_EQUAL(8u, HistogramSnapshot::bucketOf(8));
+    CHECK_EQUAL(HistogramSnapshot::bucketOf(1000), HistogramSnapshot::bucketOf(1023));
+    CHECK(HistogramSnapshot::bucketOf(1024) > HistogramSnapshot::bucketOf(1023));
+    CHECK_EQUAL(HistogramSnapshot::BUCKETS - 1, HistogramSnapshot::bucketOf(~uint64_t(0)));
+    for (unsigned b = 1; b < HistogramSnapshot::BUCKETS; ++b) {
+        CHECK_EQUAL(b, HistogramSnapshot::bucketOf(HistogramSnapshot::lowerBound(b)));
+        CHECK_EQUAL(b - 1, HistogramSnapshot::bucketOf(HistogramSnapshot::lowerBound(b) - 1));
+    }
+
+    HistogramSnapshot h{};
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        h.buckets[HistogramSnapshot::bucketOf(v)]++;
+        h.count++;
+        h.sum += v;
+        h.max = v;
+    }
+    CHECK_CLOSE(500.5, h.mean(), 1e-9);
+    uint64_t p50 = h.percentile(0.5);
+    CHECK(p50 >= 500 && p50 <= 500 * 9 / 8 + 1);   // погрешность корзины — не больше 1/8
+    CHECK_EQUAL(static_cast<uint64_t>(1000), h.percentile(1.0));
+    CHECK_EQUAL(static_cast<uint64_t>(1), h.percentile(0.0));
+}
+
+// 159
+TEST(Metrics_CountsDishesAndFailures) {
+    KitchenWorld w;
+    w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    Cook& ck = *w.getCook();
+    NullSink quiet;
+    ck.setSink(&quiet);
+
+    Metrics::reset();
+    for (int i = 0; i < 10; ++i) CHECK(ck.tryCookRecipe(w.getBook(), 0).ok());
+    CookStatus st = ck.tryCookRecipe(w.getBook(), 0);    // пасты больше нет
+    CHECK(st.error == KitchenError::NotEnoughIngredient);
+
+    MetricsSnapshot m = Metrics::snapshot();
+#if KITCHEN_METRICS
+    CHECK_EQUAL(static_cast<uint64_t>(10), m[MetricCounter::DishesCooked]);
+    CHECK_EQUAL(static_cast<uint64_t>(1), m[MetricCounter::DishesFailed]);
+    CHECK_EQUAL(static_cast<uint64_t>(1), m.errors[static_cast<unsigned>(KitchenError::NotEnoughIngredient)]);
+    CHECK(m[MetricCounter::StockOuts] >= 1);
+    CHECK(m[MetricCounter::StepsRun] > 100);
+    CHECK_EQUAL(static_cast<uint64_t>(11), m.recipes[0].count);
+    CHECK_EQUAL(static_cast<uint64_t>(0), m.steps[static_cast<unsigned>(RecipeOp::Hold)].count);
+#endif
+
+    // Счётчики разных потоков складываются в снимке.
+    Metrics::reset();
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) Metrics::count(MetricCounter::ToolFailures);
+        });
+    }
+    for (thread& th : threads) th.join();
+    Knife broken;
+    broken.breakTool();
+    CHECK(!broken.tryUse());
+#if KITCHEN_METRICS
+    CHECK_EQUAL(static_cast<uint64_t>(4001), Metrics::snapshot()[MetricCounter::ToolFailures]);
+#endif
+}
+
+// 160
+TEST(Metrics_StepTimingAndExport) {
+    KitchenWorld w;
+    w.build(TEST_WORLD, TEST_PASTA_RECIPE);
+    Cook& ck = *w.getCook();
+    NullSink quiet;
+    ck.setSink(&quiet);
+
+    Metrics::reset();
+    Metrics::setStepTiming(true);
+    CHECK(ck.tryCookRecipe(w.getBook(), 0).ok());
+    Metrics::setStepTiming(false);
+    CHECK(ck.tryCookRecipe(w.getBook(), 0).ok());
+
+    MetricsSnapshot m = Metrics::snapshot();
+    ostringstream text;
+    Metrics::writeText(m, text, &w.getBook());
+    CHECK(text.str().find("kitchen_dishes_cooked") != string::npos);
+#if KITCHEN_METRICS
+    CHECK_EQUAL(static_cast<uint64_t>(1), m.steps[static_cast<unsigned>(RecipeOp::Hold)].count);
+    CHECK_EQUAL(static_cast<uint64_t>(1), m.steps[static_cast<unsigned>(RecipeOp::Reserve)].count / 2);
+    CHECK(text.str().find("kitchen_dishes_cooked 2") != string::npos);
+    CHECK(text.str().find("recipe=\"Pasta\"") != string::npos);
+    CHECK(text.str().find("op=\"hold\"") != string::npos);
+#endif
+    CHECK(strcmp("hold", recipeOpName(RecipeOp::Hold)) == 0);
+    CHECK(strcmp("join", recipeOpName(RecipeOp::Join)) == 0);
+}
+
+
+// ---------------------------------------------------------
+// STATIC UNITS (161–162)
+// ---------------------------------------------------------
+
+// 161
+TEST(Amount_ConversionsFoldAtCompileTime) {
+    static_assert(Grams(150).milligrams() == 150000);
+    static_assert(Kilograms(1.5).milligrams() == 1500000);
+    static_assert(Grams(Kilograms(2)).count() == 2000.0);
+    static_assert(Liters(Milliliters(250)).count() == 0.25);
+    static_assert(Pieces<50>(3).toGrams() == 150.0);
+    static_assert(Grams(0.0004).milligrams() == 0 && Grams(0.0005).milligrams() == 1);
+    static_assert(!is_convertible_v<Milliliters, Grams>);  // объём в массу — только через toGrams()
+    static_assert(!is_convertible_v<double, Grams>);
+
+    for (double g : {0.0, 0.4, 0.5, 1.25, 99.9995, 123456.789}) {
+        CHECK_EQUAL(Ingredient::toMilligrams(g), Grams(g).milligrams());
+    }
+    CHECK_CLOSE(0.2, Kilograms(Grams(200)).count(), 1e-12);
+    CHECK(Grams(100) + Grams(50) == Grams(150));
+    CHECK(Grams(100) * 0.5 < Grams(60));
+
+    Quantity q = Milliliters(200).toQuantity();
+    CHECK(q.hasUnit());
+    CHECK_CLOSE(200.0, q.toGrams(), 1e-9);
+    CHECK(&units::unitOf<units::Milliliter>() == &units::unitOf<units::Milliliter>());
+    CHECK(units::unitOf<units::Milliliter>().isLiquid());
+    CHECK(!units::unitOf<units::Gram>().isLiquid());
+}
+
+// 162
+TEST(Amount_IngredientAndReservation) {
+    Ingredient flour("flour", Kilograms(1), 0.0, false);
+    CHECK_EQUAL(1000000LL, flour.getMilligrams());
+
+    flour.useAmount(Grams(250));
+    CHECK_CLOSE(750.0, flour.getAmount<units::Gram>().count(), 1e-9);
+    CHECK_CLOSE(0.75, flour.getAmount<units::Kilogram>().count(), 1e-12);
+    flour.addAmount(Kilograms(0.25));
+    CHECK_EQUAL(1000000LL, flour.getMilligrams());
+
+    CHECK(!flour.tryReserve(Kilograms(2)));
+    CHECK_THROW(flour.useAmount(Grams(1000.001)), NotEnoughIngredientException);
+    CHECK_EQUAL(1000000LL, flour.getMilligrams());
+
+    // Ингредиент без единицы: старый путь бросает, типизированный считает в миллиграммах.
+    Ingredient bare("bare", Quantity(0.0, nullptr), 0.0, false);
+    CHECK_THROW(bare.addAmount(10.0), StorageException);
+    bare.addAmount(Grams(10));
+    CHECK_EQUAL(10000LL, bare.getMilligrams());
+
+    Ingredient eggs("eggs", Pieces<50>(4), 0.0, true);
+    {
+        StockReservation r;
+        r.add(&flour, Grams(300)).add(&eggs, Pieces<50>(2));
+        CHECK(r.tryReserve());
+        CHECK_EQUAL(700000LL, flour.getMilligrams());
+        CHECK_CLOSE(2.0, eggs.getAmount<units::Piece<50>>().count(), 1e-12);
+    }
+    CHECK_EQUAL(1000000LL, flour.getMilligrams());  // не подтверждён — вернулся в запас
+    CHECK_EQUAL(200000LL, eggs.getMilligrams());
+}
+
+
+// ---------------------------------------------------------
+// WORLD SNAPSHOTS (163–165)
+// ---------------------------------------------------------
+
+static const char* const TEST_SNAPSHOT_WORLD = R"(
+unit g 1
+ingredient pasta 1000 g 340
+ingredient sauce 500 g 80 perishable
+knife knife
+pot   pot 3
+oven  oven
+stove stove 2
+timer timer
+cook  chef
+)";
+
+/// Меняет состояние мира: две порции пасты, сломанный нож, разогретая духовка, идущий таймер.
+static void useSnapshotWorld(KitchenWorld& w) {
+    NullSink quiet;
+    w.getCook()->setSink(&quiet);
+    w.getCook()->cookRecipe(w.getBook(), 0);
+    w.getCook()->cookRecipe(w.getBook(), 0);
+    w.tool(w.find("knife"))->breakTool();
+    Oven* o = w.oven(w.find("oven"));
+    o->preheat(180.0, 10);
+    o->tick(300);
+    w.timer(w.find("timer"))->start(90);
+    w.timer(w.find("timer"))->tick(30);
+    w.getCook()->setSink(nullptr);
+}
+
+// 163
+TEST(WorldSnapshot_CaptureApplyRoundTrip) {
+    KitchenWorld a;
+    a.build(TEST_SNAPSHOT_WORLD, TEST_PASTA_RECIPE);
+    useSnapshotWorld(a);
+    vector<unsigned char> image = WorldSnapshot::capture(a, 7);
+    CHECK_EQUAL(sizeof(SnapshotHeader) + 2 * sizeof(IngredientRecord) + 2 * sizeof(ToolRecord)
+                + sizeof(OvenRecord) + sizeof(StoveRecord) + sizeof(TimerRecord), image.size());
+
+    KitchenWorld b;
+    b.build(TEST_SNAPSHOT_WORLD, nullptr);   // другая книга рецептов — тот же отпечаток
+    CHECK_EQUAL(WorldSnapshot::fingerprint(a), WorldSnapshot::fingerprint(b));
+    CHECK_EQUAL(static_cast<uint64_t>(7), WorldSnapshot::apply(b, image.data(), image.size()));
+
+    CHECK_EQUAL(800000LL, b.ingredient(b.find("pasta"))->getMilligrams());
+    CHECK_EQUAL(400000LL, b.ingredient(b.find("sauce"))->getMilligrams());
+    CHECK(!b.tool(b.find("knife"))->isAvailable());
+    CHECK_EQUAL(a.tool(a.find("pot"))->getDurability(), b.tool(b.find("pot"))->getDurability());
+    Oven* oa = a.oven(a.find("oven"));
+    Oven* ob = b.oven(b.find("oven"));
+    CHECK_CLOSE(oa->getTemperature(), ob->getTemperature(), 1e-9);
+    oa->tick(300);
+    ob->tick(300);                           // профиль нагрева тоже восстановлен
+    CHECK_CLOSE(oa->getTemperature(), ob->getTemperature(), 1e-9);
+    CHECK_EQUAL(60, b.timer(b.find("timer"))->remaining());
+    CHECK(!b.timer(b.find("timer"))->isFinished());
+
+    // Снимок восстановленного мира совпадает с исходным побайтно.
+    CHECK(WorldSnapshot::capture(a, 7) == WorldSnapshot::capture(b, 7));
+
+    KitchenWorld other;
+    other.build(TEST_WORLD, nullptr);
+    CHECK_THROW(WorldSnapshot::apply(other, image.data(), image.size()), StorageException);
+    image[sizeof(SnapshotHeader)] ^= 1;
+    CHECK_THROW(WorldSnapshot::apply(b, image.data(), image.size()), StorageException);
+    CHECK_THROW(WorldSnapshot::apply(b, image.data(), image.size() - 1), StorageException);
+}
+
+// 164
+TEST(WorldSnapshot_DeltaFramesReplay) {
+    KitchenWorld w;
+    w.build(TEST_SNAPSHOT_WORLD, TEST_PASTA_RECIPE);
+    vector<unsigned char> base = WorldSnapshot::capture(w, 1);
+    CHECK(WorldSnapshot::diff(base, WorldSnapshot::capture(w, 2), 1).empty());
+
+    w.ingredient(w.find("pasta"))->useAmount(Grams(100));
+    vector<unsigned char> next = WorldSnapshot::capture(w, 2);
+    vector<unsigned char> frame = WorldSnapshot::diff(base, next, 1);
+    CHECK_EQUAL(sizeof(DeltaFrame) + sizeof(DeltaRecord), frame.size());
+
+    w.tool(w.find("knife"))->breakTool();
+    w.timer(w.find("timer"))->start(60);
+    vector<unsigned char> last = WorldSnapshot::capture(w, 3);
+    vector<unsigned char> frame2 = WorldSnapshot::diff(next, last, 1);
+    CHECK_EQUAL(sizeof(DeltaFrame) + 2 * sizeof(DeltaRecord), frame2.size());
+
+    vector<unsigned char> stale = WorldSnapshot::diff(base, last, 99);   // от другого полного снимка
+    vector<unsigned char> log(stale);
+    log.insert(log.end(), frame.begin(), frame.end());
+    log.insert(log.end(), frame2.begin(), frame2.end());
+
+    vector<unsigned char> image(base);
+    CHECK_EQUAL(2u, WorldSnapshot::replay(image.data(), image.size(), log.data(), log.size()));
+    CHECK(image == last);
+
+    // Оборванный последний кадр отбрасывается, предыдущие применяются.
+    vector<unsigned char> torn(base);
+    CHECK_EQUAL(1u, WorldSnapshot::replay(torn.data(), torn.size(), log.data(), log.size() - 1));
+    CHECK(torn == next);
+}
+
+// 165
+TEST(WorldSnapshot_CheckpointWriterWarmStart) {
+    const char* path = "kitchen_snapshot_test.bin";
+    remove(path);
+    remove("kitchen_snapshot_test.bin.delta");
+
+    KitchenWorld fresh;
+    fresh.build(TEST_SNAPSHOT_WORLD, nullptr);
+    CHECK(!WorldSnapshot::load(fresh, path));
+
+    KitchenWorld w;
+    w.build(TEST_SNAPSHOT_WORLD, TEST_PASTA_RECIPE);
+    Ingredient* pasta = w.ingredient(w.find("pasta"));
+    uint64_t firstRun = 0;
+    {
+        CheckpointWriter cp(path, 2);
+        cp.submit(WorldSnapshot::capture(w));
+        CHECK(cp.flush());
+        CHECK_EQUAL(1u, cp.snapshotsWritten());
+        for (int i = 0; i < 3; ++i) {
+            pasta->useAmount(Grams(100));
+            cp.submit(WorldSnapshot::capture(w));
+            CHECK(cp.flush());
+        }
+        CHECK_EQUAL(2u, cp.deltasWritten());
+        CHECK_EQUAL(2u, cp.snapshotsWritten());   // третий кадр свернулся в полный снимок
+        pasta->useAmount(Grams(50));
+        w.tool(w.find("knife"))->breakTool();
+        firstRun = WorldSnapshot::lastSequence(path);
+        cp.submit(WorldSnapshot::capture(w));      // дописывается деструктором
+    }
+    CHECK(WorldSnapshot::lastSequence(path) > firstRun);
+
+    CHECK(WorldSnapshot::load(fresh, path));
+    CHECK_EQUAL(650000LL, fresh.ingredient(fresh.find("pasta"))->getMilligrams());
+    CHECK(!fresh.tool(fresh.find("knife"))->isAvailable());
+
+    // Новый процесс продолжает нумерацию: старый журнал к его снимку не применяется.
+    {
+        CheckpointWriter cp(path, 2);
+        pasta->restore(50000);
+        cp.submit(WorldSnapshot::capture(w));
+    }
+    KitchenWorld again;
+    again.build(TEST_SNAPSHOT_WORLD, nullptr);
+    CHECK(WorldSnapshot::load(again, path));
+    CHECK_EQUAL(700000LL, again.ingredient(again.find("pasta"))->getMilligrams());
+
+    // Оборванный хвост журнала: вместо кадра за ним пишется полный снимок.
+    {
+        CheckpointWriter cp(path, 64);
+        cp.submit(WorldSnapshot::capture(w));
+        CHECK(cp.flush());
+        pasta->useAmount(Grams(100));
+        cp.submit(WorldSnapshot::capture(w));
+        CHECK(cp.flush());
+        CHECK_EQUAL(1u, cp.deltasWritten());
+
+        FILE* f = fopen("kitchen_snapshot_test.bin.delta", "ab");
+        CHECK(f != nullptr);
+        if (f) {
+            fputs("torn", f);
+            fclose(f);
+        }
+        pasta->useAmount(Grams(100));
+        cp.submit(WorldSnapshot::capture(w));
+        CHECK(cp.flush());
+        CHECK_EQUAL(2u, cp.snapshotsWritten());
+        CHECK_EQUAL(1u, cp.deltasWritten());
+
+        pasta->useAmount(Grams(100));
+        cp.submit(WorldSnapshot::capture(w));
+        CHECK(cp.flush());
+        CHECK_EQUAL(2u, cp.deltasWritten());      // журнал снова дописывается
+    }
+    KitchenWorld torn;
+    torn.build(TEST_SNAPSHOT_WORLD, nullptr);
+    CHECK(WorldSnapshot::load(torn, path));
+    CHECK_EQUAL(400000LL, torn.ingredient(torn.find("pasta"))->getMilligrams());
+
+    remove(path);
+    remove("kitchen_snapshot_test.bin.delta");
+}
+
+
+// ---------------------------------------------------------
+// FEASIBILITY (166–168)
+// ---------------------------------------------------------
+
+static const char* const TEST_FEASIBILITY_WORLD = R"(
+unit g 1
+ingredient pasta 350 g 340 | Паста
+ingredient sauce 500 g 80
+ingredient veggies 200 g 40
+knife knife
+board board
+pot   pot 3
+pot   cup 1
+stove stove 2
+timer timer
+cook  chef
+)";
+
+static const char* const TEST_FEASIBILITY_RECIPES = R"(
+recipe Pasta
+    require pot 2
+    lease pot
+    lease stove
+    acquire
+    reserve pasta 100
+    reserve sauce 50
+    take
+    commit
+end
+recipe Big pasta
+    lease pot
+    acquire
+    reserve pasta 150
+    reserve pasta 150
+    take
+    commit
+end
+recipe Salad
+    require knife
+    use board
+    reserve veggies 120
+    take
+    commit
+end
+recipe Soup in a cup
+    require cup 2
+    reserve sauce 10
+    take
+    commit
+end
+)";
+
+// 166
+TEST(Feasibility_TracksStockThresholds) {
+    KitchenWorld w;
+    w.build(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    FeasibilityIndex* f = w.getBook().getFeasibility();
+    CHECK(f != nullptr);
+    CHECK_EQUAL(4, f->size());
+    Ingredient* pasta = w.ingredient(w.find("pasta"));
+
+    CHECK(f->canCook(0));
+    CHECK(f->canCook(1));          // два reserve складываются: 300 г из 350
+    pasta->useAmount(Grams(100));  // 250 г: большой порции не хватает
+    CHECK(f->canCook(0));
+    CHECK(!f->canCook(1));
+    CHECK_EQUAL(1, f->shortages(1));
+    CookStatus why = f->whyNot(1);
+    CHECK(why.error == KitchenError::NotEnoughIngredient);
+    CHECK(why.kind == ResourceKind::Ingredient);
+    CHECK(why.step == 2);
+
+    CHECK(pasta->tryReserve(Grams(200)));   // 50 г: не хватает никому
+    CHECK(!f->canCook(0));
+    CHECK(!pasta->tryReserve(Grams(60)));   // неудачное списание ничего не меняет
+    CHECK_EQUAL(1, f->shortages(0));
+    pasta->restore(250000);                  // 300 г: обоим снова хватает
+    CHECK(f->canCook(0));
+    CHECK(f->canCook(1));
+    CHECK(w.dishAt(1)->canCook());
+
+    // Приготовление списывает продукты и двигает счётчики само.
+    NullSink quiet;
+    w.getCook()->setSink(&quiet);
+    CHECK(w.getCook()->tryCookRecipe(w.getBook(), 1).ok());
+    CHECK(!f->canCook(0));
+    CHECK(!w.dishAt(0)->canCook());
+
+    // Отключённый ингредиент блокирует все свои рецепты.
+    CHECK(f->canCook(2));
+    f->detach(w.ingredient(w.find("veggies")));
+    CHECK(!f->canCook(2));
+    CHECK(f->whyNot(2).error == KitchenError::IngredientNotFound);
+}
+
+// 167
+TEST(Feasibility_ToolsAndFixedFailures) {
+    KitchenWorld w;
+    w.build(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    FeasibilityIndex* f = w.getBook().getFeasibility();
+
+    // Кастрюля на 1 л меньше нужных 2 л: отказ известен при построении.
+    CHECK(!f->canCook(3));
+    CookStatus fixed = f->whyNot(3);
+    CHECK(fixed.error == KitchenError::NotEnoughIngredient);
+    CHECK_EQUAL(0, fixed.step);
+
+    CHECK(f->canCook(2));
+    Knife* knife = static_cast<Knife*>(w.tool(w.find("knife")));
+    knife->dull();
+    CHECK(!f->canCook(2));
+    CookStatus why = f->whyNot(2);
+    CHECK(why.error == KitchenError::ToolNotAvailable);
+    CHECK(why.kind == ResourceKind::Knife);
+    knife->sharpen();
+    CHECK(f->canCook(2));
+
+    KitchenTool* board = w.tool(w.find("board"));
+    board->breakTool();
+    CHECK(!f->canCook(2));
+    CHECK(f->whyNot(2).step == 1);
+
+    // Занятость не мешает: аренда освободится.
+    CHECK(w.tool(w.find("pot"))->tryLease());
+    CHECK(f->canCook(0));
+    w.tool(w.find("pot"))->releaseLease();
+
+    // Без индекса блюдо считается выполнимым; разборка мира отвязывает индекс.
+    w.teardown();
+    CHECK(w.getBook().getFeasibility() == nullptr);
+}
+
+// 168
+TEST(Feasibility_MenuAndOrdersSkipUnavailableDishes) {
+    KitchenWorld w;
+    w.build(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    w.ingredient(w.find("veggies"))->useAmount(Grams(150));
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+
+    ostringstream shown;
+    streambuf* oldCout = cout.rdbuf(shown.rdbuf());
+    menu.show();
+    cout.rdbuf(oldCout);
+    CHECK(shown.str().find("1) Pasta\n") != string::npos);
+    CHECK(shown.str().find("3) Salad (нет в наличии)\n") != string::npos);
+
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+    OrderStream stream(menu, engine);
+    OrderStreamReport r = stream.run("1 3x2 4", 7);
+    CHECK_EQUAL(3u, r.orders.size());
+    CHECK_EQUAL(1LL, r.done);
+    CHECK_EQUAL(0LL, r.failed);
+    CHECK_EQUAL(2LL, r.rejected);
+    CHECK(r.orders[1].reject == OrderReject::Unavailable);
+    CHECK(r.orders[2].reject == OrderReject::Unavailable);
+    CHECK_EQUAL(50000LL, w.ingredient(w.find("veggies"))->getMilligrams());
+
+    ostringstream out;
+    OrderStream::writeSummary(r, out);
+    CHECK(out.str().find("unavailable") != string::npos);
+}
+
+// ---------------------------------------------------------
+// ALLOCATION-FREE ORDERS (169–170)
+// ---------------------------------------------------------
+
+// 169
+TEST(SmallVector_SpillsToHeapAndKeepsOrder) {
+    SmallVector<int, 2> v;
+    v.push_back(1);
+    v.push_back(2);
+    CHECK(!v.onHeap());
+    CHECK_EQUAL(2u, v.capacity());
+
+    v.push_back(3);
+    CHECK(v.onHeap());
+    CHECK_EQUAL(3u, v.size());
+    CHECK_EQUAL(4u, v.capacity());
+    int sum = 0;
+    for (int x : v) sum = sum * 10 + x;
+    CHECK_EQUAL(123, sum);
+    CHECK_EQUAL(3, v.back());
+
+    v.clear();
+    CHECK(v.empty());
+    CHECK_EQUAL(4u, v.capacity());
+}
+
+// 170
+TEST(KitchenEngine_FailedOrderKeepsErrorTextAndResultsReuseBuffer) {
+    static Unit g("g", 1.0, false, 1);
+    Ingredient fruits("fruits", Quantity(1000.0, &g), 0.0, true);
+    Knife knife("knife");
+    CuttingBoard board("board");
+    Cook ck("cook");
+    FruitSaladDish dish("Fruit salad", &fruits, &knife, &board, &ck);
+
+    KitchenEngine engine(2);
+    for (int i = 0; i < 7; ++i) engine.submit(&dish);
+    engine.waitAll();
+    vector<OrderResult> res;
+    res.reserve(16);
+    const OrderResult* buffer = res.data();
+    engine.collectResults(res);
+
+    CHECK_EQUAL(7u, res.size());
+    CHECK(res.data() == buffer);
+    int failed = 0;
+    for (const auto& r : res) {
+        if (r.ok) {
+            CHECK(r.error == nullptr);
+        } else {
+            ++failed;
+            CHECK(r.error != nullptr && strlen(r.error) > 0);
+            CHECK(r.status.error == KitchenError::NotEnoughIngredient);
+        }
+    }
+    CHECK_EQUAL(2, failed);
+
+    // Повторный сбор заменяет содержимое.
+    engine.collectResults(res);
+    CHECK(res.empty());
+    CHECK(res.data() == buffer);
+}
+
+
+// ---------------------------------------------------------
+// WHAT-IF SIMULATION (171–173)
+// ---------------------------------------------------------
+
+// 171
+TEST(SimRandom_IsDeterministicPerSeed) {
+    SimRandom a(42), b(42), c(43);
+    bool differs = false;
+    for (int i = 0; i < 100; ++i) {
+        uint64_t x = a.next();
+        CHECK_EQUAL(x, b.next());
+        if (x != c.next()) differs = true;
+    }
+    CHECK(differs);
+    for (int i = 0; i < 1000; ++i) {
+        double u = a.uniform(2.0, 3.0);
+        CHECK(u >= 2.0 && u < 3.0);
+        CHECK(a.exponential(0.5) >= 0.0);
+    }
+    CHECK(WhatIfSimulator::replicaSeed(1, 0) != WhatIfSimulator::replicaSeed(1, 1));
+    CHECK(WhatIfSimulator::replicaSeed(1, 0) != WhatIfSimulator::replicaSeed(2, 0));
+}
+
+// 172
+TEST(WhatIfSimulator_ReportDoesNotDependOnThreads) {
+    WhatIfScenario sc = WhatIfScenario::standard(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    sc.horizon = 4 * 3600;
+    sc.ordersPerHour = 30.0;
+    sc.breaksPerHour = 0.2;
+    WhatIfSimulator sim(sc);
+    WhatIfReport one = sim.run(12, 7, 1);
+    WhatIfReport three = sim.run(12, 7, 3);
+
+    CHECK_EQUAL(12u, one.replicas.size());
+    CHECK(one.orders > 0);
+    CHECK_EQUAL(one.orders, one.done + one.failed + one.rejected);
+    CHECK_EQUAL(one.orders, three.orders);
+    CHECK_EQUAL(one.done, three.done);
+    CHECK_EQUAL(one.stockOuts, three.stockOuts);
+    CHECK_EQUAL(one.toolFailures, three.toolFailures);
+    CHECK_EQUAL(static_cast<uint64_t>(one.orders), one.waits.count);
+    CHECK_EQUAL(one.waits.sum, three.waits.sum);
+    for (size_t i = 0; i < one.replicas.size(); ++i) {
+        CHECK_EQUAL(one.replicas[i].seed, three.replicas[i].seed);
+        CHECK_EQUAL(one.replicas[i].done, three.replicas[i].done);
+        CHECK_EQUAL(one.replicas[i].maxWait, three.replicas[i].maxWait);
+    }
+    CHECK(one.throughputQuantile(0.1) <= one.throughputQuantile(0.9));
+
+    // Другое зерно — другая смена.
+    WhatIfReport other = sim.run(12, 8, 2);
+    CHECK(other.waits.sum != one.waits.sum || other.orders != one.orders);
+}
+
+// 173
+TEST(WhatIfSimulator_CountsStockOutsAndToolFailures) {
+    WhatIfScenario sc = WhatIfScenario::standard(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    sc.stockLow = 0.0;
+    sc.stockHigh = 0.0;
+    sc.dishWeights = {1.0, 0.0, 0.0, 0.0};
+    WhatIfSimulator empty(sc);
+    WhatIfReport r = empty.run(4, 1, 2);
+    CHECK(r.orders > 0);
+    CHECK_EQUAL(r.orders, r.rejected);
+    CHECK_EQUAL(r.orders, r.stockOuts);
+    CHECK_CLOSE(1.0, r.stockOutRate(), 1e-9);
+    CHECK_EQUAL(0.0, r.meanThroughput());
+
+    // Инструменты ломаются сразу: 2 кастрюли, доска и нож в каждой реплике;
+    // салату нужны нож и доска.
+    sc.dishWeights = {0.0, 0.0, 1.0, 0.0};
+    sc.stockLow = 1.0;
+    sc.stockHigh = 1.0;
+    sc.breaksPerHour = 1e6;
+    sc.dullsPerHour = 1e6;
+    WhatIfSimulator broken(sc);
+    r = broken.run(3, 1, 1);
+    CHECK_EQUAL(12LL, r.toolFailures);
+    CHECK_EQUAL(0LL, r.done);
+    CHECK_EQUAL(0LL, r.stockOuts);
+
+    sc.dishWeights = {1.0};
+    WhatIfSimulator wrong(sc);
+    CHECK_THROW(wrong.run(2, 1, 2), StorageException);
+}
+
+// ---------------------------------------------------------
+// NUTRITION LEDGER (174–176)
+// ---------------------------------------------------------
+
+static const char* const TEST_LEDGER_WORLD = R"(
+unit g 1
+ingredient pasta 1000 g 340 price 150
+ingredient sauce 1000 g 80 price 300
+pot   pot 3
+stove stove 2
+cook  chef
+)";
+
+static const char* const TEST_LEDGER_RECIPES = R"(
+recipe Pasta
+    lease pot
+    lease stove
+    acquire
+    reserve pasta 100
+    reserve sauce 50
+    take
+    commit
+end
+recipe Sauce
+    reserve sauce 200
+    take
+end
+)";
+
+// 174
+TEST(StockReservation_CommitRecordsNutritionOnce) {
+    Ingredient pasta("pasta", Quantity(1000.0, &gramUnit), 340.0, false);
+    pasta.setPrice(150.0);
+    CHECK_CLOSE(340.0, pasta.getCalories(), 1e-9);
+    CHECK_CLOSE(150.0, pasta.getPrice(), 1e-9);
+    CHECK_THROW(pasta.setPrice(-1.0), StorageException);
+    NutritionTotals t = pasta.nutritionOf(Ingredient::toMilligrams(100.0));
+    CHECK_EQUAL(340000LL, t.milliKcal);   // 340 ккал на 100 г
+    CHECK_EQUAL(15000LL, t.milliCost);    // 150 за кг → 15 за 100 г
+
+    ShiftLedger ledger(2);
+    NutritionTotals order{0, 0};
+    LedgerScope scope(&ledger, &order);
+    {
+        LedgerDish dish(1);
+        StockReservation cancelled;
+        cancelled.add(&pasta, 200.0);
+        CHECK(cancelled.tryReserve());
+    }
+    CHECK_EQUAL(0LL, ledger.commits(1));
+    CHECK_EQUAL(1000000LL, pasta.getMilligrams());
+    {
+        LedgerDish dish(1);
+        StockReservation stock;
+        stock.add(&pasta, 50.0);
+        stock.reserve();
+        stock.commit();
+        stock.commit();
+        CHECK_EQUAL(170000LL, stock.getTotals().milliKcal);
+    }
+    CHECK_EQUAL(1LL, ledger.commits(1));
+    CHECK_EQUAL(170000LL, ledger.dish(1).milliKcal);
+    CHECK_EQUAL(7500LL, ledger.dish(1).milliCost);
+    CHECK_EQUAL(170000LL, order.milliKcal);
+    CHECK_CLOSE(170.0, ledger.shift().kcal(), 1e-9);
+    CHECK_CLOSE(7.5, ledger.shift().cost(), 1e-9);
+
+    // Без номера рецепта — строка «прочее».
+    StockReservation other;
+    other.add(&pasta, Grams(10));
+    other.reserve();
+    other.commit();
+    CHECK_EQUAL(1LL, ledger.commits(-1));
+    CHECK_EQUAL(34000LL, ledger.dish(7).milliKcal);
+    CHECK_EQUAL(204000LL, ledger.shift().milliKcal);
+
+    ledger.reset();
+    CHECK_EQUAL(0LL, ledger.shift().milliKcal);
+    CHECK_EQUAL(0LL, ledger.commits(1));
+}
+
+// 175
+TEST(ShiftLedger_RecipesAccountPerDish) {
+    KitchenWorld w;
+    w.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    CHECK_CLOSE(300.0, w.ingredient(w.find("sauce"))->getPrice(), 1e-9);
+    ShiftLedger ledger(w.dishCount());
+    LedgerScope scope(&ledger, nullptr);
+    NullSink none;
+    Cook& ck = *w.getCook();
+    ck.setSink(&none);
+
+    CHECK(ck.tryCookRecipe(w.getBook(), 0).ok());
+    CHECK(ck.tryCookRecipe(w.getBook(), 0).ok());
+    CHECK(ck.tryCookRecipe(w.getBook(), 1).ok());
+    CHECK_EQUAL(2LL, ledger.commits(0));
+    CHECK_EQUAL(2 * 380000LL, ledger.dish(0).milliKcal);
+    CHECK_EQUAL(2 * 30000LL, ledger.dish(0).milliCost);
+    // Sauce не подтверждает резерв: продукты вернулись, в учёт не попали.
+    CHECK_EQUAL(0LL, ledger.commits(1));
+    CHECK_EQUAL(900000LL, w.ingredient(w.find("sauce"))->getMilligrams());
+
+    ostringstream out;
+    ShiftLedger::writeText(ledger, out, &w.getBook());
+    CHECK(out.str().find("Pasta 2 760 60\n") != string::npos);
+    CHECK(out.str().find("Итого за смену: 2 списаний, 760 ккал, себестоимость 60") != string::npos);
+
+    KitchenWorld bad;
+    CHECK_THROW(bad.build("unit g 1\ningredient x 1 g price\n"), RecipeFormatException);
+    CHECK_THROW(bad.build("unit g 1\ningredient x 1 g price -5\n"), RecipeFormatException);
+}
+
+// 176
+TEST(KitchenEngine_OrdersCarryNutrition) {
+    KitchenWorld w;
+    w.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    ShiftLedger ledger(w.dishCount());
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+    engine.setLedger(&ledger);
+    OrderStream stream(menu, engine);
+    OrderStreamReport r = stream.run("1x3", 3);
+    CHECK_EQUAL(3LL, r.done);
+    CHECK_EQUAL(3 * 380000LL, r.nutrition.milliKcal);
+    CHECK_EQUAL(3 * 30000LL, r.nutrition.milliCost);
+    CHECK_EQUAL(r.nutrition.milliKcal, ledger.shift().milliKcal);
+    CHECK_EQUAL(3LL, ledger.commits(0));
+
+    ostringstream out;
+    OrderStream::writeSummary(r, out);
+    CHECK(out.str().find("Израсходовано: 1140 ккал, себестоимость 90") != string::npos);
+
+    // Итог заказа ведётся и без журнала смены.
+    engine.setLedger(nullptr);
+    engine.submit(w.dishAt(0));
+    engine.waitAll();
+    vector<OrderResult> res = engine.collectResults();
+    CHECK_EQUAL(1u, res.size());
+    CHECK_EQUAL(380000LL, res[0].nutrition.milliKcal);
+    CHECK_EQUAL(3LL, ledger.commits(0));
+}
+
+// ---------------------------------------------------------
+// PERISHABLE LOTS (177–179)
+// ---------------------------------------------------------
+
+// 177
+TEST(ExpiryIndex_DrawsOldestLotFirstAndEvictsOnExpiry) {
+    Ingredient milk("milk", Quantity(1000.0, &gramUnit), 60.0, true);
+    ExpiryIndex index;
+    index.track(milk, 100);
+    CHECK_THROW(index.track(milk, 100), StorageException);
+    index.receive(milk, 500000, 300);
+    CHECK_EQUAL(1500000LL, milk.getMilligrams());
+
+    // Расход идёт с партии, которая испортится раньше.
+    CHECK(milk.tryReserve(300000));
+    vector<StockLot> lots = index.lots(milk);
+    CHECK_EQUAL(2u, lots.size());
+    CHECK_EQUAL(700000LL, lots[0].mg);
+    CHECK_EQUAL(100LL, lots[0].expiresAt);
+    CHECK_EQUAL(500000LL, lots[1].mg);
+
+    // Поставка с более ранним сроком встаёт первой и расходуется первой.
+    index.receive(milk, 200000, 50);
+    milk.useAmount(100.0);
+    {
+        StockReservation stock;
+        stock.add(&milk, 150.0);
+        CHECK(stock.tryReserve());
+    }
+    lots = index.lots(milk);
+    CHECK_EQUAL(3u, lots.size());
+    CHECK_EQUAL(100000LL, lots[0].mg);
+    CHECK_EQUAL(50LL, lots[0].expiresAt);
+    CHECK_EQUAL(700000LL, lots[1].mg);
+    CHECK_EQUAL(50LL, index.nextExpiry());
+
+    CHECK_EQUAL(0u, index.expire(49));
+    CHECK_EQUAL(1u, index.expire(60));
+    CHECK_EQUAL(1200000LL, milk.getMilligrams());
+    CHECK_EQUAL(100LL, index.nextExpiry());
+    CHECK_EQUAL(1u, index.expire(150));
+    CHECK_EQUAL(500000LL, milk.getMilligrams());
+    CHECK_EQUAL(800000LL, index.expiredMg(milk));
+    CHECK_EQUAL(480000LL, index.wasted().milliKcal);   // 60 ккал на 100 г × 800 г
+
+    // Время индекса не идёт назад; addAmount — поставка со сроком хранения.
+    CHECK_EQUAL(0u, index.expire(10));
+    CHECK_EQUAL(150LL, index.now());
+    milk.addAmount(100.0);
+    lots = index.lots(milk);
+    CHECK_EQUAL(2u, lots.size());
+    CHECK_EQUAL(100000LL, lots[0].mg);
+    CHECK_EQUAL(250LL, lots[0].expiresAt);
+    CHECK_EQUAL(300LL, lots[1].expiresAt);
+    CHECK_EQUAL(1u, index.expire(260));
+    CHECK_EQUAL(1u, index.expire(300));
+    CHECK_EQUAL(0LL, milk.getMilligrams());
+    CHECK_EQUAL(ExpiryIndex::NEVER, index.nextExpiry());
+
+    Ingredient salt("salt", Quantity(10.0, &gramUnit), 0.0, false);
+    CHECK_THROW(index.receive(salt, 1000), StorageException);
+    CHECK_THROW(index.track(salt, 0), StorageException);
+}
+
+// 178
+TEST(ExpiryIndex_ConsumedLotsAreSkippedAndConcurrentDrawsBalance) {
+    vector<unique_ptr<Ingredient>> items;
+    ExpiryIndex index;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back(new Ingredient("item", Quantity(100.0, &gramUnit), 10.0, true));
+        index.track(*items.back(), 10 + i);
+    }
+    CHECK_EQUAL(100u, index.size());
+    // Израсходованная целиком партия в срок ничего не списывает.
+    CHECK(items[0]->tryReserve(100000));
+    CHECK_EQUAL(4u, index.expire(14));
+    CHECK_EQUAL(100000LL, items[5]->getMilligrams());
+    CHECK_EQUAL(400000LL, index.expiredMg());
+
+    // Повара списывают, пока истекает партия: ничего не теряется и не удваивается.
+    Ingredient flour("flour", Quantity(1000.0, &gramUnit), 340.0, true);
+    ExpiryIndex shared;
+    shared.track(flour, 1000);
+    shared.receive(flour, 1000000, 2000);
+    atomic<long long> taken{0};
+    vector<thread> cooks;
+    for (int t = 0; t < 4; ++t) {
+        cooks.emplace_back([&] {
+            for (int i = 0; i < 200; ++i) {
+                if (flour.tryReserve(1000)) taken.fetch_add(1000);
+            }
+        });
+    }
+    shared.expire(1000);
+    for (thread& th : cooks) th.join();
+    shared.expire(2000);
+    CHECK_EQUAL(0LL, flour.getMilligrams());
+    CHECK_EQUAL(2000000LL, taken.load() + shared.expiredMg());
+}
+
+static const char* const TEST_EXPIRY_WORLD = R"(
+unit g 1
+ingredient milk 300 g 60 perishable shelf 1
+ingredient flour 1000 g 340
+cook chef
+)";
+
+static const char* const TEST_EXPIRY_RECIPES = R"(
+recipe Porridge
+    reserve milk 100
+    reserve flour 50
+    take
+    commit
+end
+)";
+
+// 179
+TEST(KitchenWorld_ShelfLifeSpoilsStockAndUpdatesFeasibility) {
+    KitchenWorld w;
+    w.build(TEST_EXPIRY_WORLD, TEST_EXPIRY_RECIPES);
+    ExpiryIndex* index = w.getExpiry();
+    CHECK(index != nullptr);
+    CHECK_EQUAL(1u, index->size());
+    Ingredient* milk = w.ingredient(w.find("milk"));
+    CHECK_EQUAL(3600LL, index->lots(*milk)[0].expiresAt);
+    CHECK_THROW(index->lots(*w.ingredient(w.find("flour"))), StorageException);
+
+    NullSink none;
+    w.getCook()->setSink(&none);
+    CHECK(w.dishAt(0)->canCook());
+    CHECK(w.getCook()->tryCookRecipe(w.getBook(), 0).ok());
+    CHECK_EQUAL(200000LL, milk->getMilligrams());
+
+    CHECK_EQUAL(1u, index->expire(3600));
+    CHECK_EQUAL(0LL, milk->getMilligrams());
+    CHECK(!w.dishAt(0)->canCook());
+    CHECK(w.getBook().getFeasibility()->whyNot(0).error == KitchenError::NotEnoughIngredient);
+
+    KitchenWorld plain;
+    plain.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    CHECK(plain.getExpiry() == nullptr);
+    CHECK_THROW(plain.build("unit g 1\ningredient x 1 g shelf\n"), RecipeFormatException);
+    CHECK_THROW(plain.build("unit g 1\ningredient x 1 g shelf 0\n"), RecipeFormatException);
+
+    // Тёплый старт: снимок хранит время индекса и остатки партий.
+    const char* path = "kitchen_lots_test.bin";
+    remove(path);
+    remove("kitchen_lots_test.bin.delta");
+    KitchenWorld before;
+    before.build(TEST_EXPIRY_WORLD, TEST_EXPIRY_RECIPES);
+    before.getCook()->setSink(&none);
+    CHECK(before.getCook()->tryCookRecipe(before.getBook(), 0).ok());
+    CHECK_EQUAL(0u, before.getExpiry()->expire(3000));
+    before.ingredient(before.find("milk"))->addAmount(Grams(100));   // новая партия до 6600 с
+    {
+        CheckpointWriter cp(path, 64);
+        cp.submit(WorldSnapshot::capture(before));
+        CHECK(cp.flush());
+    }
+    KitchenWorld back;
+    back.build(TEST_EXPIRY_WORLD, TEST_EXPIRY_RECIPES);
+    CHECK(WorldSnapshot::load(back, path));
+    CHECK(WorldSnapshot::capture(back) == WorldSnapshot::capture(before));
+    ExpiryIndex* restored = back.getExpiry();
+    Ingredient* backMilk = back.ingredient(back.find("milk"));
+    CHECK_EQUAL(3000LL, restored->now());
+    vector<StockLot> lots = restored->lots(*backMilk);
+    CHECK_EQUAL(2u, lots.size());
+    if (lots.size() == 2) {
+        CHECK_EQUAL(200000LL, lots[0].mg);
+        CHECK_EQUAL(3600LL, lots[0].expiresAt);
+        CHECK_EQUAL(100000LL, lots[1].mg);
+        CHECK_EQUAL(6600LL, lots[1].expiresAt);
+    }
+    back.getCook()->setSink(&none);
+    CHECK(back.getCook()->tryCookRecipe(back.getBook(), 0).ok());   // расход — со старой партии
+    CHECK_EQUAL(0u, restored->expire(3599));
+    CHECK_EQUAL(1u, restored->expire(3600));
+    CHECK_EQUAL(100000LL, backMilk->getMilligrams());
+    CHECK_EQUAL(1u, restored->expire(6600));
+    CHECK_EQUAL(0LL, backMilk->getMilligrams());
+    remove(path);
+    remove("kitchen_lots_test.bin.delta");
+
+    // Движок: часы повара мира стоят на 0, просрочку списывает работник по своим часам.
+    KitchenWorld slow;
+    slow.build("unit g 1\n"
+               "ingredient milk 500 g 60 perishable shelf 1\n"
+               "ingredient flour 1000 g 340\n"
+               "timer t\n"
+               "cook chef\n",
+               "recipe Slow\n"
+               "    reserve milk 100\n"
+               "    reserve flour 50\n"
+               "    take\n"
+               "    hold t 2400\n"
+               "    commit\n"
+               "end\n");
+    Menu menu;
+    menu.addDish(slow.dishAt(0));
+    KitchenEngine engine(1);
+    engine.setSink(&none);
+    engine.setExpiry(slow.getExpiry());
+    OrderStream stream(menu, engine);
+    OrderStreamReport r = stream.run("1x4", 3);
+    CHECK_EQUAL(0LL, slow.getCook()->getClock().now());
+    CHECK_EQUAL(2LL, r.done);                      // третий заказ начат в 4800 с: молоко испортилось
+    CHECK_EQUAL(2LL, r.failed);
+    CHECK_EQUAL(300000LL, slow.getExpiry()->expiredMg());
+    CHECK_EQUAL(4800LL, slow.getExpiry()->now());
+    CHECK_EQUAL(0u, slow.getExpiry()->expire(0));  // время индекса не идёт назад
+}
+
+// ---------------------------------------------------------
+// COROUTINE RECIPES (180–182)
+// ---------------------------------------------------------
+
+// 180
+TEST(CookTask_PancakesSuspendOnTimerAndMatchBlockingRecipe) {
+    Ingredient flour = makeIngredient("flour", 1000.0);
+    Ingredient eggs  = makeIngredient("eggs", 1000.0);
+    Ingredient sugar = makeIngredient("sugar", 1000.0);
+    Ingredient milk  = makeIngredient("milk", 1000.0);
+    Pan pan("pan");
+    Stove stove;
+    Timer t;
+    Mixer mixer("mixer", true);
+
+    Cook blocking("blocking");
+    PancakeDish first("Pancakes", &flour, &eggs, &sugar, &milk, &pan, &stove, &t, &mixer, &blocking);
+    blocking.cookPancakes(&first);
+    CHECK_EQUAL(360LL, blocking.getClock().now());
+    CHECK_EQUAL(850000LL, flour.getMilligrams());
+
+    Cook ck("cook");
+    PancakeDish second("Pancakes", &flour, &eggs, &sugar, &milk, &pan, &stove, &t, &mixer, &ck);
+    CookTask task = ck.cookPancakesTask(&second);
+    CHECK(!task.started());
+    CHECK(!task.done());
+    CHECK_THROW(task.get(), StorageException);
+    CHECK(task.status().error == KitchenError::Storage);
+
+    task.start();
+    CHECK(task.started());
+    CHECK(!task.done());
+    CHECK_EQUAL(0LL, ck.getClock().now());
+    CHECK(ck.getClock().pending() > 0);
+    // Ждущее блюдо держит аренду и резерв.
+    CHECK(!pan.tryLease());
+    CHECK_EQUAL(700000LL, flour.getMilligrams());
+
+    ck.getClock().run();
+    CHECK(task.done());
+    CHECK(task.status().ok());
+    task.get();
+    CHECK_EQUAL(360LL, ck.getClock().now());
+    CHECK(pan.tryLease());
+    pan.releaseLease();
+}
+
+static CookTask waitOnClock(SimClock& clock, Oven* oven, long long* slept, long long* heated) {
+    *slept = co_await sleepFor(clock, 90);
+    *heated = co_await ovenReaches(clock, oven, 150.0);
+    co_await ovenOff(clock, oven);
+    throw OvercookedDishException("Духовка выключилась");
+}
+
+// 181
+TEST(CookTask_ExceptionsAreKeptInTaskAndMappedToStatus) {
+    Ingredient meat = makeIngredient("meat", 1000.0);
+    Cook ck("cook");
+    BakedMeatDish dish("Baked meat", &meat, nullptr, &ck);
+    CookTask task = ck.cookBakedMeatTask(&dish);
+    task.start();
+    CHECK(task.done());
+    CHECK(task.status().error == KitchenError::ToolNotAvailable);
+    CHECK_THROW(task.get(), ToolNotAvailableException);
+    CHECK_THROW(ck.cookBakedMeat(&dish), ToolNotAvailableException);
+    CHECK(dish.tryCookWith(&ck).error == KitchenError::ToolNotAvailable);
+
+    Oven oven;
+    oven.preheat(200.0, 1);
+    oven.setTimerMinutes(10);
+    long long slept = 0, heated = 0;
+    CookTask waiting = waitOnClock(ck.getClock(), &oven, &slept, &heated);
+    CHECK_THROW(waiting.runOn(ck.getClock()), OvercookedDishException);
+    CHECK_EQUAL(90LL, slept);
+    CHECK(heated >= 0 && heated <= 60);
+    // Духовку продвигают только ожидания духовки: 90 с сна + 10 мин выпечки.
+    CHECK_EQUAL(90LL + 600LL, ck.getClock().now());
+    CHECK(waiting.status().error == KitchenError::Overcooked);
+
+    CHECK(CookStatus::fromException(nullptr).ok());
+    CHECK(CookStatus::fromException(make_exception_ptr(TimerNotSetException("x"))).error
+          == KitchenError::TimerNotSet);
+    CHECK_THROW(CookStatus::fromException(make_exception_ptr(std::logic_error("x"))), std::logic_error);
+
+    CookTask empty;
+    CHECK(empty.done());
+    CHECK(empty.status().ok());
+}
+
+// 182
+TEST(DishInterleaver_ManyDishesShareOneThreadAndBurners) {
+    const int N = 12;
+    Ingredient eggs = makeIngredient("eggs", 1000.0);
+    Stove stove;  // 4 конфорки на 12 блюд
+    Cook ck("cook");
+    vector<unique_ptr<Pot>> pots;
+    vector<unique_ptr<Timer>> timers;
+    vector<unique_ptr<BoiledEggDish>> dishes;
+    for (int i = 0; i < N; ++i) {
+        pots.push_back(make_unique<Pot>("pot", 2.0, true, false));
+        timers.push_back(make_unique<Timer>());
+        dishes.push_back(make_unique<BoiledEggDish>("Boiled eggs", &eggs, pots.back().get(),
+                                                    &stove, timers.back().get(), &ck));
+    }
+
+    {
+        DishInterleaver batch(ck);
+        for (int i = 0; i < N; ++i) batch.spawn(ck.cookBoiledEggsTask(dishes[i].get()));
+        CHECK_EQUAL(static_cast<size_t>(N), batch.size());
+        CHECK_EQUAL(static_cast<size_t>(N), batch.unfinished());
+        CHECK_EQUAL(0, stove.freeBurners());
+
+        CHECK_EQUAL(static_cast<size_t>(N), batch.run());
+        CHECK_EQUAL(0u, batch.unfinished());
+        CHECK(batch.status(0).ok());
+        CHECK_THROW(batch.status(N), StorageException);
+    }
+    // Три волны по 8 минут на четырёх конфорках вместо двенадцати блюд подряд.
+    CHECK_EQUAL(3LL * 8 * 60, ck.getClock().now());
+    CHECK_EQUAL(4, stove.freeBurners());
+    CHECK_EQUAL(1000000LL - N * 3000LL, eggs.getMilligrams());
+}
+
+// ---------------------------------------------------------
+// NETWORK INTAKE (183–184)
+// ---------------------------------------------------------
+
+/// Отправляет куски по одному, закрывает свою сторону и читает ответы до закрытия сервером.
+static string talkToServer(unsigned short port, const vector<string>& pieces) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return "connect failed";
+    }
+    for (const string& p : pieces) {
+        send(fd, p.data(), p.size(), 0);
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    shutdown(fd, SHUT_WR);
+    string reply;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) reply.append(buf, static_cast<size_t>(n));
+    close(fd);
+    return reply;
+}
+
+static int countLines(const string& text, const char* prefix) {
+    int n = 0;
+    istringstream in(text);
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, strlen(prefix), prefix) == 0) ++n;
+    }
+    return n;
+}
+
+// 183
+TEST(OrderServer_AcceptsSplitRecordsAndStreamsResults) {
+    KitchenWorld w;
+    w.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+
+    string reply;
+    long long accepted = 0, rejected = 0, reported = 0;
+    uint64_t batches = 0;
+    {
+        OrderServer server(menu, engine);
+        unsigned short port = server.listen("127.0.0.1", 0);
+        CHECK(port != 0);
+        CHECK_THROW(server.listen("127.0.0.1", 0), StorageException);
+        thread loop([&] { server.run(); });
+        // Запись «1x2» разорвана между посылками; после 0 поток клиента закончен.
+        reply = talkToServer(port, {"1x3\n9\n", "1", "x2\n# comment\n", "0\n1\n"});
+        server.stop();
+        loop.join();
+        accepted = server.accepted();
+        rejected = server.rejected();
+        reported = server.reported();
+        batches  = server.intakeLatency().count;
+        CHECK_EQUAL(0u, server.connectionCount());
+    }
+    CHECK_EQUAL(5, countLines(reply, "queued "));
+    CHECK_EQUAL(1, countLines(reply, "rejected 2 no_such_dish"));
+    CHECK_EQUAL(5, countLines(reply, "done "));
+    CHECK_EQUAL(0, countLines(reply, "failed "));
+    CHECK(reply.find("queued 1 1\n") < reply.find("done 1 "));
+    CHECK_EQUAL(5LL, accepted);
+    CHECK_EQUAL(1LL, rejected);
+    CHECK_EQUAL(5LL, reported);
+    CHECK(batches >= 2);
+    CHECK_EQUAL(500000LL, w.ingredient(w.find("pasta"))->getMilligrams());
+}
+
+// 184
+TEST(OrderServer_ServesClientsConcurrentlyAndSurvivesDisconnects) {
+    KitchenWorld w;
+    w.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+
+    OrderServer server(menu, engine);
+    CHECK_THROW(server.listen("not-an-address", 0), StorageException);
+    unsigned short port = server.listen(nullptr, 0);
+    thread loop([&] { server.run(); });
+
+    // Клиент уходит, не дождавшись итогов: его итоги просто некому отправить.
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        CHECK_EQUAL(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+        send(fd, "1x2\n", 4, 0);
+        close(fd);
+    }
+    string a, b;
+    thread first([&] { a = talkToServer(port, {"1 abc\n"}); });
+    thread second([&] { b = talkToServer(port, {"1\n", "1\n"}); });
+    first.join();
+    second.join();
+    engine.waitAll();
+    server.stop();
+    loop.join();
+
+    CHECK_EQUAL(1, countLines(a, "done "));
+    CHECK_EQUAL(1, countLines(a, "rejected 1 syntax"));
+    CHECK_EQUAL(2, countLines(b, "queued "));
+    CHECK_EQUAL(2, countLines(b, "done "));
+    CHECK_EQUAL(5LL, server.accepted());
+    CHECK(!server.poll(0));
+}
+
+// ---------------------------------------------------------
+// SYNTHETIC WORLDS (185–186)
+// ---------------------------------------------------------
+
+/// Небольшая синтетическая кухня для тестов.
+static SyntheticSpec smallSyntheticSpec() {
+    SyntheticSpec s = SyntheticSpec::standard();
+    s.ingredients = 60;
+    s.stations    = 8;
+    s.stoves      = 2;
+    s.burners     = 2;
+    s.dishes      = 40;
+    s.stockGrams  = 200000;
+    return s;
+}
+
+// 185
+TEST(SyntheticKitchen_IsDeterministicAndBuildsAWorld) {
+    SyntheticSpec spec = smallSyntheticSpec();
+    string kitchen = SyntheticKitchen::kitchen(spec, 3);
+    string recipes = SyntheticKitchen::recipes(spec, 3);
+    CHECK(kitchen == SyntheticKitchen::kitchen(spec, 3));
+    CHECK(recipes == SyntheticKitchen::recipes(spec, 3));
+    CHECK(recipes != SyntheticKitchen::recipes(spec, 4));
+
+    KitchenWorld w;
+    w.build(kitchen.c_str(), recipes.c_str());
+    CHECK_EQUAL(40, w.dishCount());
+    CHECK(w.find("ing59") != KitchenWorld::NO_HANDLE);
+    CHECK(w.find("timer7") != KitchenWorld::NO_HANDLE);
+
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    KitchenEngine engine(2);
+    NullSink none;
+    engine.setSink(&none);
+    OrderStream stream(menu, engine);
+    ostringstream trace;
+    TraceSpec ts = TraceSpec::standard(40);
+    ts.horizon = 3600;
+    ts.ordersPerHour = 120.0;
+    long long orders = OrderTraceGenerator::write(ts, 3, trace);
+    OrderStreamReport r = stream.run(trace.str().data(), trace.str().size());
+    CHECK(orders > 60);
+    CHECK_EQUAL(orders, r.done + r.failed + r.rejected);
+    CHECK(r.done > 0);
+
+    spec.maxReserves = spec.ingredients + 1;
+    CHECK_THROW(SyntheticKitchen::kitchen(spec, 3), StorageException);
+}
+
+// 186
+TEST(OrderTraceGenerator_SkewsPopularityAndBurstsInRushHours) {
+    TraceSpec ts = TraceSpec::standard(200);
+    ts.horizon = 4 * 3600;
+    ts.ordersPerHour = 3000.0;
+    ts.rushes = {{3600, 7200, 4.0}};
+    OrderTraceGenerator gen(ts, 11);
+    vector<long long> perDish(200, 0);
+    long long base = 0, rush = 0, total = 0, last = 0;
+    bool ordered = true;
+    TraceOrder o;
+    while (gen.next(o)) {
+        if (o.at < last) ordered = false;
+        last = o.at;
+        ++perDish[static_cast<size_t>(o.dish - 1)];
+        if (o.at >= 3600 && o.at < 7200) ++rush; else ++base;
+        ++total;
+    }
+    CHECK(ordered);
+    CHECK(last < ts.horizon);
+    // Вне пика 3 часа по 3000 заказов, в пик — час по 12000.
+    CHECK(base > 8000 && base < 10000);
+    CHECK(rush > 11000 && rush < 13000);
+    long long top = *max_element(perDish.begin(), perDish.end());
+    CHECK(top * 200 > total * 10);
+
+    vector<double> w = OrderTraceGenerator::popularity(200, 1.1, 11);
+    size_t hot = static_cast<size_t>(max_element(w.begin(), w.end()) - w.begin());
+    CHECK_EQUAL(top, perDish[hot]);
+
+    // Трасса читается обратно с теми же отметками.
+    ostringstream text;
+    CHECK_EQUAL(total, OrderTraceGenerator::write(ts, 11, text));
+    string s = text.str();
+    OrderScanner scan;
+    vector<ParsedOrder> parsed;
+    scan.feed(s.data(), s.data() + s.size(), parsed);
+    scan.finish(parsed);
+    long long read = 0;
+    for (const ParsedOrder& p : parsed) {
+        CHECK(!p.bad);
+        read += p.count;
+    }
+    CHECK_EQUAL(total, read);
+    CHECK(parsed.back().at == last);
+
+    const char bad[] = "@12 3 @ 4";
+    OrderScanner marks;
+    vector<ParsedOrder> out;
+    marks.feed(bad, bad + sizeof(bad) - 1, out);
+    marks.finish(out);
+    CHECK_EQUAL(3u, out.size());
+    CHECK_EQUAL(12LL, out[0].at);
+    CHECK(out[1].bad);
+    CHECK_EQUAL(12LL, out[2].at);
+}
+
+// ---------------------------------------------------------
+// SESSION RECORD/REPLAY (187–188)
+// ---------------------------------------------------------
+
+static const char* const TEST_SESSION_WORLD = R"(
+unit g 1
+ingredient beef 500 g 250 price 650
+pot   pot 3
+stove stove 1
+timer t
+cook  chef
+)";
+
+static const char* const TEST_SESSION_RECIPES = R"(
+recipe Roast
+    lease pot
+    lease stove
+    acquire
+    reserve beef 200
+    take
+    burner_on stove
+    hold t 2400
+    overcooked 35
+    commit
+    burner_off stove
+end
+recipe Sear
+    lease pot
+    lease stove
+    acquire
+    reserve beef 100
+    take
+    burner_on stove
+    hold t 300
+    commit
+    burner_off stove
+end
+)";
+
+/// Обрабатывает заказы движком с записью сеанса в path (просрочка — как в main).
+static OrderStreamReport recordSession(const char* path, const char* orders, int workers, uint64_t& events,
+                                       const char* kitchen = TEST_SESSION_WORLD,
+                                       const char* recipes = TEST_SESSION_RECIPES) {
+    KitchenWorld w;
+    w.build(kitchen, recipes);
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    SessionRecorder rec(path, kitchen, recipes, w, menu, workers);
+    OrderStreamReport r;
+    {
+        KitchenEngine engine(workers);
+        NullSink none;
+        engine.setSink(&none);
+        engine.setRecorder(&rec);
+        engine.setExpiry(w.getExpiry());
+        OrderStream stream(menu, engine);
+        r = stream.run(orders, strlen(orders));
+    }
+    rec.flush();
+    events = rec.events();
+    return r;
+}
+
+// 187
+TEST(SessionReplay_ReproducesOvercookedAndStockOut) {
+    const char* path = "kitchen_session_test.log";
+    uint64_t events = 0;
+    // Жаркое передерживается, к концу потока говядины не хватает.
+    OrderStreamReport live = recordSession(path, "2 1 2 2 1 2 2 2\n", 1, events);
+    CHECK_EQUAL(2LL * (live.done + live.failed), static_cast<long long>(events));
+
+    SessionLog log = SessionLog::read(path);
+    CHECK_EQUAL(0u, log.truncated);
+    CHECK_EQUAL(static_cast<size_t>(events), log.events.size());
+    CHECK(string(TEST_SESSION_RECIPES) == log.recipes);
+    ReplayReport rep = SessionReplay::run(log);
+    CHECK_EQUAL(live.done + live.failed, rep.orders);
+    CHECK_EQUAL(rep.orders, rep.matched);
+    CHECK_EQUAL(live.done, rep.done);
+    CHECK(rep.mismatches.empty());
+    int overcooked = 0, stockOuts = 0;
+    for (const OrderSummary& o : live.orders) {
+        if (o.error == KitchenError::Overcooked) ++overcooked;
+        if (o.error == KitchenError::NotEnoughIngredient) ++stockOuts;
+    }
+    CHECK(overcooked >= 1);
+    CHECK(stockOuts >= 1);
+
+    // Изменённый итог в журнале — расхождение с указанием заказа.
+    for (SessionEvent& e : log.events) {
+        if (e.kind == SessionEventKind::Finish && e.error == KitchenError::Overcooked) {
+            e.error = KitchenError::None;
+            break;
+        }
+    }
+    ReplayReport bad = SessionReplay::run(log);
+    CHECK_EQUAL(1u, bad.mismatches.size());
+    CHECK(bad.mismatches[0].replayed == KitchenError::Overcooked);
+    ostringstream text;
+    SessionReplay::writeReport(bad, text);
+    CHECK(text.str().find("записано - ") != string::npos);
+
+    // Скоропортящееся молоко: третий заказ начат после срока его партии.
+    OrderStreamReport spoiled = recordSession(path, "1x4\n", 1, events,
+                                              "unit g 1\n"
+                                              "ingredient milk 500 g 60 perishable shelf 1\n"
+                                              "ingredient flour 1000 g 340\n"
+                                              "timer t\n"
+                                              "cook chef\n",
+                                              "recipe Slow\n"
+                                              "    reserve milk 100\n"
+                                              "    reserve flour 50\n"
+                                              "    take\n"
+                                              "    hold t 2400\n"
+                                              "    commit\n"
+                                              "end\n");
+    CHECK_EQUAL(2LL, spoiled.done);
+    CHECK_EQUAL(2LL, spoiled.failed);
+    ReplayReport again = SessionReplay::run(SessionLog::read(path));
+    CHECK_EQUAL(4LL, again.orders);
+    CHECK_EQUAL(4LL, again.matched);
+    CHECK_EQUAL(2LL, again.failed);
+    CHECK(again.mismatches.empty());
+    remove(path);
+}
+
+// 188
+TEST(SessionLog_DropsTornTailAndRejectsForeignFiles) {
+    const char* path = "kitchen_session_test.log";
+    uint64_t events = 0;
+    recordSession(path, "2 2 2 2\n", 2, events);
+    {
+        FILE* f = fopen(path, "ab");
+        fwrite("torn", 1, 4, f);
+        fclose(f);
+    }
+    SessionLog log = SessionLog::read(path);
+    CHECK_EQUAL(4u, log.truncated);
+    CHECK_EQUAL(static_cast<size_t>(events), log.events.size());
+    CHECK_EQUAL(2u, log.header.workers);
+    for (size_t i = 1; i < log.events.size(); ++i) CHECK(log.events[i - 1].seq < log.events[i].seq);
+    ReplayReport rep = SessionReplay::run(log);
+    CHECK_EQUAL(4LL, rep.orders);
+    CHECK_EQUAL(0LL, rep.unfinished);
+
+    {
+        FILE* f = fopen(path, "wb");
+        fwrite("KDLTnot a session log at all, just some other bytes here", 1, 56, f);
+        fclose(f);
+    }
+    CHECK_THROW(SessionLog::read(path), StorageException);
+    remove(path);
+    CHECK_THROW(SessionLog::read(path), StorageException);
+}
+
+// ---------------------------------------------------------
+// COST MODEL (189–190)
+// ---------------------------------------------------------
+
+// 189
+TEST(CostModel_StartsFromPlanQueuesAndLearns) {
+    KitchenWorld w;
+    w.build(TEST_PLAN_WORLD, TEST_PLAN_RECIPES);
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    CostModel m(w.getBook(), menu, 2);
+    CapacityPlanner planner(w.getBook(), PlannerCapacity::of(w.getBook().getKitchen(), 2));
+    for (int item = 1; item <= 3; ++item) {
+        CHECK_EQUAL(planner.demandOf(item - 1).seconds, m.estimate(item));
+        CHECK_EQUAL(m.estimate(item), m.readyIn(item));
+        CHECK_EQUAL(0ULL, static_cast<unsigned long long>(m.observations(item)));
+    }
+    CHECK_EQUAL(1, m.demand(3).units[static_cast<unsigned>(PlanResource::Pan)]);
+    CHECK_EQUAL(CostModel::UNREACHABLE, m.readyIn(0));
+    CHECK_EQUAL(CostModel::UNREACHABLE, m.readyIn(4));
+    CHECK_THROW(m.demand(4), StorageException);
+
+    // Сковорода одна: второй Fry ждёт первого, третий не успевает к сроку.
+    long long first = 0, second = 0, third = 0;
+    CHECK(m.admit(3, 600, first));
+    CHECK_EQUAL(300000LL, first);
+    CHECK_EQUAL(600LL, m.readyIn(3));
+    CHECK(m.admit(3, 600, second));
+    CHECK(!m.admit(3, 600, third));
+    CHECK_EQUAL(0LL, third);
+    CHECK_EQUAL(600LL, m.backlog(PlanResource::Pan));
+    CHECK_EQUAL(600LL, m.backlog(PlanResource::Cook));
+    CHECK_EQUAL(900LL, m.readyIn(1));            // повара и конфорки заняты Fry на 300 с
+
+    // Итоги освобождают очередь; приготовленный за 460 с сдвигает оценку на 1/8.
+    m.finished(menu.dishAt(3), first, 460, true);
+    m.finished(menu.dishAt(3), second, 0, false);
+    CHECK_EQUAL(0LL, m.backlog(PlanResource::Pan));
+    CHECK_EQUAL(0LL, m.backlog(PlanResource::Cook));
+    CHECK_EQUAL(320LL, m.estimate(3));
+    CHECK_EQUAL(1ULL, static_cast<unsigned long long>(m.observations(3)));
+    CHECK_EQUAL(320LL, m.readyIn(3));
+}
+
+// 190
+TEST(OrderStream_RejectsOrdersOverSla) {
+    KitchenWorld w;
+    w.build(TEST_PLAN_WORLD, TEST_PLAN_RECIPES);
+    Menu menu;
+    for (int i = 0; i < w.dishCount(); ++i) menu.addDish(w.dishAt(i));
+    CostModel m(w.getBook(), menu, 1);
+    OrderStreamReport r;
+    {
+        KitchenEngine engine(1);
+        NullSink none;
+        engine.setSink(&none);
+        engine.setCostModel(&m);
+        OrderStream stream(menu, engine);
+        stream.setAdmission(&m, 1000);
+        const char* orders = "2x2 1\n";         // Roast идёт 1200 с — дольше срока
+        r = stream.run(orders, strlen(orders));
+    }
+    CHECK_EQUAL(3u, static_cast<unsigned>(r.orders.size()));
+    CHECK_EQUAL(2LL, r.rejected);
+    CHECK(r.orders[0].reject == OrderReject::OverSla);
+    CHECK(r.orders[1].reject == OrderReject::OverSla);
+    CHECK(r.orders[2].outcome == OrderOutcome::Done);
+    CHECK_EQUAL(string("over_sla"), string(orderRejectName(OrderReject::OverSla)));
+    CHECK_EQUAL(1ULL, static_cast<unsigned long long>(m.observations(1)));
+    CHECK_EQUAL(0ULL, static_cast<unsigned long long>(m.observations(2)));
+    CHECK_EQUAL(0LL, m.backlog(PlanResource::Cook));
+    CHECK_EQUAL(0LL, m.backlog(PlanResource::Pot));
+}
+
+// ---------------------------------------------------------
+// INVENTORY VERSIONS (191–192)
+// ---------------------------------------------------------
+
+// 191
+TEST(InventoryVersions_ViewKeepsItsMomentAcrossPublishes) {
+    KitchenWorld w;
+    w.build(TEST_FEASIBILITY_WORLD, TEST_FEASIBILITY_RECIPES);
+    FeasibilityIndex* f = w.getBook().getFeasibility();
+    Ingredient* pasta = w.ingredient(w.find("pasta"));
+    Knife* knife = static_cast<Knife*>(w.tool(w.find("knife")));
+    InventoryVersions versions(w);
+    CHECK_EQUAL(1ULL, static_cast<unsigned long long>(versions.latest()));
+    CHECK_THROW(InventoryVersions again(w), StorageException);
+    {
+        InventoryView old(versions);
+        CHECK_EQUAL(350000LL, old->milligrams(0));
+        CHECK_EQUAL(0LL, old->milligrams(99));
+        CHECK(!old->usable(100000));
+
+        StockReservation r;
+        r.add(pasta, 300.0);
+        CHECK(r.tryReserve());
+        r.commit();
+        w.tool(w.find("board"))->breakTool();
+        CHECK_EQUAL(2ULL, static_cast<unsigned long long>(versions.publish()));
+
+        // Закреплённая версия не видит ни списания, ни поломки.
+        CHECK_EQUAL(350000LL, old->milligrams(0));
+        CHECK(f->canCook(1, *old));
+        CHECK(f->canCook(2, *old));
+        InventoryView now(versions);
+        CHECK_EQUAL(2ULL, static_cast<unsigned long long>(now->sequence));
+        CHECK_EQUAL(50000LL, now->milligrams(0));
+        CHECK(!f->canCook(0, *now));
+        CHECK(!f->canCook(2, *now));
+        CHECK(!f->canCook(3, *now));             // кастрюля мала при любом запасе
+        CHECK_EQUAL(1u, static_cast<unsigned>(versions.retainedVersions()));
+
+        // Острота ножа в версию не входит и берётся текущей.
+        knife->dull();
+        CHECK(!f->canCook(2, *old));
+        knife->sharpen();
+    }
+    CHECK_EQUAL(0u, static_cast<unsigned>(versions.retainedVersions()));
+    pasta->restore(300000);
+    InventoryView back(versions);
+    CHECK_EQUAL(50000LL, back->milligrams(0));   // до публикации видна прежняя версия
+}
+
+// 192
+TEST(InventoryVersions_PublishSeesReservationsWhole) {
+    KitchenWorld w;
+    w.build(TEST_LEDGER_WORLD, TEST_LEDGER_RECIPES);
+    Ingredient* pasta = w.ingredient(w.find("pasta"));
+    Ingredient* sauce = w.ingredient(w.find("sauce"));
+    InventoryVersions versions(w);
+    atomic<bool> stop(false);
+    atomic<int>  torn(0);
+    vector<thread> cooks;
+    for (int t = 0; t < 3; ++t) {
+        cooks.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                StockReservation r;
+                r.add(pasta, 0.1).add(sauce, 0.1);
+                if (r.tryReserve() && (i + t) % 4 == 0) r.commit(); // остальные отменяются
+            }
+        });
+    }
+    thread reader([&] {
+        while (!stop.load()) {
+            InventoryView v(versions);
+            if (v->milligrams(0) != v->milligrams(1)) torn.fetch_add(1);
+        }
+    });
+    uint64_t published = 0;
+    for (int i = 0; i < 300; ++i) {
+        published = versions.publish();
+        InventoryView v(versions);
+        if (v->milligrams(0) != v->milligrams(1)) torn.fetch_add(1);
+    }
+    for (thread& c : cooks) c.join();
+    stop.store(true);
+    reader.join();
+
+    CHECK_EQUAL(0, torn.load());
+    CHECK_EQUAL(301ULL, static_cast<unsigned long long>(published));
+    versions.publish();
+    InventoryView last(versions);
+    CHECK_EQUAL(1000000LL - 1500 * 100, last->milligrams(0));
+    CHECK_EQUAL(pasta->getMilligrams(), last->milligrams(0));
+    CHECK_EQUAL(sauce->getMilligrams(), last->milligrams(1));
+    CHECK_EQUAL(0u, static_cast<unsigned>(versions.retainedVersions()));
+}
+
+// ---------------------------------------------------------
+// KITCHEN FEDERATION (193–194)
+// ---------------------------------------------------------
+
+static const char* const TEST_FEDERATION_WORLD = R"(
+unit g 1
+ingredient pasta 1000 g 340
+ingredient sauce 1000 g 80
+pot   pot 3
+stove stove 2
+timer t
+cook  chef
+)";
+
+static const char* const TEST_FEDERATION_RECIPES = R"(
+recipe Pasta
+    lease pot
+    lease stove
+    acquire
+    reserve pasta 100
+    reserve sauce 50
+    take
+    hold t 600
+    commit
+end
+)";
+
+// 193
+TEST(KitchenFederation_RoutesByStockAndMovesStockInBatches) {
+    NullSink none;
+    KitchenFederation fed;
+    CHECK_EQUAL(0, fed.addShard(TEST_FEDERATION_WORLD, TEST_FEDERATION_RECIPES, 1));
+    CHECK_EQUAL(1, fed.addShard(TEST_FEDERATION_WORLD, TEST_FEDERATION_RECIPES, 1, {0}));
+    CHECK_EQUAL(2, fed.size());
+    CHECK_THROW(fed.shard(2), StorageException);
+    KitchenShard& a = fed.shard(0);
+    KitchenShard& b = fed.shard(1);
+    a.getEngine().setSink(&none);
+    b.getEngine().setSink(&none);
+    Ingredient* pastaA = a.getWorld().ingredient(a.getWorld().find("pasta"));
+    Ingredient* pastaB = b.getWorld().ingredient(b.getWorld().find("pasta"));
+
+    // Соуса не хватает: не переносится ничего.
+    StockTransfer tooMuch(b, a);
+    tooMuch.add("pasta", 950.0).add("sauce", 2000.0);
+    CHECK(!tooMuch.tryMove());
+    CHECK(tooMuch.getShortage() == b.getWorld().ingredient(b.getWorld().find("sauce")));
+    CHECK_EQUAL(1000000LL, pastaB->getMilligrams());
+    StockTransfer move(b, a);
+    move.add("pasta", 950.0).add("sauce", 100.0);
+    CHECK(move.tryMove());
+    CHECK(move.getShortage() == nullptr);
+    CHECK_EQUAL(50000LL, pastaB->getMilligrams());
+    CHECK_EQUAL(1950000LL, pastaA->getMilligrams());
+    CHECK_THROW(move.add("salt", 1.0), IngredientNotFoundException);
+
+    // У второго участка пасты на порцию нет: заказ уходит на первый.
+    RoutedOrder r = fed.route(1);
+    CHECK_EQUAL(0, r.shard);
+    CHECK(r.reject == OrderReject::None);
+    CHECK_EQUAL(600LL, r.readyIn);
+    CHECK(fed.route(2).reject == OrderReject::NoSuchDish);
+    CHECK(fed.route(0).reject == OrderReject::NoSuchDish);
+    CHECK(fed.route(1, 100).reject == OrderReject::OverSla);
+    fed.waitAll();
+    vector<OrderResult> done = a.getEngine().collectResults();
+    CHECK_EQUAL(1u, static_cast<unsigned>(done.size()));
+    CHECK(done[0].ok);
+    CHECK_EQUAL(r.order, done[0].orderId);
+
+    pastaA->useAmount(pastaA->getGrams());
+    CHECK(fed.route(1).reject == OrderReject::Unavailable);
+
+    // Перенос скоропортящегося: сроки партий источника сохраняются, учёт смены не меняется.
+    const char* dairy = "unit g 1\n"
+                        "ingredient milk 300 g 60 perishable shelf 1\n"
+                        "ingredient flour 1000 g 340\n"
+                        "timer t\n"
+                        "cook chef\n";
+    KitchenShard& c = fed.shard(fed.addShard(dairy, TEST_EXPIRY_RECIPES, 1));
+    KitchenShard& d = fed.shard(fed.addShard(dairy, TEST_EXPIRY_RECIPES, 1));
+    ExpiryIndex* ec = c.getWorld().getExpiry();
+    ExpiryIndex* ed = d.getWorld().getExpiry();
+    Ingredient* milkC = c.getWorld().ingredient(c.getWorld().find("milk"));
+    Ingredient* milkD = d.getWorld().ingredient(d.getWorld().find("milk"));
+    CHECK_EQUAL(0u, ec->expire(1000));
+    milkC->addAmount(Grams(100));                      // партия до 4600 с
+    milkC->restore(Ingredient::toMilligrams(50.0));    // запас вне партий уходит первым
+    ShiftLedger ledger(1);
+    NutritionTotals order{0, 0};
+    {
+        LedgerScope scope(&ledger, &order);
+        StockTransfer dairyMove(c, d);
+        dairyMove.add("milk", 400.0);
+        CHECK(dairyMove.tryMove());
+    }
+    CHECK_EQUAL(0LL, order.milliKcal);
+    CHECK_EQUAL(0LL, ledger.shift().milliKcal);
+    vector<StockLot> left = ec->lots(*milkC);
+    CHECK_EQUAL(1u, left.size());
+    if (left.size() == 1) {
+        CHECK_EQUAL(50000LL, left[0].mg);
+        CHECK_EQUAL(4600LL, left[0].expiresAt);
+    }
+    CHECK_EQUAL(700000LL, milkD->getMilligrams());
+    vector<StockLot> moved = ed->lots(*milkD);
+    CHECK_EQUAL(3u, moved.size());
+    if (moved.size() == 3) {
+        CHECK_EQUAL(300000LL, moved[1].mg);
+        CHECK_EQUAL(3600LL, moved[1].expiresAt);        // срок источника, а не 0 + 3600 получателя
+        CHECK_EQUAL(50000LL, moved[2].mg);
+        CHECK_EQUAL(4600LL, moved[2].expiresAt);
+    }
+    CHECK_EQUAL(2u, ed->expire(3600));
+    CHECK_EQUAL(100000LL, milkD->getMilligrams());
+    CHECK_EQUAL(1u, ed->expire(4600));
+    CHECK_EQUAL(50000LL, milkD->getMilligrams());      // перенесённое без партии не портится
+}
+
+// 194
+TEST(KitchenFederation_ConcurrentRoutersShareNoState) {
+    NullSink none;
+    KitchenFederation fed;
+    for (int s = 0; s < 4; ++s) {
+        fed.addShard(TEST_FEDERATION_WORLD, TEST_FEDERATION_RECIPES, 1);
+        fed.shard(s).getEngine().setSink(&none);
+    }
+    atomic<int> accepted(0);
+    vector<thread> routers;
+    for (int t = 0; t < 4; ++t) {
+        routers.emplace_back([&] {
+            for (int i = 0; i < 10; ++i) {
+                if (fed.route(1).reject == OrderReject::None) accepted.fetch_add(1);
+            }
+        });
+    }
+    for (thread& t : routers) t.join();
+    fed.waitAll();
+
+    long long cooked = 0, portions = 0;
+    for (int s = 0; s < fed.size(); ++s) {
+        for (const OrderResult& r : fed.shard(s).getEngine().collectResults()) cooked += r.ok;
+        portions += (1000000LL - fed.shard(s).getWorld().ingredient(fed.shard(s).getWorld().find("pasta"))
+                                     ->getMilligrams()) / 100000;
+        CHECK_EQUAL(0LL, fed.shard(s).getCosts().backlog(PlanResource::Cook));
+    }
+    CHECK(accepted.load() > 0);
+    // Маршрут — оценка: параллельный заказ может забрать порцию у уже принятого.
+    CHECK(cooked > 0 && cooked <= accepted.load());
+    CHECK_EQUAL(cooked, portions);
+}
+
 
-static const int TOTAL_DEFINED_TESTS = 107;
+static const int TOTAL_DEFINED_TESTS = 194;
 
 int main() {
     int failures = UnitTest::RunAllTests();
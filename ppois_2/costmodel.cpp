@@ -0,0 +1,106 @@
+/**
+ * @file costmodel.cpp
+ * @brief Реализация модели стоимости блюд.
+ */
+
+#include "costmodel.hpp"
+
+#include <algorithm>
+
+/* ===== CostModel ===== */
+
+CostModel::CostModel(const RecipeBook& book, const Menu& menu, int cooks)
+    : entries(), items(static_cast<int>(menu.size())), capacity(), numbers(), queued() {
+    capacity = PlannerCapacity::of(book.getKitchen(), cooks < 1 ? 1 : cooks);
+    CapacityPlanner planner(book, capacity);
+    entries.reset(new Entry[static_cast<size_t>(items) + 1]);
+    for (int i = 0; i <= items; ++i) {
+        Entry& e = entries[static_cast<size_t>(i)];
+        e.demand = RecipeDemand{};
+        e.demand.units[static_cast<unsigned>(PlanResource::Cook)] = 1;
+        e.observations.store(0, memory_order_relaxed);
+        if (i == 0) {
+            e.estimate.store(0, memory_order_relaxed);
+            continue;
+        }
+        Dish* d = menu.dishAt(i);
+        const RecipeDish* rd = dynamic_cast<const RecipeDish*>(d);
+        if (rd && rd->getRecipe() < book.size()) e.demand = planner.demandOf(rd->getRecipe());
+        e.estimate.store(e.demand.seconds * 1000, memory_order_relaxed);
+        numbers[d] = i;
+    }
+    for (auto& q : queued) q.store(0, memory_order_relaxed);
+}
+
+const CostModel::Entry* CostModel::entryOf(int item) const {
+    if (item < 1 || item > items) return nullptr;
+    return &entries[static_cast<size_t>(item)];
+}
+
+const RecipeDemand& CostModel::demand(int item) const {
+    const Entry* e = entryOf(item);
+    if (!e) {
+        throw StorageException("Нет такого пункта меню в модели стоимости");
+    }
+    return e->demand;
+}
+
+long long CostModel::estimate(int item) const {
+    const Entry* e = entryOf(item);
+    return e ? (e->estimate.load(memory_order_relaxed) + 999) / 1000 : 0;
+}
+
+uint64_t CostModel::observations(int item) const {
+    const Entry* e = entryOf(item);
+    return e ? e->observations.load(memory_order_relaxed) : 0;
+}
+
+long long CostModel::readyIn(int item) const {
+    const Entry* e = entryOf(item);
+    if (!e) return UNREACHABLE;
+    long long wait = 0;
+    for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+        int units = e->demand.units[r];
+        if (units == 0) continue;
+        if (capacity.units[r] < units) return UNREACHABLE;
+        wait = max(wait, queued[r].load(memory_order_relaxed) / capacity.units[r]);
+    }
+    return (wait + e->estimate.load(memory_order_relaxed) + 999) / 1000;
+}
+
+long long CostModel::backlog(PlanResource r) const {
+    return queued[static_cast<unsigned>(r)].load(memory_order_relaxed) / 1000;
+}
+
+bool CostModel::admit(int item, long long sla, long long& cost) {
+    cost = 0;
+    long long ready = readyIn(item);
+    if (ready == UNREACHABLE || ready > sla) return false;
+    const Entry& e = entries[static_cast<size_t>(item)];
+    // Не меньше 1 мс, чтобы принятый заказ был отличим от принятого без допуска.
+    cost = max(1LL, e.estimate.load(memory_order_relaxed));
+    for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+        if (e.demand.units[r]) queued[r].fetch_add(cost * e.demand.units[r], memory_order_relaxed);
+    }
+    return true;
+}
+
+void CostModel::finished(const Dish* dish, long long cost, long long seconds, bool ok) {
+    auto it = numbers.find(dish);
+    if (it == numbers.end()) return;
+    Entry& e = entries[static_cast<size_t>(it->second)];
+    if (cost > 0) {
+        for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+            if (e.demand.units[r]) queued[r].fetch_sub(cost * e.demand.units[r], memory_order_relaxed);
+        }
+    }
+    if (!ok) return;
+    // Блюдо без программы не имеет статической оценки: первое наблюдение заменяет её.
+    bool first = e.observations.fetch_add(1, memory_order_relaxed) == 0 && e.demand.seconds == 0;
+    long long observed = seconds * 1000;
+    long long old = e.estimate.load(memory_order_relaxed);
+    long long next;
+    do {
+        next = first ? observed : old + (observed - old) / 8;
+    } while (!e.estimate.compare_exchange_weak(old, next, memory_order_relaxed));
+}
@@ -0,0 +1,138 @@
+/**
+ * @file costmodel.hpp
+ * @brief Модель стоимости блюд: «к какому сроку будет готово?» до приготовления.
+ *
+ * Рукописный рецепт узнаёт своё время только после приготовления
+ * (cookBakedMeat() видит cookedMinutes по окончании), а движок берёт
+ * заказы, не зная, успеет ли их отдать. CostModel держит для каждого пункта
+ * меню оценку длительности и занятости ресурсов:
+ * - начальная оценка статическая — по программе рецепта, как у
+ *   CapacityPlanner: длительность — RecipePlan::predictedMakespan(),
+ *   занятость — повар и по единице пула на каждый lease;
+ * - оценка уточняется по ходу работы: работники движка
+ *   (KitchenEngine::setCostModel()) сообщают симулированное время каждого
+ *   приготовленного заказа, и оценка сдвигается к нему скользящим средним
+ *   (вес нового наблюдения 1/8). Так учитываются шаги, которые план не
+ *   видит (разогрев, кипячение), и рукописные блюда без программы.
+ *
+ * Модель считает очередь принятых, но не приготовленных заказов: по
+ * каждому пулу — сумму «оценка × единиц». readyIn() — сколько секунд до
+ * готовности нового заказа, если пулы разбирают очередь без простоев:
+ * самая длинная очередь среди пулов, которые нужны блюду, делённая на
+ * размер пула, плюс оценка самого блюда. Ответ — несколько атомарных чтений
+ * без блокировок, поэтому приём заказов (OrderStream, OrderServer) может
+ * спрашивать его на каждый заказ и отклонять те, что не уложатся в срок
+ * (admit(), причина OrderReject::OverSla).
+ *
+ * Все времена — симулированные секунды. Оценка приблизительная: пулы
+ * общие на всю кухню (как у CapacityPlanner), а проверка и постановка в
+ * очередь двух одновременных admit() не упорядочены между собой.
+ */
+
+#pragma once
+
+#include "planner.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @class CostModel
+ * @brief Оценка длительности пунктов меню, очередь принятых заказов и допуск по сроку.
+ */
+class CostModel {
+private:
+    /**
+     * @struct Entry
+     * @brief Оценка одного пункта меню.
+     */
+    struct alignas(64) Entry {
+        RecipeDemand        demand;       ///< Статическая оценка: длительность и единицы пулов.
+        atomic<long long>   estimate;     ///< Уточнённая длительность, мс.
+        atomic<uint64_t>    observations; ///< Учтённых наблюдений.
+    };
+
+    unique_ptr<Entry[]>             entries;  ///< Пункты 1…items (нулевой не используется).
+    int                             items;    ///< Пунктов меню.
+    PlannerCapacity                 capacity; ///< Размеры пулов.
+    unordered_map<const Dish*, int> numbers;  ///< Блюдо → пункт меню.
+    atomic<long long>               queued[PLAN_RESOURCES]; ///< Очередь пулов, единице-мс.
+
+    /// Пункт или nullptr, если номера нет.
+    const Entry* entryOf(int item) const;
+
+public:
+    static constexpr long long UNREACHABLE = 0x7FFFFFFFFFFFFFFFLL; ///< Кухне не хватает пула на блюдо.
+
+    /**
+     * @brief Строит модель по меню.
+     * @param book Книга рецептов, по которой созданы блюда меню.
+     * @param menu Меню (номера пунктов).
+     * @param cooks Поваров (работников движка).
+     */
+    CostModel(const RecipeBook& book, const Menu& menu, int cooks);
+
+    CostModel(const CostModel&) = delete;
+    CostModel& operator=(const CostModel&) = delete;
+
+    /**
+     * @brief Статическая оценка пункта по программе рецепта.
+     * @param item Пункт меню (с 1).
+     * @return Длительность и единицы пулов (у блюда без программы — только повар).
+     * @throw StorageException если пункта нет.
+     */
+    const RecipeDemand& demand(int item) const;
+
+    /**
+     * @brief Текущая оценка длительности.
+     * @param item Пункт меню (с 1).
+     * @return Секунды (0 у неизвестного пункта).
+     */
+    long long estimate(int item) const;
+
+    /**
+     * @brief Сколько наблюдений учтено в оценке.
+     * @param item Пункт меню (с 1).
+     * @return Наблюдений (0 у неизвестного пункта).
+     */
+    uint64_t observations(int item) const;
+
+    /**
+     * @brief Через сколько будет готов заказ, принятый сейчас.
+     * @param item Пункт меню (с 1).
+     * @return Секунды; UNREACHABLE, если пункта нет или пула не хватает.
+     */
+    long long readyIn(int item) const;
+
+    /**
+     * @brief Очередь пула.
+     * @param r Пул.
+     * @return Сумма оценок принятых заказов, умноженных на их единицы пула, с.
+     */
+    long long backlog(PlanResource r) const;
+
+    /**
+     * @brief Принимает заказ, если он будет готов не позже срока.
+     * @param item Пункт меню (с 1).
+     * @param sla Наибольшее допустимое время до готовности, с.
+     * @param cost Оценка принятого заказа (передать в KitchenEngine::submit()).
+     * @return false, если заказ не уложится в срок (очередь не меняется).
+     */
+    bool admit(int item, long long sla, long long& cost);
+
+    /**
+     * @brief Заказ приготовлен (вызывает работник движка).
+     *
+     * Убирает заказ из очереди и, если блюдо приготовлено, уточняет
+     * оценку его пункта.
+     * @param dish Блюдо.
+     * @param cost Оценка из admit() (0 — заказ принят без допуска).
+     * @param seconds Симулированное время приготовления.
+     * @param ok Блюдо приготовлено.
+     */
+    void finished(const Dish* dish, long long cost, long long seconds, bool ok);
+};
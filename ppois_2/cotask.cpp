@@ -0,0 +1,198 @@
+/**
+ * @file cotask.cpp
+ * @brief Реализация рецептов-сопрограмм и их чередования на одних часах.
+ */
+
+#include "cotask.hpp"
+
+#include <algorithm>
+
+namespace {
+
+/// Сопрограммы потока, ждущие аренды, в порядке засыпания.
+thread_local vector<LeaseAwait*> parkedLeases;
+
+/**
+ * @brief Возобновляет первую ожидающую аренды сопрограмму этих часов, которой она досталась.
+ * @param clock Часы.
+ * @param block Ждать освобождения (событий у часов больше нет).
+ * @return true, если сопрограмма возобновлена.
+ */
+bool wakeParked(SimClock& clock, bool block) {
+    for (size_t i = 0; i < parkedLeases.size(); ++i) {
+        LeaseAwait* w = parkedLeases[i];
+        if (&w->clock != &clock) continue;
+        if (!w->lease.tryAcquire()) {
+            if (!block) continue;
+            // Событий нет — аренду держит другой поток: ждём, как раньше.
+            w->lease.acquire();
+        }
+        parkedLeases.erase(parkedLeases.begin() + static_cast<ptrdiff_t>(i));
+        w->waiter.resume();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Прогоняет часы, повторяя после каждого события попытки ожидающих аренды.
+ * @param clock Часы.
+ */
+void drive(SimClock& clock) {
+    for (;;) {
+        while (wakeParked(clock, false)) {}
+        if (clock.step()) continue;
+        if (!wakeParked(clock, true)) break;
+    }
+}
+
+} // namespace
+
+/* ===== CookTask ===== */
+
+CookTask::CookTask(CookTask&& other) noexcept : h(other.h) {
+    other.h = Handle();
+}
+
+CookTask& CookTask::operator=(CookTask&& other) noexcept {
+    if (this != &other) {
+        if (h) h.destroy();
+        h = other.h;
+        other.h = Handle();
+    }
+    return *this;
+}
+
+CookTask::~CookTask() {
+    if (h) h.destroy();
+}
+
+void CookTask::start() {
+    if (!h || h.promise().begun) return;
+    h.promise().begun = true;
+    h.resume();
+}
+
+bool CookTask::started() const {
+    return !h || h.promise().begun;
+}
+
+bool CookTask::done() const {
+    return !h || h.done();
+}
+
+void CookTask::get() const {
+    if (!done()) {
+        throw StorageException("Cooking task is not finished");
+    }
+    if (h && h.promise().error) rethrow_exception(h.promise().error);
+}
+
+CookStatus CookTask::status() const {
+    if (!done()) return CookStatus::failure(KitchenError::Storage, "Cooking task is not finished");
+    return h ? CookStatus::fromException(h.promise().error) : CookStatus::success();
+}
+
+void CookTask::runOn(SimClock& clock) {
+    start();
+    // Как прежнее блокирующее ожидание: часы прогоняются до конца очереди.
+    if (!done()) drive(clock);
+    if (!done()) {
+        throw StorageException("Cooking task waits for an event the clock does not have");
+    }
+    get();
+}
+
+/* ===== ClockAwait ===== */
+
+void ClockAwait::await_suspend(coroutine_handle<> h) {
+    startedAt = clock.now();
+    // Захват — один дескриптор: function<> хранит его без выделения памяти.
+    auto wake = [h] { h.resume(); };
+    switch (what) {
+    case What::Timer:      clock.onTimerFinished(timer, wake); break;
+    case What::OvenOff:    clock.onOvenOff(oven, wake); break;
+    case What::OvenHeated: clock.onOvenTemperature(oven, temperature, wake); break;
+    case What::Delay:      clock.schedule(seconds, wake); break;
+    }
+}
+
+ClockAwait timerFinished(SimClock& clock, Timer* t) {
+    return ClockAwait{clock, ClockAwait::What::Timer, t, nullptr, 0.0, 0, 0};
+}
+
+ClockAwait ovenOff(SimClock& clock, Oven* o) {
+    return ClockAwait{clock, ClockAwait::What::OvenOff, nullptr, o, 0.0, 0, 0};
+}
+
+ClockAwait ovenReaches(SimClock& clock, Oven* o, double temp) {
+    return ClockAwait{clock, ClockAwait::What::OvenHeated, nullptr, o, temp, 0, 0};
+}
+
+ClockAwait sleepFor(SimClock& clock, long long seconds) {
+    return ClockAwait{clock, ClockAwait::What::Delay, nullptr, nullptr, 0.0, seconds, 0};
+}
+
+/* ===== LeaseAwait ===== */
+
+LeaseAwait::~LeaseAwait() {
+    auto it = find(parkedLeases.begin(), parkedLeases.end(), this);
+    if (it != parkedLeases.end()) parkedLeases.erase(it);
+}
+
+bool LeaseAwait::await_ready() {
+    startedAt = clock.now();
+    return lease.tryAcquire();
+}
+
+void LeaseAwait::await_suspend(coroutine_handle<> h) {
+    waiter = h;
+    parkedLeases.push_back(this);
+}
+
+LeaseAwait leaseAcquired(SimClock& clock, EquipmentLease& lease) {
+    return LeaseAwait{clock, lease, 0, coroutine_handle<>()};
+}
+
+/* ===== DishInterleaver ===== */
+
+DishInterleaver::DishInterleaver(Cook& ck) : cook(ck), tasks() {}
+
+DishInterleaver::~DishInterleaver() {
+    // Ожидающие кадры нельзя разрушить раньше событий, которые их возобновят.
+    if (unfinished()) drive(cook.getClock());
+}
+
+size_t DishInterleaver::spawn(CookTask task) {
+    tasks.push_back(std::move(task));
+    tasks.back().start();
+    return tasks.size() - 1;
+}
+
+size_t DishInterleaver::run() {
+    drive(cook.getClock());
+    size_t ok = 0;
+    for (const CookTask& t : tasks) {
+        if (t.done() && t.status().ok()) ++ok;
+    }
+    return ok;
+}
+
+size_t DishInterleaver::size() const {
+    return tasks.size();
+}
+
+size_t DishInterleaver::unfinished() const {
+    size_t n = 0;
+    for (const CookTask& t : tasks) {
+        if (!t.done()) ++n;
+    }
+    return n;
+}
+
+CookStatus DishInterleaver::status(size_t i) const {
+    if (i >= tasks.size()) {
+        throw StorageException("No such dish in interleaver");
+    }
+    return tasks[i].status();
+}
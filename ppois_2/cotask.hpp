@@ -0,0 +1,309 @@
+/**
+ * @file cotask.hpp
+ * @brief Рецепты-сопрограммы: ожидание таймера или духовки без блокировки потока.
+ *
+ * Рукописный рецепт (Cook::cookPancakes(), Cook::cookBakedMeat() и другие)
+ * занимает вызывающий поток на всё время блюда: каждое ожидание прогоняет
+ * часы повара до конца. Тот же рецепт в виде сопрограммы C++20
+ * (Cook::cookPancakesTask() и т.д.) на ожидании регистрирует в часах
+ * событие, которое возобновит именно его, и засыпает. Ожидающее блюдо —
+ * это один приостановленный кадр сопрограммы, поэтому один поток
+ * ведёт сколько угодно начатых блюд на общих часах (DishInterleaver),
+ * без циклов с tick() и без потока на блюдо.
+ *
+ * Ожидания:
+ * @code
+ * long long s = co_await timerFinished(clock, timer);  // таймер дошёл до нуля
+ * long long s = co_await ovenOff(clock, oven);         // духовка выключилась
+ * long long s = co_await ovenReaches(clock, oven, 180);// духовка нагрелась
+ * long long s = co_await sleepFor(clock, 60);          // просто прошло 60 с
+ * long long s = co_await leaseAcquired(clock, lease);  // оборудование получено
+ * @endcode
+ * Результат co_await — сколько секунд симуляции прошло. Событие часов
+ * хранит только дескриптор сопрограммы (8 байт), поэтому SimClock::Action
+ * не выделяет памяти; выделяется лишь кадр самой сопрограммы.
+ *
+ * Исключения предметной области внутри сопрограммы не вылетают из часов:
+ * они сохраняются в задаче и бросаются из CookTask::get() (или
+ * переводятся в CookStatus через CookTask::status()).
+ *
+ * Задача и её часы живут вместе: пока задача ждёт события, часы,
+ * которые это событие выполнят, нельзя продвигать после разрушения задачи.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+#include "engine.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class CookTask
+ * @brief Приготовление блюда в виде сопрограммы (ленивое: начинается по start()).
+ */
+class CookTask {
+public:
+    /**
+     * @struct promise_type
+     * @brief Состояние сопрограммы: запущена ли и чем закончилась.
+     */
+    struct promise_type {
+        exception_ptr error = nullptr; ///< Исключение из тела рецепта.
+        bool          begun = false;   ///< start() уже вызван.
+
+        CookTask get_return_object() {
+            return CookTask(coroutine_handle<promise_type>::from_promise(*this));
+        }
+        suspend_always initial_suspend() noexcept { return {}; }
+        suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = current_exception(); }
+    };
+
+    using Handle = coroutine_handle<promise_type>; ///< Дескриптор кадра.
+
+private:
+    Handle h; ///< Кадр сопрограммы или пусто.
+
+    explicit CookTask(Handle c) : h(c) {}
+
+public:
+    /// Пустая задача (done() == true).
+    CookTask() : h() {}
+
+    CookTask(const CookTask&) = delete;
+    CookTask& operator=(const CookTask&) = delete;
+
+    /// Забирает кадр у другой задачи.
+    CookTask(CookTask&& other) noexcept;
+
+    /// Освобождает свой кадр и забирает чужой.
+    CookTask& operator=(CookTask&& other) noexcept;
+
+    /// Освобождает кадр (локальные объекты рецепта разрушаются, резерв отменяется).
+    ~CookTask();
+
+    /**
+     * @brief Начинает рецепт: исполняет его до первого ожидания или до конца.
+     *
+     * Повторный вызов ничего не делает.
+     */
+    void start();
+
+    /**
+     * @brief Запущена ли задача.
+     * @return true после start() (и у пустой задачи).
+     */
+    bool started() const;
+
+    /**
+     * @brief Завершён ли рецепт (успешно или исключением).
+     * @return true, если кадр дошёл до конца или задача пуста.
+     */
+    bool done() const;
+
+    /**
+     * @brief Бросает исключение рецепта, если оно было.
+     * @throw Исключение из тела рецепта.
+     * @throw StorageException если рецепт ещё не завершён.
+     */
+    void get() const;
+
+    /**
+     * @brief Итог рецепта кодом (как Dish::tryCookWith()).
+     * @return success(), код исключения предметной области или Storage, пока рецепт не завершён.
+     * @throw Исключения, не относящиеся к предметной области.
+     */
+    CookStatus status() const;
+
+    /**
+     * @brief Доводит рецепт до конца на часах: start(), затем все события часов.
+     * @param clock Часы, по которым рецепт ждёт.
+     * @throw Исключение из тела рецепта.
+     * @throw StorageException если рецепт ждёт события, которого в часах нет.
+     */
+    void runOn(SimClock& clock);
+};
+
+/**
+ * @struct ClockAwait
+ * @brief Ожидание события часов: сопрограмма засыпает, событие её возобновляет.
+ */
+struct ClockAwait {
+    /// Вид ожидаемого события.
+    enum class What : unsigned char {
+        Timer,       ///< Таймер дошёл до нуля.
+        OvenOff,     ///< Духовка выключилась по таймеру выпечки.
+        OvenHeated,  ///< Духовка нагрелась до temperature.
+        Delay        ///< Прошло seconds секунд.
+    };
+
+    SimClock& clock;       ///< Часы.
+    What      what;        ///< Что ждём.
+    Timer*    timer;       ///< Таймер (What::Timer).
+    Oven*     oven;        ///< Духовка (What::OvenOff, What::OvenHeated).
+    double    temperature; ///< Температура (What::OvenHeated).
+    long long seconds;     ///< Задержка (What::Delay).
+    long long startedAt;   ///< Момент засыпания.
+
+    /// Всегда засыпаем: событие придёт из часов.
+    bool await_ready() const noexcept { return false; }
+
+    /**
+     * @brief Регистрирует в часах событие, возобновляющее сопрограмму.
+     * @param h Сопрограмма.
+     * @throw TimerNotSetException / InvalidTemperatureException как у SimClock::onXxx().
+     */
+    void await_suspend(coroutine_handle<> h);
+
+    /// Сколько секунд симуляции прошло.
+    long long await_resume() const noexcept { return clock.now() - startedAt; }
+};
+
+/**
+ * @brief Ожидание окончания таймера.
+ * @param clock Часы.
+ * @param t Запущенный таймер.
+ * @return Ожидание для co_await.
+ */
+ClockAwait timerFinished(SimClock& clock, Timer* t);
+
+/**
+ * @brief Ожидание выключения духовки по таймеру выпечки.
+ * @param clock Часы.
+ * @param o Духовка.
+ * @return Ожидание для co_await.
+ */
+ClockAwait ovenOff(SimClock& clock, Oven* o);
+
+/**
+ * @brief Ожидание нагрева духовки.
+ * @param clock Часы.
+ * @param o Духовка.
+ * @param temp Температура, °C.
+ * @return Ожидание для co_await.
+ */
+ClockAwait ovenReaches(SimClock& clock, Oven* o, double temp);
+
+/**
+ * @brief Ожидание заданного времени.
+ * @param clock Часы.
+ * @param seconds Секунды симуляции.
+ * @return Ожидание для co_await.
+ */
+ClockAwait sleepFor(SimClock& clock, long long seconds);
+
+/**
+ * @struct LeaseAwait
+ * @brief Ожидание аренды оборудования без блокировки потока.
+ *
+ * Если оборудование занято, сопрограмма засыпает в списке ожидающих
+ * аренды своего потока. Исполнитель задач (CookTask::runOn(),
+ * DishInterleaver::run()) после каждого события часов повторяет попытки
+ * ожидающих: занявшее оборудование блюдо того же потока успевает
+ * закончить и освободить его. Если событий больше нет, оборудованием
+ * владеет повар другого потока, и ожидание становится блокирующим, как
+ * EquipmentLease::acquire(). Часы, прогоняемые напрямую (SimClock::run()),
+ * ожидающих аренды не будят.
+ */
+struct LeaseAwait {
+    SimClock&          clock;     ///< Часы ожидающей сопрограммы.
+    EquipmentLease&    lease;     ///< Аренда.
+    long long          startedAt; ///< Момент начала ожидания.
+    coroutine_handle<> waiter;    ///< Ждущая сопрограмма или пусто.
+
+    /// Убирает себя из списка ожидающих (кадр разрушен до получения аренды).
+    ~LeaseAwait();
+
+    /**
+     * @brief Пытается получить аренду сразу.
+     * @return true, если аренда получена (засыпать не нужно).
+     */
+    bool await_ready();
+
+    /**
+     * @brief Засыпает в списке ожидающих аренды.
+     * @param h Сопрограмма.
+     */
+    void await_suspend(coroutine_handle<> h);
+
+    /// Сколько секунд симуляции заняло ожидание.
+    long long await_resume() const noexcept { return clock.now() - startedAt; }
+};
+
+/**
+ * @brief Ожидание аренды оборудования.
+ * @param clock Часы.
+ * @param lease Аренда с заполненным набором.
+ * @return Ожидание для co_await.
+ */
+LeaseAwait leaseAcquired(SimClock& clock, EquipmentLease& lease);
+
+/**
+ * @class DishInterleaver
+ * @brief Много начатых блюд одного повара на одном потоке и одних часах.
+ *
+ * spawn() начинает рецепт, и он идёт до первого ожидания; run() прогоняет
+ * часы повара, и каждое событие возобновляет своё блюдо. Блюда не ждут
+ * друг друга: пока одно варится, остальные продолжают. Общие инструменты
+ * и продукты разбираются так же, как у поваров движка заказов (аренда и
+ * резерв), поэтому блюдам нужны свои таймеры. Блюдо, которому не
+ * досталась аренда, не блокирует поток: оно ждёт (leaseAcquired()), пока
+ * занявшее инструмент блюдо не освободит его.
+ */
+class DishInterleaver {
+private:
+    Cook&            cook;  ///< Повар, чьи часы ведут блюда.
+    vector<CookTask> tasks; ///< Блюда в порядке spawn().
+
+public:
+    /**
+     * @brief Создаёт пустой набор блюд повара.
+     * @param ck Повар.
+     */
+    explicit DishInterleaver(Cook& ck);
+
+    DishInterleaver(const DishInterleaver&) = delete;
+    DishInterleaver& operator=(const DishInterleaver&) = delete;
+
+    /// Доводит незавершённые блюда до конца (часы повара прогоняются).
+    ~DishInterleaver();
+
+    /**
+     * @brief Начинает блюдо.
+     * @param task Рецепт-сопрограмма (например, cook.cookPancakesTask(&dish)).
+     * @return Номер блюда.
+     */
+    size_t spawn(CookTask task);
+
+    /**
+     * @brief Прогоняет часы повара, пока есть события.
+     * @return Сколько блюд завершилось успешно (из всех начатых).
+     */
+    size_t run();
+
+    /**
+     * @brief Число начатых блюд.
+     * @return Размер набора.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Сколько блюд ещё ждут.
+     * @return Незавершённых блюд.
+     */
+    size_t unfinished() const;
+
+    /**
+     * @brief Итог блюда.
+     * @param i Номер блюда.
+     * @return Итог (Storage, пока блюдо не завершено).
+     * @throw StorageException если номера нет.
+     */
+    CookStatus status(size_t i) const;
+};
@@ -0,0 +1,289 @@
+/**
+ * @file engine.cpp
+ * @brief Реализация движка исполнения заказов и аренды оборудования.
+ */
+
+#include "engine.hpp"
+#include "session.hpp"
+#include "costmodel.hpp"
+#include "expiry.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+/// Привязывает поток к набору процессоров.
+bool pinHandle(thread::native_handle_type h, const vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for (int c : cpus) {
+        if (c < 0 || c >= CPU_SETSIZE) continue;
+        CPU_SET(c, &set);
+        any = true;
+    }
+    return any && pthread_setaffinity_np(h, sizeof(set), &set) == 0;
+#else
+    (void)h;
+    (void)cpus;
+    return false;
+#endif
+}
+
+} // namespace
+
+bool pinCurrentThread(const vector<int>& cpus) {
+#if defined(__linux__)
+    return pinHandle(pthread_self(), cpus);
+#else
+    return pinHandle(thread::native_handle_type(), cpus);
+#endif
+}
+
+/* ===== EquipmentLease ===== */
+
+EquipmentLease::EquipmentLease()
+    : tools(), ovens(), stoves(), held(false) {}
+
+EquipmentLease::~EquipmentLease() {
+    release();
+}
+
+EquipmentLease& EquipmentLease::add(KitchenTool* t) {
+    if (t) tools.push_back(t);
+    return *this;
+}
+
+EquipmentLease& EquipmentLease::add(Oven* o) {
+    if (o) ovens.push_back(o);
+    return *this;
+}
+
+EquipmentLease& EquipmentLease::add(Stove* s) {
+    if (s) stoves.push_back(s);
+    return *this;
+}
+
+EquipmentLease& EquipmentLease::add(Timer* t) {
+    // Рецепт может запускать один таймер несколько раз — арендуется он однажды.
+    if (t && find(timers.begin(), timers.end(), t) == timers.end()) timers.push_back(t);
+    return *this;
+}
+
+bool EquipmentLease::tryAcquire() {
+    if (held) return true;
+
+    size_t t = 0, o = 0, s = 0, c = 0;
+    while (t < tools.size() && tools[t]->tryLease()) ++t;
+    if (t == tools.size()) {
+        while (o < ovens.size() && ovens[o]->tryLease()) ++o;
+        if (o == ovens.size()) {
+            while (s < stoves.size() && stoves[s]->tryLeaseBurner()) ++s;
+            if (s == stoves.size()) {
+                while (c < timers.size() && timers[c]->tryLease()) ++c;
+                if (c == timers.size()) {
+                    held = true;
+                    return true;
+                }
+            }
+        }
+    }
+
+    // Откат: отпускаем всё, что успели захватить.
+    while (c > 0) timers[--c]->releaseLease();
+    while (s > 0) stoves[--s]->releaseBurner();
+    while (o > 0) ovens[--o]->releaseLease();
+    while (t > 0) tools[--t]->releaseLease();
+    return false;
+}
+
+void EquipmentLease::acquire() {
+    int spins = 0;
+    while (!tryAcquire()) {
+        if (++spins < 64) {
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(50));
+        }
+    }
+}
+
+void EquipmentLease::release() {
+    if (!held) return;
+    for (KitchenTool* t : tools) t->releaseLease();
+    for (Oven* o : ovens) o->releaseLease();
+    for (Stove* s : stoves) s->releaseBurner();
+    for (Timer* t : timers) t->releaseLease();
+    held = false;
+}
+
+bool EquipmentLease::isHeld() const {
+    return held;
+}
+
+/* ===== KitchenEngine ===== */
+
+KitchenEngine::KitchenEngine(int workerCount, size_t queueCapacity)
+    : orders(queueCapacity),
+      cookNames(),
+      cooks(),
+      results(),
+      workers(),
+      stopping(false),
+      nextId(1),
+      submitted(0),
+      finished(0),
+      ledger(nullptr),
+      listener(nullptr),
+      recorder(nullptr),
+      costs(nullptr),
+      expiry(nullptr) {
+    if (workerCount < 1) workerCount = 1;
+    cookNames.reserve(static_cast<size_t>(workerCount));
+    for (int i = 0; i < workerCount; ++i) {
+        cookNames.push_back("Повар " + to_string(i + 1));
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        cooks.push_back(make_unique<Cook>(cookNames[static_cast<size_t>(i)].c_str()));
+    }
+    results.resize(static_cast<size_t>(workerCount));
+    for (auto& part : results) {
+        part.reserve(orders.capacity() / static_cast<size_t>(workerCount) + 1);
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&KitchenEngine::workerLoop, this, i);
+    }
+}
+
+KitchenEngine::~KitchenEngine() {
+    shutdown();
+}
+
+void KitchenEngine::workerLoop(int index) {
+    Cook& cook = *cooks[static_cast<size_t>(index)];
+    vector<OrderResult>& mine = results[static_cast<size_t>(index)];
+    int idle = 0;
+
+    while (true) {
+        Order order{0, nullptr, 0};
+        if (!orders.tryPop(order)) {
+            if (stopping.load(memory_order_acquire)) return;
+            if (++idle < 64) {
+                this_thread::yield();
+            } else {
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+            continue;
+        }
+        idle = 0;
+
+        OrderResult r{order.id, order.dish->getName(), true, nullptr, index, 0,
+                      CookStatus::success(), NutritionTotals{0, 0}};
+        long long startedAt = cook.getClock().now();
+        if (expiry) expiry->expire(startedAt);
+        if (recorder) recorder->started(index, order.id, order.dish, startedAt);
+        LedgerScope account(ledger, &r.nutrition);
+        try {
+            r.status = order.dish->tryCookWith(&cook);
+        } catch (const exception&) {
+            r.status = CookStatus::failure(KitchenError::Storage);
+        }
+        if (!r.status.ok()) {
+            r.ok = false;
+            r.error = r.status.message;
+        }
+        r.simSeconds = cook.getClock().now() - startedAt;
+        if (recorder) recorder->finished(index, r, startedAt + r.simSeconds);
+        if (costs) costs->finished(order.dish, order.cost, r.simSeconds, r.ok);
+        if (listener) listener->orderFinished(r);
+        else          mine.push_back(r);
+        finished.fetch_add(1, memory_order_release);
+    }
+}
+
+int KitchenEngine::submit(Dish* d, long long cost) {
+    if (!d) {
+        throw IngredientNotFoundException("Order without dish");
+    }
+    Order order{nextId.fetch_add(1, memory_order_relaxed), d, cost};
+    submitted.fetch_add(1, memory_order_relaxed);
+    while (!orders.tryPush(order)) {
+        this_thread::yield();
+    }
+    return order.id;
+}
+
+void KitchenEngine::waitAll() {
+    while (finished.load(memory_order_acquire) < submitted.load(memory_order_relaxed)) {
+        this_thread::sleep_for(chrono::microseconds(100));
+    }
+}
+
+vector<OrderResult> KitchenEngine::collectResults() {
+    vector<OrderResult> all;
+    collectResults(all);
+    return all;
+}
+
+void KitchenEngine::collectResults(vector<OrderResult>& out) {
+    out.clear();
+    for (auto& part : results) {
+        out.insert(out.end(), part.begin(), part.end());
+        part.clear();
+    }
+    sort(out.begin(), out.end(),
+         [](const OrderResult& a, const OrderResult& b) { return a.orderId < b.orderId; });
+}
+
+bool KitchenEngine::pinWorkers(const vector<int>& cpus) {
+    bool ok = !workers.empty();
+    for (thread& t : workers) ok = pinHandle(t.native_handle(), cpus) && ok;
+    return ok;
+}
+
+int KitchenEngine::workerCount() const {
+    return static_cast<int>(cooks.size());
+}
+
+void KitchenEngine::setLedger(ShiftLedger* l) {
+    ledger = l;
+}
+
+void KitchenEngine::setListener(OrderListener* l) {
+    listener = l;
+}
+
+void KitchenEngine::setRecorder(SessionRecorder* r) {
+    recorder = r;
+}
+
+void KitchenEngine::setCostModel(CostModel* m) {
+    costs = m;
+}
+
+void KitchenEngine::setExpiry(ExpiryIndex* e) {
+    expiry = e;
+}
+
+void KitchenEngine::setSink(EventSink* s) {
+    for (auto& ck : cooks) {
+        ck->setSink(s);
+    }
+}
+
+void KitchenEngine::shutdown() {
+    if (workers.empty()) return;
+    waitAll();
+    stopping.store(true, memory_order_release);
+    for (auto& w : workers) {
+        if (w.joinable()) w.join();
+    }
+    workers.clear();
+}
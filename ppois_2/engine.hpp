@@ -0,0 +1,413 @@
+/**
+ * @file engine.hpp
+ * @brief Многопоточный движок исполнения заказов: пул поваров, очередь заказов и аренда оборудования.
+ *
+ * Заказы попадают в ограниченную lock-free очередь MPMC, из которой их
+ * забирают N потоков-работников, у каждого из которых свой объект Cook.
+ * Общее оборудование (конфорки плиты, духовка, сковороды, кастрюли, миксер)
+ * выдаётся поварам через аренду EquipmentLease: повар либо получает весь
+ * набор оборудования для рецепта сразу, либо не получает ничего и ждёт.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+#include "smallvec.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class SessionRecorder;
+class CostModel;
+class ExpiryIndex;
+
+/**
+ * @brief Привязывает текущий поток к процессорам.
+ * @param cpus Номера процессоров (недопустимые пропускаются).
+ * @return false, если допустимых номеров нет или система привязку не поддерживает (только Linux).
+ */
+bool pinCurrentThread(const vector<int>& cpus);
+
+/**
+ * @class MpmcQueue
+ * @brief Ограниченная lock-free очередь «много производителей — много потребителей».
+ *
+ * Кольцевой буфер с порядковым номером в каждой ячейке (схема Д. Вьюкова):
+ * производители и потребители захватывают позиции через compare_exchange
+ * и никогда не блокируют друг друга мьютексом.
+ *
+ * @tparam T Тип элемента (копируемый, конструируемый по умолчанию).
+ */
+template <typename T>
+class MpmcQueue {
+private:
+    /**
+     * @struct Cell
+     * @brief Ячейка кольцевого буфера.
+     */
+    struct Cell {
+        atomic<size_t> seq;  ///< Номер поколения ячейки.
+        T              data; ///< Хранимый элемент.
+    };
+
+    unique_ptr<Cell[]> cells;             ///< Кольцевой буфер.
+    size_t             mask;              ///< Ёмкость - 1 (ёмкость — степень двойки).
+    alignas(64) atomic<size_t> enqueuePos; ///< Позиция записи.
+    alignas(64) atomic<size_t> dequeuePos; ///< Позиция чтения.
+
+public:
+    /**
+     * @brief Создаёт очередь.
+     * @param capacity Желаемая ёмкость (округляется вверх до степени двойки, минимум 2).
+     */
+    explicit MpmcQueue(size_t capacity = 1024)
+        : cells(), mask(0), enqueuePos(0), dequeuePos(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].seq.store(i, memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    /**
+     * @brief Пытается положить элемент в очередь.
+     * @param value Элемент.
+     * @return false, если очередь заполнена.
+     */
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(memory_order_acquire);
+            long long diff = static_cast<long long>(seq) - static_cast<long long>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.data = value;
+                    cell.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Пытается забрать элемент из очереди.
+     * @param out Куда записать элемент.
+     * @return false, если очередь пуста.
+     */
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(memory_order_acquire);
+            long long diff = static_cast<long long>(seq) - static_cast<long long>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    out = cell.data;
+                    cell.seq.store(pos + mask + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Ёмкость очереди.
+     * @return Максимальное число элементов.
+     */
+    size_t capacity() const {
+        return mask + 1;
+    }
+};
+
+/**
+ * @class EquipmentLease
+ * @brief Аренда набора оборудования на время приготовления блюда.
+ *
+ * Захват «всё или ничего»: если хотя бы одна единица оборудования занята,
+ * уже полученные освобождаются. Поэтому повар никогда не держит часть
+ * оборудования, ожидая остальное, и взаимная блокировка невозможна.
+ * Освобождение происходит в деструкторе, в том числе при исключении.
+ * Типичный набор рецепта хранится в самом объекте, без выделения памяти.
+ * Таймеры, которые запускает блюдо, арендуются вместе с остальным
+ * оборудованием: общий таймер не может запустить повар другого блюда.
+ */
+class EquipmentLease {
+private:
+    SmallVector<KitchenTool*, 8> tools;  ///< Арендуемые инструменты.
+    SmallVector<Oven*, 2>        ovens;  ///< Арендуемые духовки.
+    SmallVector<Stove*, 2>       stoves; ///< Плиты, на которых арендуется по одной конфорке.
+    SmallVector<Timer*, 4>       timers; ///< Арендуемые таймеры.
+    bool                         held;   ///< Аренда получена.
+
+public:
+    /**
+     * @brief Создаёт пустую аренду.
+     */
+    EquipmentLease();
+
+    EquipmentLease(const EquipmentLease&) = delete;
+    EquipmentLease& operator=(const EquipmentLease&) = delete;
+
+    /// Освобождает оборудование, если аренда получена.
+    ~EquipmentLease();
+
+    /**
+     * @brief Добавляет инструмент в набор (nullptr игнорируется).
+     * @param t Инструмент.
+     * @return *this для цепочки вызовов.
+     */
+    EquipmentLease& add(KitchenTool* t);
+
+    /**
+     * @brief Добавляет духовку в набор (nullptr игнорируется).
+     * @param o Духовка.
+     * @return *this для цепочки вызовов.
+     */
+    EquipmentLease& add(Oven* o);
+
+    /**
+     * @brief Добавляет одну конфорку плиты в набор (nullptr игнорируется).
+     * @param s Плита.
+     * @return *this для цепочки вызовов.
+     */
+    EquipmentLease& add(Stove* s);
+
+    /**
+     * @brief Добавляет таймер в набор (nullptr и повтор игнорируются).
+     * @param t Таймер.
+     * @return *this для цепочки вызовов.
+     */
+    EquipmentLease& add(Timer* t);
+
+    /**
+     * @brief Пытается получить всё оборудование сразу.
+     * @return true, если аренда получена; иначе ничего не удерживается.
+     */
+    bool tryAcquire();
+
+    /**
+     * @brief Ждёт, пока всё оборудование не освободится, и получает его.
+     */
+    void acquire();
+
+    /**
+     * @brief Освобождает оборудование (повторный вызов безопасен).
+     */
+    void release();
+
+    /**
+     * @brief Проверяет, удерживается ли аренда.
+     * @return true, если оборудование получено.
+     */
+    bool isHeld() const;
+};
+
+/**
+ * @struct Order
+ * @brief Заказ в очереди движка.
+ */
+struct Order {
+    int       id;   ///< Номер заказа.
+    Dish*     dish; ///< Заказанное блюдо.
+    long long cost; ///< Оценка заказа при допуске (CostModel::admit()), 0 — без допуска.
+};
+
+/**
+ * @struct OrderResult
+ * @brief Итог выполнения заказа.
+ *
+ * Запись тривиально копируемая: итог заказа сохраняется без выделения
+ * памяти (текст исключения не копируется, как и в Dish::tryCookWith()).
+ */
+struct OrderResult {
+    int             orderId;    ///< Номер заказа.
+    const char*     dishName;   ///< Название блюда.
+    bool            ok;         ///< Блюдо успешно приготовлено.
+    const char*     error;      ///< Текст ошибки (строка с постоянным временем жизни), если ok == false; иначе nullptr.
+    int             worker;     ///< Номер повара-работника.
+    long long       simSeconds; ///< Симулированное время приготовления.
+    CookStatus      status;     ///< Код отказа и виновник (см. Dish::tryCookWith()).
+    NutritionTotals nutrition;  ///< Калории и себестоимость израсходованного (см. ledger.hpp).
+};
+
+/**
+ * @class OrderListener
+ * @brief Получатель итогов заказов по мере готовности (например, сетевой приём заказов).
+ */
+class OrderListener {
+public:
+    virtual ~OrderListener() {}
+
+    /**
+     * @brief Заказ выполнен (вызывается из потока работника).
+     * @param r Итог заказа.
+     */
+    virtual void orderFinished(const OrderResult& r) = 0;
+};
+
+/**
+ * @class KitchenEngine
+ * @brief Движок исполнения заказов с пулом поваров-работников.
+ *
+ * Каждый работник — отдельный поток со своим объектом Cook. Работники
+ * забирают заказы из общей lock-free очереди и готовят их через
+ * Dish::cookWith(), а оборудование делят через EquipmentLease.
+ */
+class KitchenEngine {
+private:
+    MpmcQueue<Order>            orders;     ///< Очередь заказов.
+    vector<string>              cookNames;  ///< Имена поваров (хранилище для Cook::name).
+    vector<unique_ptr<Cook>>    cooks;      ///< Повара-работники.
+    vector<vector<OrderResult>> results;    ///< Итоги по каждому работнику.
+    vector<thread>              workers;    ///< Потоки работников.
+    atomic<bool>                stopping;   ///< Признак остановки движка.
+    atomic<int>                 nextId;     ///< Следующий номер заказа.
+    atomic<long long>           submitted;  ///< Сколько заказов принято.
+    atomic<long long>           finished;   ///< Сколько заказов выполнено.
+    ShiftLedger*                ledger;     ///< Журнал смены или nullptr.
+    OrderListener*              listener;   ///< Получатель итогов или nullptr.
+    SessionRecorder*            recorder;   ///< Запись сеанса или nullptr.
+    CostModel*                  costs;      ///< Модель стоимости или nullptr.
+    ExpiryIndex*                expiry;     ///< Сроки годности мира или nullptr.
+
+    /**
+     * @brief Цикл работника: забирает и готовит заказы до остановки.
+     * @param index Номер работника.
+     */
+    void workerLoop(int index);
+
+public:
+    /**
+     * @brief Создаёт движок и запускает работников.
+     * @param workerCount Число поваров-работников (минимум 1).
+     * @param queueCapacity Ёмкость очереди заказов.
+     */
+    explicit KitchenEngine(int workerCount, size_t queueCapacity = 1024);
+
+    KitchenEngine(const KitchenEngine&) = delete;
+    KitchenEngine& operator=(const KitchenEngine&) = delete;
+
+    /// Дожидается выполнения принятых заказов и останавливает работников.
+    ~KitchenEngine();
+
+    /**
+     * @brief Принимает заказ (ждёт, если очередь заполнена).
+     * @param d Блюдо.
+     * @param cost Оценка из CostModel::admit() (0 — заказ принят без допуска).
+     * @return Номер заказа.
+     * @throw IngredientNotFoundException если d == nullptr.
+     */
+    int submit(Dish* d, long long cost = 0);
+
+    /**
+     * @brief Ждёт, пока все принятые заказы не будут выполнены.
+     */
+    void waitAll();
+
+    /**
+     * @brief Забирает накопленные итоги (вызывать после waitAll()).
+     * @return Итоги, упорядоченные по номеру заказа.
+     */
+    vector<OrderResult> collectResults();
+
+    /**
+     * @brief Забирает накопленные итоги в out (вызывать после waitAll()).
+     *
+     * Прежнее содержимое out заменяется; ёмкость out переиспользуется,
+     * поэтому при повторных вызовах память не выделяется.
+     * @param out Куда записать итоги, упорядоченные по номеру заказа.
+     */
+    void collectResults(vector<OrderResult>& out);
+
+    /**
+     * @brief Число работников.
+     * @return Размер пула поваров.
+     */
+    int workerCount() const;
+
+    /**
+     * @brief Подключает журнал событий ко всем поварам-работникам.
+     *
+     * Вызывать до submit(): повара читают приёмник без синхронизации.
+     * @param s Приёмник или nullptr (текстовый вывод).
+     */
+    void setSink(EventSink* s);
+
+    /**
+     * @brief Подключает журнал смены для калорий и себестоимости заказов.
+     *
+     * Вызывать до submit(). Итог каждого заказа попадает в
+     * OrderResult::nutrition и независимо от журнала.
+     * @param l Журнал или nullptr.
+     */
+    void setLedger(ShiftLedger* l);
+
+    /**
+     * @brief Передаёт итоги заказов получателю по мере готовности.
+     *
+     * Вызывать до submit(). Итоги с получателем не копятся для
+     * collectResults(), поэтому долгая работа движка не растит память.
+     * @param l Получатель или nullptr (итоги копятся для collectResults()).
+     */
+    void setListener(OrderListener* l);
+
+    /**
+     * @brief Записывает начало и итог каждого заказа в журнал сеанса (см. session.hpp).
+     *
+     * Вызывать до submit(). Журнал создаётся с тем же числом работников.
+     * @param r Запись сеанса или nullptr.
+     */
+    void setRecorder(SessionRecorder* r);
+
+    /**
+     * @brief Сообщает модели стоимости время каждого заказа (см. costmodel.hpp).
+     *
+     * Вызывать до submit(). Заказ уходит из очереди модели и уточняет
+     * оценку своего пункта меню.
+     * @param m Модель или nullptr.
+     */
+    void setCostModel(CostModel* m);
+
+    /**
+     * @brief Списывает просрочку по часам работников (см. expiry.hpp).
+     *
+     * Вызывать до submit(). Перед каждым заказом работник вызывает
+     * ExpiryIndex::expire() со своим временем, поэтому продукты портятся и
+     * тогда, когда время идёт только у работников, а не у повара мира.
+     * @param e Индекс мира (KitchenWorld::getExpiry()) или nullptr.
+     */
+    void setExpiry(ExpiryIndex* e);
+
+    /**
+     * @brief Привязывает работников к процессорам (например, к ядрам одного узла NUMA).
+     *
+     * Каждый работник может выполняться на любом процессоре из набора.
+     * @param cpus Номера процессоров.
+     * @return false, если набор пуст или система привязку не поддерживает (только Linux).
+     */
+    bool pinWorkers(const vector<int>& cpus);
+
+    /**
+     * @brief Останавливает работников после выполнения принятых заказов.
+     */
+    void shutdown();
+};
@@ -0,0 +1,171 @@
+/**
+ * @file eventlog.cpp
+ * @brief Реализация журнала событий кухни.
+ */
+
+#include "eventlog.hpp"
+#include "recipe.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+thread_local LogContext currentLog{nullptr, 0, 0, nullptr};
+
+} // namespace
+
+/* ===== LogContext ===== */
+
+LogContext& logContext() {
+    return currentLog;
+}
+
+bool logEvent(EventKind kind, double value) {
+    LogContext& ctx = currentLog;
+    if (!ctx.sink) return false;
+    KitchenEvent e{ctx.clock ? ctx.clock->now() : 0, value, ctx.dish, ctx.step, kind, 0};
+    ctx.sink->record(e);
+    return true;
+}
+
+LogScope::LogScope(EventSink* sink, unsigned dish, const SimClock* clock)
+    : saved(currentLog) {
+    currentLog = LogContext{sink, dish, 0, clock};
+}
+
+LogScope::~LogScope() {
+    currentLog = saved;
+}
+
+/* ===== RingBufferSink ===== */
+
+RingBufferSink::RingBufferSink(ostream* binaryOut, size_t capacity)
+    : ring(capacity),
+      out(binaryOut),
+      recorded(0),
+      written(0),
+      dropped(0),
+      stopping(false),
+      flusher() {
+    flusher = thread(&RingBufferSink::flushLoop, this);
+}
+
+RingBufferSink::~RingBufferSink() {
+    stopping.store(true, memory_order_release);
+    if (flusher.joinable()) flusher.join();
+    drain();
+    if (out) out->flush();
+}
+
+void RingBufferSink::record(const KitchenEvent& e) {
+    if (ring.tryPush(e)) {
+        recorded.fetch_add(1, memory_order_relaxed);
+    } else {
+        dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void RingBufferSink::drain() {
+    KitchenEvent batch[256];
+    size_t n = 0;
+    KitchenEvent e;
+    while (ring.tryPop(e)) {
+        batch[n++] = e;
+        if (n == 256) {
+            if (out) out->write(reinterpret_cast<const char*>(batch), sizeof(batch));
+            written.fetch_add(static_cast<long long>(n), memory_order_release);
+            n = 0;
+        }
+    }
+    if (n > 0) {
+        if (out) out->write(reinterpret_cast<const char*>(batch),
+                            static_cast<streamsize>(n * sizeof(KitchenEvent)));
+        written.fetch_add(static_cast<long long>(n), memory_order_release);
+    }
+}
+
+void RingBufferSink::flushLoop() {
+    while (!stopping.load(memory_order_acquire)) {
+        drain();
+        this_thread::sleep_for(chrono::microseconds(200));
+    }
+}
+
+void RingBufferSink::flush() {
+    while (written.load(memory_order_acquire) < recorded.load(memory_order_relaxed)) {
+        this_thread::sleep_for(chrono::microseconds(50));
+    }
+    if (out) out->flush();
+}
+
+long long RingBufferSink::getRecorded() const {
+    return recorded.load(memory_order_relaxed);
+}
+
+long long RingBufferSink::getWritten() const {
+    return written.load(memory_order_acquire);
+}
+
+long long RingBufferSink::getDropped() const {
+    return dropped.load(memory_order_relaxed);
+}
+
+/* ===== EventLog ===== */
+
+void EventLog::render(const KitchenEvent& e, ostream& text, const RecipeBook* book) {
+    bool known = book && static_cast<int>(e.dish) < book->size();
+    switch (e.kind) {
+    case EventKind::DishStarted:
+        if (e.value > 1.0) {
+            text << "\n=== Готовим партию: ";
+        } else {
+            text << "\n=== Готовим блюдо: ";
+        }
+        if (known) text << book->name(static_cast<int>(e.dish));
+        else       text << "#" << e.dish;
+        if (e.value > 1.0) text << ", порций: " << static_cast<long long>(e.value);
+        text << " ===\n";
+        break;
+    case EventKind::StepText:
+        if (known && e.step < book->stepCount(static_cast<int>(e.dish))) {
+            const RecipeStep& s = book->stepsOf(static_cast<int>(e.dish))[e.step];
+            book->printText(s, static_cast<long long>(e.value), text);
+        } else {
+            text << "[блюдо #" << e.dish << ", шаг " << e.step << "]\n";
+        }
+        break;
+    case EventKind::MixerPlugged:
+        text << "Миксер включён в сеть.\n";
+        break;
+    case EventKind::MixerUnplugged:
+        text << "Миксер выключен из сети.\n";
+        break;
+    case EventKind::MixerRan:
+        text << "Включаем миксер...\n";
+        text << "Bzzzzzz-bzzz-bzzz...\n";
+        text << "Миксер поработал и остановился.\n";
+        break;
+    case EventKind::MixerNotPlugged:
+        text << "Миксер не включён в сеть. Не могу начать работу.\n";
+        break;
+    case EventKind::Mashed:
+        text << "Using potato masher... mash-mash-mash...\n";
+        break;
+    case EventKind::WaitDone:
+    case EventKind::DishDone:
+    case EventKind::DishFailed:
+        // Служебные события: при прямом выводе текста у них нет.
+        break;
+    }
+}
+
+long long EventLog::render(istream& binary, ostream& text, const RecipeBook* book) {
+    long long count = 0;
+    KitchenEvent e;
+    while (binary.read(reinterpret_cast<char*>(&e), sizeof(e))) {
+        render(e, text, book);
+        ++count;
+    }
+    return count;
+}
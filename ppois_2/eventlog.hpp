@@ -0,0 +1,202 @@
+/**
+ * @file eventlog.hpp
+ * @brief Журнал событий кухни: типизированные записи вместо текста в cout.
+ *
+ * Повар с подключённым приёмником (Cook::setSink()) не форматирует текст,
+ * а пишет компактные записи KitchenEvent: номер блюда, номер шага, время
+ * симуляции и числовое значение. Текст получается из записей только по
+ * запросу (EventLog::render()). NullSink отбрасывает всё, RingBufferSink
+ * складывает записи в lock-free кольцо, которое фоновый поток сбрасывает
+ * в двоичный поток.
+ */
+
+#pragma once
+
+#include "engine.hpp"
+
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <thread>
+
+using namespace std;
+
+class RecipeBook;
+
+/**
+ * @enum EventKind
+ * @brief Тип события журнала.
+ */
+enum class EventKind : unsigned char {
+    DishStarted,     ///< Начато блюдо (value — число порций).
+    StepText,        ///< Текстовый шаг рецепта (value — минуты последнего ожидания).
+    WaitDone,        ///< Ожидание завершено (value — секунды ожидания).
+    DishDone,        ///< Блюдо готово.
+    DishFailed,      ///< Блюдо сорвалось (исключение).
+    MixerPlugged,    ///< Миксер включён в сеть.
+    MixerUnplugged,  ///< Миксер выключен из сети.
+    MixerRan,        ///< Миксер отработал.
+    MixerNotPlugged, ///< Миксер не включён — смешивание пропущено.
+    Mashed           ///< Толкушка отработала.
+};
+
+/**
+ * @struct KitchenEvent
+ * @brief Запись журнала (24 байта, без указателей — пригодна для файла).
+ */
+struct KitchenEvent {
+    long long      simTime; ///< Время симуляции повара, с.
+    double         value;   ///< Значение события.
+    unsigned       dish;    ///< Номер рецепта в книге.
+    unsigned short step;    ///< Номер шага в программе рецепта.
+    EventKind      kind;    ///< Тип события.
+    unsigned char  worker;  ///< Зарезервировано (номер потока-работника).
+};
+
+/**
+ * @class EventSink
+ * @brief Приёмник событий журнала.
+ */
+class EventSink {
+public:
+    /// Виртуальный деструктор.
+    virtual ~EventSink() {}
+
+    /**
+     * @brief Принимает событие (не должен блокировать вызывающего).
+     * @param e Событие.
+     */
+    virtual void record(const KitchenEvent& e) = 0;
+};
+
+/**
+ * @class NullSink
+ * @brief Приёмник, который ничего не делает (журнал выключен).
+ */
+class NullSink : public EventSink {
+public:
+    void record(const KitchenEvent&) override {}
+};
+
+/**
+ * @class RingBufferSink
+ * @brief Кольцевой буфер событий с фоновым сбросом в двоичный поток.
+ *
+ * record() только кладёт запись в MpmcQueue; если кольцо заполнено,
+ * запись отбрасывается и учитывается в getDropped(). Форматирование и
+ * запись в поток выполняются в фоновом потоке.
+ */
+class RingBufferSink : public EventSink {
+private:
+    MpmcQueue<KitchenEvent> ring;     ///< Кольцо записей.
+    ostream*                out;      ///< Куда сбрасывать записи (может быть nullptr).
+    atomic<long long>       recorded; ///< Принято записей.
+    atomic<long long>       written;  ///< Сброшено записей.
+    atomic<long long>       dropped;  ///< Отброшено из-за переполнения.
+    atomic<bool>            stopping; ///< Признак остановки.
+    thread                  flusher;  ///< Фоновый поток сброса.
+
+    /// Цикл фонового потока.
+    void flushLoop();
+
+    /// Сбрасывает всё, что есть в кольце.
+    void drain();
+
+public:
+    /**
+     * @brief Создаёт приёмник и запускает фоновый поток.
+     * @param binaryOut Двоичный поток для записей (nullptr — только счётчики).
+     * @param capacity Ёмкость кольца.
+     */
+    explicit RingBufferSink(ostream* binaryOut, size_t capacity = 4096);
+
+    RingBufferSink(const RingBufferSink&) = delete;
+    RingBufferSink& operator=(const RingBufferSink&) = delete;
+
+    /// Сбрасывает остаток и останавливает фоновый поток.
+    ~RingBufferSink();
+
+    void record(const KitchenEvent& e) override;
+
+    /**
+     * @brief Ждёт, пока все принятые записи не будут сброшены в поток.
+     */
+    void flush();
+
+    long long getRecorded() const; ///< Сколько записей принято.
+    long long getWritten() const;  ///< Сколько записей сброшено.
+    long long getDropped() const;  ///< Сколько записей отброшено.
+};
+
+/**
+ * @struct LogContext
+ * @brief Контекст журнала текущего потока: приёмник и где находится повар.
+ */
+struct LogContext {
+    EventSink*      sink;  ///< Приёмник или nullptr (тогда печатается текст).
+    unsigned        dish;  ///< Текущий рецепт.
+    unsigned short  step;  ///< Текущий шаг.
+    const SimClock* clock; ///< Часы повара.
+};
+
+/**
+ * @brief Контекст журнала текущего потока.
+ * @return Ссылка на thread_local контекст.
+ */
+LogContext& logContext();
+
+/**
+ * @brief Записывает событие в приёмник текущего потока.
+ * @param kind Тип события.
+ * @param value Значение.
+ * @return false, если приёмник не подключён (вызывающий печатает текст сам).
+ */
+bool logEvent(EventKind kind, double value = 0.0);
+
+/**
+ * @class LogScope
+ * @brief Подключает приёмник к текущему потоку на время приготовления блюда.
+ */
+class LogScope {
+private:
+    LogContext saved; ///< Предыдущий контекст.
+
+public:
+    /**
+     * @brief Подключает приёмник.
+     * @param sink Приёмник (nullptr — текстовый вывод).
+     * @param dish Номер рецепта.
+     * @param clock Часы повара.
+     */
+    LogScope(EventSink* sink, unsigned dish, const SimClock* clock);
+
+    LogScope(const LogScope&) = delete;
+    LogScope& operator=(const LogScope&) = delete;
+
+    /// Восстанавливает предыдущий контекст.
+    ~LogScope();
+};
+
+/**
+ * @class EventLog
+ * @brief Перевод записей журнала в текст по запросу.
+ */
+class EventLog {
+public:
+    /**
+     * @brief Печатает одно событие тем же текстом, что и прямой вывод.
+     * @param e Событие.
+     * @param text Поток для текста.
+     * @param book Книга рецептов (для названий блюд и текстов шагов) или nullptr.
+     */
+    static void render(const KitchenEvent& e, ostream& text, const RecipeBook* book);
+
+    /**
+     * @brief Печатает двоичный журнал целиком.
+     * @param binary Поток с записями RingBufferSink.
+     * @param text Поток для текста.
+     * @param book Книга рецептов или nullptr.
+     * @return Сколько записей прочитано.
+     */
+    static long long render(istream& binary, ostream& text, const RecipeBook* book);
+};
@@ -0,0 +1,222 @@
+/**
+ * @file expiry.cpp
+ * @brief Реализация партий и списания просроченных продуктов.
+ */
+
+#include "expiry.hpp"
+
+#include <algorithm>
+
+/* ===== ExpiryIndex ===== */
+
+ExpiryIndex::ExpiryIndex()
+    : shelves(), heap(), nextSeq(0), clockNow(0), nextDue(NEVER), expiredTotal(0), waste{0, 0} {}
+
+ExpiryIndex::~ExpiryIndex() {
+    lock_guard<mutex> g(lock);
+    for (Shelf& s : shelves) {
+        if (s.ing) s.ing->expiry = nullptr;
+    }
+}
+
+unsigned ExpiryIndex::slotOf(const Ingredient& ing) const {
+    if (ing.expiry != this) {
+        throw StorageException("Ingredient is not tracked by this expiry index");
+    }
+    return ing.expirySlot;
+}
+
+long long ExpiryIndex::cursor(const Shelf& s) {
+    return s.received - s.ing->getMilligrams();
+}
+
+void ExpiryIndex::dropConsumed(Shelf& s) {
+    long long c = cursor(s);
+    while (!s.lots.empty() && s.lots.front().end <= c) {
+        s.base = s.lots.front().end;
+        s.lots.pop_front();
+    }
+}
+
+void ExpiryIndex::addLot(unsigned slot, long long mg, long long expiresAt) {
+    if (mg <= 0) return;
+    Shelf& s = shelves[slot];
+    dropConsumed(s);
+    long long c = cursor(s);
+    auto pos = upper_bound(s.lots.begin(), s.lots.end(), expiresAt,
+                           [](long long at, const Lot& l) { return at < l.expiresAt; });
+    size_t k = static_cast<size_t>(pos - s.lots.begin());
+    // Новая партия раньше всех истекает: она начинается с курсора, а уже
+    // израсходованная часть прежней первой партии выпадает из оси.
+    long long start = k == 0 ? max(c, s.base) : s.lots[k - 1].end;
+    if (k == 0) s.base = start;
+    for (size_t j = k; j < s.lots.size(); ++j) s.lots[j].end += mg;
+    s.lots.insert(s.lots.begin() + static_cast<ptrdiff_t>(k), Lot{start + mg, expiresAt, nextSeq});
+    s.received += mg;
+    heap.push_back(Entry{expiresAt, nextSeq, slot});
+    push_heap(heap.begin(), heap.end(), Later());
+    ++nextSeq;
+    publishDue();
+}
+
+void ExpiryIndex::publishDue() {
+    nextDue.store(heap.empty() ? NEVER : heap.front().at, memory_order_release);
+}
+
+void ExpiryIndex::receiveLocked(unsigned slot, long long mg, long long expiresAt) {
+    if (mg <= 0) return;
+    addLot(slot, mg, expiresAt);
+    shelves[slot].ing->restore(mg);
+}
+
+void ExpiryIndex::track(Ingredient& ing, long long shelfLife) {
+    if (ing.expiry) {
+        throw StorageException("Ingredient is already attached to an expiry index");
+    }
+    if (shelfLife <= 0) {
+        throw StorageException("Shelf life must be > 0");
+    }
+    lock_guard<mutex> g(lock);
+    unsigned slot = static_cast<unsigned>(shelves.size());
+    shelves.push_back(Shelf{&ing, {}, 0, 0, shelfLife, 0});
+    ing.expiry     = this;
+    ing.expirySlot = slot;
+    addLot(slot, ing.getMilligrams(), clockNow.load(memory_order_relaxed) + shelfLife);
+}
+
+void ExpiryIndex::receive(Ingredient& ing, long long mg, long long expiresAt) {
+    lock_guard<mutex> g(lock);
+    receiveLocked(slotOf(ing), mg, expiresAt);
+}
+
+void ExpiryIndex::receive(Ingredient& ing, long long mg) {
+    lock_guard<mutex> g(lock);
+    unsigned slot = slotOf(ing);
+    receiveLocked(slot, mg, clockNow.load(memory_order_relaxed) + shelves[slot].shelfLife);
+}
+
+size_t ExpiryIndex::expire(long long now) {
+    long long seen = clockNow.load(memory_order_relaxed);
+    while (now > seen && !clockNow.compare_exchange_weak(seen, now, memory_order_relaxed)) {}
+    if (max(now, seen) < nextDue.load(memory_order_acquire)) return 0;
+
+    lock_guard<mutex> g(lock);
+    long long at = clockNow.load(memory_order_relaxed);
+    size_t evicted = 0;
+    while (!heap.empty() && heap.front().at <= at) {
+        Entry e = heap.front();
+        pop_heap(heap.begin(), heap.end(), Later());
+        heap.pop_back();
+        Shelf& s = shelves[e.slot];
+        if (!s.ing) continue;
+        // Партии ингредиента идут в том же порядке, что и очередь, поэтому
+        // истёкшая — первая; если её там нет, она уже израсходована целиком.
+        dropConsumed(s);
+        if (s.lots.empty() || s.lots.front().seq != e.seq) continue;
+        long long end = s.lots.front().end;
+        long long mg = s.ing->evict(s.received, s.base, end);
+        s.base = end;
+        s.lots.pop_front();
+        if (mg > 0) {
+            s.expiredMg  += mg;
+            expiredTotal += mg;
+            waste        += s.ing->nutritionOf(mg);
+            ++evicted;
+        }
+    }
+    publishDue();
+    return evicted;
+}
+
+long long ExpiryIndex::nextExpiry() const {
+    lock_guard<mutex> g(lock);
+    return heap.empty() ? NEVER : heap.front().at;
+}
+
+long long ExpiryIndex::now() const {
+    return clockNow.load(memory_order_relaxed);
+}
+
+vector<StockLot> ExpiryIndex::lots(const Ingredient& ing) const {
+    lock_guard<mutex> g(lock);
+    const Shelf& s = shelves[slotOf(ing)];
+    long long c = cursor(s);
+    vector<StockLot> out;
+    long long start = s.base;
+    for (const Lot& l : s.lots) {
+        long long rem = l.end - max(c, start);
+        if (rem > 0) out.push_back(StockLot{rem, l.expiresAt});
+        start = l.end;
+    }
+    return out;
+}
+
+bool ExpiryIndex::tracks(const Ingredient& ing) const {
+    return ing.expiry == this;
+}
+
+void ExpiryIndex::rebuild(long long now, const vector<ShelfLot>& lots) {
+    lock_guard<mutex> g(lock);
+    vector<vector<StockLot>> bySlot(shelves.size());
+    for (const ShelfLot& l : lots) bySlot[slotOf(*l.ing)].push_back(l.lot);
+
+    clockNow.store(now, memory_order_relaxed);
+    heap.clear();
+    for (unsigned slot = 0; slot < shelves.size(); ++slot) {
+        Shelf& s = shelves[slot];
+        s.lots.clear();
+        if (!s.ing) continue;
+        vector<StockLot>& mine = bySlot[slot];
+        stable_sort(mine.begin(), mine.end(),
+                    [](const StockLot& a, const StockLot& b) { return a.expiresAt < b.expiresAt; });
+        long long stock = s.ing->getMilligrams();
+        long long total = 0;
+        for (const StockLot& l : mine) total += l.mg;
+        // Курсор расхода — 0: партии занимают верхнюю часть запаса.
+        long long skip = total > stock ? total - stock : 0;
+        s.received = stock;
+        s.base     = stock - (total - skip);
+        long long end = s.base;
+        for (const StockLot& l : mine) {
+            long long mg = l.mg;
+            long long cut = min(skip, mg);
+            skip -= cut;
+            mg   -= cut;
+            if (mg <= 0) continue;
+            end += mg;
+            s.lots.push_back(Lot{end, l.expiresAt, nextSeq});
+            heap.push_back(Entry{l.expiresAt, nextSeq, slot});
+            ++nextSeq;
+        }
+    }
+    make_heap(heap.begin(), heap.end(), Later());
+    publishDue();
+}
+
+long long ExpiryIndex::expiredMg(const Ingredient& ing) const {
+    lock_guard<mutex> g(lock);
+    return shelves[slotOf(ing)].expiredMg;
+}
+
+long long ExpiryIndex::expiredMg() const {
+    lock_guard<mutex> g(lock);
+    return expiredTotal;
+}
+
+NutritionTotals ExpiryIndex::wasted() const {
+    lock_guard<mutex> g(lock);
+    return waste;
+}
+
+size_t ExpiryIndex::size() const {
+    lock_guard<mutex> g(lock);
+    return shelves.size();
+}
+
+void ExpiryIndex::detach(Ingredient* ing) {
+    lock_guard<mutex> g(lock);
+    if (!ing || ing->expiry != this) return;
+    shelves[ing->expirySlot].ing = nullptr;
+    shelves[ing->expirySlot].lots.clear();
+    ing->expiry = nullptr;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file expiry.hpp
+ * @brief Партии скоропортящихся продуктов со сроком годности и списание просрочки.
+ *
+ * Ingredient::isPerishable() — только признак: запас хранится одним
+ * счётчиком, и когда что поступило, неизвестно. ExpiryIndex ведёт у
+ * отслеживаемого ингредиента партии (масса и момент, когда партия
+ * испортится) и общую для всех ингредиентов очередь с приоритетом по
+ * сроку. expire(now) снимает с вершины очереди только истёкшие партии —
+ * O(log n) на партию, без обхода сотен ингредиентов на каждом шаге часов.
+ *
+ * Партии ингредиента упорядочены по сроку, и расход идёт с самой старой
+ * (первой истекающей) партии. Горячий путь при этом не меняется:
+ * tryReserve() по-прежнему один compare-and-swap счётчика запаса. Партии
+ * лежат подряд на оси «сколько всего поступило», а курсор расхода
+ * вычисляется из запаса: поступило − осталось. Всё, что левее курсора,
+ * израсходовано; поэтому остаток партии — это часть её отрезка правее
+ * курсора, и ни резерв, ни возврат в запас (StockReservation::cancel())
+ * индекс не трогают. При списании просрочки курсор сдвигается на конец
+ * истёкшей партии тем же compare-and-swap, так что параллельное
+ * списание поваром не теряется и не удваивается.
+ *
+ * Поступление (receive(), Ingredient::addAmount() у отслеживаемого
+ * ингредиента) и списание просрочки редки и идут под мьютексом индекса.
+ * expire() можно звать перед каждым заказом с часов любого работника
+ * (KitchenEngine::setExpiry()): время индекса — наибольшее из
+ * переданных, и пока ближайший срок не наступил, вызов не берёт мьютекс.
+ * Остаток, вернувшийся в запас после списания своей партии, в партии не
+ * входит и не портится. Снимок состояния (snapshot.hpp) хранит время
+ * индекса и остатки партий; WorldSnapshot::apply() возвращает их через
+ * rebuild().
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct StockLot
+ * @brief Остаток партии.
+ */
+struct StockLot {
+    long long mg;        ///< Осталось миллиграммов.
+    long long expiresAt; ///< Момент порчи, с симуляции.
+};
+
+/**
+ * @struct ShelfLot
+ * @brief Остаток партии вместе с ингредиентом (для ExpiryIndex::rebuild()).
+ */
+struct ShelfLot {
+    Ingredient* ing; ///< Подключённый ингредиент.
+    StockLot    lot; ///< Остаток партии.
+};
+
+/**
+ * @class ExpiryIndex
+ * @brief Партии ингредиентов и очередь их сроков годности.
+ */
+class ExpiryIndex {
+private:
+    /**
+     * @struct Lot
+     * @brief Партия: отрезок оси поступлений от конца предыдущей партии до end.
+     */
+    struct Lot {
+        long long          end;       ///< Конец отрезка на оси поступлений.
+        long long          expiresAt; ///< Момент порчи.
+        unsigned long long seq;       ///< Номер партии (порядок поступления).
+    };
+
+    /**
+     * @struct Shelf
+     * @brief Партии одного ингредиента.
+     */
+    struct Shelf {
+        Ingredient*  ing;       ///< Ингредиент или nullptr (отключён).
+        deque<Lot>   lots;      ///< Партии по сроку.
+        long long    base;      ///< Начало первой партии на оси.
+        long long    received;  ///< Всего поступило в партиях (конец последней).
+        long long    shelfLife; ///< Срок хранения новой поставки, с.
+        long long    expiredMg; ///< Списано просроченного.
+    };
+
+    /**
+     * @struct Entry
+     * @brief Срок партии в очереди.
+     */
+    struct Entry {
+        long long          at;   ///< Момент порчи.
+        unsigned long long seq;  ///< Номер партии.
+        unsigned           slot; ///< Номер ингредиента.
+    };
+
+    /// Сравнение для min-кучи: раньше по сроку, при равенстве — по порядку поступления.
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (a.at != b.at) return a.at > b.at;
+            return a.seq > b.seq;
+        }
+    };
+
+    mutable mutex      lock;     ///< Защищает партии и очередь.
+    vector<Shelf>      shelves;  ///< Ингредиенты по номеру.
+    vector<Entry>      heap;     ///< Очередь сроков: min-куча по Later.
+    unsigned long long nextSeq;  ///< Номер следующей партии.
+    atomic<long long>  clockNow; ///< Наибольший момент, переданный expire().
+    atomic<long long>  nextDue;  ///< Вершина очереди (NEVER, если пуста); пишется под мьютексом.
+    long long          expiredTotal; ///< Списано всего, мг.
+    NutritionTotals    waste;    ///< Калорийность и стоимость списанного.
+
+    /// Номер ингредиента в индексе (бросает, если не подключён).
+    unsigned slotOf(const Ingredient& ing) const;
+
+    /// Курсор расхода на оси поступлений.
+    static long long cursor(const Shelf& s);
+
+    /// Убирает из начала израсходованные партии.
+    static void dropConsumed(Shelf& s);
+
+    /// Добавляет партию на ось поступлений (под мьютексом; запас не меняет).
+    void addLot(unsigned slot, long long mg, long long expiresAt);
+
+    /// Принимает поставку (под мьютексом).
+    void receiveLocked(unsigned slot, long long mg, long long expiresAt);
+
+    /// Обновляет nextDue по вершине очереди (под мьютексом).
+    void publishDue();
+
+public:
+    static const long long NEVER = LLONG_MAX; ///< Нет сроков в очереди.
+
+    /**
+     * @brief Создаёт пустой индекс (время — 0).
+     */
+    ExpiryIndex();
+
+    ExpiryIndex(const ExpiryIndex&) = delete;
+    ExpiryIndex& operator=(const ExpiryIndex&) = delete;
+
+    /// Отключает ингредиенты.
+    ~ExpiryIndex();
+
+    /**
+     * @brief Начинает вести партии ингредиента.
+     *
+     * Текущий запас становится одной партией со сроком now() + shelfLife.
+     * @param ing Ингредиент (должен жить, пока подключён).
+     * @param shelfLife Срок хранения поставки, с (> 0).
+     * @throw StorageException если ингредиент уже подключён к индексу или срок не положителен.
+     */
+    void track(Ingredient& ing, long long shelfLife);
+
+    /**
+     * @brief Принимает поставку со сроком.
+     * @param ing Подключённый ингредиент.
+     * @param mg Масса, мг.
+     * @param expiresAt Момент порчи, с симуляции.
+     * @throw StorageException если ингредиент не подключён.
+     */
+    void receive(Ingredient& ing, long long mg, long long expiresAt);
+
+    /**
+     * @brief Принимает поставку со сроком хранения ингредиента, отсчитанным от now().
+     * @param ing Подключённый ингредиент.
+     * @param mg Масса, мг.
+     * @throw StorageException если ингредиент не подключён.
+     */
+    void receive(Ingredient& ing, long long mg);
+
+    /**
+     * @brief Списывает партии, срок которых наступил.
+     *
+     * Потокобезопасно. Если ближайший срок позже времени индекса,
+     * возвращает 0 без блокировки.
+     * @param now Текущее время симуляции, с (время индекса не идёт назад).
+     * @return Число партий, от которых списан остаток.
+     */
+    size_t expire(long long now);
+
+    /**
+     * @brief Ближайший срок в очереди.
+     * @return Момент, с, или NEVER.
+     */
+    long long nextExpiry() const;
+
+    /**
+     * @brief Время индекса.
+     * @return Наибольший момент, переданный expire(), с.
+     */
+    long long now() const;
+
+    /**
+     * @brief Остатки партий ингредиента, от первой истекающей.
+     * @param ing Подключённый ингредиент.
+     * @return Партии с ненулевым остатком.
+     * @throw StorageException если ингредиент не подключён.
+     */
+    vector<StockLot> lots(const Ingredient& ing) const;
+
+    /**
+     * @brief Подключён ли ингредиент к этому индексу.
+     * @param ing Ингредиент.
+     * @return true, если индекс ведёт его партии.
+     */
+    bool tracks(const Ingredient& ing) const;
+
+    /**
+     * @brief Заменяет время индекса и партии всех ингредиентов (применение снимка).
+     *
+     * Запас ингредиентов уже восстановлен. Остатки каждого ингредиента
+     * ложатся на его текущий запас: первым расходуется запас сверх всех
+     * остатков, затем партии от первой истекающей. Если остатков больше
+     * запаса, отбрасывается их самая старая часть. Ингредиент без остатков
+     * в lots остаётся без партий. Время индекса ставится равным now, даже
+     * если оно меньше прежнего.
+     * @param now Время индекса, с.
+     * @param lots Остатки партий.
+     * @throw StorageException если ингредиент остатка не подключён.
+     */
+    void rebuild(long long now, const vector<ShelfLot>& lots);
+
+    /**
+     * @brief Сколько ингредиента списано как просроченное.
+     * @param ing Подключённый ингредиент.
+     * @return Миллиграммы.
+     * @throw StorageException если ингредиент не подключён.
+     */
+    long long expiredMg(const Ingredient& ing) const;
+
+    /**
+     * @brief Всего списано просроченного.
+     * @return Миллиграммы по всем ингредиентам.
+     */
+    long long expiredMg() const;
+
+    /**
+     * @brief Калорийность и себестоимость списанного.
+     * @return Итог по всем ингредиентам.
+     */
+    NutritionTotals wasted() const;
+
+    /**
+     * @brief Число ингредиентов индекса.
+     * @return Подключено ингредиентов (включая отключённые позже).
+     */
+    size_t size() const;
+
+    /**
+     * @brief Отключает ингредиент (ингредиент вызывает при разрушении).
+     * @param ing Ингредиент.
+     */
+    void detach(Ingredient* ing);
+};
@@ -0,0 +1,257 @@
+/**
+ * @file feasibility.cpp
+ * @brief Реализация индекса выполнимости рецептов.
+ */
+
+#include "feasibility.hpp"
+#include "versions.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+
+/* ===== FeasibilityIndex ===== */
+
+FeasibilityIndex::FeasibilityIndex(RecipeBook& b)
+    : book(&b),
+      recipes(),
+      needs(),
+      words(),
+      toolNeeds(),
+      loose(),
+      watched(),
+      thresholds(),
+      firstThreshold(),
+      blockers() {
+    RecipeKitchen& k = b.getKitchen();
+    unordered_map<const Ingredient*, unsigned> slotOf;
+    recipes.reserve(static_cast<size_t>(b.size()));
+
+    for (int id = 0; id < b.size(); ++id) {
+        Recipe r{static_cast<unsigned>(needs.size()), 0, static_cast<unsigned>(words.size()), 0,
+                 static_cast<unsigned>(toolNeeds.size()), 0, static_cast<unsigned>(loose.size()), 0,
+                 CookStatus::success()};
+        const RecipeStep* first = b.stepsOf(id);
+        unsigned count = b.stepCount(id);
+
+        auto needTool = [&](const RecipeStep& s) {
+            unsigned short step = static_cast<unsigned short>(&s - first);
+            for (unsigned i = r.firstTool; i < toolNeeds.size(); ++i) {
+                if (toolNeeds[i].target == s.target) return;
+            }
+            const KitchenTool* t = k.tool(s.target);
+            ResourceKind kind = k.toolKind(s.target);
+            toolNeeds.push_back(ToolNeed{t, kind, !t->registry || kind == ResourceKind::Knife, s.target, step});
+        };
+
+        for (unsigned i = 0; i < count; ++i) {
+            const RecipeStep& s = first[i];
+            switch (s.op) {
+            case RecipeOp::Reserve: {
+                long long mg = Ingredient::toMilligrams(s.value);
+                if (mg <= 0) break;
+                Ingredient* ing = k.ingredient(s.target);
+                auto it = slotOf.find(ing);
+                if (it == slotOf.end()) {
+                    it = slotOf.emplace(ing, static_cast<unsigned>(watched.size())).first;
+                    watched.push_back(ing);
+                }
+                bool merged = false;
+                for (unsigned n = r.firstNeed; n < needs.size(); ++n) {
+                    if (needs[n].watched == it->second) {
+                        needs[n].mg += mg;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged) needs.push_back(Need{it->second, mg, s.target, static_cast<unsigned short>(i)});
+                break;
+            }
+            case RecipeOp::Require:
+                if (k.toolKind(s.target) == ResourceKind::Pot && s.value > 0.0) {
+                    // Объём кастрюли не меняется: отказ известен заранее.
+                    if (r.fixed.ok() && !static_cast<const Pot*>(k.tool(s.target))->canBoil(s.value)) {
+                        r.fixed = CookStatus{KitchenError::NotEnoughIngredient, s.kind, s.target,
+                                             static_cast<unsigned short>(i),
+                                             s.textLen ? b.textOf(s) : "Кастрюля слишком маленькая"};
+                    }
+                } else {
+                    needTool(s);
+                }
+                break;
+            case RecipeOp::Use:
+            case RecipeOp::HeatPan:
+            case RecipeOp::Mix:
+            case RecipeOp::Mash:
+                needTool(s);
+                break;
+            default:
+                break;
+            }
+        }
+
+        r.needCount = static_cast<unsigned>(needs.size()) - r.firstNeed;
+        r.toolCount = static_cast<unsigned>(toolNeeds.size()) - r.firstTool;
+        for (unsigned i = r.firstTool; i < toolNeeds.size(); ++i) {
+            const ToolNeed& t = toolNeeds[i];
+            if (t.loose) {
+                loose.push_back(i);
+                if (!t.tool->registry) continue;
+            }
+            const ToolRegistry* reg = t.tool->registry;
+            size_t   w = t.tool->slot / ToolRegistry::WORD_BITS;
+            uint64_t m = uint64_t(1) << (t.tool->slot % ToolRegistry::WORD_BITS);
+            bool merged = false;
+            for (unsigned j = r.firstWord; j < words.size(); ++j) {
+                if (words[j].registry == reg && words[j].word == w) {
+                    words[j].mask |= m;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged) words.push_back(ToolWord{reg, w, m});
+        }
+        r.wordCount  = static_cast<unsigned>(words.size()) - r.firstWord;
+        r.looseCount = static_cast<unsigned>(loose.size()) - r.firstLoose;
+        recipes.push_back(r);
+    }
+
+    for (Ingredient* ing : watched) {
+        if (ing->feasibility) {
+            throw StorageException("Ingredient is already attached to a feasibility index");
+        }
+    }
+
+    // Пороги по ингредиентам: подсчёт, смещения, раскладка и сортировка.
+    firstThreshold.assign(watched.size() + 1, 0);
+    for (const Need& n : needs) ++firstThreshold[n.watched + 1];
+    for (size_t i = 0; i < watched.size(); ++i) firstThreshold[i + 1] += firstThreshold[i];
+    thresholds.resize(needs.size());
+    vector<unsigned> fill(firstThreshold.begin(), firstThreshold.end() - 1);
+    blockers.reset(new atomic<int>[recipes.size()]);
+    for (size_t id = 0; id < recipes.size(); ++id) {
+        const Recipe& r = recipes[id];
+        int blocked = 0;
+        for (unsigned i = 0; i < r.needCount; ++i) {
+            const Need& n = needs[r.firstNeed + i];
+            thresholds[fill[n.watched]++] = Threshold{n.mg, static_cast<int>(id)};
+            if (watched[n.watched]->getMilligrams() < n.mg) ++blocked;
+        }
+        blockers[id].store(blocked, memory_order_relaxed);
+    }
+    for (size_t i = 0; i < watched.size(); ++i) {
+        sort(thresholds.begin() + firstThreshold[i], thresholds.begin() + firstThreshold[i + 1],
+             [](const Threshold& a, const Threshold& c) { return a.mg < c.mg; });
+    }
+
+    for (size_t i = 0; i < watched.size(); ++i) {
+        watched[i]->feasibility = this;
+        watched[i]->feasSlot    = static_cast<unsigned>(i);
+    }
+    b.setFeasibility(this);
+}
+
+FeasibilityIndex::~FeasibilityIndex() {
+    for (Ingredient* ing : watched) {
+        if (ing) ing->feasibility = nullptr;
+    }
+    if (book->getFeasibility() == this) book->setFeasibility(nullptr);
+}
+
+int FeasibilityIndex::size() const {
+    return static_cast<int>(recipes.size());
+}
+
+bool FeasibilityIndex::canCook(int id, const InventoryVersion& v) const {
+    const Recipe& r = recipes[static_cast<size_t>(id)];
+    if (!r.fixed.ok()) return false;
+    for (unsigned i = 0; i < r.needCount; ++i) {
+        const Need& n = needs[r.firstNeed + i];
+        if (v.milligrams(n.target) < n.mg) return false;
+    }
+    for (unsigned i = 0; i < r.wordCount; ++i) {
+        const ToolWord& w = words[r.firstWord + i];
+        for (uint64_t m = w.mask; m; m &= m - 1) {
+            if (!v.usable(w.word * ToolRegistry::WORD_BITS + static_cast<size_t>(countr_zero(m)))) return false;
+        }
+    }
+    for (unsigned i = 0; i < r.looseCount; ++i) {
+        const ToolNeed& t = toolNeeds[loose[r.firstLoose + i]];
+        if (t.kind == ResourceKind::Knife && !static_cast<const Knife*>(t.tool)->isSharp()) return false;
+        if (t.tool->registry ? !v.usable(t.tool->slot) : !t.tool->isAvailable()) return false;
+    }
+    return true;
+}
+
+bool FeasibilityIndex::usable(const ToolNeed& t) {
+    if (t.kind == ResourceKind::Knife && !static_cast<const Knife*>(t.tool)->isSharp()) return false;
+    if (const ToolRegistry* reg = t.tool->registry) {
+        uint64_t m = uint64_t(1) << (t.tool->slot % ToolRegistry::WORD_BITS);
+        return reg->usableIn(t.tool->slot / ToolRegistry::WORD_BITS, m) != 0;
+    }
+    return t.tool->isAvailable();
+}
+
+const FeasibilityIndex::ToolNeed* FeasibilityIndex::brokenTool(const Recipe& r) const {
+    for (unsigned i = 0; i < r.toolCount; ++i) {
+        const ToolNeed& t = toolNeeds[r.firstTool + i];
+        if (!usable(t)) return &t;
+    }
+    return nullptr;
+}
+
+CookStatus FeasibilityIndex::whyNot(int id) const {
+    const Recipe& r = recipes[static_cast<size_t>(id)];
+    if (!r.fixed.ok()) return r.fixed;
+    for (unsigned i = 0; i < r.needCount; ++i) {
+        const Need& n = needs[r.firstNeed + i];
+        const Ingredient* ing = watched[n.watched];
+        if (!ing) {
+            return CookStatus{KitchenError::IngredientNotFound, ResourceKind::Ingredient, n.target, n.step,
+                              CookStatus::describe(KitchenError::IngredientNotFound)};
+        }
+        if (ing->getMilligrams() < n.mg) {
+            return CookStatus{KitchenError::NotEnoughIngredient, ResourceKind::Ingredient, n.target, n.step,
+                              "Not enough ingredient"};
+        }
+    }
+    if (const ToolNeed* t = brokenTool(r)) {
+        return CookStatus{KitchenError::ToolNotAvailable, t->kind, t->target, t->step,
+                          t->kind == ResourceKind::Knife ? "Нож недоступен" : "Инструмент недоступен"};
+    }
+    return CookStatus::success();
+}
+
+int FeasibilityIndex::shortages(int id) const {
+    return blockers[static_cast<size_t>(id)].load(memory_order_relaxed);
+}
+
+void FeasibilityIndex::stockChanged(unsigned slot, long long before, long long after) {
+    const Threshold* first = thresholds.data() + firstThreshold[slot];
+    const Threshold* last  = thresholds.data() + firstThreshold[slot + 1];
+    long long top = last[-1].mg;
+    if (before >= top && after >= top) return; // обычный случай: запаса хватает всем
+
+    // Рецепт заблокирован, пока запас меньше порога: состояние меняют пороги в (low, high].
+    long long low  = before < after ? before : after;
+    long long high = before < after ? after : before;
+    auto below = [](long long v, const Threshold& t) { return v < t.mg; };
+    const Threshold* from = upper_bound(first, last, low, below);
+    const Threshold* to   = upper_bound(from, last, high, below);
+    int delta = after < before ? 1 : -1;
+    for (const Threshold* t = from; t != to; ++t) {
+        blockers[static_cast<size_t>(t->recipe)].fetch_add(delta, memory_order_relaxed);
+    }
+}
+
+void FeasibilityIndex::detach(Ingredient* ing) {
+    if (!ing || ing->feasibility != this) return;
+    unsigned slot = ing->feasSlot;
+    long long mg = ing->getMilligrams();
+    // Пропавший ингредиент блокирует все рецепты, которым его ещё хватало.
+    for (unsigned i = firstThreshold[slot]; i < firstThreshold[slot + 1] && thresholds[i].mg <= mg; ++i) {
+        blockers[static_cast<size_t>(thresholds[i].recipe)].fetch_add(1, memory_order_relaxed);
+    }
+    watched[slot]    = nullptr;
+    ing->feasibility = nullptr;
+}
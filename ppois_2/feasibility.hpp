@@ -0,0 +1,208 @@
+/**
+ * @file feasibility.hpp
+ * @brief Индекс выполнимости: можно ли приготовить блюдо прямо сейчас.
+ *
+ * До сих пор узнать это можно было только попыткой: Dish::cook() с
+ * перехватом исключения. Попытка не бесплатна — она арендует
+ * оборудование, ждёт таймеры, а старые рецепты (Cook::cookPancakes())
+ * ещё и списывают часть продуктов до того, как обнаружат грязную
+ * сковороду.
+ *
+ * FeasibilityIndex один раз проходит программы книги рецептов и
+ * запоминает для каждого рецепта:
+ * - сколько миллиграммов каждого ингредиента резервирует одна порция
+ *   (сумма шагов reserve);
+ * - какие инструменты должны быть пригодны (require, use, heatPan, mix,
+ *   mash) — для инструментов ToolRegistry это маска слотов по словам
+ *   битовых множеств;
+ * - неустранимые отказы (кастрюля меньше нужного объёма).
+ *
+ * Запасы отслеживаются инкрементально. Подключённый ингредиент сообщает
+ * индексу о каждом изменении запаса (старое и новое значение); пороги
+ * рецептов по ингредиенту отсортированы, и двоичный поиск находит
+ * рецепты, чей порог запас пересёк. У каждого рецепта — счётчик
+ * «блокирующих» ингредиентов, которых не хватает на порцию. Поэтому
+ * canCook() — это чтение одного счётчика и AND нескольких слов
+ * состояния инструментов, без обхода шагов и без побочных эффектов.
+ *
+ * Аренда (занятость) в выполнимость не входит: занятый инструмент
+ * освободится, и повар его дождётся. Ответ — оценка на момент вызова:
+ * параллельный повар может забрать продукт сразу после проверки.
+ *
+ * Индекс строится, когда повара не готовят, и действителен, пока книга
+ * не перезагружена (load(), clear()).
+ */
+
+#pragma once
+
+#include "recipe.hpp"
+#include "tools.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+struct InventoryVersion; ///< Версия запасов и инструментов (versions.hpp).
+
+/**
+ * @class FeasibilityIndex
+ * @brief Требования рецептов книги и поддерживаемый ответ «можно ли приготовить».
+ */
+class FeasibilityIndex {
+private:
+    /**
+     * @struct Threshold
+     * @brief Порог ингредиента: сколько нужно рецепту на порцию.
+     */
+    struct Threshold {
+        long long mg;     ///< Нужно миллиграммов.
+        int       recipe; ///< Номер рецепта.
+    };
+
+    /**
+     * @struct Need
+     * @brief Потребность рецепта в ингредиенте (для whyNot()).
+     */
+    struct Need {
+        unsigned       watched; ///< Номер отслеживаемого ингредиента.
+        long long      mg;      ///< Нужно миллиграммов.
+        unsigned short target;  ///< Индекс ингредиента в RecipeKitchen.
+        unsigned short step;    ///< Первый шаг reserve.
+    };
+
+    /**
+     * @struct ToolWord
+     * @brief Слоты одного слова реестра, которые должны быть пригодны.
+     */
+    struct ToolWord {
+        const ToolRegistry* registry; ///< Реестр.
+        size_t              word;     ///< Номер слова.
+        uint64_t            mask;     ///< Нужные слоты.
+    };
+
+    /**
+     * @struct ToolNeed
+     * @brief Инструмент, который должен быть пригоден.
+     */
+    struct ToolNeed {
+        const KitchenTool* tool;   ///< Инструмент.
+        ResourceKind       kind;   ///< Тип (у ножа нужна ещё и острота).
+        bool               loose;  ///< Проверяется сам (вне реестра или нож), а не по слову.
+        unsigned short     target; ///< Индекс в RecipeKitchen.
+        unsigned short     step;   ///< Первый шаг, которому он нужен.
+    };
+
+    /**
+     * @struct Recipe
+     * @brief Требования одного рецепта (диапазоны в общих массивах).
+     */
+    struct Recipe {
+        unsigned   firstNeed;  ///< Первая потребность в needs.
+        unsigned   needCount;  ///< Число ингредиентов.
+        unsigned   firstWord;  ///< Первое слово в words.
+        unsigned   wordCount;  ///< Число слов.
+        unsigned   firstTool;  ///< Первый инструмент в toolNeeds.
+        unsigned   toolCount;  ///< Число инструментов.
+        unsigned   firstLoose; ///< Первый инструмент в loose.
+        unsigned   looseCount; ///< Число инструментов с отдельной проверкой.
+        CookStatus fixed;      ///< Неустранимый отказ или успех.
+    };
+
+    RecipeBook*                book;           ///< Книга (её указатель на индекс ставит конструктор).
+    vector<Recipe>             recipes;        ///< Требования по номеру рецепта.
+    vector<Need>               needs;          ///< Потребности всех рецептов подряд.
+    vector<ToolWord>           words;          ///< Маски инструментов всех рецептов подряд.
+    vector<ToolNeed>           toolNeeds;      ///< Инструменты всех рецептов подряд.
+    vector<unsigned>           loose;          ///< Номера инструментов toolNeeds с отдельной проверкой.
+    vector<Ingredient*>        watched;        ///< Отслеживаемые ингредиенты (nullptr — отключён).
+    vector<Threshold>          thresholds;     ///< Пороги подряд, по ингредиентам, по возрастанию mg.
+    vector<unsigned>           firstThreshold; ///< Начало порогов ингредиента (watched.size() + 1).
+    unique_ptr<atomic<int>[]>  blockers;       ///< Ингредиентов, которых рецепту не хватает.
+
+    /// Пригоден ли отдельно проверяемый инструмент.
+    static bool usable(const ToolNeed& t);
+
+    /// Первый непригодный инструмент рецепта или nullptr.
+    const ToolNeed* brokenTool(const Recipe& r) const;
+
+public:
+    /**
+     * @brief Строит индекс по книге и подключает её ингредиенты.
+     * @param b Книга рецептов (получает указатель на индекс, см. RecipeBook::getFeasibility()).
+     * @throw StorageException если ингредиент уже подключён к другому индексу.
+     */
+    explicit FeasibilityIndex(RecipeBook& b);
+
+    FeasibilityIndex(const FeasibilityIndex&) = delete;
+    FeasibilityIndex& operator=(const FeasibilityIndex&) = delete;
+
+    /// Отключает ингредиенты и отвязывает книгу.
+    ~FeasibilityIndex();
+
+    /**
+     * @brief Число рецептов в индексе.
+     * @return Размер книги на момент построения.
+     */
+    int size() const;
+
+    /**
+     * @brief Можно ли сейчас приготовить порцию рецепта.
+     * @param id Номер рецепта.
+     * @return true, если продуктов хватает на порцию и нужные инструменты пригодны.
+     */
+    bool canCook(int id) const {
+        const Recipe& r = recipes[static_cast<size_t>(id)];
+        if (!r.fixed.ok() || blockers[static_cast<size_t>(id)].load(memory_order_relaxed) > 0) return false;
+        for (unsigned i = 0; i < r.wordCount; ++i) {
+            const ToolWord& w = words[r.firstWord + i];
+            if (w.registry->usableIn(w.word, w.mask) != w.mask) return false;
+        }
+        for (unsigned i = 0; i < r.looseCount; ++i) {
+            if (!usable(toolNeeds[loose[r.firstLoose + i]])) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Можно ли было приготовить порцию рецепта в момент версии.
+     *
+     * Запасы и инструменты реестра берутся из версии (versions.hpp), поэтому
+     * ответы по разным рецептам согласованы между собой. Острота ножей и
+     * инструменты вне реестра в версию не входят и проверяются по текущему
+     * состоянию.
+     * @param id Номер рецепта.
+     * @param v Версия мира, к ингредиентам которого подключён индекс.
+     * @return true, если в версии продуктов хватает на порцию и нужные инструменты пригодны.
+     */
+    bool canCook(int id, const InventoryVersion& v) const;
+
+    /**
+     * @brief Почему рецепт сейчас приготовить нельзя.
+     * @param id Номер рецепта.
+     * @return Первый отказ (с виновником и шагом) или успех.
+     */
+    CookStatus whyNot(int id) const;
+
+    /**
+     * @brief Сколько ингредиентов рецепту сейчас не хватает на порцию.
+     * @param id Номер рецепта.
+     * @return Число ингредиентов.
+     */
+    int shortages(int id) const;
+
+    /**
+     * @brief Сообщение подключённого ингредиента об изменении запаса.
+     * @param slot Номер ингредиента в индексе.
+     * @param before Запас до изменения, мг.
+     * @param after Запас после изменения, мг.
+     */
+    void stockChanged(unsigned slot, long long before, long long after);
+
+    /**
+     * @brief Отключает ингредиент: рецепты, которым он нужен, становятся невыполнимыми.
+     * @param ing Ингредиент этого индекса (иначе ничего не делает).
+     */
+    void detach(Ingredient* ing);
+};
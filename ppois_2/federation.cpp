@@ -0,0 +1,177 @@
+/**
+ * @file federation.cpp
+ * @brief Реализация федерации кухонь и переноса запасов.
+ */
+
+#include "federation.hpp"
+#include "inventory.hpp"
+#include "expiry.hpp"
+
+#include <exception>
+#include <thread>
+
+namespace {
+
+/**
+ * @struct Candidate
+ * @brief Участок, на котором заказ можно приготовить.
+ */
+struct Candidate {
+    long long ready; ///< Срок по модели стоимости, с.
+    int       shard; ///< Участок.
+};
+
+} // namespace
+
+/* ===== KitchenShard ===== */
+
+KitchenShard::KitchenShard(const char* kitchen, const char* recipes, int workers, const vector<int>& cpuSet)
+    : world(), menu(), costs(), engine(), cpus(cpuSet), pinned(false) {
+    if (cpus.empty()) {
+        world.build(kitchen, recipes);
+    } else {
+        // Арена мира заполняется на процессорах участка: память достаётся его узлу.
+        exception_ptr failure;
+        thread builder([&] {
+            pinned = pinCurrentThread(cpus);
+            try {
+                world.build(kitchen, recipes);
+            } catch (...) {
+                failure = current_exception();
+            }
+        });
+        builder.join();
+        if (failure) rethrow_exception(failure);
+    }
+    for (int i = 0; i < world.dishCount(); ++i) menu.addDish(world.dishAt(i));
+    int cooks = workers < 1 ? 1 : workers;
+    costs.reset(new CostModel(world.getBook(), menu, cooks));
+    engine.reset(new KitchenEngine(cooks));
+    engine->setCostModel(costs.get());
+    engine->setExpiry(world.getExpiry());
+    if (!cpus.empty()) pinned = engine->pinWorkers(cpus) && pinned;
+}
+
+KitchenShard::~KitchenShard() {
+    engine.reset();
+}
+
+/* ===== KitchenFederation ===== */
+
+KitchenFederation::KitchenFederation() : shards() {}
+
+int KitchenFederation::addShard(const char* kitchen, const char* recipes, int workers, const vector<int>& cpus) {
+    shards.emplace_back(new KitchenShard(kitchen, recipes, workers, cpus));
+    return static_cast<int>(shards.size()) - 1;
+}
+
+int KitchenFederation::size() const {
+    return static_cast<int>(shards.size());
+}
+
+KitchenShard& KitchenFederation::shard(int i) {
+    if (i < 0 || i >= size()) {
+        throw StorageException("Нет такого участка федерации");
+    }
+    return *shards[static_cast<size_t>(i)];
+}
+
+RoutedOrder KitchenFederation::route(int item, long long sla) {
+    SmallVector<Candidate, 8> found;
+    bool listed = false;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        KitchenShard& sh = *shards[s];
+        if (item < 1 || static_cast<size_t>(item) > sh.getMenu().size()) continue;
+        listed = true;
+        if (!sh.getMenu().dishAt(item)->canCook()) continue;
+        found.push_back(Candidate{sh.getCosts().readyIn(item), static_cast<int>(s)});
+    }
+    if (!listed) return RoutedOrder{-1, 0, 0, OrderReject::NoSuchDish};
+    if (found.empty()) return RoutedOrder{-1, 0, 0, OrderReject::Unavailable};
+
+    // Участков немного: выбираем ближайший срок, пока допуск не пройдёт.
+    for (size_t left = found.size(); left > 0; --left) {
+        size_t best = 0;
+        for (size_t i = 1; i < left; ++i) {
+            if (found[i].ready < found[best].ready) best = i;
+        }
+        Candidate c = found[best];
+        found[best] = found[left - 1];
+        if (c.ready > sla) break;
+        KitchenShard& sh = *shards[static_cast<size_t>(c.shard)];
+        long long cost = 0;
+        if (!sh.getCosts().admit(item, sla, cost)) continue;
+        int id = sh.getEngine().submit(sh.getMenu().dishAt(item), cost);
+        return RoutedOrder{c.shard, id, c.ready, OrderReject::None};
+    }
+    return RoutedOrder{-1, 0, 0, OrderReject::OverSla};
+}
+
+void KitchenFederation::waitAll() {
+    for (unique_ptr<KitchenShard>& s : shards) s->getEngine().waitAll();
+}
+
+/* ===== StockTransfer ===== */
+
+StockTransfer::StockTransfer(KitchenShard& from, KitchenShard& to)
+    : source(from), target(to), lines(), shortage(nullptr) {}
+
+StockTransfer& StockTransfer::add(const char* ingredient, double grams) {
+    Ingredient* from = source.getWorld().ingredient(source.getWorld().find(ingredient));
+    Ingredient* to   = target.getWorld().ingredient(target.getWorld().find(ingredient));
+    if (!from || !to) {
+        throw IngredientNotFoundException("Ингредиента для переноса нет на одном из участков");
+    }
+    lines.push_back(Line{from, to, Ingredient::toMilligrams(grams)});
+    return *this;
+}
+
+bool StockTransfer::tryMove() {
+    shortage = nullptr;
+    ExpiryIndex* fromIndex = source.getWorld().getExpiry();
+    ExpiryIndex* toIndex   = target.getWorld().getExpiry();
+
+    // Что списание заберёт у источника: сначала запас вне партий, затем партии по сроку.
+    vector<vector<StockLot>> aged(lines.size());
+    vector<long long>        loose(lines.size(), 0);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const Line& l = lines[i];
+        if (!toIndex || !toIndex->tracks(*l.to) || !fromIndex || !fromIndex->tracks(*l.from)) continue;
+        aged[i] = fromIndex->lots(*l.from);
+        long long inLots = 0;
+        for (const StockLot& lot : aged[i]) inLots += lot.mg;
+        loose[i] = max(0LL, l.from->getMilligrams() - inLots);
+    }
+
+    StockReservation taken;
+    for (const Line& l : lines) taken.add(l.from, Grams::fromMilligrams(l.mg));
+    if (!taken.tryReserve()) {
+        shortage = taken.getShortage();
+        return false;
+    }
+    taken.handOver();
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const Line& l = lines[i];
+        if (!toIndex || !toIndex->tracks(*l.to)) {
+            l.to->restore(l.mg);
+            continue;
+        }
+        if (!fromIndex || !fromIndex->tracks(*l.from)) {
+            toIndex->receive(*l.to, l.mg); // у источника срока нет: срок получателя
+            continue;
+        }
+        long long left = l.mg;
+        long long part = min(left, loose[i]);
+        l.to->restore(part);
+        left -= part;
+        for (const StockLot& lot : aged[i]) {
+            if (left <= 0) break;
+            part = min(left, lot.mg);
+            toIndex->receive(*l.to, part, lot.expiresAt);
+            left -= part;
+        }
+        if (left > 0) toIndex->receive(*l.to, left);
+    }
+    return true;
+}
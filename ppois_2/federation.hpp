@@ -0,0 +1,218 @@
+/**
+ * @file federation.hpp
+ * @brief Несколько кухонь в одном процессе: независимые участки и маршрутизация заказов.
+ *
+ * KitchenWorld, Menu и KitchenEngine описывают одну кухню. Сеть кухонь
+ * раньше приходилось запускать отдельными процессами. KitchenFederation
+ * держит несколько независимых участков (KitchenShard). У каждого свой
+ * мир (запасы, инструменты, духовки, плиты), своё меню, свой пул
+ * работников и своя модель стоимости (costmodel.hpp). Общего состояния у
+ * участков нет, поэтому их работники не делят ни очереди, ни атомарные
+ * счётчики, и пропускная способность растёт с числом участков.
+ *
+ * Участок можно привязать к набору процессоров (например, к ядрам одного
+ * узла NUMA). Тогда его мир собирается потоком, привязанным к тем же
+ * процессорам, и память арены выделяется на узле участка, а работники
+ * движка выполняются только на этих процессорах.
+ *
+ * route() отправляет заказ пункта меню на участок, который отдаст его
+ * раньше всех: среди участков, где блюдо сейчас можно приготовить
+ * (Dish::canCook(), то есть хватает продуктов и инструменты пригодны),
+ * выбирается наименьший CostModel::readyIn(). Маршрутизация читает только
+ * атомарные значения участков и глобальных блокировок не берёт. Её можно
+ * вызывать из нескольких потоков сразу. Номера пунктов у участков общие,
+ * как при одной книге рецептов на всю сеть. Участок без такого пункта
+ * при выборе пропускается.
+ *
+ * Запасы между участками переносятся явно, пакетом: StockTransfer списывает
+ * все строки у источника одним StockReservation (всё или ничего) и
+ * зачисляет их получателю. Перенос — не расход: в учёт смены (LedgerScope)
+ * он не попадает. Если оба участка ведут сроки годности ингредиента,
+ * перенесённое сохраняет сроки партий источника (сначала уходит запас
+ * вне партий, затем самые старые партии).
+ *
+ * Сроки годности у участка списываются по часам его работников
+ * (KitchenEngine::setExpiry()).
+ *
+ * Участки добавляются до первого заказа; удаляются вместе с федерацией.
+ */
+
+#pragma once
+
+#include "world.hpp"
+#include "engine.hpp"
+#include "costmodel.hpp"
+#include "orders.hpp"
+#include "smallvec.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class KitchenShard
+ * @brief Одна кухня федерации: мир, меню, работники и модель стоимости.
+ */
+class KitchenShard {
+private:
+    KitchenWorld              world;  ///< Запасы и оборудование.
+    Menu                      menu;   ///< Пункт i — блюдо мира dishAt(i - 1).
+    unique_ptr<CostModel>     costs;  ///< Оценка сроков по меню.
+    unique_ptr<KitchenEngine> engine; ///< Работники (уничтожаются первыми).
+    vector<int>               cpus;   ///< Процессоры участка (пусто — без привязки).
+    bool                      pinned; ///< Привязка удалась.
+
+public:
+    /**
+     * @brief Собирает кухню и запускает её работников.
+     * @param kitchen Описание кухни (как у KitchenWorld::build()).
+     * @param recipes Книга рецептов.
+     * @param workers Работников (минимум 1).
+     * @param cpuSet Процессоры участка (пусто — без привязки).
+     * @throw RecipeFormatException или StorageException, если описание неверно.
+     */
+    KitchenShard(const char* kitchen, const char* recipes, int workers, const vector<int>& cpuSet = {});
+
+    KitchenShard(const KitchenShard&) = delete;
+    KitchenShard& operator=(const KitchenShard&) = delete;
+
+    /// Дожидается принятых заказов и останавливает работников.
+    ~KitchenShard();
+
+    KitchenWorld&  getWorld() { return world; }    ///< Мир участка.
+    Menu&          getMenu() { return menu; }      ///< Меню участка.
+    CostModel&     getCosts() { return *costs; }   ///< Модель стоимости участка.
+    KitchenEngine& getEngine() { return *engine; } ///< Движок участка.
+
+    /**
+     * @brief Привязан ли участок к своим процессорам.
+     * @return true, если и сборка мира, и работники выполняются на процессорах участка.
+     */
+    bool isPinned() const { return pinned; }
+};
+
+/**
+ * @struct RoutedOrder
+ * @brief Куда ушёл заказ.
+ */
+struct RoutedOrder {
+    int         shard;   ///< Участок (-1 — заказ отклонён).
+    int         order;   ///< Номер заказа в движке участка (0 у отклонённого).
+    long long   readyIn; ///< Обещанный срок, с.
+    OrderReject reject;  ///< OrderReject::None или причина отклонения.
+};
+
+/**
+ * @class KitchenFederation
+ * @brief Участки-кухни и выбор участка для каждого заказа.
+ */
+class KitchenFederation {
+private:
+    vector<unique_ptr<KitchenShard>> shards; ///< Участки.
+
+public:
+    KitchenFederation();
+
+    KitchenFederation(const KitchenFederation&) = delete;
+    KitchenFederation& operator=(const KitchenFederation&) = delete;
+
+    /**
+     * @brief Добавляет участок (до первого заказа).
+     * @param kitchen Описание кухни.
+     * @param recipes Книга рецептов.
+     * @param workers Работников участка.
+     * @param cpus Процессоры участка (пусто — без привязки).
+     * @return Номер участка (с 0).
+     * @throw RecipeFormatException или StorageException, если описание неверно.
+     */
+    int addShard(const char* kitchen, const char* recipes, int workers, const vector<int>& cpus = {});
+
+    /**
+     * @brief Число участков.
+     * @return Участков.
+     */
+    int size() const;
+
+    /**
+     * @brief Участок по номеру.
+     * @param i Номер (с 0).
+     * @return Участок.
+     * @throw StorageException если номера нет.
+     */
+    KitchenShard& shard(int i);
+
+    /**
+     * @brief Отправляет заказ на участок, который приготовит его раньше всех.
+     *
+     * Если выбранный участок успели занять другие заказы и допуск не
+     * прошёл, берётся следующий по сроку. Выбор — оценка на момент вызова,
+     * как у OrderStream: параллельный заказ может забрать продукт раньше.
+     * @param item Пункт меню (с 1).
+     * @param sla Наибольшее допустимое время до готовности, с.
+     * @return Участок и номер заказа или причина отклонения
+     * (NoSuchDish, Unavailable, OverSla).
+     */
+    RoutedOrder route(int item, long long sla = CostModel::UNREACHABLE - 1);
+
+    /// Ждёт, пока все участки не выполнят принятые заказы.
+    void waitAll();
+};
+
+/**
+ * @class StockTransfer
+ * @brief Пакетный перенос запасов между участками.
+ */
+class StockTransfer {
+private:
+    /**
+     * @struct Line
+     * @brief Строка переноса.
+     */
+    struct Line {
+        Ingredient* from; ///< Ингредиент источника.
+        Ingredient* to;   ///< Ингредиент получателя.
+        long long   mg;   ///< Количество, мг.
+    };
+
+    KitchenShard&         source;   ///< Источник.
+    KitchenShard&         target;   ///< Получатель.
+    SmallVector<Line, 8>  lines;    ///< Строки.
+    const Ingredient*     shortage; ///< Чего не хватило источнику.
+
+public:
+    /**
+     * @brief Начинает перенос.
+     * @param from Участок-источник.
+     * @param to Участок-получатель.
+     */
+    StockTransfer(KitchenShard& from, KitchenShard& to);
+
+    StockTransfer(const StockTransfer&) = delete;
+    StockTransfer& operator=(const StockTransfer&) = delete;
+
+    /**
+     * @brief Добавляет строку.
+     * @param ingredient Ключ ингредиента (одинаковый у обоих участков).
+     * @param grams Граммов.
+     * @return *this.
+     * @throw IngredientNotFoundException если ингредиента нет у одного из участков.
+     */
+    StockTransfer& add(const char* ingredient, double grams);
+
+    /**
+     * @brief Переносит все строки или ни одной.
+     *
+     * Партии источника читаются перед списанием; если повара источника
+     * расходуют ингредиент одновременно с переносом, сроки перенесённого
+     * приблизительны.
+     * @return false, если источнику чего-то не хватает (см. getShortage()).
+     */
+    bool tryMove();
+
+    /**
+     * @brief Ингредиент источника, которого не хватило в tryMove().
+     * @return Ингредиент или nullptr.
+     */
+    const Ingredient* getShortage() const { return shortage; }
+};
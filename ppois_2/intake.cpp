@@ -0,0 +1,500 @@
+/**
+ * @file intake.cpp
+ * @brief Реализация сетевого приёма заказов.
+ */
+
+#include "intake.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <sys/event.h>
+#include <sys/time.h>
+#define KITCHEN_INTAKE_KQUEUE 1
+#else
+#error "OrderServer needs epoll or kqueue"
+#endif
+
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+const int SEND_FLAGS = MSG_NOSIGNAL; ///< Закрытый клиентом сокет не шлёт SIGPIPE.
+#else
+const int SEND_FLAGS = 0;            ///< SIGPIPE отключается SO_NOSIGPIPE у сокета.
+#endif
+
+/// Переводит дескриптор в неблокирующий режим.
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/// Дописывает число к ответу без форматного вывода.
+void appendNumber(string& out, long long v) {
+    char digits[24];
+    auto res = to_chars(digits, digits + sizeof(digits), v);
+    out.append(digits, res.ptr);
+}
+
+} // namespace
+
+/* ===== OrderServer::Poller ===== */
+
+/**
+ * @class OrderServer::Poller
+ * @brief Очередь готовности сокетов (по уровню): epoll в Linux, kqueue в macOS и BSD.
+ */
+class OrderServer::Poller {
+private:
+    int fd; ///< Дескриптор epoll или kqueue.
+
+public:
+    /**
+     * @struct Ready
+     * @brief Готовность одного дескриптора.
+     */
+    struct Ready {
+        unsigned tag;      ///< Метка дескриптора.
+        bool     readable; ///< Есть данные, конец потока или ошибка.
+        bool     writable; ///< Можно писать.
+    };
+
+    static const int MAX_READY = 64; ///< Наибольшее число готовых за одно ожидание.
+
+    Poller() {
+#if KITCHEN_INTAKE_KQUEUE
+        fd = kqueue();
+#else
+        fd = epoll_create1(0);
+#endif
+        if (fd < 0) {
+            throw StorageException("Не удалось создать очередь готовности сокетов");
+        }
+    }
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    ~Poller() {
+        ::close(fd);
+    }
+
+    /// Начинает следить за дескриптором.
+    void add(int target, unsigned tag, bool read, bool write) {
+#if KITCHEN_INTAKE_KQUEUE
+        watch(target, tag, read, write);
+#else
+        epoll_event ev{};
+        ev.events   = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+        ev.data.u32 = tag;
+        if (epoll_ctl(fd, EPOLL_CTL_ADD, target, &ev) != 0) {
+            throw StorageException("Не удалось добавить сокет в очередь готовности");
+        }
+#endif
+    }
+
+    /// Меняет интерес к чтению и записи.
+    void watch(int target, unsigned tag, bool read, bool write) {
+#if KITCHEN_INTAKE_KQUEUE
+        struct kevent changes[2];
+        void* udata = reinterpret_cast<void*>(static_cast<uintptr_t>(tag));
+        EV_SET(&changes[0], target, EVFILT_READ, EV_ADD | (read ? EV_ENABLE : EV_DISABLE), 0, 0, udata);
+        EV_SET(&changes[1], target, EVFILT_WRITE, EV_ADD | (write ? EV_ENABLE : EV_DISABLE), 0, 0, udata);
+        kevent(fd, changes, 2, nullptr, 0, nullptr);
+#else
+        epoll_event ev{};
+        ev.events   = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+        ev.data.u32 = tag;
+        epoll_ctl(fd, EPOLL_CTL_MOD, target, &ev);
+#endif
+    }
+
+    /// Перестаёт следить за дескриптором (до его закрытия).
+    void remove(int target) {
+#if KITCHEN_INTAKE_KQUEUE
+        // Закрытие дескриптора само убирает его фильтры из kqueue.
+        (void)target;
+#else
+        epoll_ctl(fd, EPOLL_CTL_DEL, target, nullptr);
+#endif
+    }
+
+    /**
+     * @brief Ждёт готовности.
+     * @param out Массив на MAX_READY записей.
+     * @param timeoutMs Наибольшее ожидание, мс (-1 — без ограничения).
+     * @return Число готовых записей.
+     */
+    int wait(Ready* out, int timeoutMs) {
+#if KITCHEN_INTAKE_KQUEUE
+        struct kevent evs[MAX_READY];
+        timespec ts{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000L};
+        int n = kevent(fd, nullptr, 0, evs, MAX_READY, timeoutMs < 0 ? nullptr : &ts);
+        for (int i = 0; i < n; ++i) {
+            bool eof = (evs[i].flags & (EV_EOF | EV_ERROR)) != 0;
+            out[i] = Ready{static_cast<unsigned>(reinterpret_cast<uintptr_t>(evs[i].udata)),
+                           evs[i].filter == EVFILT_READ || eof, evs[i].filter == EVFILT_WRITE};
+        }
+#else
+        epoll_event evs[MAX_READY];
+        int n = epoll_wait(fd, evs, MAX_READY, timeoutMs);
+        for (int i = 0; i < n; ++i) {
+            unsigned e = evs[i].events;
+            out[i] = Ready{evs[i].data.u32, (e & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0, (e & EPOLLOUT) != 0};
+        }
+#endif
+        return n < 0 ? 0 : n;
+    }
+};
+
+/* ===== OrderServer ===== */
+
+OrderServer::OrderServer(const Menu& m, KitchenEngine& e)
+    : menu(m),
+      engine(e),
+      costs(nullptr),
+      sla(0),
+      poller(new Poller()),
+      listenFd(-1),
+      wakeRead(-1),
+      wakeWrite(-1),
+      stopping(false),
+      wakeArmed(false),
+      finishedLock(),
+      finished(),
+      delivering(),
+      touched(),
+      conns(),
+      owners(),
+      nextConn(2),
+      acceptedOrders(0),
+      rejectedOrders(0),
+      reportedOrders(0),
+      intake() {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw StorageException("Не удалось создать канал пробуждения");
+    }
+    wakeRead  = fds[0];
+    wakeWrite = fds[1];
+    setNonBlocking(wakeRead);
+    setNonBlocking(wakeWrite);
+    poller->add(wakeRead, WAKE_TAG, true, false);
+    engine.setListener(this);
+}
+
+void OrderServer::setAdmission(CostModel* m, long long slaSeconds) {
+    costs = m;
+    sla = slaSeconds;
+}
+
+OrderServer::~OrderServer() {
+    // Работники ещё могут отдавать итоги: сначала дожидаемся их.
+    engine.waitAll();
+    engine.setListener(nullptr);
+    for (auto& kv : conns) ::close(kv.second->fd);
+    if (listenFd >= 0) ::close(listenFd);
+    ::close(wakeRead);
+    ::close(wakeWrite);
+}
+
+unsigned short OrderServer::listen(const char* host, unsigned short port) {
+    if (listenFd >= 0) {
+        throw StorageException("Сервер заказов уже слушает адрес");
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (!host || !*host) {
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        throw StorageException("Некорректный IPv4-адрес для приёма заказов");
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw StorageException("Не удалось создать сокет для приёма заказов");
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || ::listen(fd, SOMAXCONN) != 0
+        || !setNonBlocking(fd)
+        || getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        ::close(fd);
+        throw StorageException("Не удалось занять адрес для приёма заказов");
+    }
+    listenFd = fd;
+    poller->add(listenFd, LISTEN_TAG, true, false);
+    return ntohs(addr.sin_port);
+}
+
+bool OrderServer::poll(int timeoutMs) {
+    if (stopping.load(memory_order_acquire)) return false;
+    Poller::Ready ready[Poller::MAX_READY];
+    int n = poller->wait(ready, timeoutMs);
+    for (int i = 0; i < n; ++i) {
+        const Poller::Ready& r = ready[i];
+        if (r.tag == LISTEN_TAG) {
+            acceptAll();
+            continue;
+        }
+        if (r.tag == WAKE_TAG) {
+            char drain[64];
+            while (::read(wakeRead, drain, sizeof(drain)) > 0) {}
+            // Сброс до забора итогов: итог, пришедший после, снова разбудит цикл.
+            wakeArmed.store(false, memory_order_release);
+            deliver();
+            continue;
+        }
+        auto it = conns.find(r.tag);
+        if (it == conns.end()) continue;   // закрыто раньше в этой же пачке
+        Connection& c = *it->second;
+        if (r.readable && !readFrom(c)) continue;
+        if (r.writable && !flush(c)) {
+            drop(c);
+            continue;
+        }
+        closeIfDone(c);
+    }
+    return !stopping.load(memory_order_acquire);
+}
+
+void OrderServer::run() {
+    while (poll(-1)) {}
+}
+
+void OrderServer::stop() {
+    stopping.store(true, memory_order_release);
+    wake();
+}
+
+void OrderServer::wake() {
+    char b = 1;
+    if (::write(wakeWrite, &b, 1) < 0) {
+        // Канал полон — цикл и так проснётся.
+    }
+}
+
+void OrderServer::orderFinished(const OrderResult& r) {
+    {
+        lock_guard<mutex> guard(finishedLock);
+        finished.push_back(r);
+    }
+    if (!wakeArmed.exchange(true, memory_order_acq_rel)) wake();
+}
+
+void OrderServer::acceptAll() {
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;   // EAGAIN или нехватка дескрипторов: попробуем при следующей готовности
+        }
+        if (!setNonBlocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#if defined(SO_NOSIGPIPE)
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        unsigned id = nextConn++;
+        unique_ptr<Connection> c(new Connection{fd, id, OrderScanner(), {}, {}, 0, 0, false, true, false});
+        poller->add(fd, id, true, false);
+        conns.emplace(id, std::move(c));
+    }
+}
+
+bool OrderServer::readFrom(Connection& c) {
+    char buffer[READ_CHUNK];
+    ssize_t n = ::read(c.fd, buffer, sizeof(buffer));
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return true;
+        drop(c);
+        return false;
+    }
+    if (n == 0) {
+        // Клиент закрыл свою сторону: дописываем последнюю запись.
+        if (!c.ended) c.scanner.finish(c.batch);
+        if (!c.batch.empty()) dispatch(c);
+        c.ended   = true;
+        c.reading = false;
+        watch(c);
+    } else if (!c.ended) {
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        if (!c.scanner.feed(buffer, buffer + n, c.batch)) c.ended = true;
+        if (!c.batch.empty()) {
+            dispatch(c);
+            uint64_t ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - started).count());
+            ++intake.buckets[HistogramSnapshot::bucketOf(ns)];
+            ++intake.count;
+            intake.sum += ns;
+            if (ns > intake.max) intake.max = ns;
+        }
+    }
+    if (!flush(c)) {
+        drop(c);
+        return false;
+    }
+    return true;
+}
+
+void OrderServer::dispatch(Connection& c) {
+    for (const ParsedOrder& o : c.batch) {
+        Dish* d = nullptr;
+        OrderReject why = checkOrder(menu, o, d);
+        if (why != OrderReject::None) {
+            reject(c, o, why);
+            continue;
+        }
+        for (long long i = 0; i < o.count; ++i) {
+            long long cost = 0;
+            if (costs && !costs->admit(static_cast<int>(o.dish), sla, cost)) {
+                reject(c, o, OrderReject::OverSla);
+                continue;
+            }
+            int id = engine.submit(d, cost);
+            // Итог разошлёт этот же поток, поэтому владелец записан раньше, чем понадобится.
+            owners[id] = c.id;
+            ++c.pending;
+            ++acceptedOrders;
+            c.out += "queued ";
+            appendNumber(c.out, id);
+            c.out += ' ';
+            appendNumber(c.out, o.dish);
+            c.out += '\n';
+        }
+    }
+    c.batch.clear();
+}
+
+void OrderServer::reject(Connection& c, const ParsedOrder& o, OrderReject why) {
+    ++rejectedOrders;
+    c.out += "rejected ";
+    appendNumber(c.out, o.line);
+    c.out += ' ';
+    c.out += orderRejectName(why);
+    c.out += '\n';
+}
+
+bool OrderServer::flush(Connection& c) {
+    while (c.sent < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, SEND_FLAGS);
+        if (n > 0) {
+            c.sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c.writing) {
+                c.writing = true;
+                watch(c);
+            }
+            return true;
+        }
+        return false;
+    }
+    c.out.clear();
+    c.sent = 0;
+    if (c.writing) {
+        c.writing = false;
+        watch(c);
+    }
+    return true;
+}
+
+void OrderServer::deliver() {
+    {
+        lock_guard<mutex> guard(finishedLock);
+        delivering.swap(finished);
+    }
+    for (const OrderResult& r : delivering) {
+        auto owner = owners.find(r.orderId);
+        if (owner == owners.end()) continue;
+        unsigned id = owner->second;
+        owners.erase(owner);
+        auto it = conns.find(id);
+        if (it == conns.end()) continue;   // клиент ушёл, не дождавшись
+        Connection& c = *it->second;
+        if (c.out.empty()) touched.push_back(id);
+        --c.pending;
+        ++reportedOrders;
+        if (r.ok) {
+            c.out += "done ";
+            appendNumber(c.out, r.orderId);
+            c.out += ' ';
+            appendNumber(c.out, r.worker);
+            c.out += ' ';
+            appendNumber(c.out, r.simSeconds);
+        } else {
+            c.out += "failed ";
+            appendNumber(c.out, r.orderId);
+            c.out += ' ';
+            c.out += kitchenErrorName(r.status.ok() ? KitchenError::Storage : r.status.error);
+        }
+        c.out += '\n';
+    }
+    delivering.clear();
+
+    for (unsigned id : touched) {
+        auto it = conns.find(id);
+        if (it == conns.end()) continue;
+        Connection& c = *it->second;
+        if (!flush(c)) {
+            drop(c);
+            continue;
+        }
+        closeIfDone(c);
+    }
+    touched.clear();
+}
+
+void OrderServer::watch(Connection& c) {
+    poller->watch(c.fd, c.id, c.reading, c.writing);
+}
+
+void OrderServer::closeIfDone(Connection& c) {
+    if (c.ended && c.pending == 0 && c.out.empty()) drop(c);
+}
+
+void OrderServer::drop(Connection& c) {
+    poller->remove(c.fd);
+    ::close(c.fd);
+    conns.erase(c.id);
+}
+
+size_t OrderServer::connectionCount() const {
+    return conns.size();
+}
+
+long long OrderServer::accepted() const {
+    return acceptedOrders;
+}
+
+long long OrderServer::rejected() const {
+    return rejectedOrders;
+}
+
+long long OrderServer::reported() const {
+    return reportedOrders;
+}
+
+const HistogramSnapshot& OrderServer::intakeLatency() const {
+    return intake;
+}
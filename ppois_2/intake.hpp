@@ -0,0 +1,217 @@
+/**
+ * @file intake.hpp
+ * @brief Сетевой приём заказов: неблокирующий TCP-сервер перед меню и движком.
+ *
+ * Menu::run() читает выбор с терминала, OrderStream — поток из файла.
+ * OrderServer принимает заказы по TCP от многих клиентов сразу. Один
+ * поток ведёт все соединения через epoll (Linux) или kqueue (macOS, BSD):
+ * сокеты неблокирующие, поток спит, только когда ни одному соединению
+ * нечего читать или писать.
+ *
+ * Протокол строковый. Клиент пишет заказы в формате потока заказов
+ * (orders.hpp): номера пунктов меню, NxK — K заказов, '#' — комментарий,
+ * 0 — конец заказов этого клиента. Запись может прийти частями. Сервер
+ * отвечает строками:
+ * @code
+ * queued <заказ> <пункт>        # заказ принят и отправлен в движок
+ * rejected <строка> <причина>   # отклонён (причины — как в сводке OrderStream, over_sla — не успеть к сроку)
+ * done <заказ> <повар> <сек>    # приготовлен за <сек> симулированных секунд
+ * failed <заказ> <код_отказа>   # не удалось приготовить
+ * @endcode
+ * Все записи, прочитанные одним read(), проверяются по меню и
+ * отправляются в KitchenEngine пачкой, а ответы на них уходят одной
+ * записью в сокет. Итоги работники передают через OrderListener в
+ * очередь сервера и будят его поток один раз на пачку итогов.
+ *
+ * После 0 или закрытия клиентом своей стороны сервер дожидается
+ * итогов принятых заказов, отправляет их и закрывает соединение.
+ *
+ * Задержка приёма — от возврата read() до постановки ответов queued в
+ * очередь отправки — копится в гистограмме intakeLatency().
+ */
+
+#pragma once
+
+#include "orders.hpp"
+#include "metrics.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class OrderServer
+ * @brief TCP-приём заказов для меню: один поток, много соединений.
+ *
+ * Сервер подключается к движку получателем итогов (KitchenEngine::setListener()),
+ * поэтому движок на время жизни сервера должен получать заказы только от него.
+ */
+class OrderServer : private OrderListener {
+private:
+    class Poller; ///< Очередь готовности сокетов: epoll или kqueue.
+
+    /**
+     * @struct Connection
+     * @brief Соединение клиента.
+     */
+    struct Connection {
+        int                 fd;      ///< Сокет.
+        unsigned            id;      ///< Номер соединения (метка в очереди готовности).
+        OrderScanner        scanner; ///< Разбор входящих записей.
+        vector<ParsedOrder> batch;   ///< Записи текущего чтения.
+        string              out;     ///< Ответы, ещё не отправленные.
+        size_t              sent;    ///< Сколько байт out уже отправлено.
+        long long           pending; ///< Принятых заказов, итог которых ещё не отправлен.
+        bool                ended;   ///< Клиент закончил заказы (0 или закрыл свою сторону).
+        bool                reading; ///< Сокет ждёт данных (до закрытия клиентом своей стороны).
+        bool                writing; ///< Сокет ждёт готовности к записи.
+    };
+
+    const Menu&     menu;       ///< Меню (номера пунктов).
+    KitchenEngine&  engine;     ///< Движок, который готовит заказы.
+    CostModel*      costs;      ///< Модель стоимости для допуска или nullptr.
+    long long       sla;        ///< Срок готовности при допуске, с.
+    unique_ptr<Poller> poller;  ///< Очередь готовности.
+    int             listenFd;   ///< Слушающий сокет или -1.
+    int             wakeRead;   ///< Канал пробуждения: чтение (в очереди готовности).
+    int             wakeWrite;  ///< Канал пробуждения: запись (работники, stop()).
+    atomic<bool>    stopping;   ///< Запрошена остановка.
+    atomic<bool>    wakeArmed;  ///< В канал уже записан байт, цикл ещё не проснулся.
+
+    mutex               finishedLock; ///< Защищает finished.
+    vector<OrderResult> finished;     ///< Итоги от работников, ещё не разосланные.
+    vector<OrderResult> delivering;   ///< Рассылаемые итоги (только поток цикла).
+    vector<unsigned>    touched;      ///< Соединения, получившие ответы при рассылке.
+
+    unordered_map<unsigned, unique_ptr<Connection>> conns;  ///< Соединения по номеру.
+    unordered_map<int, unsigned>                    owners; ///< Номер заказа → соединение.
+    unsigned            nextConn;       ///< Номер следующего соединения.
+    long long           acceptedOrders; ///< Принято заказов.
+    long long           rejectedOrders; ///< Отклонено заказов.
+    long long           reportedOrders; ///< Итогов отправлено клиентам.
+    HistogramSnapshot   intake;         ///< Задержка приёма, нс.
+
+    static const unsigned LISTEN_TAG = 0; ///< Метка слушающего сокета.
+    static const unsigned WAKE_TAG   = 1; ///< Метка канала пробуждения.
+
+    /// Итог заказа от работника: в очередь и разбудить цикл.
+    void orderFinished(const OrderResult& r) override;
+
+    /// Будит поток цикла (безопасно из обработчика сигнала).
+    void wake();
+
+    /// Принимает все ожидающие соединения.
+    void acceptAll();
+
+    /// Читает доступное из соединения и отправляет заказы в движок; false — соединение закрыто.
+    bool readFrom(Connection& c);
+
+    /// Проверяет записи batch и отправляет принятые в движок.
+    void dispatch(Connection& c);
+
+    /// Отвечает клиенту, что запись отклонена.
+    void reject(Connection& c, const ParsedOrder& o, OrderReject why);
+
+    /// Отправляет накопленные ответы; false — соединение нужно закрыть.
+    bool flush(Connection& c);
+
+    /// Рассылает итоги, пришедшие от работников.
+    void deliver();
+
+    /// Обновляет интерес соединения к чтению и записи в очереди готовности.
+    void watch(Connection& c);
+
+    /// Закрывает соединение, если ему больше нечего ждать и отправлять.
+    void closeIfDone(Connection& c);
+
+    /// Закрывает соединение и забывает его.
+    void drop(Connection& c);
+
+public:
+    static constexpr size_t READ_CHUNK = 16 * 1024; ///< Размер одного чтения, байт.
+
+    /**
+     * @brief Создаёт сервер над меню и движком (движок ещё не получал заказов).
+     * @param m Меню.
+     * @param e Движок заказов.
+     * @throw StorageException если не удалось создать очередь готовности или канал.
+     */
+    OrderServer(const Menu& m, KitchenEngine& e);
+
+    OrderServer(const OrderServer&) = delete;
+    OrderServer& operator=(const OrderServer&) = delete;
+
+    /// Дожидается движка, отключается от него и закрывает сокеты.
+    ~OrderServer();
+
+    /**
+     * @brief Включает допуск по сроку, как OrderStream::setAdmission().
+     *
+     * Заказ, который не будет готов за slaSeconds, получает ответ
+     * rejected с причиной over_sla. Вызывать до poll().
+     * @param m Модель стоимости (та же, что у KitchenEngine::setCostModel()) или nullptr.
+     * @param slaSeconds Срок готовности, симулированные секунды.
+     */
+    void setAdmission(CostModel* m, long long slaSeconds);
+
+    /**
+     * @brief Начинает слушать адрес.
+     * @param host IPv4-адрес ("127.0.0.1"; nullptr или "" — все адреса).
+     * @param port Порт (0 — любой свободный).
+     * @return Порт, который слушает сервер.
+     * @throw StorageException если адрес некорректен или занят.
+     */
+    unsigned short listen(const char* host, unsigned short port);
+
+    /**
+     * @brief Одна итерация цикла: ждёт готовности сокетов и обслуживает их.
+     * @param timeoutMs Наибольшее ожидание, мс (-1 — без ограничения).
+     * @return false, если запрошена остановка.
+     */
+    bool poll(int timeoutMs);
+
+    /**
+     * @brief Обслуживает соединения до stop().
+     */
+    void run();
+
+    /**
+     * @brief Просит цикл завершиться (из любого потока и из обработчика сигнала).
+     */
+    void stop();
+
+    /**
+     * @brief Число открытых соединений.
+     * @return Соединений клиентов.
+     */
+    size_t connectionCount() const;
+
+    /**
+     * @brief Сколько заказов принято.
+     * @return Заказов, отправленных в движок.
+     */
+    long long accepted() const;
+
+    /**
+     * @brief Сколько заказов отклонено при проверке.
+     * @return Отклонённых записей (NxK — одна запись; по сроку — каждый заказ).
+     */
+    long long rejected() const;
+
+    /**
+     * @brief Сколько итогов отправлено клиентам.
+     * @return Строк done и failed.
+     */
+    long long reported() const;
+
+    /**
+     * @brief Задержка приёма заказов.
+     * @return Гистограмма, нс (одно значение на чтение с заказами).
+     */
+    const HistogramSnapshot& intakeLatency() const;
+};
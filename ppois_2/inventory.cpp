@@ -0,0 +1,91 @@
+/**
+ * @file inventory.cpp
+ * @brief Реализация пакетного резервирования ингредиентов.
+ */
+
+#include "inventory.hpp"
+
+#include <string>
+
+StockReservation::StockReservation()
+    : lines(), reserved(false), committed(false), shortage(nullptr), totals{0, 0} {}
+
+StockReservation::~StockReservation() {
+    cancel();
+}
+
+StockReservation& StockReservation::add(Ingredient* ing, double grams) {
+    lines.push_back(Line{ing, Ingredient::toMilligrams(grams)});
+    return *this;
+}
+
+bool StockReservation::tryReserve() {
+    if (reserved) return true;
+    shortage = nullptr;
+    InventoryScope section; // весь набор попадает в снимок версий целиком
+
+    size_t done = 0;
+    for (; done < lines.size(); ++done) {
+        Ingredient* ing = lines[done].ingredient;
+        if (!ing || !ing->tryReserve(lines[done].mg)) {
+            shortage = ing;
+            break;
+        }
+    }
+    if (done == lines.size()) {
+        reserved = true;
+        return true;
+    }
+
+    while (done > 0) {
+        --done;
+        lines[done].ingredient->restore(lines[done].mg);
+    }
+    return false;
+}
+
+void StockReservation::reserve() {
+    for (const Line& l : lines) {
+        if (!l.ingredient) {
+            throw IngredientNotFoundException("Ingredient is not set for reservation");
+        }
+    }
+    if (!tryReserve()) {
+        string msg = "Not enough ingredient: ";
+        msg += shortage ? shortage->getName() : "?";
+        throw NotEnoughIngredientException(msg.c_str());
+    }
+}
+
+void StockReservation::commit() {
+    if (!reserved || committed) return;
+    committed = true;
+    for (const Line& l : lines) totals += l.ingredient->nutritionOf(l.mg);
+    ledgerRecord(totals);
+}
+
+void StockReservation::handOver() {
+    if (!reserved || committed) return;
+    committed = true;
+}
+
+void StockReservation::cancel() {
+    if (!reserved || committed) return;
+    InventoryScope section;
+    for (const Line& l : lines) {
+        l.ingredient->restore(l.mg);
+    }
+    reserved = false;
+}
+
+const Ingredient* StockReservation::getShortage() const {
+    return shortage;
+}
+
+bool StockReservation::isReserved() const {
+    return reserved;
+}
+
+const NutritionTotals& StockReservation::getTotals() const {
+    return totals;
+}
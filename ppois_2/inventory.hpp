@@ -0,0 +1,132 @@
+/**
+ * @file inventory.hpp
+ * @brief Пакетное резервирование ингредиентов под рецепт («всё или ничего»).
+ *
+ * Запас каждого ингредиента — атомарный счётчик миллиграммов
+ * (см. Ingredient::tryReserve()). StockReservation списывает сразу весь
+ * набор ингредиентов рецепта: если хотя бы одного не хватает, уже
+ * списанное возвращается, и запасы остаются нетронутыми. Блокировки
+ * не используются, параллельные повара конкурируют только на CAS.
+ *
+ * Подтверждённый резерв заодно учитывается в калориях и себестоимости
+ * (см. ledger.hpp): итог резерва, текущего заказа и смены растёт вместе
+ * со списанием, без отдельного прохода по истории.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+#include "smallvec.hpp"
+
+using namespace std;
+
+/**
+ * @class StockReservation
+ * @brief Резерв ингредиентов под одно приготовление.
+ *
+ * Жизненный цикл: add() → reserve() → commit(). Резерв, который не был
+ * подтверждён через commit(), возвращается в запас в деструкторе — то есть
+ * если рецепт сорвался до подтверждения (например, сломалась сковорода),
+ * ингредиенты не теряются.
+ */
+class StockReservation {
+private:
+    /**
+     * @struct Line
+     * @brief Строка резерва: ингредиент и масса.
+     */
+    struct Line {
+        Ingredient* ingredient; ///< Ингредиент.
+        long long   mg;         ///< Масса в миллиграммах.
+    };
+
+    SmallVector<Line, 8> lines;     ///< Строки резерва (до 8 — без выделения памяти).
+    bool                 reserved;  ///< Запас списан.
+    bool                 committed; ///< Резерв подтверждён.
+    const Ingredient*    shortage;  ///< Ингредиент, которого не хватило при последней попытке.
+    NutritionTotals      totals;    ///< Калории и стоимость подтверждённого резерва.
+
+public:
+    /**
+     * @brief Создаёт пустой резерв.
+     */
+    StockReservation();
+
+    StockReservation(const StockReservation&) = delete;
+    StockReservation& operator=(const StockReservation&) = delete;
+
+    /// Возвращает неподтверждённый резерв в запас.
+    ~StockReservation();
+
+    /**
+     * @brief Добавляет ингредиент в резерв.
+     * @param ing Ингредиент (nullptr приведёт к исключению в reserve()).
+     * @param grams Масса в граммах.
+     * @return *this для цепочки вызовов.
+     */
+    StockReservation& add(Ingredient* ing, double grams);
+
+    /**
+     * @brief Добавляет ингредиент в резерв (перевод в миллиграммы — при компиляции).
+     * @param ing Ингредиент (nullptr приведёт к исключению в reserve()).
+     * @param a Количество в стандартной единице.
+     * @return *this для цепочки вызовов.
+     */
+    template <class U>
+    StockReservation& add(Ingredient* ing, Amount<U> a) {
+        lines.push_back(Line{ing, a.milligrams()});
+        return *this;
+    }
+
+    /**
+     * @brief Пытается списать все ингредиенты сразу.
+     * @return true при успехе; при неудаче запасы не меняются, см. getShortage().
+     */
+    bool tryReserve();
+
+    /**
+     * @brief Списывает все ингредиенты сразу.
+     * @throw IngredientNotFoundException если какой-то ингредиент не задан.
+     * @throw NotEnoughIngredientException если какого-то ингредиента не хватает.
+     */
+    void reserve();
+
+    /**
+     * @brief Подтверждает резерв: ингредиенты израсходованы окончательно.
+     *
+     * Калории и стоимость резерва добавляются в итог резерва и в контекст
+     * учёта потока (ledgerRecord()) — один раз, при первом подтверждении.
+     */
+    void commit();
+
+    /**
+     * @brief Подтверждает резерв без учёта: запас не израсходован, а передаётся.
+     *
+     * Как commit(), но ни итог резерва, ни контекст учёта потока не
+     * меняются. Для переноса запасов между кухнями (StockTransfer).
+     */
+    void handOver();
+
+    /**
+     * @brief Отменяет неподтверждённый резерв и возвращает ингредиенты.
+     */
+    void cancel();
+
+    /**
+     * @brief Ингредиент, которого не хватило при последней попытке.
+     * @return Указатель на ингредиент или nullptr.
+     */
+    const Ingredient* getShortage() const;
+
+    /**
+     * @brief Проверяет, списан ли запас.
+     * @return true после успешного reserve()/tryReserve().
+     */
+    bool isReserved() const;
+
+    /**
+     * @brief Калории и стоимость израсходованного.
+     * @return Итог после commit() (до него — нули).
+     */
+    const NutritionTotals& getTotals() const;
+};
@@ -4,8 +4,79 @@
  */
 
 #include "kitchen.hpp"
-
-
+#include "engine.hpp"
+#include "inventory.hpp"
+#include "eventlog.hpp"
+#include "tools.hpp"
+#include "timers.hpp"
+#include "metrics.hpp"
+#include "feasibility.hpp"
+#include "expiry.hpp"
+#include "versions.hpp"
+#include "cotask.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* ===== CookStatus ===== */
+
+CookStatus CookStatus::failure(KitchenError e, const char* msg) {
+    return CookStatus{e, ResourceKind::Tool, NO_CULPRIT, 0, msg ? msg : describe(e)};
+}
+
+const char* CookStatus::describe(KitchenError e) {
+    switch (e) {
+    case KitchenError::None:                return "OK";
+    case KitchenError::IngredientNotFound:  return "Ingredient not found";
+    case KitchenError::NotEnoughIngredient: return "Not enough ingredient";
+    case KitchenError::ToolNotAvailable:    return "Tool not available";
+    case KitchenError::InvalidTemperature:  return "Invalid temperature";
+    case KitchenError::TimerNotSet:         return "Timer is not set";
+    case KitchenError::Overcooked:          return "Dish is overcooked";
+    case KitchenError::Undercooked:         return "Dish is undercooked";
+    case KitchenError::Storage:             return "Storage error";
+    }
+    return "Unknown kitchen error";
+}
+
+void CookStatus::throwIfFailed() const {
+    const char* msg = message ? message : describe(error);
+    switch (error) {
+    case KitchenError::None:                return;
+    case KitchenError::IngredientNotFound:  throw IngredientNotFoundException(msg);
+    case KitchenError::NotEnoughIngredient: throw NotEnoughIngredientException(msg);
+    case KitchenError::ToolNotAvailable:    throw ToolNotAvailableException(msg);
+    case KitchenError::InvalidTemperature:  throw InvalidTemperatureException(msg);
+    case KitchenError::TimerNotSet:         throw TimerNotSetException(msg);
+    case KitchenError::Overcooked:          throw OvercookedDishException(msg);
+    case KitchenError::Undercooked:         throw UndercookedDishException(msg);
+    case KitchenError::Storage:             throw StorageException(msg);
+    }
+    throw StorageException(msg);
+}
+
+CookStatus CookStatus::fromException(const exception_ptr& e) {
+    if (!e) return success();
+    try {
+        rethrow_exception(e);
+    } catch (const IngredientNotFoundException&) {
+        return failure(KitchenError::IngredientNotFound);
+    } catch (const NotEnoughIngredientException&) {
+        return failure(KitchenError::NotEnoughIngredient);
+    } catch (const ToolNotAvailableException&) {
+        return failure(KitchenError::ToolNotAvailable);
+    } catch (const InvalidTemperatureException&) {
+        return failure(KitchenError::InvalidTemperature);
+    } catch (const TimerNotSetException&) {
+        return failure(KitchenError::TimerNotSet);
+    } catch (const OvercookedDishException&) {
+        return failure(KitchenError::Overcooked);
+    } catch (const UndercookedDishException&) {
+        return failure(KitchenError::Undercooked);
+    } catch (const StorageException&) {
+        return failure(KitchenError::Storage);
+    }
+}
 
 Unit::Unit(const char* n, double g, bool l, int i)
     : name(n), gramsPerUnit(g), liquid(l), id(i) {}
@@ -42,69 +113,243 @@ bool Quantity::isZero() const {
     return value <= 0.0;
 }
 
+bool Quantity::hasUnit() const {
+    return unit != nullptr;
+}
+
 /* ===== Ingredient ===== */
 
 Ingredient::Ingredient(const char* n, const Quantity& q, double cal, bool per)
-    : name(n), quantity(q), calories(cal), perishable(per) {}
+    : name(n),
+      quantity(q),
+      calories(cal),
+      price(0.0),
+      perishable(per),
+      stockMg(q.hasUnit() ? toMilligrams(q.toGrams()) : 0),
+      feasibility(nullptr),
+      feasSlot(0),
+      expiry(nullptr),
+      expirySlot(0),
+      versions(nullptr),
+      versionSlot(0) {}
+
+Ingredient::Ingredient(const Ingredient& other)
+    : name(other.name),
+      quantity(other.quantity),
+      calories(other.calories),
+      price(other.price),
+      perishable(other.perishable),
+      stockMg(other.stockMg.load()),
+      feasibility(nullptr),
+      feasSlot(0),
+      expiry(nullptr),
+      expirySlot(0),
+      versions(nullptr),
+      versionSlot(0) {}
+
+Ingredient& Ingredient::operator=(const Ingredient& other) {
+    if (this != &other) {
+        name       = other.name;
+        quantity   = other.quantity;
+        calories   = other.calories;
+        price      = other.price;
+        perishable = other.perishable;
+        InventoryWrite w(versions, InventorySlot::Stock, versionSlot);
+        long long before = stockMg.exchange(other.stockMg.load());
+        if (feasibility) feasibility->stockChanged(feasSlot, before, stockMg.load(memory_order_relaxed));
+    }
+    return *this;
+}
+
+Ingredient::~Ingredient() {
+    if (feasibility) feasibility->detach(this);
+    if (expiry) expiry->detach(this);
+    if (versions) versions->detach(this);
+}
+
+long long Ingredient::toMilligrams(double grams) {
+    return llround(grams * 1000.0);
+}
 
 void Ingredient::addAmount(double v) {
-    double oldGrams = quantity.toGrams();
-    double newGrams = oldGrams + v;
-    if (oldGrams > 0.0) {
-        double factor = newGrams / oldGrams;
-        quantity.scale(factor);
+    if (!quantity.hasUnit()) {
+        throw StorageException("Unit is not set for quantity");
+    }
+    receiveStock(toMilligrams(v));
+}
+
+void Ingredient::receiveStock(long long mg) {
+    if (expiry) expiry->receive(*this, mg);
+    else        restore(mg);
+}
+
+long long Ingredient::evict(long long received, long long start, long long end) {
+    InventoryWrite w(versions, InventorySlot::Stock, versionSlot);
+    long long cur = stockMg.load(memory_order_relaxed);
+    while (true) {
+        long long consumed = received - cur;
+        long long rem = end - (consumed > start ? consumed : start);
+        if (rem > cur) rem = cur;
+        if (rem <= 0) return 0;
+        if (stockMg.compare_exchange_weak(cur, cur - rem, memory_order_acq_rel)) {
+            if (feasibility) feasibility->stockChanged(feasSlot, cur, cur - rem);
+            return rem;
+        }
     }
 }
 
 void Ingredient::useAmount(double vGrams) {
-    double grams = quantity.toGrams();
-    if (vGrams > grams) {
+    if (!quantity.hasUnit()) {
+        throw StorageException("Unit is not set for quantity");
+    }
+    if (!tryReserve(toMilligrams(vGrams))) {
         throw NotEnoughIngredientException("Not enough ingredient");
     }
-    if (grams > 0.0) {
-        double factor = (grams - vGrams) / grams;
-        quantity.scale(factor);
+}
+
+bool Ingredient::tryReserve(long long mg) {
+    if (mg <= 0) return true;
+    InventoryWrite w(versions, InventorySlot::Stock, versionSlot);
+    long long cur = stockMg.load(memory_order_relaxed);
+    while (cur >= mg) {
+        if (stockMg.compare_exchange_weak(cur, cur - mg, memory_order_acq_rel)) {
+            if (feasibility) feasibility->stockChanged(feasSlot, cur, cur - mg);
+            return true;
+        }
     }
+    Metrics::count(MetricCounter::StockOuts);
+    return false;
+}
+
+void Ingredient::restore(long long mg) {
+    if (mg <= 0) return;
+    InventoryWrite w(versions, InventorySlot::Stock, versionSlot);
+    long long before = stockMg.fetch_add(mg, memory_order_acq_rel);
+    if (feasibility) feasibility->stockChanged(feasSlot, before, before + mg);
+}
+
+double Ingredient::getGrams() const {
+    return static_cast<double>(stockMg.load(memory_order_acquire)) / 1000.0;
+}
+
+long long Ingredient::getMilligrams() const {
+    return stockMg.load(memory_order_acquire);
+}
+
+const char* Ingredient::getName() const {
+    return name;
 }
 
 bool Ingredient::isPerishable() const {
     return perishable;
 }
 
+double Ingredient::getCalories() const {
+    return calories;
+}
+
+double Ingredient::getPrice() const {
+    return price;
+}
+
+void Ingredient::setPrice(double perKg) {
+    if (perKg < 0.0) {
+        throw StorageException("Ingredient price must be >= 0");
+    }
+    price = perKg;
+}
+
+NutritionTotals Ingredient::nutritionOf(long long mg) const {
+    // ккал/100 г × мг / 100 000 = ккал; в тысячных — × мг / 100.
+    // цена/кг × мг / 1 000 000 = стоимость; в тысячных — × мг / 1000.
+    double m = static_cast<double>(mg);
+    return NutritionTotals{llround(calories * m / 100.0), llround(price * m / 1000.0)};
+}
+
 /* ===== KitchenTool ===== */
 
 KitchenTool::KitchenTool(const char* n,
                          bool c,
                          bool a,
                          int  d)
-    : name(n), clean(c), available(a), busy(false), durability(d) {}
+    : name(n), clean(c), available(a), busy(false), durability(d),
+      registry(nullptr), slot(0) {}
+
+KitchenTool::~KitchenTool() {
+    if (registry) registry->detach(this);
+}
 
 void KitchenTool::useTool() {
-    if (!available || !clean || durability <= 0) {
+    if (!tryUse()) {
         throw ToolNotAvailableException("Tool not usable (unavailable, dirty, or broken)");
     }
-    busy = true;
+}
+
+bool KitchenTool::tryUse() {
+    if (registry) {
+        if (registry->tryUse(slot)) return true;
+        Metrics::count(MetricCounter::ToolFailures);
+        return false;
+    }
+    if (!available || !clean || durability <= 0) {
+        Metrics::count(MetricCounter::ToolFailures);
+        return false;
+    }
     durability--;
     if (durability <= 0) {
         durability = 0;
         available = false;
     }
-    busy = false;
+    return true;
 }
 
 void KitchenTool::cleanTool() {
-    clean = true;
+    if (registry) registry->clean(slot);
+    else          clean = true;
 }
 
 void KitchenTool::breakTool() {
+    if (registry) {
+        registry->breakTool(slot);
+        return;
+    }
     available = false;
     durability = 0;
 }
 
 bool KitchenTool::isAvailable() const {
+    if (registry) return registry->isAvailable(slot);
     return available && clean && durability > 0;
 }
 
+bool KitchenTool::isClean() const {
+    return registry ? registry->isClean(slot) : clean;
+}
+
+int KitchenTool::getDurability() const {
+    return registry ? registry->durabilityOf(slot) : durability;
+}
+
+ToolRegistry* KitchenTool::getRegistry() const {
+    return registry;
+}
+
+bool KitchenTool::tryLease() {
+    if (registry) return registry->tryLease(slot);
+    bool expected = false;
+    return busy.compare_exchange_strong(expected, true, memory_order_acquire);
+}
+
+void KitchenTool::releaseLease() {
+    if (registry) registry->releaseLease(slot);
+    else          busy.store(false, memory_order_release);
+}
+
+bool KitchenTool::isBusy() const {
+    if (registry) return registry->isBusy(slot);
+    return busy.load(memory_order_acquire);
+}
+
 /* ===== Knife ===== */
 
 Knife::Knife(const char* n, bool s, int sz, int i)
@@ -125,6 +370,10 @@ bool Knife::canCut() const {
     return isAvailable() && sharp;
 }
 
+bool Knife::isSharp() const {
+    return sharp;
+}
+
 /* ===== CuttingBoard ===== */
 
 CuttingBoard::CuttingBoard(const char* n, bool w, bool we, int i)
@@ -196,18 +445,30 @@ bool Pot::canBoil(double liters) const {
 /* ===== Timer ===== */
 
 Timer::Timer(int s, bool r, int e, int i)
-    : seconds(s), running(r), elapsed(e), id(i) {}
+    : seconds(s), running(r), elapsed(e), id(i), bank(nullptr), slot(0), leased(false) {}
+
+Timer::~Timer() {
+    if (bank) bank->detach(this);
+}
 
 void Timer::start(int s) {
     if (s <= 0) {
         throw TimerNotSetException("Timer seconds must be > 0");
     }
+    if (bank) {
+        bank->start(slot, s);
+        return;
+    }
     seconds = s;
     elapsed = 0;
     running = true;
 }
 
 void Timer::tick(int delta) {
+    if (bank) {
+        bank->tick(slot, delta);
+        return;
+    }
     if (delta <= 0) return;
     if (!running) return;
     elapsed += delta;
@@ -218,9 +479,28 @@ void Timer::tick(int delta) {
 }
 
 bool Timer::isFinished() const {
+    if (bank) return bank->isFinished(slot);
     return !running && elapsed >= seconds && seconds > 0;
 }
 
+int Timer::remaining() const {
+    if (bank) return bank->remaining(slot);
+    return running ? seconds - elapsed : 0;
+}
+
+TimerBank* Timer::getBank() const {
+    return bank;
+}
+
+bool Timer::tryLease() {
+    bool expected = false;
+    return leased.compare_exchange_strong(expected, true, memory_order_acquire);
+}
+
+void Timer::releaseLease() {
+    leased.store(false, memory_order_release);
+}
+
 /* ===== Mixer ===== */
 
 Mixer::Mixer(const char* n, bool plugged)
@@ -229,30 +509,37 @@ Mixer::Mixer(const char* n, bool plugged)
 
 bool Mixer::plugIn() {
     pluggedIn = true;
-    cout << "Миксер включён в сеть.\n";
+    if (!logEvent(EventKind::MixerPlugged)) cout << "Миксер включён в сеть.\n";
     return pluggedIn;
 }
 
 bool Mixer::unplug() {
     pluggedIn = false;
-    cout << "Миксер выключен из сети.\n";
+    if (!logEvent(EventKind::MixerUnplugged)) cout << "Миксер выключен из сети.\n";
     return pluggedIn;
 }
 
 void Mixer::mix() {
     if (!pluggedIn) {
-        cout << "Миксер не включён в сеть. Не могу начать работу.\n";
+        if (!logEvent(EventKind::MixerNotPlugged)) {
+            cout << "Миксер не включён в сеть. Не могу начать работу.\n";
+        }
         return;
     }
     if (!isAvailable()) {
         throw ToolNotAvailableException("Mixer is not available");
     }
     useTool();
+    if (logEvent(EventKind::MixerRan)) return;
     cout << "Включаем миксер...\n";
     cout << "Bzzzzzz-bzzz-bzzz...\n";
     cout << "Миксер поработал и остановился.\n";
 }
 
+bool Mixer::isPluggedIn() const {
+    return pluggedIn;
+}
+
 /* ===== PotatoMasher ===== */
 
 PotatoMasher::PotatoMasher(const char* n, int i)
@@ -264,19 +551,83 @@ void PotatoMasher::mash() {
         throw ToolNotAvailableException("Potato masher is not available");
     }
     useTool();
-    cout << "Using potato masher... mash-mash-mash...\n";
+    if (!logEvent(EventKind::Mashed)) cout << "Using potato masher... mash-mash-mash...\n";
 }
 
 
+/* ===== HeatCurve ===== */
+
+HeatCurve::HeatCurve() : table() {}
+
+shared_ptr<const HeatCurve> HeatCurve::exponential(double rate) {
+    if (!(rate > 0.0)) {
+        throw InvalidTemperatureException("Heat curve rate must be > 0");
+    }
+    shared_ptr<HeatCurve> c(new HeatCurve());
+    double norm = 1.0 - exp(-rate);
+    for (int i = 0; i <= SAMPLES; ++i) {
+        c->table[i] = (1.0 - exp(-rate * i / SAMPLES)) / norm;
+    }
+    c->table[SAMPLES] = 1.0;
+    return c;
+}
+
+shared_ptr<const HeatCurve> HeatCurve::piecewise(const vector<pair<double, double>>& points) {
+    vector<pair<double, double>> pts;
+    pts.reserve(points.size() + 2);
+    pts.push_back(make_pair(0.0, 0.0));
+    for (const pair<double, double>& p : points) {
+        if (p.first < 0.0 || p.first > 1.0 || p.second < 0.0 || p.second > 1.0) {
+            throw InvalidTemperatureException("Heat curve points must lie in [0, 1]");
+        }
+        if (p.first < pts.back().first || p.second < pts.back().second) {
+            throw InvalidTemperatureException("Heat curve must not decrease");
+        }
+        pts.push_back(p);
+    }
+    pts.push_back(make_pair(1.0, 1.0));
+
+    shared_ptr<HeatCurve> c(new HeatCurve());
+    size_t seg = 1;
+    for (int i = 0; i <= SAMPLES; ++i) {
+        double u = static_cast<double>(i) / SAMPLES;
+        while (seg + 1 < pts.size() && pts[seg].first < u) ++seg;
+        const pair<double, double>& a = pts[seg - 1];
+        const pair<double, double>& b = pts[seg];
+        double span = b.first - a.first;
+        c->table[i] = span > 0.0 ? a.second + (b.second - a.second) * (u - a.first) / span : b.second;
+    }
+    return c;
+}
+
+double HeatCurve::progress(double u) const {
+    if (u <= 0.0) return table[0];
+    if (u >= 1.0) return table[SAMPLES];
+    double x = u * SAMPLES;
+    int i = static_cast<int>(x);
+    return table[i] + (table[i + 1] - table[i]) * (x - i);
+}
+
+double HeatCurve::timeFor(double p) const {
+    if (p <= table[0]) return 0.0;
+    if (p > table[SAMPLES]) p = table[SAMPLES];
+    int i = static_cast<int>(lower_bound(table, table + SAMPLES + 1, p) - table);
+    double span = table[i] - table[i - 1];
+    double f = span > 0.0 ? (p - table[i - 1]) / span : 0.0;
+    return (i - 1 + f) / SAMPLES;
+}
+
+/* ===== TemperatureProfile ===== */
 
 TemperatureProfile::TemperatureProfile(double s, double t, int d, bool g)
-    : startTemp(s), targetTemp(t), duration(d), gradual(g) {}
+    : startTemp(s), targetTemp(t), duration(d), gradual(g), curve() {}
 
 double TemperatureProfile::currentTemp(int elapsed) const {
     if (!gradual || elapsed >= duration || duration <= 0) {
         return targetTemp;
     }
     double ratio = static_cast<double>(elapsed) / duration;
+    if (curve) ratio = curve->progress(ratio);
     return startTemp + (targetTemp - startTemp) * ratio;
 }
 
@@ -284,12 +635,39 @@ bool TemperatureProfile::isReached(double current) const {
     return current >= targetTemp;
 }
 
+int TemperatureProfile::secondsToReach(double temp) const {
+    if (!gradual || duration <= 0) {
+        return temp <= targetTemp ? 0 : -1;
+    }
+    if (temp <= startTemp) return 0;
+    if (temp > targetTemp) return -1;
+    double ratio = (temp - startTemp) / (targetTemp - startTemp);
+    if (curve) ratio = curve->timeFor(ratio);
+    int s = static_cast<int>(ceil(ratio * duration));
+    // Оценка по таблице или округление могут промахнуться на секунду в любую сторону.
+    while (s < duration && currentTemp(s) < temp) {
+        s++;
+    }
+    while (s > 0 && currentTemp(s - 1) >= temp) {
+        s--;
+    }
+    return s;
+}
+
 void TemperatureProfile::reset(double s, double t, int d) {
     startTemp  = s;
     targetTemp = t;
     duration   = d;
 }
 
+void TemperatureProfile::setCurve(shared_ptr<const HeatCurve> c) {
+    curve = std::move(c);
+}
+
+const HeatCurve* TemperatureProfile::getCurve() const {
+    return curve.get();
+}
+
 
 
 Oven::Oven(double t, bool o, bool d)
@@ -298,7 +676,8 @@ Oven::Oven(double t, bool o, bool d)
       doorClosed(d),
       bakingTimer(),
       profile(),
-      elapsedSeconds(0) {}
+      elapsedSeconds(0),
+      leased(false) {}
 
 void Oven::preheat(double t, int warmupMinutes) {
     if (t <= 0.0 || t > 300.0) {
@@ -362,29 +741,101 @@ bool Oven::isDoorClosed() const {
     return doorClosed;
 }
 
+int Oven::secondsUntilOff() const {
+    if (!on || bakingTimer.remaining() <= 0) return -1;
+    return bakingTimer.remaining();
+}
 
+int Oven::secondsUntilTemperature(double temp) const {
+    if (!on) return -1;
+    int s = profile.secondsToReach(temp);
+    if (s < 0) return -1;
+    return s > elapsedSeconds ? s - elapsedSeconds : 0;
+}
 
-Stove::Stove(int b, int act, bool g, bool o)
-    : burners(b), activeBurners(act), gas(g), on(o) {}
+OvenState Oven::stateAt(int seconds) const {
+    OvenState st{temperature, on, bakingTimer.remaining()};
+    if (seconds <= 0) return st;
 
-void Stove::turnOnBurner() {
-    if (activeBurners < burners) {
-        activeBurners++;
-        on = true;
+    if (on) st.temperature = profile.currentTemp(elapsedSeconds + seconds);
+    bool finished = bakingTimer.isFinished();
+    if (st.timerRemaining > 0) {
+        finished = seconds >= st.timerRemaining;
+        st.timerRemaining = finished ? 0 : st.timerRemaining - seconds;
+    }
+    if (finished && on) {
+        st.on = false;
+        st.temperature = 0.0;
     }
+    return st;
+}
+
+void Oven::setHeatCurve(shared_ptr<const HeatCurve> c) {
+    profile.setCurve(std::move(c));
+}
+
+bool Oven::tryLease() {
+    bool expected = false;
+    return leased.compare_exchange_strong(expected, true, memory_order_acquire);
+}
+
+void Oven::releaseLease() {
+    leased.store(false, memory_order_release);
+}
+
+
+
+Stove::Stove(int b, int act, bool g, bool o)
+    : burners(b), activeBurners(act), leasedBurners(act), gas(g), on(o) {}
+
+bool Stove::turnOnBurner() {
+    int cur = activeBurners.load();
+    while (cur < burners) {
+        if (activeBurners.compare_exchange_weak(cur, cur + 1)) {
+            on = true;
+            return true;
+        }
+    }
+    return false;
 }
 
 void Stove::turnOffBurner() {
-    if (activeBurners > 0) {
-        activeBurners--;
-        if (activeBurners == 0) {
-            on = false;
+    int cur = activeBurners.load();
+    while (cur > 0) {
+        if (activeBurners.compare_exchange_weak(cur, cur - 1)) {
+            if (cur - 1 == 0) {
+                on = false;
+            }
+            return;
         }
     }
 }
 
 int Stove::freeBurners() const {
-    return burners - activeBurners;
+    return burners - activeBurners.load();
+}
+
+int Stove::getBurners() const {
+    return burners;
+}
+
+bool Stove::tryLeaseBurner() {
+    int cur = leasedBurners.load(memory_order_relaxed);
+    while (cur < burners) {
+        if (leasedBurners.compare_exchange_weak(cur, cur + 1, memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Stove::releaseBurner() {
+    int cur = leasedBurners.load(memory_order_relaxed);
+    while (cur > 0) {
+        if (leasedBurners.compare_exchange_weak(cur, cur - 1, memory_order_release)) {
+            return;
+        }
+    }
 }
 
 //Виртуальный метод cook() в наследнике реализован через делегирование. Конкретное блюдо (например, ChickenSoupDish) хранит указатель на объект повара — это реализация агрегации: блюдо пользуется поваром, но не владеет им и не создаёт его само.
@@ -393,6 +844,22 @@ int Stove::freeBurners() const {
 
 
 Dish::Dish(const char* n) : name(n) {}
+
+void Dish::cookWith(Cook* ck) {
+    (void)ck;
+    cook();
+}
+
+CookStatus Dish::tryCookWith(Cook* ck) {
+    // Рукописные рецепты бросают исключения; здесь они переводятся в код.
+    try {
+        cookWith(ck);
+    } catch (...) {
+        return CookStatus::fromException(current_exception());
+    }
+    return CookStatus::success();
+}
+
 ChickenSoupDish::ChickenSoupDish(const char* n,
                                  Ingredient* c,
                                  Ingredient* v,
@@ -412,7 +879,11 @@ void ChickenSoupDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для куриного супа");
     }
-    chef->cookChickenSoup(this);
+    cookWith(chef);
+}
+
+void ChickenSoupDish::cookWith(Cook* ck) {
+    ck->cookChickenSoup(this);
 }
 
 SaladDish::SaladDish(const char* n,
@@ -428,7 +899,11 @@ void SaladDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для салата");
     }
-    chef->cookSalad(this);
+    cookWith(chef);
+}
+
+void SaladDish::cookWith(Cook* ck) {
+    ck->cookSalad(this);
 }
 
 BakedMeatDish::BakedMeatDish(const char* n,
@@ -441,7 +916,11 @@ void BakedMeatDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для запечённого мяса");
     }
-    chef->cookBakedMeat(this);
+    cookWith(chef);
+}
+
+void BakedMeatDish::cookWith(Cook* ck) {
+    ck->cookBakedMeat(this);
 }
 
 PancakeDish::PancakeDish(const char* n,
@@ -461,7 +940,11 @@ void PancakeDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для блинов");
     }
-    chef->cookPancakes(this);
+    cookWith(chef);
+}
+
+void PancakeDish::cookWith(Cook* ck) {
+    ck->cookPancakes(this);
 }
 
 PastaDish::PastaDish(const char* n,
@@ -477,7 +960,11 @@ void PastaDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для пасты");
     }
-    chef->cookPasta(this);
+    cookWith(chef);
+}
+
+void PastaDish::cookWith(Cook* ck) {
+    ck->cookPasta(this);
 }
 
 ScrambledEggsDish::ScrambledEggsDish(const char* n,
@@ -495,7 +982,11 @@ void ScrambledEggsDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для яичницы");
     }
-    chef->cookScrambledEggs(this);
+    cookWith(chef);
+}
+
+void ScrambledEggsDish::cookWith(Cook* ck) {
+    ck->cookScrambledEggs(this);
 }
 
 VegGrillDish::VegGrillDish(const char* n,
@@ -513,7 +1004,11 @@ void VegGrillDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для овощей-гриль");
     }
-    chef->cookVegGrill(this);
+    cookWith(chef);
+}
+
+void VegGrillDish::cookWith(Cook* ck) {
+    ck->cookVegGrill(this);
 }
 
 MeatStewDish::MeatStewDish(const char* n,
@@ -532,7 +1027,11 @@ void MeatStewDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для рагу");
     }
-    chef->cookMeatStew(this);
+    cookWith(chef);
+}
+
+void MeatStewDish::cookWith(Cook* ck) {
+    ck->cookMeatStew(this);
 }
 
 SandwichDish::SandwichDish(const char* n,
@@ -549,7 +1048,11 @@ void SandwichDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для сэндвича");
     }
-    chef->cookSandwich(this);
+    cookWith(chef);
+}
+
+void SandwichDish::cookWith(Cook* ck) {
+    ck->cookSandwich(this);
 }
 
 CookieDish::CookieDish(const char* n,
@@ -567,7 +1070,11 @@ void CookieDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для печенья");
     }
-    chef->cookCookies(this);
+    cookWith(chef);
+}
+
+void CookieDish::cookWith(Cook* ck) {
+    ck->cookCookies(this);
 }
 
 RiceDish::RiceDish(const char* n,
@@ -582,7 +1089,11 @@ void RiceDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для риса");
     }
-    chef->cookRice(this);
+    cookWith(chef);
+}
+
+void RiceDish::cookWith(Cook* ck) {
+    ck->cookRice(this);
 }
 
 BoiledEggDish::BoiledEggDish(const char* n,
@@ -597,7 +1108,11 @@ void BoiledEggDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для варёных яиц");
     }
-    chef->cookBoiledEggs(this);
+    cookWith(chef);
+}
+
+void BoiledEggDish::cookWith(Cook* ck) {
+    ck->cookBoiledEggs(this);
 }
 
 MashedPotatoDish::MashedPotatoDish(const char* n,
@@ -615,7 +1130,11 @@ void MashedPotatoDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для пюре");
     }
-    chef->cookMashedPotato(this);
+    cookWith(chef);
+}
+
+void MashedPotatoDish::cookWith(Cook* ck) {
+    ck->cookMashedPotato(this);
 }
 
 GrilledCheeseDish::GrilledCheeseDish(const char* n,
@@ -634,7 +1153,11 @@ void GrilledCheeseDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для грилл-сэндвича");
     }
-    chef->cookGrilledCheese(this);
+    cookWith(chef);
+}
+
+void GrilledCheeseDish::cookWith(Cook* ck) {
+    ck->cookGrilledCheese(this);
 }
 
 FriedFishDish::FriedFishDish(const char* n,
@@ -649,7 +1172,11 @@ void FriedFishDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для жареной рыбы");
     }
-    chef->cookFriedFish(this);
+    cookWith(chef);
+}
+
+void FriedFishDish::cookWith(Cook* ck) {
+    ck->cookFriedFish(this);
 }
 
 FruitSaladDish::FruitSaladDish(const char* n,
@@ -663,7 +1190,11 @@ void FruitSaladDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для фруктового салата");
     }
-    chef->cookFruitSalad(this);
+    cookWith(chef);
+}
+
+void FruitSaladDish::cookWith(Cook* ck) {
+    ck->cookFruitSalad(this);
 }
 
 PorridgeDish::PorridgeDish(const char* n,
@@ -679,7 +1210,11 @@ void PorridgeDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для каши");
     }
-    chef->cookPorridge(this);
+    cookWith(chef);
+}
+
+void PorridgeDish::cookWith(Cook* ck) {
+    ck->cookPorridge(this);
 }
 
 SteakDish::SteakDish(const char* n,
@@ -694,7 +1229,11 @@ void SteakDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для стейка");
     }
-    chef->cookSteak(this);
+    cookWith(chef);
+}
+
+void SteakDish::cookWith(Cook* ck) {
+    ck->cookSteak(this);
 }
 
 HotDogDish::HotDogDish(const char* n,
@@ -711,7 +1250,11 @@ void HotDogDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для хот-дога");
     }
-    chef->cookHotDog(this);
+    cookWith(chef);
+}
+
+void HotDogDish::cookWith(Cook* ck) {
+    ck->cookHotDog(this);
 }
 
 SauteedMushroomsDish::SauteedMushroomsDish(const char* n,
@@ -726,7 +1269,11 @@ void SauteedMushroomsDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для грибов");
     }
-    chef->cookSauteedMushrooms(this);
+    cookWith(chef);
+}
+
+void SauteedMushroomsDish::cookWith(Cook* ck) {
+    ck->cookSauteedMushrooms(this);
 }
 
 FriedPotatoDish::FriedPotatoDish(const char* n,
@@ -744,7 +1291,11 @@ void FriedPotatoDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для жареного картофеля");
     }
-    chef->cookFriedPotato(this);
+    cookWith(chef);
+}
+
+void FriedPotatoDish::cookWith(Cook* ck) {
+    ck->cookFriedPotato(this);
 }
 
 TomatoSoupDish::TomatoSoupDish(const char* n,
@@ -764,7 +1315,11 @@ void TomatoSoupDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для томатного супа");
     }
-    chef->cookTomatoSoup(this);
+    cookWith(chef);
+}
+
+void TomatoSoupDish::cookWith(Cook* ck) {
+    ck->cookTomatoSoup(this);
 }
 
 VegOmeletteDish::VegOmeletteDish(const char* n,
@@ -786,7 +1341,11 @@ void VegOmeletteDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для омлета");
     }
-    chef->cookVegOmelette(this);
+    cookWith(chef);
+}
+
+void VegOmeletteDish::cookWith(Cook* ck) {
+    ck->cookVegOmelette(this);
 }
 
 GarlicBreadDish::GarlicBreadDish(const char* n,
@@ -803,7 +1362,11 @@ void GarlicBreadDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для чесночного хлеба");
     }
-    chef->cookGarlicBread(this);
+    cookWith(chef);
+}
+
+void GarlicBreadDish::cookWith(Cook* ck) {
+    ck->cookGarlicBread(this);
 }
 
 SimpleSauceDish::SimpleSauceDish(const char* n,
@@ -822,15 +1385,35 @@ void SimpleSauceDish::cook() {
     if (!chef) {
         throw ToolNotAvailableException("Нет повара для соуса");
     }
-    chef->cookSimpleSauce(this);
+    cookWith(chef);
+}
+
+void SimpleSauceDish::cookWith(Cook* ck) {
+    ck->cookSimpleSauce(this);
 }
 
 /* ===== Cook ===== */
 
 Cook::Cook(const char* n)
-    : name(n) {}
+    : name(n), clock(), sink(nullptr) {}
+
+SimClock& Cook::getClock() {
+    return clock;
+}
+
+void Cook::setSink(EventSink* s) {
+    sink = s;
+}
+
+EventSink* Cook::getSink() const {
+    return sink;
+}
 
 void Cook::cookChickenSoup(ChickenSoupDish* dish) {
+    cookChickenSoupTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookChickenSoupTask(ChickenSoupDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->use_pot)        throw ToolNotAvailableException("Нет кастрюли для супа");
     if (!dish->use_stove)      throw ToolNotAvailableException("Нет плиты для супа");
@@ -839,9 +1422,16 @@ void Cook::cookChickenSoup(ChickenSoupDish* dish) {
     if (!dish->use_pot->canBoil(1.5)) {
         throw NotEnoughIngredientException("Кастрюля слишком маленькая для супа");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->use_pot).add(dish->use_stove).add(dish->use_boilTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем курицу и овощи для супа...\n";
-    dish->chicken->useAmount(150.0);
-    dish->veggies->useAmount(100.0);
+    StockReservation stock;
+    stock.add(dish->chicken, Grams(150))
+         .add(dish->veggies, Grams(100));
+    stock.reserve();
     cout << "Ставим кастрюлю на плиту и включаем конфорку...\n";
     dish->use_stove->turnOnBurner();
     dish->use_pot->startBoil();
@@ -849,14 +1439,9 @@ void Cook::cookChickenSoup(ChickenSoupDish* dish) {
     const int totalSeconds = 30 * 60;
     dish->use_boilTimer->start(totalSeconds);
 
-    int step = 5 * 60;
-    int minutesPassed = 0;
-
-    while (!dish->use_boilTimer->isFinished()) {
-        dish->use_boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки супа...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->use_boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки супа...\n";
+    stock.commit();
 
     cout << "Варка супа по таймеру завершена.\n";
 
@@ -867,6 +1452,10 @@ void Cook::cookChickenSoup(ChickenSoupDish* dish) {
 }
 
 void Cook::cookSalad(SaladDish* dish) {
+    cookSaladTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookSaladTask(SaladDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->knife || !dish->knife->canCut()) {
         throw ToolNotAvailableException("Нож недоступен для салата");
@@ -875,35 +1464,46 @@ void Cook::cookSalad(SaladDish* dish) {
         cout << "Доска не сухая или не деревянная — используем её с осторожностью.\n";
     }
     cout << "Нарезаем овощи для салата...\n";
-    dish->veggies->useAmount(120.0);
+    StockReservation stock;
+    stock.add(dish->veggies, Grams(120))
+         .add(dish->oil, Grams(10));
+    stock.reserve();
     cout << "Заправляем салат маслом...\n";
-    dish->oil->useAmount(10.0);
+    stock.commit();
     cout << "Салат готов!\n";
+    co_return;
 }
 
 void Cook::cookBakedMeat(BakedMeatDish* dish) {
+    cookBakedMeatTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookBakedMeatTask(BakedMeatDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->oven) {
         throw ToolNotAvailableException("Нет духовки для мяса");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->oven);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Подготавливаем и нарезаем мясо...\n";
-    dish->meat->useAmount(200.0);
+    StockReservation stock;
+    stock.add(dish->meat, Grams(200));
+    stock.reserve();
 
     dish->oven->closeDoor();
     dish->oven->preheat(180.0);
     dish->oven->setTimerMinutes(30);
 
     cout << "Запекаем мясо 30 минут при 180C...\n";
-    int cookedSeconds = 0;
-    while (true) {
-        dish->oven->tick(300);
-        cookedSeconds += 300;
-        cout << "Прошло " << cookedSeconds / 60 << " минут...\n";
-        if (!dish->oven->isOn()) break;
-    }
+    long long cookedSeconds = co_await ovenOff(clock, dish->oven);
+    cout << "Прошло " << cookedSeconds / 60 << " минут...\n";
+    stock.commit();
 
-    int cookedMinutes   = cookedSeconds / 60;
-    int expectedMinutes = 30;
+    long long cookedMinutes   = cookedSeconds / 60;
+    int       expectedMinutes = 30;
     if (cookedMinutes > expectedMinutes + 5) {
         throw OvercookedDishException("Мясо передержали в духовке");
     }
@@ -915,6 +1515,10 @@ void Cook::cookBakedMeat(BakedMeatDish* dish) {
 }
 
 void Cook::cookPancakes(PancakeDish* dish) {
+    cookPancakesTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookPancakesTask(PancakeDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->flour || !dish->eggs || !dish->sugar || !dish->milk) {
@@ -924,15 +1528,22 @@ void Cook::cookPancakes(PancakeDish* dish) {
     if (!dish->stove)     throw ToolNotAvailableException("Нет плиты для блинов");
     if (!dish->fryTimer)  throw TimerNotSetException("Нет таймера для блинов");
     if (!dish->mixer)     throw ToolNotAvailableException("Нет миксера для теста блинов");
+
+    EquipmentLease lease;
+    lease.add(dish->mixer).add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
     if (!dish->mixer->plugIn()) {
         throw ToolNotAvailableException("Миксер не включён в розетку");
     }
 
     cout << "Подготавливаем ингредиенты для теста: мука, яйца, сахар, молоко...\n";
-    dish->flour->useAmount(150.0);
-    dish->eggs->useAmount(2.0);
-    dish->sugar->useAmount(20.0);
-    dish->milk->useAmount(200.0);
+    StockReservation stock;
+    stock.add(dish->flour, Grams(150))
+         .add(dish->eggs, Grams(2))
+         .add(dish->sugar, Grams(20))
+         .add(dish->milk, Grams(200));
+    stock.reserve();
 
     cout << "Смешиваем всё миксером...\n";
     dish->mixer->mix();
@@ -943,28 +1554,22 @@ void Cook::cookPancakes(PancakeDish* dish) {
 
     const int secondsPerPancake = 2 * 60;
     const int flipTime          = 1 * 60;
-    const int step              = 30;
 
     cout << "Наливаем тесто и жарим 3 блина...\n";
     for (int i = 1; i <= 3; ++i) {
         cout << "\nБлин " << i << ": наливаем порцию теста на сковороду...\n";
 
         dish->fryTimer->start(secondsPerPancake);
-        int  sec_passed = 0;
-        bool flipped    = false;
-
-        while (!dish->fryTimer->isFinished()) {
-            dish->fryTimer->tick(step);
-            sec_passed += step;
-            if (!flipped && sec_passed >= flipTime) {
-                cout << "Блин " << i << ": переворачиваем на другую сторону...\n";
-                flipped = true;
-            }
-            cout << "Блин " << i << ": прошло " << sec_passed / 60.0
-                 << " мин жарки...\n";
-        }
+        clock.schedule(flipTime, [i] {
+            cout << "Блин " << i << ": переворачиваем на другую сторону...\n";
+        });
+
+        long long sec_passed = co_await timerFinished(clock, dish->fryTimer);
+        cout << "Блин " << i << ": прошло " << sec_passed / 60.0
+             << " мин жарки...\n";
         cout << "Блин " << i << " готов.\n";
     }
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -972,6 +1577,10 @@ void Cook::cookPancakes(PancakeDish* dish) {
 }
 
 void Cook::cookPasta(PastaDish* dish) {
+    cookPastaTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookPastaTask(PastaDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->pot || !dish->stove) {
@@ -991,9 +1600,15 @@ void Cook::cookPasta(PastaDish* dish) {
         throw NotEnoughIngredientException("Кастрюля слишком маленькая для пасты");
     }
 
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Проверяем и подготавливаем ингредиенты...\n";
-    dish->pasta->useAmount(100.0);
-    dish->sauce->useAmount(50.0);
+    StockReservation stock;
+    stock.add(dish->pasta, Grams(100))
+         .add(dish->sauce, Grams(50));
+    stock.reserve();
 
     cout << "Ставим кастрюлю на плиту и включаем конфорку...\n";
     dish->stove->turnOnBurner();
@@ -1002,14 +1617,9 @@ void Cook::cookPasta(PastaDish* dish) {
     const int totalSeconds = 10 * 60;
     dish->boilTimer->start(totalSeconds);
 
-    int step = 5 * 60;
-    int minutesPassed = 0;
-
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки пасты...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки пасты...\n";
+    stock.commit();
 
     cout << "Варка пасты по таймеру завершена.\n";
     dish->pot->stopBoil();
@@ -1018,6 +1628,10 @@ void Cook::cookPasta(PastaDish* dish) {
 }
 
 void Cook::cookScrambledEggs(ScrambledEggsDish* dish) {
+    cookScrambledEggsTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookScrambledEggsTask(ScrambledEggsDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->pan || !dish->stove) {
@@ -1032,13 +1646,20 @@ void Cook::cookScrambledEggs(ScrambledEggsDish* dish) {
     if (!dish->mixer) {
         throw ToolNotAvailableException("Нет миксера для яичницы");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->mixer).add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
     if (!dish->mixer->plugIn()) {
         throw ToolNotAvailableException("Миксер не включён в розетку для яичницы");
     }
 
     cout << "Подготавливаем яйца и молоко для яичницы...\n";
-    dish->eggs->useAmount(3.0);
-    dish->milk->useAmount(50.0);
+    StockReservation stock;
+    stock.add(dish->eggs, Grams(3))
+         .add(dish->milk, Grams(50));
+    stock.reserve();
 
     cout << "Смешиваем яйца с молоком миксером...\n";
     dish->mixer->mix();
@@ -1048,16 +1669,11 @@ void Cook::cookScrambledEggs(ScrambledEggsDish* dish) {
     cout << "Разогреваем сковороду для яичницы...\n";
 
     const int totalSeconds = 5 * 60;
-    const int step  = 60;
-    int secondsPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60
-             << " мин жарки яичницы...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки яичницы...\n";
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -1065,6 +1681,10 @@ void Cook::cookScrambledEggs(ScrambledEggsDish* dish) {
 }
 
 void Cook::cookVegGrill(VegGrillDish* dish) {
+    cookVegGrillTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookVegGrillTask(VegGrillDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->pan || !dish->stove) {
         throw ToolNotAvailableException("Нет сковороды или плиты для овощей-гриль");
@@ -1081,27 +1701,33 @@ void Cook::cookVegGrill(VegGrillDish* dish) {
     if (!dish->board) {
         throw ToolNotAvailableException("Нет разделочной доски для овощей-гриль");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем овощи для гриля...\n";
-    dish->veggies->useAmount(150.0);
+    StockReservation stock;
+    stock.add(dish->veggies, Grams(150));
+    stock.reserve();
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
     cout << "Разогреваем сковороду для овощей-гриль...\n";
     const int totalSeconds = 10 * 60;
-    const int step = 2 * 60;
     dish->fryTimer->start(totalSeconds);
-    int secondsPassed = 0;
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60
-             << " мин жарки овощей...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки овощей...\n";
+    stock.commit();
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
     cout << "Овощи-гриль готовы!\n";
 }
 
 void Cook::cookMeatStew(MeatStewDish* dish) {
+    cookMeatStewTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookMeatStewTask(MeatStewDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->pot || !dish->stove) {
         throw ToolNotAvailableException("Нет кастрюли или плиты для рагу");
@@ -1121,9 +1747,16 @@ void Cook::cookMeatStew(MeatStewDish* dish) {
     if (!dish->board) {
         throw ToolNotAvailableException("Нет разделочной доски для рагу");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем мясо и овощи для рагу...\n";
-    dish->meat->useAmount(150.0);
-    dish->veggies->useAmount(100.0);
+    StockReservation stock;
+    stock.add(dish->meat, Grams(150))
+         .add(dish->veggies, Grams(100));
+    stock.reserve();
     cout << "Ставим кастрюлю на плиту и включаем конфорку...\n";
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
@@ -1131,13 +1764,9 @@ void Cook::cookMeatStew(MeatStewDish* dish) {
     const int totalSeconds = 45 * 60;
     dish->boilTimer->start(totalSeconds);
 
-    int step = 5 * 60;
-    int minutesPassed = 0;
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин тушения рагу...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин тушения рагу...\n";
+    stock.commit();
     cout << "Тушение рагу по таймеру завершено.\n";
     dish->stove->turnOffBurner();
     dish->pot->stopBoil();
@@ -1145,6 +1774,10 @@ void Cook::cookMeatStew(MeatStewDish* dish) {
 }
 
 void Cook::cookSandwich(SandwichDish* dish) {
+    cookSandwichTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookSandwichTask(SandwichDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->knife || !dish->knife->canCut()) {
         throw ToolNotAvailableException("Нож недоступен для сэндвича");
@@ -1155,15 +1788,23 @@ void Cook::cookSandwich(SandwichDish* dish) {
     if (!dish->board->isSafeForBread()) {
         throw ToolNotAvailableException("Доска непригодна для хлеба (не деревянная или мокрая)");
     }
-    dish->bread->useAmount(2.0);
-    dish->cheese->useAmount(30.0);
-    dish->meat->useAmount(20.0);
+    StockReservation stock;
+    stock.add(dish->bread, Grams(2))
+         .add(dish->cheese, Grams(30))
+         .add(dish->meat, Grams(20));
+    stock.reserve();
     cout << "Нарезаем хлеб, сыр и мясо на доске...\n";
     cout << "Собираем сэндвич из хлеба, сыра и мяса...\n";
+    stock.commit();
     cout << "Сэндвич готов!\n";
+    co_return;
 }
 
 void Cook::cookCookies(CookieDish* dish) {
+    cookCookiesTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookCookiesTask(CookieDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->flour || !dish->eggs || !dish->milk || !dish->sugar) {
@@ -1175,15 +1816,22 @@ void Cook::cookCookies(CookieDish* dish) {
     if (!dish->mixer) {
         throw ToolNotAvailableException("Нет миксера для печенья");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->mixer).add(dish->oven);
+    co_await leaseAcquired(clock, lease);
+
     if (!dish->mixer->plugIn()) {
         throw ToolNotAvailableException("Миксер не включён в розетку для печенья");
     }
 
     cout << "Подготавливаем ингредиенты для теста печенья...\n";
-    dish->flour->useAmount(200.0);
-    dish->sugar->useAmount(50.0);
-    dish->eggs->useAmount(2.0);
-    dish->milk->useAmount(100.0);
+    StockReservation stock;
+    stock.add(dish->flour, Grams(200))
+         .add(dish->sugar, Grams(50))
+         .add(dish->eggs, Grams(2))
+         .add(dish->milk, Grams(100));
+    stock.reserve();
 
     cout << "Смешиваем муку, сахар, яйца и молоко миксером до теста...\n";
     dish->mixer->mix();
@@ -1192,17 +1840,13 @@ void Cook::cookCookies(CookieDish* dish) {
     dish->oven->preheat(190.0);
     dish->oven->setTimerMinutes(15);
 
-    int bakedSeconds = 0;
     cout << "Выпекаем печенье 15 минут при 190C...\n";
-    while (true) {
-        dish->oven->tick(180);
-        bakedSeconds += 180;
-        cout << "Прошло " << bakedSeconds / 60 << " минут...\n";
-        if (!dish->oven->isOn()) break;
-    }
+    long long bakedSeconds = co_await ovenOff(clock, dish->oven);
+    cout << "Прошло " << bakedSeconds / 60 << " минут...\n";
+    stock.commit();
 
-    int bakedMin    = bakedSeconds / 60;
-    int expectedMin = 15;
+    long long bakedMin    = bakedSeconds / 60;
+    int       expectedMin = 15;
     if (bakedMin > expectedMin + 5) {
         throw OvercookedDishException("Печенье сгорело");
     }
@@ -1214,52 +1858,64 @@ void Cook::cookCookies(CookieDish* dish) {
 }
 
 void Cook::cookRice(RiceDish* dish) {
+    cookRiceTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookRiceTask(RiceDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->rice)  throw IngredientNotFoundException("Нет риса");
     if (!dish->pot || !dish->stove) throw ToolNotAvailableException("Нет кастрюли или плиты для риса");
     if (!dish->boilTimer)     throw TimerNotSetException("Нет таймера для риса");
 
-    dish->rice->useAmount(80.0);
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->rice, Grams(80));
+    stock.reserve();
     cout << "Промываем и засыпаем рис в кастрюлю...\n";
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
 
     const int totalSeconds = 15 * 60;
-    const int step = 5 * 60;
-    int minutesPassed = 0;
 
     dish->boilTimer->start(totalSeconds);
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки риса...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки риса...\n";
+    stock.commit();
     dish->pot->stopBoil();
     dish->stove->turnOffBurner();
     cout << "Рис готов!\n";
 }
 
 void Cook::cookBoiledEggs(BoiledEggDish* dish) {
+    cookBoiledEggsTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookBoiledEggsTask(BoiledEggDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->eggs) throw IngredientNotFoundException("Нет яиц");
     if (!dish->pot || !dish->stove) throw ToolNotAvailableException("Нет кастрюли или плиты для яиц");
     if (!dish->boilTimer) throw TimerNotSetException("Нет таймера для яиц");
 
-    dish->eggs->useAmount(3.0);
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->eggs, Grams(3));
+    stock.reserve();
     cout << "Кладём яйца в кастрюлю с водой...\n";
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
 
     const int totalSeconds = 8 * 60;
-    const int step = 2 * 60;
-    int minutesPassed = 0;
 
     dish->boilTimer->start(totalSeconds);
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки яиц...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки яиц...\n";
+    stock.commit();
 
     dish->pot->stopBoil();
     dish->stove->turnOffBurner();
@@ -1267,29 +1923,35 @@ void Cook::cookBoiledEggs(BoiledEggDish* dish) {
 }
 
 void Cook::cookMashedPotato(MashedPotatoDish* dish) {
+    cookMashedPotatoTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookMashedPotatoTask(MashedPotatoDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->potatoes || !dish->milk) throw IngredientNotFoundException("Нет картофеля или молока для пюре");
     if (!dish->pot || !dish->stove)  throw ToolNotAvailableException("Нет кастрюли или плиты для пюре");
     if (!dish->boilTimer) throw TimerNotSetException("Нет таймера для пюре");
     if (!dish->masher) throw ToolNotAvailableException("Нет potato masher для пюре");
 
-    dish->potatoes->useAmount(200.0);
-    dish->milk->useAmount(50.0);
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->masher).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->potatoes, Grams(200))
+         .add(dish->milk, Grams(50));
+    stock.reserve();
     cout << "Чистим и нарезаем картофель...\n";
 
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
 
     const int totalSeconds = 20 * 60;
-    const int step = 5 * 60;
-    int minutesPassed = 0;
 
     dish->boilTimer->start(totalSeconds);
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки картофеля...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки картофеля...\n";
+    stock.commit();
     dish->pot->stopBoil();
     dish->stove->turnOffBurner();
     cout << "Разминаем картофель с молоком при помощи potato masher...\n";
@@ -1298,6 +1960,10 @@ void Cook::cookMashedPotato(MashedPotatoDish* dish) {
 }
 
 void Cook::cookGrilledCheese(GrilledCheeseDish* dish) {
+    cookGrilledCheeseTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookGrilledCheeseTask(GrilledCheeseDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->bread || !dish->cheese) throw IngredientNotFoundException("Нет хлеба или сыра для грилл-сэндвича");
     if (!dish->pan || !dish->stove) throw ToolNotAvailableException("Нет сковороды или плиты для грилл-сэндвича");
@@ -1308,49 +1974,57 @@ void Cook::cookGrilledCheese(GrilledCheeseDish* dish) {
         throw ToolNotAvailableException("Доска непригодна для хлеба при приготовлении грилл-сэндвича");
     }
 
-    dish->bread->useAmount(2.0);
-    dish->cheese->useAmount(40.0);
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->bread, Grams(2))
+         .add(dish->cheese, Grams(40));
+    stock.reserve();
     cout << "Нарезаем хлеб и сыр на доске...\n";
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
     cout << "Обжариваем сэндвич на сковороде...\n";
 
     const int totalSeconds = 5 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин жарки сэндвича...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки сэндвича...\n";
+    stock.commit();
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
     cout << "Горячий грилл-сэндвич с сыром готов!\n";
 }
 
 void Cook::cookFriedFish(FriedFishDish* dish) {
+    cookFriedFishTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookFriedFishTask(FriedFishDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->fish)  throw IngredientNotFoundException("Нет рыбы");
     if (!dish->pan || !dish->stove) throw ToolNotAvailableException("Нет сковороды или плиты для рыбы");
     if (!dish->fryTimer)      throw TimerNotSetException("Нет таймера для рыбы");
 
-    dish->fish->useAmount(150.0);
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->fish, Grams(150));
+    stock.reserve();
     cout << "Подготавливаем рыбу к жарке...\n";
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
 
     const int totalSeconds = 7 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин жарки рыбы...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки рыбы...\n";
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -1358,6 +2032,10 @@ void Cook::cookFriedFish(FriedFishDish* dish) {
 }
 
 void Cook::cookFruitSalad(FruitSaladDish* dish) {
+    cookFruitSaladTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookFruitSaladTask(FruitSaladDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->fruits) throw IngredientNotFoundException("Нет фруктов для салата");
     if (!dish->knife || !dish->knife->canCut()) {
@@ -1366,59 +2044,75 @@ void Cook::cookFruitSalad(FruitSaladDish* dish) {
     if (!dish->board) {
         throw ToolNotAvailableException("Нет доски для фруктового салата");
     }
-    dish->fruits->useAmount(200.0);
+    StockReservation stock;
+    stock.add(dish->fruits, Grams(200));
+    stock.reserve();
+    stock.commit();
     cout << "Нарезаем фрукты на доске и смешиваем — фруктовый салат готов!\n";
+    co_return;
 }
 
 void Cook::cookPorridge(PorridgeDish* dish) {
+    cookPorridgeTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookPorridgeTask(PorridgeDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->oats || !dish->milk) throw IngredientNotFoundException("Нет овсянки или молока");
     if (!dish->pot || !dish->stove) throw ToolNotAvailableException("Нет кастрюли или плиты для каши");
     if (!dish->boilTimer)     throw TimerNotSetException("Нет таймера для каши");
 
-    dish->oats->useAmount(50.0);
-    dish->milk->useAmount(150.0);
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->oats, Grams(50))
+         .add(dish->milk, Grams(150));
+    stock.reserve();
     cout << "Смешиваем овсянку с молоком в кастрюле...\n";
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
 
     const int totalSeconds = 7 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
 
     dish->boilTimer->start(totalSeconds);
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин варки каши...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки каши...\n";
+    stock.commit();
     dish->pot->stopBoil();
     dish->stove->turnOffBurner();
     cout << "Овсяная каша готова!\n";
 }
 
 void Cook::cookSteak(SteakDish* dish) {
+    cookSteakTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookSteakTask(SteakDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->meat) throw IngredientNotFoundException("Нет мяса для стейка");
     if (!dish->pan || !dish->stove) throw ToolNotAvailableException("Нет сковороды или плиты для стейка");
     if (!dish->fryTimer)      throw TimerNotSetException("Нет таймера для стейка");
 
-    dish->meat->useAmount(180.0);
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->meat, Grams(180));
+    stock.reserve();
     cout << "Разогреваем сковороду и выкладываем стейк...\n";
 
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
 
     const int totalSeconds = 8 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин жарки стейка...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки стейка...\n";
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -1426,6 +2120,10 @@ void Cook::cookSteak(SteakDish* dish) {
 }
 
 void Cook::cookHotDog(HotDogDish* dish) {
+    cookHotDogTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookHotDogTask(HotDogDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->bun || !dish->sausage) {
@@ -1438,24 +2136,25 @@ void Cook::cookHotDog(HotDogDish* dish) {
         throw TimerNotSetException("Нет таймера для хот-дога");
     }
 
-    dish->bun->useAmount(1.0);
-    dish->sausage->useAmount(1.0);
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->bun, Grams(1))
+         .add(dish->sausage, Grams(1));
+    stock.reserve();
 
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
     cout << "Разогреваем сковороду для сосиски...\n";
 
     const int totalSeconds = 2 * 60;
-    const int step  = 60;
-    int       secondsPassed = 0;
     dish->fryTimer->start(totalSeconds);
     cout << "Обжариваем сосиску на сковороде...\n";
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60
-             << " мин обжарки сосиски...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин обжарки сосиски...\n";
+    stock.commit();
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
 
@@ -1463,24 +2162,30 @@ void Cook::cookHotDog(HotDogDish* dish) {
 }
 
 void Cook::cookSauteedMushrooms(SauteedMushroomsDish* dish) {
+    cookSauteedMushroomsTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookSauteedMushroomsTask(SauteedMushroomsDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->mushrooms) throw IngredientNotFoundException("Нет грибов");
     if (!dish->pan || !dish->stove) throw ToolNotAvailableException("Нет сковороды или плиты для грибов");
     if (!dish->fryTimer)      throw TimerNotSetException("Нет таймера для грибов");
 
-    dish->mushrooms->useAmount(120.0);
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
+    StockReservation stock;
+    stock.add(dish->mushrooms, Grams(120));
+    stock.reserve();
     cout << "Кладём грибы на разогретую сковороду...\n";
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
     const int totalSeconds = 6 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин жарки грибов...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки грибов...\n";
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -1488,6 +2193,10 @@ void Cook::cookSauteedMushrooms(SauteedMushroomsDish* dish) {
 }
 
 void Cook::cookFriedPotato(FriedPotatoDish* dish) {
+    cookFriedPotatoTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookFriedPotatoTask(FriedPotatoDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->potatoes) throw IngredientNotFoundException("Нет картофеля");
     if (!dish->pan || !dish->stove) throw ToolNotAvailableException("Нет сковороды или плиты для картофеля");
@@ -1495,29 +2204,35 @@ void Cook::cookFriedPotato(FriedPotatoDish* dish) {
     if (!dish->knife || !dish->knife->canCut()) throw ToolNotAvailableException("Нож недоступен для нарезки картофеля");
     if (!dish->board) throw ToolNotAvailableException("Нет разделочной доски для картофеля");
 
+    EquipmentLease lease;
+    lease.add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем картофель на доске...\n";
-    dish->potatoes->useAmount(200.0);
+    StockReservation stock;
+    stock.add(dish->potatoes, Grams(200));
+    stock.reserve();
     cout << "Выкладываем картофель на сковороду...\n";
 
     dish->stove->turnOnBurner();
     dish->pan->heatUp();
 
     const int totalSeconds = 12 * 60;
-    const int step = 3 * 60;
-    int minutesPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин жарки картофеля...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки картофеля...\n";
+    stock.commit();
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
     cout << "Жареный картофель готов!\n";
 }
 
 void Cook::cookTomatoSoup(TomatoSoupDish* dish) {
+    cookTomatoSoupTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookTomatoSoupTask(TomatoSoupDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->tomatoes || !dish->veggies) throw IngredientNotFoundException("Нет томатов или овощей для супа");
     if (!dish->pot || !dish->stove) throw ToolNotAvailableException("Нет кастрюли или плиты для томатного супа");
@@ -1525,29 +2240,35 @@ void Cook::cookTomatoSoup(TomatoSoupDish* dish) {
     if (!dish->knife || !dish->knife->canCut()) throw ToolNotAvailableException("Нож недоступен для нарезки томатного супа");
     if (!dish->board) throw ToolNotAvailableException("Нет разделочной доски для томатного супа");
 
+    EquipmentLease lease;
+    lease.add(dish->pot).add(dish->stove).add(dish->boilTimer);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем томаты и овощи на доске...\n";
-    dish->tomatoes->useAmount(150.0);
-    dish->veggies->useAmount(80.0);
+    StockReservation stock;
+    stock.add(dish->tomatoes, Grams(150))
+         .add(dish->veggies, Grams(80));
+    stock.reserve();
 
     cout << "Кладём томаты и овощи в кастрюлю и ставим на плиту...\n";
     dish->stove->turnOnBurner();
     dish->pot->startBoil();
     const int totalSeconds = 25 * 60;
-    const int step = 5 * 60;
-    int minutesPassed = 0;
     dish->boilTimer->start(totalSeconds);
 
-    while (!dish->boilTimer->isFinished()) {
-        dish->boilTimer->tick(step);
-        minutesPassed += step / 60;
-        cout << "Прошло " << minutesPassed << " мин варки томатного супа...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->boilTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин варки томатного супа...\n";
+    stock.commit();
     dish->pot->stopBoil();
     dish->stove->turnOffBurner();
     cout << "Томатный суп готов!\n";
 }
 
 void Cook::cookVegOmelette(VegOmeletteDish* dish) {
+    cookVegOmeletteTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookVegOmeletteTask(VegOmeletteDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->eggs || !dish->veggies || !dish->milk) {
@@ -1568,16 +2289,23 @@ void Cook::cookVegOmelette(VegOmeletteDish* dish) {
     if (!dish->mixer) {
         throw ToolNotAvailableException("Нет миксера для омлета");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->mixer).add(dish->pan).add(dish->stove).add(dish->fryTimer);
+    co_await leaseAcquired(clock, lease);
+
     if (!dish->mixer->plugIn()) {
         throw ToolNotAvailableException("Миксер не включён в розетку для омлета");
     }
 
     cout << "Нарезаем овощи для омлета на доске...\n";
-    dish->veggies->useAmount(50.0);
+    StockReservation stock;
+    stock.add(dish->veggies, Grams(50))
+         .add(dish->eggs, Grams(3))
+         .add(dish->milk, Grams(30));
+    stock.reserve();
 
     cout << "Разбиваем яйца и добавляем молоко...\n";
-    dish->eggs->useAmount(3.0);
-    dish->milk->useAmount(30.0);
 
     cout << "Смешиваем яйца, молоко и нарезанные овощи миксером...\n";
     dish->mixer->mix();
@@ -1586,15 +2314,11 @@ void Cook::cookVegOmelette(VegOmeletteDish* dish) {
     dish->pan->heatUp();
 
     const int totalSeconds = 6 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
 
     dish->fryTimer->start(totalSeconds);
-    while (!dish->fryTimer->isFinished()) {
-        dish->fryTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин жарки омлета...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->fryTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин жарки омлета...\n";
+    stock.commit();
 
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
@@ -1602,6 +2326,10 @@ void Cook::cookVegOmelette(VegOmeletteDish* dish) {
 }
 
 void Cook::cookGarlicBread(GarlicBreadDish* dish) {
+    cookGarlicBreadTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookGarlicBreadTask(GarlicBreadDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
 
     if (!dish->bread || !dish->garlic) {
@@ -1619,38 +2347,52 @@ void Cook::cookGarlicBread(GarlicBreadDish* dish) {
     if (!dish->board->isSafeForBread()) {
         throw ToolNotAvailableException("Доска непригодна для хлеба (не деревянная или мокрая)");
     }
+
+    EquipmentLease lease;
+    lease.add(dish->oven);
+    co_await leaseAcquired(clock, lease);
+
     cout << "Нарезаем чеснок на доске...\n";
-    dish->garlic->useAmount(5.0);
+    StockReservation stock;
+    stock.add(dish->garlic, Grams(5))
+         .add(dish->bread, Grams(2));
+    stock.reserve();
     cout << "Берём ломтики хлеба...\n";
-    dish->bread->useAmount(2.0);
     cout << "Намазываем хлеб нарезанным чесноком...\n";
     dish->oven->closeDoor();
     dish->oven->preheat(180.0);
     dish->oven->setTimerMinutes(8);
-    int bakedSeconds = 0;
     cout << "Запекаем чесночный хлеб 8 минут при 180C...\n";
-    while (true) {
-        dish->oven->tick(120);
-        bakedSeconds += 120;
-        cout << "Прошло " << bakedSeconds / 60 << " минут...\n";
-        if (!dish->oven->isOn()) break;
-    }
+    long long bakedSeconds = co_await ovenOff(clock, dish->oven);
+    cout << "Прошло " << bakedSeconds / 60 << " минут...\n";
+    stock.commit();
 
     cout << "Чесночный хлеб готов!\n";
 }
 
 void Cook::cookSimpleSauce(SimpleSauceDish* dish) {
+    cookSimpleSauceTask(dish).runOn(clock);
+}
+
+CookTask Cook::cookSimpleSauceTask(SimpleSauceDish* dish) {
     cout << "\n=== Готовим блюдо: " << dish->getName() << " ===\n";
     if (!dish->base || !dish->cream) throw IngredientNotFoundException("Нет основы или сливок для соуса");
     if (!dish->pan || !dish->stove)  throw ToolNotAvailableException("Нет сковороды или плиты для соуса");
     if (!dish->heatTimer)  throw TimerNotSetException("Нет таймера для соуса");
     if (!dish->mixer)   throw ToolNotAvailableException("Нет миксера для соуса");
+
+    EquipmentLease lease;
+    lease.add(dish->mixer).add(dish->pan).add(dish->stove).add(dish->heatTimer);
+    co_await leaseAcquired(clock, lease);
+
     if (!dish->mixer->plugIn()) {
         throw ToolNotAvailableException("Миксер не включён в розетку для соуса");
     }
 
-    dish->base->useAmount(50.0);
-    dish->cream->useAmount(50.0);
+    StockReservation stock;
+    stock.add(dish->base, Grams(50))
+         .add(dish->cream, Grams(50));
+    stock.reserve();
     cout << "Смешиваем основу и сливки миксером...\n";
     dish->mixer->mix();
 
@@ -1659,14 +2401,10 @@ void Cook::cookSimpleSauce(SimpleSauceDish* dish) {
     dish->pan->heatUp();
 
     const int totalSeconds = 4 * 60;
-    const int step = 60;
-    int secondsPassed = 0;
     dish->heatTimer->start(totalSeconds);
-    while (!dish->heatTimer->isFinished()) {
-        dish->heatTimer->tick(step);
-        secondsPassed += step;
-        cout << "Прошло " << secondsPassed / 60 << " мин прогрева соуса...\n";
-    }
+    long long secondsPassed = co_await timerFinished(clock, dish->heatTimer);
+    cout << "Прошло " << secondsPassed / 60 << " мин прогрева соуса...\n";
+    stock.commit();
     dish->pan->coolDown();
     dish->stove->turnOffBurner();
     cout << "Простой сливочный соус готов!\n";
@@ -1677,7 +2415,9 @@ void Cook::cookSimpleSauce(SimpleSauceDish* dish) {
 void Menu::show() const {
     cout << "\n==== МЕНЮ ====\n";
     for (size_t i = 0; i < dishes.size(); ++i) {
-        cout << (i + 1) << ") " << dishes[i]->getName() << "\n";
+        cout << (i + 1) << ") " << dishes[i]->getName();
+        if (!dishes[i]->canCook()) cout << " (нет в наличии)";
+        cout << "\n";
     }
     cout << "0) Выход\n";
 }
@@ -1686,7 +2426,20 @@ void Menu::addDish(Dish* d) {
     if (d) dishes.push_back(d);
 }
 
+size_t Menu::size() const {
+    return dishes.size();
+}
+
+Dish* Menu::dishAt(int number) const {
+    if (number < 1 || number > static_cast<int>(dishes.size())) return nullptr;
+    return dishes[static_cast<size_t>(number - 1)];
+}
+
 void Menu::run() {
+    run(function<void(Dish*)>());
+}
+
+void Menu::run(const function<void(Dish*)>& cooked) {
     while (true) {
         show();
         cout << "Выберите номер блюда: ";
@@ -1703,9 +2456,14 @@ void Menu::run() {
             cout << "Нет такого пункта.\n";
             continue;
         }
+        if (!dishes[choice - 1]->canCook()) {
+            cout << "Блюдо \"" << dishes[choice - 1]->getName() << "\" сейчас не приготовить.\n";
+            continue;
+        }
         dishes[choice - 1]->cook();
 
         cout << "Блюдо \"" << dishes[choice - 1]->getName()
              << "\" успешно приготовлено.\n";
+        if (cooked) cooked(dishes[choice - 1]);
     }
 }
@@ -13,11 +13,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <vector>
 #include <iomanip>
 #include <stdexcept>
 
+#include "simclock.hpp"
+#include "ledger.hpp"
+
 using namespace std;
 
 /**
@@ -124,6 +132,113 @@ public:
     StorageException(const char* msg) : runtime_error(msg) {}
 };
 
+/**
+ * @enum KitchenError
+ * @brief Код ошибки приготовления для API без исключений.
+ *
+ * Каждому коду, кроме None, соответствует один из классов исключений выше;
+ * CookStatus::throwIfFailed() превращает код обратно в исключение.
+ */
+enum class KitchenError : unsigned char {
+    None,                ///< Ошибки нет.
+    IngredientNotFound,  ///< См. IngredientNotFoundException.
+    NotEnoughIngredient, ///< См. NotEnoughIngredientException.
+    ToolNotAvailable,    ///< См. ToolNotAvailableException.
+    InvalidTemperature,  ///< См. InvalidTemperatureException.
+    TimerNotSet,         ///< См. TimerNotSetException.
+    Overcooked,          ///< См. OvercookedDishException.
+    Undercooked,         ///< См. UndercookedDishException.
+    Storage              ///< См. StorageException.
+};
+
+/**
+ * @enum ResourceKind
+ * @brief Тип ресурса кухни (ингредиент, инструмент, оборудование).
+ */
+enum class ResourceKind : unsigned char {
+    Ingredient, ///< Ингредиент.
+    Tool,       ///< Произвольный инструмент.
+    Knife,      ///< Нож.
+    Board,      ///< Разделочная доска.
+    Pan,        ///< Сковорода.
+    Pot,        ///< Кастрюля.
+    Mixer,      ///< Миксер.
+    Masher,     ///< Толкушка.
+    Oven,       ///< Духовка.
+    Stove,      ///< Плита.
+    Timer       ///< Таймер.
+};
+
+/**
+ * @struct CookStatus
+ * @brief Итог приготовления без исключений (16 байт).
+ *
+ * Обычные отказы — не хватило продукта, грязный инструмент, передержка —
+ * возвращаются кодом, а не раскруткой стека. Виновник задаётся типом и
+ * индексом ресурса в RecipeKitchen (для табличных рецептов).
+ */
+struct CookStatus {
+    KitchenError   error;   ///< Код ошибки.
+    ResourceKind   kind;    ///< Тип виновного ресурса.
+    unsigned short culprit; ///< Индекс виновного ресурса или NO_CULPRIT.
+    unsigned short step;    ///< Номер шага рецепта, на котором произошёл отказ.
+    const char*    message; ///< Текст ошибки (строка с постоянным временем жизни) или nullptr.
+
+    static const unsigned short NO_CULPRIT = 0xFFFF; ///< Виновник неизвестен.
+
+    /**
+     * @brief Успешный итог.
+     * @return Статус без ошибки.
+     */
+    static CookStatus success() {
+        return CookStatus{KitchenError::None, ResourceKind::Tool, NO_CULPRIT, 0, nullptr};
+    }
+
+    /**
+     * @brief Неудачный итог без известного виновника.
+     * @param e Код ошибки.
+     * @param msg Текст ошибки (nullptr — текст по умолчанию для кода).
+     * @return Статус с ошибкой.
+     */
+    static CookStatus failure(KitchenError e, const char* msg = nullptr);
+
+    /**
+     * @brief Проверяет, что ошибки нет.
+     * @return true, если error == KitchenError::None.
+     */
+    bool ok() const {
+        return error == KitchenError::None;
+    }
+
+    /**
+     * @brief Бросает исключение, соответствующее коду ошибки.
+     *
+     * Ничего не делает для успешного статуса.
+     * @throw IngredientNotFoundException, NotEnoughIngredientException,
+     *        ToolNotAvailableException, InvalidTemperatureException,
+     *        TimerNotSetException, OvercookedDishException,
+     *        UndercookedDishException или StorageException по коду.
+     */
+    void throwIfFailed() const;
+
+    /**
+     * @brief Переводит исключение предметной области в код (обратное throwIfFailed()).
+     *
+     * Текст исключения не сохраняется: он живёт не дольше самого исключения.
+     * @param e Исключение.
+     * @return Статус с кодом по типу исключения (success() для пустого e).
+     * @throw Само e, если оно не из предметной области.
+     */
+    static CookStatus fromException(const exception_ptr& e);
+
+    /**
+     * @brief Текст ошибки по умолчанию.
+     * @param e Код ошибки.
+     * @return Строка с постоянным временем жизни.
+     */
+    static const char* describe(KitchenError e);
+};
+
 /**
  * @class Unit
  * @brief Единица измерения (граммы, литры, штуки и т.п.).
@@ -209,32 +324,323 @@ public:
      * @return true, если значение <= 0; иначе false.
      */
     bool isZero() const;
+
+    /**
+     * @brief Проверяет, задана ли единица измерения.
+     * @return true, если unit != nullptr.
+     */
+    bool hasUnit() const;
+};
+
+/**
+ * @namespace units
+ * @brief Стандартные единицы измерения, известные при компиляции.
+ *
+ * Единица — тип-метка с числом миллиграммов на единицу (MG) и видом
+ * (масса, объём или штуки). Количество в такой единице — Amount<U>:
+ * перевод в граммы и миллиграммы сворачивается в умножение на константу,
+ * а «количество без единицы» записать нельзя. Единицы, заданные
+ * пользователем (строка unit в описании кухни), остаются объектами Unit.
+ */
+namespace units {
+
+/**
+ * @enum Dimension
+ * @brief Вид единицы: величины разных видов не переводятся друг в друга неявно.
+ */
+enum class Dimension : unsigned char {
+    Mass,   ///< Масса.
+    Volume, ///< Объём (жидкости).
+    Count   ///< Штуки.
+};
+
+/**
+ * @struct Tag
+ * @brief Основа единицы-метки.
+ * @tparam Mg Миллиграммов в одной единице.
+ * @tparam D Вид единицы.
+ */
+template <long long Mg, Dimension D>
+struct Tag {
+    static constexpr long long MG        = Mg;                    ///< Миллиграммов в единице.
+    static constexpr Dimension DIMENSION = D;                     ///< Вид.
+    static constexpr bool      LIQUID    = D == Dimension::Volume; ///< Жидкая ли единица (как Unit::isLiquid()).
+};
+
+struct Gram       : Tag<1000, Dimension::Mass>      { static constexpr const char* NAME = "g";  };  ///< Грамм.
+struct Kilogram   : Tag<1000000, Dimension::Mass>   { static constexpr const char* NAME = "kg"; };  ///< Килограмм.
+struct Milliliter : Tag<1000, Dimension::Volume>    { static constexpr const char* NAME = "ml"; };  ///< Миллилитр (плотность воды).
+struct Liter      : Tag<1000000, Dimension::Volume> { static constexpr const char* NAME = "l";  };  ///< Литр (плотность воды).
+
+/**
+ * @struct Piece
+ * @brief Штука известной массы.
+ * @tparam Grams Граммов в одной штуке.
+ */
+template <long long Grams>
+struct Piece : Tag<Grams * 1000, Dimension::Count> {
+    static constexpr const char* NAME = "pc"; ///< Название.
+};
+
+/**
+ * @brief Объект Unit для единицы-метки (для кода, которому нужен Quantity).
+ * @tparam U Единица.
+ * @return Единица с тем же коэффициентом (одна на программу).
+ */
+template <class U>
+Unit& unitOf() {
+    static Unit u(U::NAME, static_cast<double>(U::MG) / 1000.0, U::LIQUID, 0);
+    return u;
+}
+
+} // namespace units
+
+/**
+ * @class Amount
+ * @brief Количество в единице, известной при компиляции.
+ *
+ * Количество в другой единице того же вида приводится неявно
+ * (Amount<Kilogram> → Amount<Gram>); между видами — только через граммы.
+ * @tparam U Единица из namespace units.
+ */
+template <class U>
+class Amount {
+private:
+    double value; ///< Значение в единицах U.
+
+public:
+    using unit = U; ///< Единица.
+
+    /**
+     * @brief Конструктор количества.
+     * @param v Значение в единицах U.
+     */
+    constexpr explicit Amount(double v = 0.0) : value(v) {}
+
+    /**
+     * @brief Приводит количество из другой единицы того же вида.
+     * @param other Исходное количество.
+     */
+    template <class V>
+        requires (V::DIMENSION == U::DIMENSION)
+    constexpr Amount(Amount<V> other)
+        : value(other.count() * (static_cast<double>(V::MG) / static_cast<double>(U::MG))) {}
+
+    /**
+     * @brief Количество из миллиграммов.
+     * @param mg Масса в миллиграммах.
+     * @return Количество в единицах U.
+     */
+    static constexpr Amount fromMilligrams(long long mg) {
+        return Amount(static_cast<double>(mg) / static_cast<double>(U::MG));
+    }
+
+    /**
+     * @brief Значение в единицах U.
+     * @return Число.
+     */
+    constexpr double count() const { return value; }
+
+    /**
+     * @brief Переводит количество в граммы.
+     * @return Масса в граммах.
+     */
+    constexpr double toGrams() const { return value * (static_cast<double>(U::MG) / 1000.0); }
+
+    /**
+     * @brief Переводит количество в миллиграммы фиксированной точки.
+     *
+     * Округляет так же, как Ingredient::toMilligrams() (половина — от нуля).
+     * @return Масса в миллиграммах.
+     */
+    constexpr long long milligrams() const {
+        double mg = value * static_cast<double>(U::MG);
+        return mg >= 0.0 ? static_cast<long long>(mg + 0.5) : -static_cast<long long>(-mg + 0.5);
+    }
+
+    /**
+     * @brief То же количество как Quantity (с общим объектом Unit единицы U).
+     * @return Количество.
+     */
+    Quantity toQuantity() const { return Quantity(value, &units::unitOf<U>()); }
+
+    constexpr Amount operator+(Amount o) const { return Amount(value + o.value); } ///< Сумма.
+    constexpr Amount operator-(Amount o) const { return Amount(value - o.value); } ///< Разность.
+    constexpr Amount operator*(double k) const { return Amount(value * k); }       ///< Масштаб.
+    constexpr bool operator==(Amount o) const { return value == o.value; }         ///< Равенство.
+    constexpr bool operator<(Amount o) const { return value < o.value; }           ///< Меньше.
+};
+
+using Grams       = Amount<units::Gram>;       ///< Граммы.
+using Kilograms   = Amount<units::Kilogram>;   ///< Килограммы.
+using Milliliters = Amount<units::Milliliter>; ///< Миллилитры.
+using Liters      = Amount<units::Liter>;      ///< Литры.
+
+template <long long G>
+using Pieces = Amount<units::Piece<G>>;        ///< Штуки по G граммов.
+
+class FeasibilityIndex; ///< Индекс выполнимости блюд (feasibility.hpp).
+class ExpiryIndex;      ///< Партии и сроки годности (expiry.hpp).
+class InventoryVersions; ///< Версии запасов и инструментов (versions.hpp).
+
+/**
+ * @enum InventorySlot
+ * @brief Вид значения, которое защищает InventoryWrite.
+ */
+enum class InventorySlot : unsigned char {
+    Stock, ///< Запас ингредиента.
+    Tool   ///< Состояние инструмента реестра.
+};
+
+/**
+ * @class InventoryWrite
+ * @brief Запись одного значения кухни с подключёнными версиями (versions.hpp).
+ *
+ * Открывает секцию записи потока, если она ещё не открыта (InventoryScope),
+ * и сохраняет прежнее значение для идущего снимка. У инструмента после
+ * записи обновляет его состояние в версиях. Без версий ничего не делает.
+ */
+class InventoryWrite {
+private:
+    InventoryVersions* versions; ///< Версии или nullptr.
+    InventorySlot      kind;     ///< Вид значения.
+    unsigned           slot;     ///< Индекс ингредиента или слот инструмента.
+    bool               owner;    ///< Секцию открыл этот объект.
+
+    void begin(); ///< Открывает секцию и сохраняет прежнее значение.
+    void end();   ///< Обновляет состояние инструмента и закрывает свою секцию.
+
+public:
+    /**
+     * @brief Начинает запись.
+     * @param v Версии значения или nullptr.
+     * @param k Вид значения.
+     * @param s Индекс ингредиента в RecipeKitchen или слот ToolRegistry.
+     */
+    InventoryWrite(InventoryVersions* v, InventorySlot k, unsigned s)
+        : versions(v), kind(k), slot(s), owner(false) {
+        if (versions) begin();
+    }
+
+    InventoryWrite(const InventoryWrite&) = delete;
+    InventoryWrite& operator=(const InventoryWrite&) = delete;
+
+    /// Заканчивает запись.
+    ~InventoryWrite() {
+        if (versions) end();
+    }
+};
+
+/**
+ * @class InventoryScope
+ * @brief Объединяет записи потока в одну секцию: снимок видит их все или ни одной.
+ *
+ * Так StockReservation списывает и возвращает набор ингредиентов. Секции
+ * должны быть короткими: снимок ждёт секций, начатых до него.
+ */
+class InventoryScope {
+public:
+    /// Открывает объединяющую область (вложенные продолжают внешнюю).
+    InventoryScope();
+
+    InventoryScope(const InventoryScope&) = delete;
+    InventoryScope& operator=(const InventoryScope&) = delete;
+
+    /// Закрывает секцию, если её открыли записи внутри этой области.
+    ~InventoryScope();
 };
 
 /**
  * @class Ingredient
  * @brief Ингредиент с количеством, калорийностью и признаком скоропортимости.
+ *
+ * Запас хранится в атомарном счётчике миллиграммов (фиксированная точка),
+ * поэтому списание не накапливает ошибку округления и выполняется
+ * через compare-and-swap без блокировок. Quantity задаёт единицу
+ * измерения и начальное количество.
  */
 class Ingredient {
 private:
     const char* name;     ///< Название ингредиента.
-    Quantity    quantity; ///< Количество ингредиента.
-    double      calories; ///< Калорийность (на условную порцию).
+    Quantity    quantity; ///< Начальное количество и единица измерения.
+    double      calories; ///< Калорийность, ккал на 100 г.
+    double      price;    ///< Цена за килограмм (0 — не задана).
     bool        perishable; ///< Признак скоропортящегося продукта.
+    atomic<long long> stockMg; ///< Текущий запас в миллиграммах.
+    FeasibilityIndex* feasibility; ///< Индекс, которому сообщается об изменении запаса, или nullptr.
+    unsigned          feasSlot;    ///< Номер ингредиента в индексе.
+    ExpiryIndex*      expiry;      ///< Индекс партий или nullptr (запас без сроков).
+    unsigned          expirySlot;  ///< Номер ингредиента в индексе партий.
+    InventoryVersions* versions;   ///< Версии запасов или nullptr.
+    unsigned          versionSlot; ///< Индекс ингредиента в версиях.
+
+    friend class FeasibilityIndex;
+    friend class ExpiryIndex;
+    friend class InventoryVersions;
+
+    /// Принимает поставку: в индекс партий, если он подключён, иначе в запас.
+    void receiveStock(long long mg);
+
+    /**
+     * @brief Списывает остаток партии [start, end) правее курсора расхода.
+     * @param received Всего поступило в партиях.
+     * @param start Начало партии на оси поступлений.
+     * @param end Конец партии.
+     * @return Списано миллиграммов.
+     */
+    long long evict(long long received, long long start, long long end);
 
 public:
     /**
      * @brief Конструктор ингредиента.
      * @param n Название.
      * @param q Количество.
-     * @param cal Калорийность.
+     * @param cal Калорийность, ккал на 100 г.
      * @param per Признак скоропортимости.
      */
     Ingredient(const char* n, const Quantity& q, double cal, bool per);
 
+    /**
+     * @brief Конструктор ингредиента с количеством в стандартной единице.
+     * @param n Название.
+     * @param q Количество.
+     * @param cal Калорийность, ккал на 100 г.
+     * @param per Признак скоропортимости.
+     */
+    template <class U>
+    Ingredient(const char* n, Amount<U> q, double cal, bool per)
+        : Ingredient(n, q.toQuantity(), cal, per) {}
+
+    /**
+     * @brief Копирует ингредиент вместе с текущим запасом.
+     * @param other Исходный ингредиент.
+     */
+    Ingredient(const Ingredient& other);
+
+    /**
+     * @brief Присваивает данные и текущий запас другого ингредиента.
+     * @param other Исходный ингредиент.
+     * @return *this.
+     */
+    Ingredient& operator=(const Ingredient& other);
+
+    /// Отключает ингредиент от индексов выполнимости и партий.
+    ~Ingredient();
+
+    /**
+     * @brief Переводит граммы в миллиграммы фиксированной точки.
+     * @param grams Масса в граммах.
+     * @return Масса в миллиграммах (с округлением).
+     */
+    static long long toMilligrams(double grams);
+
     /**
      * @brief Добавляет массу к текущему количеству.
+     *
+     * У ингредиента с партиями (expiry.hpp) добавленное — новая партия
+     * со сроком хранения ингредиента.
      * @param v Масса в граммах, которую нужно добавить.
+     * @throw StorageException если у количества не задана единица измерения.
      */
     void addAmount(double v);
 
@@ -242,29 +648,141 @@ public:
      * @brief Использует часть ингредиента.
      * @param vGrams Масса в граммах, которую нужно забрать.
      * @throw NotEnoughIngredientException если vGrams больше доступного количества.
+     * @throw StorageException если у количества не задана единица измерения.
      */
     void useAmount(double vGrams);
 
+    /**
+     * @brief Добавляет количество в стандартной единице (без проверки Unit).
+     * @param a Количество.
+     */
+    template <class U>
+    void addAmount(Amount<U> a) {
+        receiveStock(a.milligrams());
+    }
+
+    /**
+     * @brief Использует количество в стандартной единице (без проверки Unit).
+     * @param a Количество.
+     * @throw NotEnoughIngredientException если запаса не хватает.
+     */
+    template <class U>
+    void useAmount(Amount<U> a) {
+        if (!tryReserve(a.milligrams())) {
+            throw NotEnoughIngredientException("Not enough ingredient");
+        }
+    }
+
+    /**
+     * @brief Пытается атомарно списать mg миллиграммов.
+     * @param mg Масса в миллиграммах (>= 0).
+     * @return false, если запаса не хватает (запас не меняется).
+     */
+    bool tryReserve(long long mg);
+
+    /**
+     * @brief Пытается атомарно списать количество в стандартной единице.
+     * @param a Количество.
+     * @return false, если запаса не хватает (запас не меняется).
+     */
+    template <class U>
+    bool tryReserve(Amount<U> a) {
+        return tryReserve(a.milligrams());
+    }
+
+    /**
+     * @brief Возвращает ранее списанные миллиграммы в запас (не поставка: партий не создаёт).
+     * @param mg Масса в миллиграммах.
+     */
+    void restore(long long mg);
+
+    /**
+     * @brief Текущий запас в граммах.
+     * @return Масса в граммах.
+     */
+    double getGrams() const;
+
+    /**
+     * @brief Текущий запас в миллиграммах.
+     * @return Масса в миллиграммах.
+     */
+    long long getMilligrams() const;
+
+    /**
+     * @brief Текущий запас в стандартной единице.
+     * @return Количество в единицах U.
+     */
+    template <class U>
+    Amount<U> getAmount() const {
+        return Amount<U>::fromMilligrams(getMilligrams());
+    }
+
+    /**
+     * @brief Возвращает название ингредиента.
+     * @return Строка с названием.
+     */
+    const char* getName() const;
+
     /**
      * @brief Проверяет, является ли ингредиент скоропортящимся.
      * @return true, если продукт perishable; иначе false.
      */
     bool isPerishable() const;
+
+    /**
+     * @brief Калорийность.
+     * @return Килокалории на 100 г.
+     */
+    double getCalories() const;
+
+    /**
+     * @brief Цена.
+     * @return Цена за килограмм (0 — не задана).
+     */
+    double getPrice() const;
+
+    /**
+     * @brief Задаёт цену.
+     * @param perKg Цена за килограмм (>= 0).
+     * @throw StorageException если цена отрицательная.
+     */
+    void setPrice(double perKg);
+
+    /**
+     * @brief Калорийность и стоимость массы ингредиента.
+     * @param mg Масса в миллиграммах.
+     * @return Тысячные ккал и тысячные денежной единицы (с округлением).
+     */
+    NutritionTotals nutritionOf(long long mg) const;
 };
 
+class ToolRegistry; ///< Реестр состояния инструментов (tools.hpp).
+class TimerBank;    ///< Банк состояния таймеров (timers.hpp).
+
 /**
  * @class KitchenTool
  * @brief Базовый класс для кухонных инструментов (ножи, кастрюли, сковороды и т.д.).
  *
  * Хранит информацию о чистоте, доступности, занятости и «прочности» инструмента.
+ * Занятость — это аренда: пока инструмент арендован одним поваром
+ * (см. EquipmentLease), другие повара получить его не могут.
+ *
+ * Инструмент, подключённый к ToolRegistry (tools.hpp), хранит состояние
+ * в слоте реестра, а собственные поля не использует.
  */
 class KitchenTool {
 protected:
     const char* name; ///< Название инструмента.
     bool clean;       ///< Инструмент чистый.
     bool available;   ///< Инструмент доступен для использования.
-    bool busy;        ///< Инструмент занят.
+    atomic<bool> busy;///< Инструмент занят (арендован поваром).
     int  durability;  ///< Остаточный ресурс/прочность.
+    ToolRegistry* registry; ///< Реестр, где хранится состояние, или nullptr.
+    unsigned      slot;     ///< Слот в реестре.
+
+    friend class ToolRegistry;
+    friend class WorldSnapshot;
+    friend class FeasibilityIndex;
 
 public:
     /**
@@ -279,6 +797,12 @@ public:
                 bool a = true,
                 int  d = 100);
 
+    KitchenTool(const KitchenTool&) = delete;
+    KitchenTool& operator=(const KitchenTool&) = delete;
+
+    /// Отключает инструмент от реестра.
+    ~KitchenTool();
+
     /**
      * @brief Использует инструмент один раз.
      *
@@ -287,6 +811,12 @@ public:
      */
     void useTool();
 
+    /**
+     * @brief Использует инструмент один раз, не бросая исключений.
+     * @return false, если инструмент грязный, недоступен или сломан (ничего не меняется).
+     */
+    bool tryUse();
+
     /**
      * @brief Помечает инструмент как чистый.
      */
@@ -304,6 +834,41 @@ public:
      * @return true, если инструмент доступен, чист и имеет ресурс; иначе false.
      */
     bool isAvailable() const;
+
+    /**
+     * @brief Проверяет, чистый ли инструмент.
+     * @return true, если инструмент чистый.
+     */
+    bool isClean() const;
+
+    /**
+     * @brief Остаточная прочность.
+     * @return Число оставшихся использований.
+     */
+    int getDurability() const;
+
+    /**
+     * @brief Реестр, к которому подключён инструмент.
+     * @return Реестр или nullptr.
+     */
+    ToolRegistry* getRegistry() const;
+
+    /**
+     * @brief Пытается арендовать инструмент.
+     * @return true, если инструмент был свободен и теперь занят вызывающим.
+     */
+    bool tryLease();
+
+    /**
+     * @brief Возвращает арендованный инструмент.
+     */
+    void releaseLease();
+
+    /**
+     * @brief Проверяет, арендован ли инструмент.
+     * @return true, если инструмент занят.
+     */
+    bool isBusy() const;
 };
 
 /**
@@ -344,6 +909,12 @@ public:
      * @return true, если нож доступен и заточен.
      */
     bool canCut() const;
+
+    /**
+     * @brief Проверяет заточенность (без проверки доступности).
+     * @return true, если нож заточен.
+     */
+    bool isSharp() const;
 };
 
 /**
@@ -472,6 +1043,9 @@ public:
 /**
  * @class Timer
  * @brief Простой таймер с секундной точностью.
+ *
+ * Таймер, общий для нескольких блюд, выдаётся в аренду (см. EquipmentLease):
+ * запускать его может только повар, который его арендовал.
  */
 class Timer {
 private:
@@ -479,6 +1053,12 @@ private:
     bool running;///< Таймер запущен.
     int elapsed; ///< Сколько секунд прошло.
     int id;      ///< Идентификатор таймера.
+    TimerBank* bank; ///< Банк, где хранится состояние, или nullptr.
+    unsigned   slot; ///< Слот в банке.
+    atomic<bool> leased; ///< Таймер арендован поваром.
+
+    friend class TimerBank;
+    friend class WorldSnapshot;
 
 public:
     /**
@@ -490,6 +1070,12 @@ public:
      */
     Timer(int s = 0, bool r = false, int e = 0, int i = 0);
 
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    /// Отключает таймер от банка.
+    ~Timer();
+
     /**
      * @brief Запускает таймер на заданное количество секунд.
      * @param s Время в секундах (>0).
@@ -508,6 +1094,28 @@ public:
      * @return true, если таймер не работает и elapsed >= seconds.
      */
     bool isFinished() const;
+
+    /**
+     * @brief Сколько секунд осталось до завершения таймера.
+     * @return seconds - elapsed для запущенного таймера, иначе 0.
+     */
+    int remaining() const;
+
+    /**
+     * @brief Банк таймеров, к которому подключён таймер.
+     * @return Банк или nullptr.
+     */
+    TimerBank* getBank() const;
+    /**
+     * @brief Пытается арендовать таймер.
+     * @return true, если таймер был свободен и теперь занят вызывающим.
+     */
+    bool tryLease();
+
+    /**
+     * @brief Возвращает арендованный таймер.
+     */
+    void releaseLease();
 };
 
 /**
@@ -546,6 +1154,12 @@ public:
      * @throw ToolNotAvailableException если миксер недоступен.
      */
     void mix();
+
+    /**
+     * @brief Проверяет, включён ли миксер в сеть.
+     * @return true, если включён.
+     */
+    bool isPluggedIn() const;
 };
 
 /**
@@ -572,9 +1186,66 @@ public:
     void mash();
 };
 
+/**
+ * @class HeatCurve
+ * @brief Нелинейная кривая нагрева, заданная таблицей.
+ *
+ * Кривая — доля пройденного нагрева p(u) от доли времени u ∈ [0, 1]:
+ * p(0) = 0, p(1) = 1, p не убывает. Значения считаются один раз при
+ * создании и хранятся в таблице из SAMPLES + 1 точек, поэтому профиль с
+ * кривой на каждом тике только интерполирует между соседними точками
+ * (без exp()), а обратный запрос — двоичный поиск по таблице.
+ */
+class HeatCurve {
+private:
+    static const int SAMPLES = 64; ///< Отрезков таблицы.
+
+    double table[SAMPLES + 1];     ///< p(i / SAMPLES).
+
+    HeatCurve();
+
+public:
+    /**
+     * @brief Экспоненциальный нагрев: быстро вначале, медленно у цели.
+     *
+     * p(u) = (1 − e^(−rate·u)) / (1 − e^(−rate)).
+     * @param rate Крутизна (>0; чем больше, тем быстрее начальный нагрев).
+     * @return Кривая.
+     * @throw InvalidTemperatureException если rate <= 0.
+     */
+    static shared_ptr<const HeatCurve> exponential(double rate);
+
+    /**
+     * @brief Кусочно-линейный нагрев по опорным точкам.
+     *
+     * Точки (0, 0) и (1, 1) добавляются сами. Изломы между узлами таблицы
+     * сглаживаются до ближайших узлов.
+     * @param points Пары (доля времени, доля нагрева) по возрастанию времени.
+     * @return Кривая.
+     * @throw InvalidTemperatureException если точки вне [0, 1] или доля нагрева убывает.
+     */
+    static shared_ptr<const HeatCurve> piecewise(const vector<pair<double, double>>& points);
+
+    /**
+     * @brief Доля нагрева в момент u.
+     * @param u Доля времени (обрезается до [0, 1]).
+     * @return p(u).
+     */
+    double progress(double u) const;
+
+    /**
+     * @brief Наименьшая доля времени, к которой нагрев достигнет доли p.
+     * @param p Доля нагрева (обрезается до [0, 1]).
+     * @return u.
+     */
+    double timeFor(double p) const;
+};
+
 /**
  * @class TemperatureProfile
  * @brief Профиль нагрева: начальная и целевая температура, длительность, режим.
+ *
+ * Плавный нагрев по умолчанию линейный; setCurve() задаёт нелинейную кривую.
  */
 class TemperatureProfile {
 private:
@@ -582,6 +1253,9 @@ private:
     double targetTemp;  ///< Целевая температура.
     int    duration;    ///< Длительность нагрева в секундах.
     bool   gradual;     ///< Плавный ли нагрев.
+    shared_ptr<const HeatCurve> curve; ///< Кривая нагрева (nullptr — линейная).
+
+    friend class WorldSnapshot;
 
 public:
     /**
@@ -608,13 +1282,47 @@ public:
      */
     bool isReached(double current) const;
 
+    /**
+     * @brief Через сколько секунд от начала профиля будет достигнута температура.
+     *
+     * Обратная к currentTemp() функция: наименьшее elapsed, при котором
+     * currentTemp(elapsed) >= temp.
+     * @param temp Пороговая температура.
+     * @return Секунды от начала профиля или -1, если порог недостижим.
+     */
+    int secondsToReach(double temp) const;
+
     /**
      * @brief Переопределяет профиль температуры.
+     *
+     * Кривая нагрева сохраняется.
      * @param s Новая начальная температура.
      * @param t Новая целевая температура.
      * @param d Новая длительность.
      */
     void reset(double s, double t, int d);
+
+    /**
+     * @brief Задаёт кривую плавного нагрева.
+     * @param c Кривая (nullptr — линейный нагрев).
+     */
+    void setCurve(shared_ptr<const HeatCurve> c);
+
+    /**
+     * @brief Кривая плавного нагрева.
+     * @return Кривая или nullptr для линейного нагрева.
+     */
+    const HeatCurve* getCurve() const;
+};
+
+/**
+ * @struct OvenState
+ * @brief Состояние духовки в заданный момент (см. Oven::stateAt()).
+ */
+struct OvenState {
+    double temperature;    ///< Температура.
+    bool   on;             ///< Включена.
+    int    timerRemaining; ///< Секунд до конца выпечки (0 — таймер не идёт).
 };
 
 /**
@@ -629,6 +1337,9 @@ private:
     Timer  bakingTimer;        ///< Таймер выпечки.
     TemperatureProfile profile;///< Профиль нагрева.
     int elapsedSeconds;        ///< Сколько секунд прошло с начала нагрева.
+    atomic<bool> leased;       ///< Духовка арендована поваром.
+
+    friend class WorldSnapshot;
 
 public:
     /**
@@ -694,18 +1405,66 @@ public:
      * @return true, если дверца закрыта.
      */
     bool isDoorClosed() const;
+
+    /**
+     * @brief Сколько секунд осталось до выключения духовки по таймеру выпечки.
+     * @return Секунды до выключения или -1, если духовка выключена или таймер не запущен.
+     */
+    int secondsUntilOff() const;
+
+    /**
+     * @brief Сколько секунд осталось до достижения температуры temp.
+     * @param temp Пороговая температура.
+     * @return Секунды (0, если уже достигнута) или -1, если духовка выключена
+     *         или порог недостижим по текущему профилю.
+     */
+    int secondsUntilTemperature(double temp) const;
+
+    /**
+     * @brief Каким будет состояние духовки через seconds секунд.
+     *
+     * Совпадает с состоянием после tick(seconds), но духовку не меняет:
+     * вызывающий сразу узнаёт температуру и момент выключения без пошагового
+     * продвижения времени.
+     * @param seconds Через сколько секунд (отрицательное — сейчас).
+     * @return Температура, признак включения и остаток таймера.
+     */
+    OvenState stateAt(int seconds) const;
+
+    /**
+     * @brief Задаёт кривую нагрева для следующих разогревов.
+     * @param c Кривая (nullptr — линейный нагрев).
+     */
+    void setHeatCurve(shared_ptr<const HeatCurve> c);
+
+    /**
+     * @brief Пытается арендовать духовку.
+     * @return true, если духовка была свободна и теперь занята вызывающим.
+     */
+    bool tryLease();
+
+    /**
+     * @brief Возвращает арендованную духовку.
+     */
+    void releaseLease();
 };
 
 /**
  * @class Stove
  * @brief Плита с несколькими конфорками.
+ *
+ * Конфорки выдаются поварам в аренду (tryLeaseBurner()), поэтому при
+ * параллельной готовке включённых конфорок не больше, чем арендованных.
  */
 class Stove {
 private:
-    int burners;        ///< Общее количество конфорок.
-    int activeBurners;  ///< Активные конфорки.
-    bool gas;           ///< Тип плиты (газовая/нет).
-    bool on;            ///< Включена ли плита.
+    int burners;               ///< Общее количество конфорок.
+    atomic<int> activeBurners; ///< Активные конфорки.
+    atomic<int> leasedBurners; ///< Арендованные конфорки.
+    bool gas;                  ///< Тип плиты (газовая/нет).
+    atomic<bool> on;           ///< Включена ли плита.
+
+    friend class WorldSnapshot;
 
 public:
     /**
@@ -719,8 +1478,9 @@ public:
 
     /**
      * @brief Включает ещё одну конфорку (если есть свободная).
+     * @return false, если все конфорки уже заняты.
      */
-    void turnOnBurner();
+    bool turnOnBurner();
 
     /**
      * @brief Выключает одну активную конфорку.
@@ -734,9 +1494,31 @@ public:
      * @return burners - activeBurners.
      */
     int freeBurners() const;
+
+    /**
+     * @brief Возвращает общее количество конфорок.
+     * @return burners.
+     */
+    int getBurners() const;
+
+    /**
+     * @brief Пытается арендовать одну конфорку.
+     * @return true, если свободная конфорка нашлась.
+     */
+    bool tryLeaseBurner();
+
+    /**
+     * @brief Возвращает арендованную конфорку.
+     */
+    void releaseBurner();
 };
 
 class Cook; ///< Объявление повара для friend-связей
+class RecipeBook; ///< Табличные рецепты (см. recipe.hpp)
+struct BatchResult; ///< Итог партии (см. recipe.hpp)
+struct ScheduleReport; ///< Итог по плану этапов (см. schedule.hpp)
+class EventSink; ///< Приёмник журнала событий (см. eventlog.hpp)
+class CookTask; ///< Рецепт-сопрограмма (см. cotask.hpp)
 
 
 
@@ -770,6 +1552,37 @@ public:
      */
     virtual void cook() = 0;
 
+    /**
+     * @brief Приготовить блюдо силами указанного повара.
+     *
+     * Используется движком заказов, в котором один и тот же объект блюда
+     * готовят разные повара-работники. По умолчанию вызывает cook().
+     * @param ck Повар (не nullptr).
+     */
+    virtual void cookWith(Cook* ck);
+
+    /**
+     * @brief Приготовить блюдо, сообщив об отказе кодом, а не исключением.
+     *
+     * По умолчанию вызывает cookWith() и переводит пойманное исключение
+     * предметной области в CookStatus (без виновника). Табличные рецепты
+     * (RecipeDish) переопределяют метод и не бросают исключений вовсе.
+     * @param ck Повар (не nullptr).
+     * @return Итог приготовления.
+     */
+    virtual CookStatus tryCookWith(Cook* ck);
+
+    /**
+     * @brief Можно ли приготовить блюдо прямо сейчас, ничего не трогая.
+     *
+     * По умолчанию ответ неизвестен и считается положительным; табличные
+     * рецепты (RecipeDish) отвечают по индексу выполнимости книги.
+     * @return false, если блюдо заведомо не получится.
+     */
+    virtual bool canCook() const {
+        return true;
+    }
+
     /**
      * @brief Возвращает название блюда.
      * @return Строка с названием.
@@ -812,6 +1625,7 @@ public:
      * @throw ToolNotAvailableException если chef == nullptr.
      */
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -842,6 +1656,7 @@ public:
      * @brief Просит повара приготовить салат.
      */
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -865,6 +1680,7 @@ public:
                   Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -900,6 +1716,7 @@ public:
                 Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -929,6 +1746,7 @@ public:
               Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -957,6 +1775,7 @@ public:
                       Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -985,6 +1804,7 @@ public:
                  Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1015,6 +1835,7 @@ public:
                  Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1041,6 +1862,7 @@ public:
                  Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1069,6 +1891,7 @@ public:
                Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1093,6 +1916,7 @@ public:
              Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1117,6 +1941,7 @@ public:
                   Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1145,6 +1970,7 @@ public:
                      Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1175,6 +2001,7 @@ public:
                       Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1199,6 +2026,7 @@ public:
                   Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1221,6 +2049,7 @@ public:
                    Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1247,6 +2076,7 @@ public:
                  Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1271,6 +2101,7 @@ public:
               Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1297,6 +2128,7 @@ public:
                Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1321,6 +2153,7 @@ public:
                          Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1349,6 +2182,7 @@ public:
                     Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1379,6 +2213,7 @@ public:
                    Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1413,6 +2248,7 @@ public:
                     Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1439,6 +2275,7 @@ public:
                     Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1467,6 +2304,7 @@ public:
                     Cook* ck);
 
     void cook() override;
+    void cookWith(Cook* ck) override;
 };
 
 /**
@@ -1475,10 +2313,15 @@ public:
  *
  * Каждый метод Cook::cookXxx() получает указатель на конкретное блюдо
  * и пошагово выполняет действия над его ингредиентами и инструментами.
+ * Ожидание таймеров и духовки идёт через собственные часы симуляции повара,
+ * которые сразу переходят к моменту завершения. Тело рецепта — сопрограмма
+ * cookXxxTask() (cotask.hpp), а cookXxx() доводит её до конца на часах повара.
  */
 class Cook {
 private:
     const char* name; ///< Имя повара (для вывода на экран).
+    SimClock    clock; ///< Часы симуляции, по которым повар ждёт таймеры и духовку.
+    EventSink*  sink;  ///< Журнал событий табличных рецептов (nullptr — текст в cout).
 
 public:
     /**
@@ -1487,6 +2330,27 @@ public:
      */
     Cook(const char* n = "Повар");
 
+    /**
+     * @brief Часы симуляции повара.
+     * @return Ссылка на часы (текущее время — суммарное время готовки).
+     */
+    SimClock& getClock();
+
+    /**
+     * @brief Подключает журнал событий к табличным рецептам повара.
+     *
+     * С подключённым приёмником cookRecipe()/cookBatch() и инструменты,
+     * которыми они пользуются, не печатают текст, а пишут KitchenEvent.
+     * @param s Приёмник или nullptr (вернуть текстовый вывод).
+     */
+    void setSink(EventSink* s);
+
+    /**
+     * @brief Текущий приёмник журнала.
+     * @return Приёмник или nullptr.
+     */
+    EventSink* getSink() const;
+
     void cookChickenSoup(ChickenSoupDish* dish);
     void cookSalad(SaladDish* dish);
     void cookBakedMeat(BakedMeatDish* dish);
@@ -1512,6 +2376,114 @@ public:
     void cookVegOmelette(VegOmeletteDish* dish);
     void cookGarlicBread(GarlicBreadDish* dish);
     void cookSimpleSauce(SimpleSauceDish* dish);
+
+    /**
+     * @brief Рецепты cookXxx() в виде сопрограмм.
+     *
+     * Рецепт исполняется до первого ожидания таймера или духовки и
+     * засыпает; продолжение приносит событие часов повара. Так один поток
+     * ведёт много начатых блюд (DishInterleaver, cotask.hpp). Исключения
+     * рецепта сохраняются в задаче (CookTask::get()).
+     * @param dish Блюдо.
+     * @return Незапущенная задача.
+     */
+    CookTask cookChickenSoupTask(ChickenSoupDish* dish);
+    CookTask cookSaladTask(SaladDish* dish);
+    CookTask cookBakedMeatTask(BakedMeatDish* dish);
+    CookTask cookPancakesTask(PancakeDish* dish);
+    CookTask cookPastaTask(PastaDish* dish);
+    CookTask cookScrambledEggsTask(ScrambledEggsDish* dish);
+    CookTask cookVegGrillTask(VegGrillDish* dish);
+    CookTask cookMeatStewTask(MeatStewDish* dish);
+    CookTask cookSandwichTask(SandwichDish* dish);
+    CookTask cookCookiesTask(CookieDish* dish);
+    CookTask cookRiceTask(RiceDish* dish);
+    CookTask cookBoiledEggsTask(BoiledEggDish* dish);
+    CookTask cookMashedPotatoTask(MashedPotatoDish* dish);
+    CookTask cookGrilledCheeseTask(GrilledCheeseDish* dish);
+    CookTask cookFriedFishTask(FriedFishDish* dish);
+    CookTask cookFruitSaladTask(FruitSaladDish* dish);
+    CookTask cookPorridgeTask(PorridgeDish* dish);
+    CookTask cookSteakTask(SteakDish* dish);
+    CookTask cookHotDogTask(HotDogDish* dish);
+    CookTask cookSauteedMushroomsTask(SauteedMushroomsDish* dish);
+    CookTask cookFriedPotatoTask(FriedPotatoDish* dish);
+    CookTask cookTomatoSoupTask(TomatoSoupDish* dish);
+    CookTask cookVegOmeletteTask(VegOmeletteDish* dish);
+    CookTask cookGarlicBreadTask(GarlicBreadDish* dish);
+    CookTask cookSimpleSauceTask(SimpleSauceDish* dish);
+
+    /**
+     * @brief Исполняет табличный рецепт из книги.
+     *
+     * Шаги рецепта выполняются подряд одним интерпретатором (см. recipe.hpp).
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @throw Те же исключения, что и рукописные рецепты cookXxx.
+     */
+    void cookRecipe(const RecipeBook& book, int id);
+
+    /**
+     * @brief Исполняет табличный рецепт без исключений.
+     *
+     * Обычные отказы (не хватило продукта, инструмент недоступен, передержка)
+     * не бросают исключений: интерпретатор останавливается на шаге с ошибкой,
+     * аренда и неподтверждённый резерв возвращаются, а итог сообщает код,
+     * номер шага и виновный ресурс. cookRecipe() — обёртка над этим методом.
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @return Итог приготовления.
+     */
+    CookStatus tryCookRecipe(const RecipeBook& book, int id);
+
+    /**
+     * @brief Готовит партию из portions порций за один проход.
+     *
+     * Проверки, аренда, включение миксера, разогрев и подготовка выполняются
+     * один раз, ингредиенты резервируются сразу на все порции. Порции одной
+     * закладки ждут общего таймера, поэтому часы продвигаются один раз на
+     * закладку, а не на порцию. Закладок больше одной, только если порции
+     * не помещаются в кастрюлю (шаг require с объёмом).
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @param portions Число порций (при portions < 1 ничего не делается).
+     * @return Итог партии с временем готовности каждой порции.
+     * @throw NotEnoughIngredientException если ингредиентов не хватает на всю партию.
+     */
+    BatchResult cookBatch(const RecipeBook& book, int id, int portions);
+
+    /**
+     * @brief Готовит партию без исключений (см. cookBatch()).
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @param portions Число порций.
+     * @param out Итог партии (заполняется и при отказе — сколько успели).
+     * @return Итог приготовления.
+     */
+    CookStatus tryCookBatch(const RecipeBook& book, int id, int portions, BatchResult& out);
+
+    /**
+     * @brief Исполняет рецепт по плану этапов (см. schedule.hpp).
+     *
+     * Пролог и эпилог идут по порядку, а этапы запускаются, как только
+     * готовы их зависимости и свободно их оборудование; среди готовых
+     * первыми идут этапы с самым длинным оставшимся путём. Ожидания
+     * одновременных этапов идут параллельно по одним часам повара.
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @return Предсказанная и фактическая длительность блюда и этапов.
+     * @throw Те же исключения, что и cookRecipe().
+     */
+    ScheduleReport cookScheduled(const RecipeBook& book, int id);
+
+    /**
+     * @brief Исполняет рецепт по плану этапов без исключений (см. cookScheduled()).
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     * @param out Итог по плану (заполняется и при отказе).
+     * @return Итог приготовления.
+     */
+    CookStatus tryCookScheduled(const RecipeBook& book, int id, ScheduleReport& out);
 };
 
 /**
@@ -1527,6 +2499,8 @@ private:
 public:
     /**
      * @brief Показывает список блюд в консоли.
+     *
+     * Блюда, которые сейчас не приготовить (Dish::canCook()), помечаются «(нет в наличии)».
      */
     void show() const;
 
@@ -1536,11 +2510,32 @@ public:
      */
     void addDish(Dish* d);
 
+    /**
+     * @brief Число блюд в меню.
+     * @return Количество пунктов (без пункта «Выход»).
+     */
+    size_t size() const;
+
+    /**
+     * @brief Блюдо по номеру пункта.
+     * @param number Номер пункта, начиная с 1 (как в show()).
+     * @return Блюдо или nullptr, если такого пункта нет.
+     */
+    Dish* dishAt(int number) const;
+
     /**
      * @brief Основной цикл работы меню.
      *
      * Выводит список блюд, читает выбор пользователя и вызывает Dish::cook()
-     * для выбранного блюда. Выход — выбор пункта 0 или некорректный ввод.
+     * для выбранного блюда. Блюдо, которое сейчас не приготовить
+     * (Dish::canCook()), не готовится: меню показывается снова. Выход —
+     * выбор пункта 0 или некорректный ввод.
      */
     void run();
+
+    /**
+     * @brief Основной цикл работы меню с действием после каждого блюда.
+     * @param cooked Вызывается после успешного приготовления (например, контрольная точка).
+     */
+    void run(const function<void(Dish*)>& cooked);
 };
@@ -0,0 +1,121 @@
+/**
+ * @file ledger.cpp
+ * @brief Реализация учёта калорийности и себестоимости.
+ */
+
+#include "ledger.hpp"
+#include "recipe.hpp"
+
+namespace {
+
+/// Контекст учёта потока: журнал, итог заказа, рецепт.
+thread_local LedgerContext currentLedger{nullptr, nullptr, -1};
+
+} // namespace
+
+/* ===== NutritionTotals ===== */
+
+double NutritionTotals::kcal() const {
+    return static_cast<double>(milliKcal) / 1000.0;
+}
+
+double NutritionTotals::cost() const {
+    return static_cast<double>(milliCost) / 1000.0;
+}
+
+/* ===== ShiftLedger ===== */
+
+ShiftLedger::ShiftLedger(int dishCount)
+    : dishes(dishCount > 0 ? dishCount : 0),
+      rows(new Row[static_cast<size_t>(dishes) + 1]),
+      total() {
+    reset();
+}
+
+NutritionTotals ShiftLedger::read(const Row& r) {
+    return NutritionTotals{r.milliKcal.load(memory_order_relaxed), r.milliCost.load(memory_order_relaxed)};
+}
+
+void ShiftLedger::add(int dish, const NutritionTotals& t) {
+    Row& r = rows[dish >= 0 && dish < dishes ? static_cast<size_t>(dish) : static_cast<size_t>(dishes)];
+    r.milliKcal.fetch_add(t.milliKcal, memory_order_relaxed);
+    r.milliCost.fetch_add(t.milliCost, memory_order_relaxed);
+    r.commits.fetch_add(1, memory_order_relaxed);
+    total.milliKcal.fetch_add(t.milliKcal, memory_order_relaxed);
+    total.milliCost.fetch_add(t.milliCost, memory_order_relaxed);
+    total.commits.fetch_add(1, memory_order_relaxed);
+}
+
+NutritionTotals ShiftLedger::dish(int dish) const {
+    return read(rows[dish >= 0 && dish < dishes ? static_cast<size_t>(dish) : static_cast<size_t>(dishes)]);
+}
+
+long long ShiftLedger::commits(int dish) const {
+    const Row& r = rows[dish >= 0 && dish < dishes ? static_cast<size_t>(dish) : static_cast<size_t>(dishes)];
+    return r.commits.load(memory_order_relaxed);
+}
+
+NutritionTotals ShiftLedger::shift() const {
+    return read(total);
+}
+
+int ShiftLedger::dishCount() const {
+    return dishes;
+}
+
+void ShiftLedger::reset() {
+    for (int i = 0; i <= dishes; ++i) {
+        rows[static_cast<size_t>(i)].milliKcal.store(0, memory_order_relaxed);
+        rows[static_cast<size_t>(i)].milliCost.store(0, memory_order_relaxed);
+        rows[static_cast<size_t>(i)].commits.store(0, memory_order_relaxed);
+    }
+    total.milliKcal.store(0, memory_order_relaxed);
+    total.milliCost.store(0, memory_order_relaxed);
+    total.commits.store(0, memory_order_relaxed);
+}
+
+void ShiftLedger::writeText(const ShiftLedger& ledger, ostream& out, const RecipeBook* book) {
+    out << "# рецепт списаний ккал стоимость\n";
+    for (int i = 0; i <= ledger.dishes; ++i) {
+        long long n = ledger.commits(i);
+        if (!n) continue;
+        if (i == ledger.dishes)                  out << "прочее";
+        else if (book && i < book->size())       out << book->name(i);
+        else                                     out << "#" << i;
+        NutritionTotals t = ledger.dish(i);
+        out << ' ' << n << ' ' << t.kcal() << ' ' << t.cost() << '\n';
+    }
+    NutritionTotals t = ledger.shift();
+    out << "Итого за смену: " << ledger.total.commits.load(memory_order_relaxed) << " списаний, "
+        << t.kcal() << " ккал, себестоимость " << t.cost() << "\n";
+}
+
+/* ===== LedgerContext ===== */
+
+LedgerContext& ledgerContext() {
+    return currentLedger;
+}
+
+void ledgerRecord(const NutritionTotals& t) {
+    LedgerContext& ctx = currentLedger;
+    if (ctx.order)  *ctx.order += t;
+    if (ctx.ledger) ctx.ledger->add(ctx.dish, t);
+}
+
+LedgerScope::LedgerScope(ShiftLedger* ledger, NutritionTotals* order)
+    : saved(currentLedger) {
+    currentLedger = LedgerContext{ledger, order, -1};
+}
+
+LedgerScope::~LedgerScope() {
+    currentLedger = saved;
+}
+
+LedgerDish::LedgerDish(int dish)
+    : saved(currentLedger.dish) {
+    currentLedger.dish = dish;
+}
+
+LedgerDish::~LedgerDish() {
+    currentLedger.dish = saved;
+}
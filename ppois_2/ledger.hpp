@@ -0,0 +1,211 @@
+/**
+ * @file ledger.hpp
+ * @brief Учёт калорийности и себестоимости: по блюду, по заказу и за смену.
+ *
+ * У ингредиента есть калорийность (ккал на 100 г) и цена (за кг), но до
+ * сих пор их никто не суммировал. Учёт встроен в путь списания: когда
+ * StockReservation::commit() подтверждает резерв, каждая строка резерва
+ * переводится в калории и стоимость, и суммы добавляются:
+ * - в итог самого резерва (StockReservation::getTotals());
+ * - в итог текущего заказа (если он подключён через LedgerScope —
+ *   так делает KitchenEngine для OrderResult::nutrition);
+ * - в журнал смены ShiftLedger — по номеру рецепта, который сейчас
+ *   готовится (LedgerDish), и в общий итог.
+ *
+ * Отменённый резерв в учёт не попадает: калории и стоимость считаются
+ * только за то, что действительно израсходовано. Суммы хранятся в
+ * целых тысячных (милликалории, тысячные доли денежной единицы),
+ * поэтому не зависят от порядка сложения и от числа поваров. Отчёт —
+ * это чтение нескольких счётчиков, без обхода истории.
+ *
+ * Контекст учёта (журнал, итог заказа, рецепт) — свой у каждого потока,
+ * как и контекст журнала событий (eventlog.hpp).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+
+using namespace std;
+
+class RecipeBook; ///< Книга рецептов (recipe.hpp), для названий в отчёте.
+
+/**
+ * @struct NutritionTotals
+ * @brief Калорийность и себестоимость израсходованных продуктов.
+ */
+struct NutritionTotals {
+    long long milliKcal; ///< Тысячные доли килокалорий.
+    long long milliCost; ///< Тысячные доли денежной единицы.
+
+    /// Добавляет другой итог.
+    NutritionTotals& operator+=(const NutritionTotals& o) {
+        milliKcal += o.milliKcal;
+        milliCost += o.milliCost;
+        return *this;
+    }
+
+    /**
+     * @brief Калорийность.
+     * @return Килокалории.
+     */
+    double kcal() const;
+
+    /**
+     * @brief Себестоимость.
+     * @return Денежные единицы.
+     */
+    double cost() const;
+};
+
+/**
+ * @class ShiftLedger
+ * @brief Итоги смены по рецептам: атомарные счётчики, запись и чтение за O(1).
+ *
+ * Рецепты с номером вне [0, dishes) (и блюда с рукописными методами
+ * Cook, для которых номер не задан) учитываются в общей строке «прочее».
+ */
+class ShiftLedger {
+private:
+    /**
+     * @struct Row
+     * @brief Счётчики одного рецепта.
+     */
+    struct Row {
+        atomic<long long> milliKcal; ///< Калории, тысячные ккал.
+        atomic<long long> milliCost; ///< Стоимость, тысячные.
+        atomic<long long> commits;   ///< Подтверждённых резервов (партия — один).
+    };
+
+    int                dishes;    ///< Число рецептов (строка dishes — «прочее»).
+    unique_ptr<Row[]>  rows;      ///< Строки рецептов и «прочее».
+    Row                total;     ///< Итог смены.
+
+    /// Итог строки.
+    static NutritionTotals read(const Row& r);
+
+public:
+    /**
+     * @brief Создаёт пустой журнал смены.
+     * @param dishCount Число рецептов в книге.
+     */
+    explicit ShiftLedger(int dishCount);
+
+    ShiftLedger(const ShiftLedger&) = delete;
+    ShiftLedger& operator=(const ShiftLedger&) = delete;
+
+    /**
+     * @brief Учитывает израсходованные продукты одного подтверждённого резерва.
+     * @param dish Номер рецепта (вне диапазона — «прочее»).
+     * @param t Калории и стоимость.
+     */
+    void add(int dish, const NutritionTotals& t);
+
+    /**
+     * @brief Итог по рецепту.
+     * @param dish Номер рецепта (вне диапазона — «прочее»).
+     * @return Калории и стоимость.
+     */
+    NutritionTotals dish(int dish) const;
+
+    /**
+     * @brief Сколько раз рецепт израсходовал продукты.
+     * @param dish Номер рецепта (вне диапазона — «прочее»).
+     * @return Число подтверждённых резервов.
+     */
+    long long commits(int dish) const;
+
+    /**
+     * @brief Итог смены.
+     * @return Калории и стоимость всех блюд.
+     */
+    NutritionTotals shift() const;
+
+    /**
+     * @brief Число рецептов журнала.
+     * @return Размер книги при создании.
+     */
+    int dishCount() const;
+
+    /**
+     * @brief Обнуляет счётчики (новая смена; повара не готовят).
+     */
+    void reset();
+
+    /**
+     * @brief Печатает итоги по рецептам и за смену.
+     * @param ledger Журнал.
+     * @param out Поток вывода.
+     * @param book Книга для названий рецептов (nullptr — номера).
+     */
+    static void writeText(const ShiftLedger& ledger, ostream& out, const RecipeBook* book = nullptr);
+};
+
+/**
+ * @struct LedgerContext
+ * @brief Контекст учёта текущего потока.
+ */
+struct LedgerContext {
+    ShiftLedger*     ledger; ///< Журнал смены или nullptr.
+    NutritionTotals* order;  ///< Итог текущего заказа или nullptr.
+    int              dish;   ///< Текущий рецепт (-1 — не задан).
+};
+
+/**
+ * @brief Контекст учёта текущего потока.
+ * @return Ссылка на thread_local контекст.
+ */
+LedgerContext& ledgerContext();
+
+/**
+ * @brief Учитывает подтверждённый резерв в контексте текущего потока.
+ * @param t Калории и стоимость резерва.
+ */
+void ledgerRecord(const NutritionTotals& t);
+
+/**
+ * @class LedgerScope
+ * @brief Подключает журнал смены и итог заказа на время жизни объекта.
+ */
+class LedgerScope {
+private:
+    LedgerContext saved; ///< Предыдущий контекст.
+
+public:
+    /**
+     * @brief Подключает журнал и итог заказа (рецепт сбрасывается).
+     * @param ledger Журнал смены или nullptr.
+     * @param order Итог заказа или nullptr.
+     */
+    LedgerScope(ShiftLedger* ledger, NutritionTotals* order);
+
+    LedgerScope(const LedgerScope&) = delete;
+    LedgerScope& operator=(const LedgerScope&) = delete;
+
+    /// Возвращает предыдущий контекст.
+    ~LedgerScope();
+};
+
+/**
+ * @class LedgerDish
+ * @brief Задаёт текущий рецепт учёта на время жизни объекта.
+ */
+class LedgerDish {
+private:
+    int saved; ///< Предыдущий рецепт.
+
+public:
+    /**
+     * @brief Задаёт рецепт.
+     * @param dish Номер рецепта.
+     */
+    explicit LedgerDish(int dish);
+
+    LedgerDish(const LedgerDish&) = delete;
+    LedgerDish& operator=(const LedgerDish&) = delete;
+
+    /// Возвращает предыдущий рецепт.
+    ~LedgerDish();
+};
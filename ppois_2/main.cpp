@@ -3,14 +3,331 @@
  * @brief Точка входа программы: инициализирует кухню, создаёт блюда и запускает меню.
  *
  * В функции main:
- * - создаются единицы измерения, количества и ингредиенты;
- * - инициализируются кухонные инструменты (плита, духовка, ножи, посуда, таймеры и т.п.);
- * - создаётся один повар, который агрегируется во все блюда;
- * - формируется меню из нескольких блюд;
- * - запускается интерактивный цикл выбора и приготовления блюд.
+ * - кухня собирается в KitchenWorld по описанию DEFAULT_KITCHEN: единицы
+ *   измерения, ингредиенты, инструменты, плита, духовка, таймеры и один повар,
+ *   который готовит все блюда, размещаются в одной арене;
+ * - рецепты загружаются в книгу мира (из файла или из DEFAULT_RECIPES)
+ *   и формируют меню из блюд RecipeDish;
+ * - запускается интерактивный цикл выбора и приготовления блюд или, с ключом
+ *   --orders, неинтерактивная обработка потока заказов (см. orders.hpp), или,
+ *   с ключом --listen, приём заказов по TCP (см. intake.hpp) до SIGINT/SIGTERM.
+ *
+ * Командная строка: ppois_2 [файл рецептов] [--kitchen файл] [--orders файл|-]
+ * [--listen [адрес:]порт] [--workers N] [--metrics] [--state файл]
+ * [--simulate N [--seed S]] [--generate префикс [--seed S]] [--record журнал]
+ * [--replay журнал] [--sla секунды].
+ * С ключом --kitchen кухня собирается по описанию из файла вместо DEFAULT_KITCHEN.
+ * С ключом --generate программа только пишет синтетическую кухню, рецепты
+ * и трассу заказов (см. synthetic.hpp) в файлы <префикс>.kitchen,
+ * <префикс>.recipes и <префикс>.orders для нагрузочных прогонов:
+ * ppois_2 p.recipes --kitchen p.kitchen --orders p.orders.
+ * С ключом --record сеанс обработки заказов (--orders, --listen) или
+ * симуляции смен пишется в двоичный журнал (см. session.hpp), а --replay
+ * исполняет записанный сеанс заново и печатает, совпали ли исходы заказов.
+ * С ключом --sla заказы (--orders, --listen), которые по модели стоимости
+ * (см. costmodel.hpp) не будут готовы за указанное число симулированных
+ * секунд, отклоняются с причиной over_sla.
+ * С ключом --metrics в конце работы в stderr печатается снимок метрик
+ * (см. metrics.hpp), включая задержки отдельных шагов, и итоги смены по
+ * калорийности и себестоимости (см. ledger.hpp). Скоропортящиеся продукты
+ * хранятся партиями со сроком (shelf в DEFAULT_KITCHEN, см. expiry.hpp); в меню
+ * просрочка списывается после каждого блюда по часам повара.
+ * С ключом --state состояние кухни (запасы, инструменты, духовка, таймеры)
+ * восстанавливается из файла при старте и сохраняется в него после каждого
+ * блюда меню и в конце обработки заказов (см. snapshot.hpp).
+ * С ключом --simulate вместо меню прогоняется N смен кухни со случайными
+ * заказами, запасами и поломками на --workers потоках, и в stdout
+ * печатается сводка по мощностям (см. montecarlo.hpp).
  */
 
 #include "kitchen.hpp"
+#include "recipe.hpp"
+#include "orders.hpp"
+#include "eventlog.hpp"
+#include "world.hpp"
+#include "metrics.hpp"
+#include "snapshot.hpp"
+#include "montecarlo.hpp"
+#include "intake.hpp"
+#include "synthetic.hpp"
+#include "session.hpp"
+#include "costmodel.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Рецепты меню по умолчанию (формат описан в recipe.hpp).
+ */
+static const char* const DEFAULT_RECIPES = R"(
+recipe Куриный суп
+    require soupPot 1.5 | Кастрюля слишком маленькая для супа
+    lease soupPot
+    lease stove
+    acquire
+    say | Нарезаем курицу и овощи для супа...
+    reserve chicken 150
+    reserve veggies 100
+    take
+    say | Ставим кастрюлю на плиту и включаем конфорку...
+    burner_on stove
+    boil soupPot
+    hold soupTimer 1800
+    say | Прошло %m мин варки супа...
+    commit
+    say | Варка супа по таймеру завершена.
+    burner_off stove
+    unboil soupPot
+    say | Куриный суп готов!
+end
+
+recipe Овощной салат
+    require knife | Нож недоступен для салата
+    warn board | Доска не сухая или не деревянная — используем её с осторожностью.
+    say | Нарезаем овощи для салата...
+    reserve veggies 120
+    reserve oil 10
+    take
+    say | Заправляем салат маслом...
+    commit
+    say | Салат готов!
+end
+
+recipe Паста с соусом
+    require pastaPot 2 | Кастрюля слишком маленькая для пасты
+    lease pastaPot
+    lease stove
+    acquire
+    say | Проверяем и подготавливаем ингредиенты...
+    reserve pasta 100
+    reserve sauce 50
+    take
+    say | Ставим кастрюлю на плиту и включаем конфорку...
+    burner_on stove
+    boil pastaPot
+    hold pastaTimer 600
+    say | Прошло %m мин варки пасты...
+    commit
+    say | Варка пасты по таймеру завершена.
+    unboil pastaPot
+    burner_off stove
+    say | Паста с соусом готова!
+end
+
+recipe Блины
+    lease mixer
+    lease pan
+    lease stove
+    acquire
+    plug mixer | Миксер не включён в розетку
+    say | Подготавливаем ингредиенты для теста: мука, яйца, сахар, молоко...
+    reserve flour 150
+    reserve eggs 2
+    reserve sugar 20
+    reserve milk 200
+    take
+    say | Смешиваем всё миксером...
+    mix mixer
+    burner_on stove
+    heat pan
+    say | Разогреваем сковороду...
+    say | Наливаем тесто и жарим 3 блина...
+    repeat 3
+        say |
+        say | Блин %i: наливаем порцию теста на сковороду...
+        after 60 | Блин %i: переворачиваем на другую сторону...
+        hold pancakesTimer 120
+        say | Блин %i: прошло %m мин жарки...
+        say | Блин %i готов.
+    done
+    commit
+    cool pan
+    burner_off stove
+    say |
+    say | Все блины готовы!
+end
+
+recipe Стейк на сковороде
+    lease pan
+    lease stove
+    acquire
+    reserve beef 180
+    take
+    say | Разогреваем сковороду и выкладываем стейк...
+    burner_on stove
+    heat pan
+    hold steakTimer 480
+    say | Прошло %m мин жарки стейка...
+    commit
+    cool pan
+    burner_off stove
+    say | Стейк готов!
+end
+
+recipe Картофельное пюре
+    lease soupPot
+    lease masher
+    lease stove
+    acquire
+    reserve potatoes 200
+    reserve milk 50
+    take
+    say | Чистим и нарезаем картофель...
+    burner_on stove
+    boil soupPot
+    hold mashedPotatoTimer 1200
+    say | Прошло %m мин варки картофеля...
+    commit
+    unboil soupPot
+    burner_off stove
+    say | Разминаем картофель с молоком при помощи potato masher...
+    mash masher
+    say | Пюре готово!
+end
+
+recipe Домашнее печенье
+    lease mixer
+    lease oven
+    acquire
+    plug mixer | Миксер не включён в розетку для печенья
+    say | Подготавливаем ингредиенты для теста печенья...
+    reserve flour 200
+    reserve sugar 50
+    reserve eggs 2
+    reserve milk 100
+    take
+    say | Смешиваем муку, сахар, яйца и молоко миксером до теста...
+    mix mixer
+    preheat oven 190 15
+    say | Выпекаем печенье 15 минут при 190C...
+    bake oven
+    say | Прошло %m минут...
+    commit
+    overcooked 20 | Печенье сгорело
+    undercooked 10 | Печенье сырое
+    say | Печенье готово!
+end
+
+recipe Томатный суп
+    require knife | Нож недоступен для нарезки томатного супа
+    lease soupPot
+    lease stove
+    acquire
+    say | Нарезаем томаты и овощи на доске...
+    reserve tomatoes 150
+    reserve veggies 80
+    take
+    say | Кладём томаты и овощи в кастрюлю и ставим на плиту...
+    burner_on stove
+    boil soupPot
+    hold tomatoSoupTimer 1500
+    say | Прошло %m мин варки томатного супа...
+    commit
+    unboil soupPot
+    burner_off stove
+    say | Томатный суп готов!
+end
+
+recipe Фруктовый салат
+    require knife | Нож недоступен для фруктового салата
+    reserve fruits 200
+    take
+    commit
+    say | Нарезаем фрукты на доске и смешиваем — фруктовый салат готов!
+end
+
+recipe Простой сливочный соус
+    lease mixer
+    lease pan
+    lease stove
+    acquire
+    plug mixer | Миксер не включён в розетку для соуса
+    reserve sauceBase 50
+    reserve cream 50
+    take
+    say | Смешиваем основу и сливки миксером...
+    mix mixer
+    say | Переливаем соус на сковороду и прогреваем...
+    burner_on stove
+    heat pan
+    hold cookiesTimer 240
+    say | Прошло %m мин прогрева соуса...
+    commit
+    cool pan
+    burner_off stove
+    say | Простой сливочный соус готов!
+end
+)";
+
+/**
+ * @brief Кухня по умолчанию (формат описан в world.hpp).
+ *
+ * Запасы сделаны с запасом, чтобы можно было несколько раз готовить разные
+ * блюда. Ключи ресурсов используются в рецептах.
+ */
+static const char* const DEFAULT_KITCHEN = R"(
+unit g  1 | г
+unit ml 1 liquid | мл
+unit pc 50 | шт                            # условно 1 шт ~ 50 г
+
+ingredient chicken   1000 g  215 perishable price 320 shelf 48  | Курица
+ingredient beef      1200 g  250 perishable price 650 shelf 72  | Говядина
+ingredient veggies   1500 g  45  perishable price 180 shelf 96  | Овощи микс
+ingredient tomatoes  1000 g  20  perishable price 220 shelf 120 | Томаты
+ingredient potatoes  2000 g  80  perishable price 60  shelf 720 | Картофель
+ingredient rice      1000 g  330            price 120           | Рис
+ingredient pasta     1000 g  340            price 150           | Паста
+ingredient oil       500  ml 880 perishable price 900 shelf 720 | Оливковое масло
+ingredient milk      1500 ml 60  perishable price 90  shelf 72  | Молоко
+ingredient cream     500  ml 200 perishable price 400 shelf 96  | Сливки
+ingredient flour     1500 g  340            price 60            | Мука
+ingredient sugar     500  g  400            price 80            | Сахар
+ingredient eggs      12   pc 155 perishable price 200 shelf 336 | Яйца
+ingredient bread     1000 g  250 perishable price 150 shelf 48  | Хлеб
+ingredient cheese    800  g  330 perishable price 800 shelf 336 | Сыр
+ingredient sauce     700  g  80  perishable price 300 shelf 168 | Готовый соус для пасты
+ingredient fruits    1500 g  60  perishable price 250 shelf 120 | Фрукты микс
+ingredient garlic    100  g  120 perishable price 400 shelf 720 | Чеснок
+ingredient sauceBase 300  g  150            price 350           | Основа для соуса
+
+knife  knife    | Шеф-нож
+board  board    | Деревянная доска
+pan    pan 26   | Универсальная сковорода
+pot    soupPot 3  | Кастрюля для супа
+pot    pastaPot 4 | Кастрюля для пасты
+masher masher   | Толкушка для пюре
+mixer  mixer    | Кухонный миксер
+oven   oven
+stove  stove 4
+
+timer soupTimer
+timer pastaTimer
+timer pancakesTimer
+timer steakTimer
+timer cookiesTimer
+timer mashedPotatoTimer
+timer tomatoSoupTimer
+timer riceTimer
+
+cook chef | Главный повар                  # один повар готовит все блюда меню
+)";
+
+namespace {
+
+/// Сервер приёма заказов, который останавливают SIGINT и SIGTERM.
+atomic<OrderServer*> listening{nullptr};
+
+/// Обработчик сигнала: просит сервер завершиться.
+void stopListening(int) {
+    if (OrderServer* s = listening.load()) s->stop();
+}
+
+} // namespace
 
 /**
  * @brief Точка входа в программу.
@@ -18,309 +335,238 @@
  * Настраивает кухню, создаёт повара, блюда и запускает меню.
  * При возникновении исключений выводит сообщение об ошибке и корректно завершает работу.
  *
+ * @param argc Число аргументов командной строки.
+ * @param argv Аргументы; argv[1] — необязательный файл рецептов.
  * @return 0 при успешном завершении, 1 при критической ошибке.
  */
-int main() {
+int main(int argc, char* argv[]) {
     
     //В блоке try выполняется «опасный» участок кода: если где-то внутри него происходит throw, то выполнение сразу прерывается, оставшаяся часть try больше не выполняется, а управление передаётся в первый подходящий catch (по типу исключения), который найдётся при подъёме по стеку вызовов. В этом catch мы уже обрабатываем ошибку: можем вывести сообщение, освободить ресурсы, что-то починить в состоянии программы; после завершения catch выполнение продолжается уже после всей конструкции try { … } catch (…) { … }, как после обычного блока. Если же ни на этом уровне, ни выше в стеке не нашлось ни одного catch, подходящего под выброшенный тип исключения, то обработчик так и не находится, и в итоге вызывается std::terminate, после чего программа аварийно завершается.
     try {
-        // ==== ЕДИНИЦЫ ИЗМЕРЕНИЯ ====
-        Unit gramUnit("г", 1.0, false, 1);
-        Unit mlUnit("мл", 1.0, true, 2);
-        Unit pieceUnit("шт", 50.0, false, 3); ///< Условно 1 шт ~ 50 г.
-
-        // ==== КОЛИЧЕСТВА И ИНГРЕДИЕНТЫ ====
-        // Запасы сделаны с запасом, чтобы можно было несколько раз готовить разные блюда.
-
-        Ingredient chicken(
-            "Курица",
-            Quantity(1000.0, &gramUnit, false, 1),
-            215.0,
-            true
-        );
-
-        Ingredient beef(
-            "Говядина",
-            Quantity(1200.0, &gramUnit, false, 2),
-            250.0,
-            true
-        );
-
-        Ingredient mixedVeggies(
-            "Овощи микс",
-            Quantity(1500.0, &gramUnit, false, 3),
-            45.0,
-            true
-        );
-
-        Ingredient tomatoes(
-            "Томаты",
-            Quantity(1000.0, &gramUnit, false, 4),
-            20.0,
-            true
-        );
-
-        Ingredient potatoes(
-            "Картофель",
-            Quantity(2000.0, &gramUnit, false, 5),
-            80.0,
-            true
-        );
-
-        Ingredient rice(
-            "Рис",
-            Quantity(1000.0, &gramUnit, false, 6),
-            330.0,
-            false
-        );
-
-        Ingredient pasta(
-            "Паста",
-            Quantity(1000.0, &gramUnit, false, 7),
-            340.0,
-            false
-        );
-
-        Ingredient saladOil(
-            "Оливковое масло",
-            Quantity(500.0, &mlUnit, true, 8),
-            880.0,
-            true
-        );
-
-        Ingredient milk(
-            "Молоко",
-            Quantity(1500.0, &mlUnit, true, 9),
-            60.0,
-            true
-        );
-
-        Ingredient cream(
-            "Сливки",
-            Quantity(500.0, &mlUnit, true, 10),
-            200.0,
-            true
-        );
-
-        Ingredient flour(
-            "Мука",
-            Quantity(1500.0, &gramUnit, false, 11),
-            340.0,
-            false
-        );
-
-        Ingredient sugar(
-            "Сахар",
-            Quantity(500.0, &gramUnit, false, 12),
-            400.0,
-            false
-        );
-
-        Ingredient eggs(
-            "Яйца",
-            Quantity(12.0, &pieceUnit, false, 13),
-            155.0,
-            true
-        );
-
-        Ingredient bread(
-            "Хлеб",
-            Quantity(1000.0, &gramUnit, false, 14),
-            250.0,
-            true
-        );
-
-        Ingredient cheese(
-            "Сыр",
-            Quantity(800.0, &gramUnit, false, 15),
-            330.0,
-            true
-        );
-
-        Ingredient sauce(
-            "Готовый соус для пасты",
-            Quantity(700.0, &gramUnit, false, 16),
-            80.0,
-            true
-        );
-
-        Ingredient fruits(
-            "Фрукты микс",
-            Quantity(1500.0, &gramUnit, false, 17),
-            60.0,
-            true
-        );
-
-        Ingredient garlic(
-            "Чеснок",
-            Quantity(100.0, &gramUnit, false, 18),
-            120.0,
-            true
-        );
-
-        Ingredient baseForSauce(
-            "Основа для соуса",
-            Quantity(300.0, &gramUnit, false, 19),
-            150.0,
-            false
-        );
-
-
-        Knife chefKnife("Шеф-нож", true, 20, 1);
-        CuttingBoard woodenBoard("Деревянная доска", true, false, 1);
-
-        Pan universalPan("Универсальная сковорода", 26.0, true, false);
-        Pot soupPot("Кастрюля для супа", 3.0, true, false);
-        Pot pastaPot("Кастрюля для пасты", 4.0, true, false);
-
-        PotatoMasher potatoMasherTool("Толкушка для пюре", 1);
-
-        Mixer kitchenMixer("Кухонный миксер", false);
-
-        Oven mainOven(0.0, false, true);
-        Stove mainStove(4, 0, true, false);
-
-        
-        Timer soupTimer(0, false, 0, 1);
-        Timer pastaTimer(0, false, 0, 2);
-        Timer pancakesTimer(0, false, 0, 3);
-        Timer steakTimer(0, false, 0, 4);
-        Timer cookiesTimer(0, false, 0, 5);
-        Timer mashedPotatoTimer(0, false, 0, 6);
-        Timer tomatoSoupTimer(0, false, 0, 7);
-        Timer riceTimer(0, false, 0, 8);
-
-       
-        Cook mainCook("Главный повар"); ///< Один повар, агрегируется во все блюда.
-
-        
-        ChickenSoupDish chickenSoup(
-            "Куриный суп",
-            &chicken,
-            &mixedVeggies,
-            &soupPot,
-            &mainStove,
-            &soupTimer,
-            &mainCook
-        );
-
-       
-        SaladDish veggieSalad(
-            "Овощной салат",
-            &mixedVeggies,
-            &saladOil,
-            &chefKnife,
-            &woodenBoard,
-            &mainCook
-        );
-
-       
-        PastaDish pastaDish(
-            "Паста с соусом",
-            &pasta,
-            &sauce,
-            &pastaPot,
-            &mainStove,
-            &pastaTimer,
-            &mainCook
-        );
-
-        
-        PancakeDish pancakes(
-            "Блины",
-            &flour,
-            &eggs,
-            &sugar,
-            &milk,
-            &universalPan,
-            &mainStove,
-            &pancakesTimer,
-            &kitchenMixer,
-            &mainCook
-        );
-
-       
-        SteakDish steak(
-            "Стейк на сковороде",
-            &beef,
-            &universalPan,
-            &mainStove,
-            &steakTimer,
-            &mainCook
-        );
-
-       
-        MashedPotatoDish mashedPotato(
-            "Картофельное пюре",
-            &potatoes,
-            &milk,
-            &soupPot,
-            &mainStove,
-            &mashedPotatoTimer,
-            &potatoMasherTool,
-            &mainCook
-        );
-
-       
-        CookieDish cookies(
-            "Домашнее печенье",
-            &flour,
-            &eggs,
-            &milk,
-            &sugar,
-            &mainOven,
-            &kitchenMixer,
-            &mainCook
-        );
-
-        
-        TomatoSoupDish tomatoSoup(
-            "Томатный суп",
-            &tomatoes,
-            &mixedVeggies,
-            &soupPot,
-            &mainStove,
-            &tomatoSoupTimer,
-            &chefKnife,
-            &woodenBoard,
-            &mainCook
-        );
-
-        FruitSaladDish fruitSalad(
-            "Фруктовый салат",
-            &fruits,
-            &chefKnife,
-            &woodenBoard,
-            &mainCook
-        );
-
-       
-        SimpleSauceDish simpleSauce(
-            "Простой сливочный соус",
-            &baseForSauce,
-            &cream,
-            &universalPan,
-            &mainStove,
-            &cookiesTimer,  ///< Переиспользуем таймер, это допустимо для демонстрации.
-            &kitchenMixer,
-            &mainCook
-        );
-
-        
+        // ==== АРГУМЕНТЫ КОМАНДНОЙ СТРОКИ ====
+        const char* recipesPath = nullptr;
+        const char* ordersPath  = nullptr;
+        const char* statePath   = nullptr;
+        const char* listenAddr  = nullptr;
+        const char* kitchenPath = nullptr;
+        const char* generatePrefix = nullptr;
+        const char* recordPath  = nullptr;
+        const char* replayPath  = nullptr;
+        bool metrics = false;
+        long long sla = -1;
+        int replicas = 0;
+        unsigned long long seed = 1;
+        int workers = static_cast<int>(thread::hardware_concurrency());
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--orders") == 0 && i + 1 < argc) {
+                ordersPath = argv[++i];
+            } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+                listenAddr = argv[++i];
+            } else if (strcmp(argv[i], "--kitchen") == 0 && i + 1 < argc) {
+                kitchenPath = argv[++i];
+            } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+                generatePrefix = argv[++i];
+            } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+                recordPath = argv[++i];
+            } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+                replayPath = argv[++i];
+            } else if (strcmp(argv[i], "--sla") == 0 && i + 1 < argc) {
+                sla = atoll(argv[++i]);
+            } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+                workers = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--metrics") == 0) {
+                metrics = true;
+            } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+                statePath = argv[++i];
+            } else if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc) {
+                replicas = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                seed = strtoull(argv[++i], nullptr, 10);
+            } else {
+                recipesPath = argv[i];
+            }
+        }
+        if (workers < 1) workers = 1;
+        Metrics::setStepTiming(metrics);
+
+        // ==== ВОСПРОИЗВЕДЕНИЕ СЕАНСА ====
+        // Кухня, рецепты и начальное состояние берутся из журнала.
+        if (replayPath) {
+            SessionLog log = SessionLog::read(replayPath);
+            if (log.truncated > 0) {
+                cerr << "Журнал сеанса оборван: отброшено " << log.truncated << " байт\n";
+            }
+            SessionReplay::writeReport(SessionReplay::run(log, &cout), cout);
+            return 0;
+        }
+
+        // ==== СИНТЕТИЧЕСКАЯ КУХНЯ ====
+        if (generatePrefix) {
+            SyntheticSpec spec = SyntheticSpec::standard();
+            string prefix(generatePrefix);
+            ofstream kitchenFile(prefix + ".kitchen");
+            ofstream recipesFile(prefix + ".recipes");
+            ofstream ordersFile(prefix + ".orders");
+            if (!kitchenFile || !recipesFile || !ordersFile) {
+                throw StorageException("Не удалось создать файлы синтетической кухни");
+            }
+            SyntheticKitchen::writeKitchen(spec, seed, kitchenFile);
+            SyntheticKitchen::writeRecipes(spec, seed, recipesFile);
+            long long orders = OrderTraceGenerator::write(TraceSpec::standard(spec.dishes), seed, ordersFile);
+            if (!kitchenFile.flush() || !recipesFile.flush() || !ordersFile.flush()) {
+                throw StorageException("Не удалось записать файлы синтетической кухни");
+            }
+            cerr << "Синтетическая кухня: " << spec.ingredients << " ингредиентов, "
+                 << spec.dishes << " блюд, " << orders << " заказов\n";
+            return 0;
+        }
+
+        // ==== КУХНЯ И КНИГА РЕЦЕПТОВ ====
+        // Все объекты кухни собираются в одной арене по описанию DEFAULT_KITCHEN
+        // (или из файла --kitchen). Рецепты можно передать файлом в первом
+        // аргументе командной строки.
+        string recipesText;
+        if (recipesPath) {
+            ifstream file(recipesPath);
+            if (!file) {
+                throw StorageException("Не удалось открыть файл рецептов");
+            }
+            recipesText.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+        string kitchenText;
+        if (kitchenPath) {
+            ifstream file(kitchenPath);
+            if (!file) {
+                throw StorageException("Не удалось открыть файл кухни");
+            }
+            kitchenText.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+        const char* kitchen = kitchenPath ? kitchenText.c_str() : DEFAULT_KITCHEN;
+        KitchenWorld world;
+        world.build(kitchen, recipesPath ? recipesText.c_str() : DEFAULT_RECIPES);
+
+        // ==== СИМУЛЯЦИЯ СМЕН ====
+        // Каждая реплика собирает свою кухню по тем же описаниям;
+        // мир выше только проверил, что они разбираются.
+        const char* recipes = recipesPath ? recipesText.c_str() : DEFAULT_RECIPES;
+        if (replicas > 0) {
+            if (recordPath) {
+                SessionRecorder(recordPath, kitchen, recipes, world, Menu(), 1).seed(seed, replicas);
+            }
+            WhatIfSimulator sim(WhatIfScenario::standard(kitchen, recipes));
+            WhatIfReport::write(sim.run(replicas, seed, workers), cout);
+            return 0;
+        }
+
+        // ==== ТЁПЛЫЙ СТАРТ ====
+        // Несовместимый или испорченный снимок не мешает работе: кухня
+        // начинает с состояния по описанию, а снимок перезаписывается.
+        unique_ptr<CheckpointWriter> checkpoints;
+        if (statePath) {
+            try {
+                WorldSnapshot::load(world, statePath);
+            } catch (const StorageException& ex) {
+                cerr << "Снимок кухни не загружен: " << ex.what() << "\n";
+            }
+            checkpoints.reset(new CheckpointWriter(statePath));
+        }
+        // После каждого блюда списывается то, что испортилось к часам повара;
+        // в режимах --orders и --listen просрочку списывают работники движка.
+        auto checkpoint = [&](Dish*) {
+            if (ExpiryIndex* e = world.getExpiry()) e->expire(world.getCook()->getClock().now());
+            if (checkpoints) checkpoints->submit(WorldSnapshot::capture(world));
+        };
+
+        // Калории и себестоимость смены копятся при каждом списании продуктов.
+        ShiftLedger ledger(world.dishCount());
+        LedgerScope account(&ledger, nullptr);
+
         Menu menu;
-        menu.addDish(&chickenSoup);
-        menu.addDish(&veggieSalad);
-        menu.addDish(&pastaDish);
-        menu.addDish(&pancakes);
-        menu.addDish(&steak);
-        menu.addDish(&mashedPotato);
-        menu.addDish(&cookies);
-        menu.addDish(&tomatoSoup);
-        menu.addDish(&fruitSalad);
-        menu.addDish(&simpleSauce);
-
-        
-        menu.run();
+        for (int i = 0; i < world.dishCount(); ++i) {
+            menu.addDish(world.dishAt(i));
+        }
+
+        // Журнал сеанса пишут работники движка; он закрывается после движка.
+        unique_ptr<SessionRecorder> recorder;
+        if (recordPath && (ordersPath || listenAddr)) {
+            recorder.reset(new SessionRecorder(recordPath, kitchen, recipes, world, menu, workers));
+        }
+
+        // Допуск по сроку: модель оценивает заказы при приёме, работники уточняют её.
+        unique_ptr<CostModel> costs;
+        if (sla >= 0 && (ordersPath || listenAddr)) {
+            costs.reset(new CostModel(world.getBook(), menu, workers));
+        }
+
+        if (ordersPath) {
+            // Неинтерактивный режим: заказы читаются пачкой и готовятся движком,
+            // текст рецептов не печатается, в stdout идёт только сводка.
+            KitchenEngine engine(workers);
+            NullSink quiet;
+            engine.setSink(&quiet);
+            engine.setLedger(&ledger);
+            engine.setRecorder(recorder.get());
+            engine.setCostModel(costs.get());
+            engine.setExpiry(world.getExpiry());
+            OrderStream stream(menu, engine);
+            stream.setAdmission(costs.get(), sla);
+            OrderStreamReport report;
+            if (strcmp(ordersPath, "-") == 0) {
+                report = stream.run(cin);
+            } else {
+                ifstream orders(ordersPath, ios::binary);
+                if (!orders) {
+                    throw StorageException("Не удалось открыть файл заказов");
+                }
+                report = stream.run(orders);
+            }
+            OrderStream::writeSummary(report, cout);
+            checkpoint(nullptr);
+        } else if (listenAddr) {
+            // Сетевой режим: заказы приходят по TCP, итоги уходят клиентам.
+            string host(listenAddr);
+            size_t colon = host.rfind(':');
+            int port = atoi(colon == string::npos ? listenAddr : listenAddr + colon + 1);
+            host = colon == string::npos ? string() : host.substr(0, colon);
+            if (port < 0 || port > 65535) {
+                throw StorageException("Некорректный порт для приёма заказов");
+            }
+            KitchenEngine engine(workers);
+            NullSink quiet;
+            engine.setSink(&quiet);
+            engine.setLedger(&ledger);
+            engine.setRecorder(recorder.get());
+            engine.setCostModel(costs.get());
+            engine.setExpiry(world.getExpiry());
+            OrderServer server(menu, engine);
+            server.setAdmission(costs.get(), sla);
+            unsigned short bound = server.listen(host.c_str(), static_cast<unsigned short>(port));
+            cerr << "Приём заказов на порту " << bound << "\n";
+            listening.store(&server);
+            signal(SIGINT, stopListening);
+            signal(SIGTERM, stopListening);
+            server.run();
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            listening.store(nullptr);
+            const HistogramSnapshot& lat = server.intakeLatency();
+            cerr << "Принято заказов: " << server.accepted() << ", отклонено: " << server.rejected()
+                 << ", итогов отправлено: " << server.reported() << "\n"
+                 << "Задержка приёма p50/p99: " << lat.percentile(0.5) / 1000.0 << " / "
+                 << lat.percentile(0.99) / 1000.0 << " мкс\n";
+            engine.waitAll();
+            checkpoint(nullptr);
+        } else {
+            menu.run(checkpoint);
+        }
+        if (checkpoints && !checkpoints->flush()) {
+            cerr << "Не удалось сохранить снимок кухни в " << statePath << "\n";
+        }
+
+        if (metrics) {
+            Metrics::writeText(Metrics::snapshot(), cerr, &world.getBook());
+            ShiftLedger::writeText(ledger, cerr, &world.getBook());
+        }
     }
     
     catch (const std::exception& ex) {
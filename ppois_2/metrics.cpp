@@ -0,0 +1,274 @@
+/**
+ * @file metrics.cpp
+ * @brief Реализация метрик горячего пути.
+ */
+
+#include "metrics.hpp"
+
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+/* ===== HistogramSnapshot ===== */
+
+unsigned HistogramSnapshot::bucketOf(uint64_t ns) {
+    const uint64_t sub = uint64_t(1) << SUB_BITS;
+    if (ns < sub) return static_cast<unsigned>(ns);
+    unsigned e = static_cast<unsigned>(63 - countl_zero(ns));
+    if (e > TOP_EXP) return BUCKETS - 1;
+    return (e - SUB_BITS + 1) * static_cast<unsigned>(sub)
+           + static_cast<unsigned>((ns >> (e - SUB_BITS)) & (sub - 1));
+}
+
+uint64_t HistogramSnapshot::lowerBound(unsigned b) {
+    const unsigned sub = 1u << SUB_BITS;
+    if (b < sub) return b;
+    unsigned e = b / sub + SUB_BITS - 1;
+    return (uint64_t(sub) + b % sub) << (e - SUB_BITS);
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = b + 1 < BUCKETS ? lowerBound(b + 1) - 1 : max;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+double HistogramSnapshot::mean() const {
+    return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+#if KITCHEN_METRICS
+
+namespace {
+
+/// Запись в слово, которое пишет только свой поток: без атомарного RMW.
+inline void bump(atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/**
+ * @struct Histogram
+ * @brief Гистограмма задержек одного потока.
+ */
+struct Histogram {
+    atomic<uint64_t> buckets[HistogramSnapshot::BUCKETS]; ///< Корзины.
+    atomic<uint64_t> count;                               ///< Значений.
+    atomic<uint64_t> sum;                                 ///< Сумма.
+    atomic<uint64_t> max;                                 ///< Наибольшее.
+
+    void add(uint64_t ns) {
+        bump(buckets[HistogramSnapshot::bucketOf(ns)], 1);
+        bump(count, 1);
+        bump(sum, ns);
+        if (ns > max.load(memory_order_relaxed)) max.store(ns, memory_order_relaxed);
+    }
+
+    void addTo(HistogramSnapshot& h) const {
+        for (unsigned b = 0; b < HistogramSnapshot::BUCKETS; ++b) {
+            h.buckets[b] += buckets[b].load(memory_order_relaxed);
+        }
+        h.count += count.load(memory_order_relaxed);
+        h.sum   += sum.load(memory_order_relaxed);
+        uint64_t m = max.load(memory_order_relaxed);
+        if (m > h.max) h.max = m;
+    }
+
+    void clear() {
+        for (atomic<uint64_t>& b : buckets) b.store(0, memory_order_relaxed);
+        count.store(0, memory_order_relaxed);
+        sum.store(0, memory_order_relaxed);
+        max.store(0, memory_order_relaxed);
+    }
+};
+
+/**
+ * @struct MetricsShard
+ * @brief Метрики одного потока (пишет только он, читает снимок).
+ */
+struct MetricsShard {
+    atomic<uint64_t> counters[METRIC_COUNTERS]; ///< Счётчики.
+    atomic<uint64_t> errors[METRIC_ERRORS];     ///< Отказы по кодам.
+    Histogram        recipes[METRIC_RECIPES];   ///< Задержки блюд.
+    Histogram        steps[METRIC_OPS];         ///< Задержки шагов.
+};
+
+/**
+ * @struct Registry
+ * @brief Все наборы метрик процесса.
+ *
+ * Набор завершившегося потока не удаляется (его значения остаются в
+ * снимках), а отдаётся следующему новому потоку.
+ */
+struct Registry {
+    mutex                            lock;       ///< Защищает списки.
+    vector<unique_ptr<MetricsShard>> shards;     ///< Все наборы.
+    vector<MetricsShard*>            spare;      ///< Наборы завершившихся потоков.
+    atomic<bool>                     stepTiming; ///< Замерять шаги.
+
+    Registry() : lock(), shards(), spare(), stepTiming(false) {}
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+/**
+ * @struct ShardHolder
+ * @brief Набор текущего потока; при завершении потока возвращается в реестр.
+ */
+struct ShardHolder {
+    MetricsShard* shard = nullptr;
+
+    ~ShardHolder() {
+        if (!shard) return;
+        Registry& r = registry();
+        lock_guard<mutex> g(r.lock);
+        r.spare.push_back(shard);
+    }
+};
+
+thread_local ShardHolder holder;
+
+MetricsShard& local() {
+    if (holder.shard) return *holder.shard;
+    Registry& r = registry();
+    lock_guard<mutex> g(r.lock);
+    if (!r.spare.empty()) {
+        holder.shard = r.spare.back();
+        r.spare.pop_back();
+    } else {
+        r.shards.emplace_back(new MetricsShard());
+        holder.shard = r.shards.back().get();
+    }
+    return *holder.shard;
+}
+
+unsigned recipeSlot(int recipe) {
+    if (recipe < 0) return METRIC_RECIPES - 1;
+    return static_cast<unsigned>(recipe) < METRIC_RECIPES ? static_cast<unsigned>(recipe) : METRIC_RECIPES - 1;
+}
+
+} // namespace
+
+/* ===== Metrics ===== */
+
+MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot s{};
+    s.recipes.resize(METRIC_RECIPES);
+    s.steps.resize(METRIC_OPS);
+    Registry& r = registry();
+    lock_guard<mutex> g(r.lock);
+    for (const unique_ptr<MetricsShard>& sh : r.shards) {
+        for (unsigned c = 0; c < METRIC_COUNTERS; ++c) s.counters[c] += sh->counters[c].load(memory_order_relaxed);
+        for (unsigned e = 0; e < METRIC_ERRORS; ++e)   s.errors[e]   += sh->errors[e].load(memory_order_relaxed);
+        for (unsigned i = 0; i < METRIC_RECIPES; ++i)  sh->recipes[i].addTo(s.recipes[i]);
+        for (unsigned i = 0; i < METRIC_OPS; ++i)      sh->steps[i].addTo(s.steps[i]);
+    }
+    s.threads = static_cast<unsigned>(r.shards.size());
+    return s;
+}
+
+void Metrics::reset() {
+    Registry& r = registry();
+    lock_guard<mutex> g(r.lock);
+    for (const unique_ptr<MetricsShard>& sh : r.shards) {
+        for (atomic<uint64_t>& c : sh->counters) c.store(0, memory_order_relaxed);
+        for (atomic<uint64_t>& e : sh->errors)   e.store(0, memory_order_relaxed);
+        for (Histogram& h : sh->recipes) h.clear();
+        for (Histogram& h : sh->steps)   h.clear();
+    }
+}
+
+void Metrics::setStepTiming(bool on) {
+    registry().stepTiming.store(on, memory_order_relaxed);
+}
+
+bool Metrics::stepTiming() {
+    return registry().stepTiming.load(memory_order_relaxed);
+}
+
+void Metrics::count(MetricCounter c, uint64_t n) {
+    bump(local().counters[static_cast<unsigned>(c)], n);
+}
+
+uint64_t Metrics::now() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Metrics::dish(int recipe, uint64_t startNs, KitchenError error) {
+    MetricsShard& sh = local();
+    sh.recipes[recipeSlot(recipe)].add(now() - startNs);
+    if (error == KitchenError::None) {
+        bump(sh.counters[static_cast<unsigned>(MetricCounter::DishesCooked)], 1);
+    } else {
+        bump(sh.counters[static_cast<unsigned>(MetricCounter::DishesFailed)], 1);
+        bump(sh.errors[static_cast<unsigned>(error)], 1);
+    }
+}
+
+void Metrics::dishAborted(int recipe, uint64_t startNs) {
+    MetricsShard& sh = local();
+    sh.recipes[recipeSlot(recipe)].add(now() - startNs);
+    bump(sh.counters[static_cast<unsigned>(MetricCounter::DishesFailed)], 1);
+}
+
+void Metrics::step(RecipeOp op, uint64_t ns) {
+    local().steps[static_cast<unsigned>(op)].add(ns);
+}
+
+#endif
+
+namespace {
+
+const char* const COUNTER_NAMES[METRIC_COUNTERS] = {
+    "dishes_cooked", "dishes_failed", "steps_run", "stock_outs", "tool_failures"
+};
+
+const char* const ERROR_NAMES[METRIC_ERRORS] = {
+    "none", "ingredient_not_found", "not_enough_ingredient", "tool_not_available",
+    "invalid_temperature", "timer_not_set", "overcooked", "undercooked", "storage"
+};
+
+void writeHistogram(const HistogramSnapshot& h, ostream& out) {
+    out << " count=" << h.count << " mean=" << static_cast<uint64_t>(h.mean())
+        << " p50=" << h.percentile(0.5) << " p90=" << h.percentile(0.9)
+        << " p99=" << h.percentile(0.99) << " max=" << h.max << "\n";
+}
+
+} // namespace
+
+void Metrics::writeText(const MetricsSnapshot& s, ostream& out, const RecipeBook* book) {
+    for (unsigned c = 0; c < METRIC_COUNTERS; ++c) {
+        out << "kitchen_" << COUNTER_NAMES[c] << " " << s.counters[c] << "\n";
+    }
+    for (unsigned e = 1; e < METRIC_ERRORS; ++e) {
+        if (s.errors[e]) out << "kitchen_dish_errors{error=\"" << ERROR_NAMES[e] << "\"} " << s.errors[e] << "\n";
+    }
+    for (unsigned i = 0; i < s.recipes.size(); ++i) {
+        if (!s.recipes[i].count) continue;
+        out << "kitchen_dish_latency_ns{recipe=\"";
+        if (i + 1 == METRIC_RECIPES)                            out << "other";
+        else if (book && static_cast<int>(i) < book->size())  out << book->name(static_cast<int>(i));
+        else                                                    out << i;
+        out << "\"}";
+        writeHistogram(s.recipes[i], out);
+    }
+    for (unsigned i = 0; i < s.steps.size(); ++i) {
+        if (!s.steps[i].count) continue;
+        out << "kitchen_step_latency_ns{op=\"" << recipeOpName(static_cast<RecipeOp>(i)) << "\"}";
+        writeHistogram(s.steps[i], out);
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * @file metrics.hpp
+ * @brief Метрики горячего пути: счётчики и гистограммы задержек по потокам.
+ *
+ * Каждый поток пишет в свой набор счётчиков (MetricsShard): запись — это
+ * чтение и запись своего же слова без атомарного RMW и без блокировок.
+ * Снимок (Metrics::snapshot()) по запросу складывает наборы всех потоков;
+ * Metrics::writeText() печатает его в текстовом формате экспозиции.
+ *
+ * Что считается:
+ * - приготовленные и сорвавшиеся блюда, отказы по коду KitchenError;
+ * - исполненные шаги рецептов;
+ * - нехватки продуктов (Ingredient::tryReserve()) и отказы инструментов
+ *   (KitchenTool::tryUse());
+ * - задержка (реальное время) приготовления каждого рецепта и, если включено
+ *   Metrics::setStepTiming(), каждой операции шага.
+ *
+ * Гистограммы логарифмически-линейные, как в HDR Histogram: 8 корзин на
+ * каждую степень двойки, погрешность перцентиля не больше 12,5 %.
+ *
+ * Сборка с -DKITCHEN_METRICS=0 убирает метрики целиком: функции записи
+ * становятся пустыми, снимок всегда нулевой.
+ */
+
+#pragma once
+
+#include "recipe.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifndef KITCHEN_METRICS
+#define KITCHEN_METRICS 1
+#endif
+
+using namespace std;
+
+/**
+ * @enum MetricCounter
+ * @brief Счётчик метрик.
+ */
+enum class MetricCounter : unsigned char {
+    DishesCooked, ///< Блюд приготовлено.
+    DishesFailed, ///< Блюд сорвалось (код отказа или исключение).
+    StepsRun,     ///< Шагов рецептов исполнено.
+    StockOuts,    ///< Нехваток продукта при списании или резерве.
+    ToolFailures  ///< Отказов инструмента (грязный, сломан, недоступен).
+};
+
+static const unsigned METRIC_COUNTERS = 5;  ///< Число MetricCounter.
+static const unsigned METRIC_ERRORS   = 9;  ///< Число кодов KitchenError.
+static const unsigned METRIC_RECIPES  = 32; ///< Рецептов со своей гистограммой (остальные — в последней).
+static const unsigned METRIC_OPS      = static_cast<unsigned>(RecipeOp::Join) + 1; ///< Операций шагов.
+
+/**
+ * @struct HistogramSnapshot
+ * @brief Копия гистограммы задержек (наносекунды).
+ */
+struct HistogramSnapshot {
+    static const unsigned SUB_BITS = 3;                             ///< log2 корзин на степень двойки.
+    static const unsigned TOP_EXP  = 40;                            ///< Старшая степень (≈18 минут).
+    static const unsigned BUCKETS  = (TOP_EXP - 1) * (1u << SUB_BITS); ///< Число корзин.
+
+    uint64_t buckets[BUCKETS]; ///< Число значений в корзине.
+    uint64_t count;            ///< Всего значений.
+    uint64_t sum;              ///< Сумма значений.
+    uint64_t max;              ///< Наибольшее значение.
+
+    /**
+     * @brief Корзина значения.
+     * @param ns Значение.
+     * @return Номер корзины (значения выше 2^TOP_EXP — в последней).
+     */
+    static unsigned bucketOf(uint64_t ns);
+
+    /**
+     * @brief Нижняя граница корзины.
+     * @param b Номер корзины.
+     * @return Наименьшее значение корзины.
+     */
+    static uint64_t lowerBound(unsigned b);
+
+    /**
+     * @brief Перцентиль.
+     * @param q Доля (0…1).
+     * @return Верхняя граница корзины, где лежит q-е значение (не больше max); 0 для пустой.
+     */
+    uint64_t percentile(double q) const;
+
+    /**
+     * @brief Среднее значение.
+     * @return sum / count (0 для пустой).
+     */
+    double mean() const;
+};
+
+/**
+ * @struct MetricsSnapshot
+ * @brief Сумма метрик всех потоков на момент снимка.
+ */
+struct MetricsSnapshot {
+    uint64_t                  counters[METRIC_COUNTERS]; ///< Счётчики (по номеру MetricCounter).
+    uint64_t                  errors[METRIC_ERRORS];     ///< Отказы блюд по коду KitchenError.
+    vector<HistogramSnapshot> recipes;                   ///< Задержка блюда по номеру рецепта.
+    vector<HistogramSnapshot> steps;                     ///< Задержка шага по операции RecipeOp.
+    unsigned                  threads;                   ///< Потоков, писавших метрики.
+
+    /// Значение счётчика c.
+    uint64_t operator[](MetricCounter c) const { return counters[static_cast<unsigned>(c)]; }
+};
+
+/**
+ * @class Metrics
+ * @brief Доступ к метрикам процесса.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Складывает метрики всех потоков.
+     *
+     * Потоки продолжают писать во время снимка: значения согласованы
+     * поштучно, но не между собой.
+     * @return Снимок.
+     */
+    static MetricsSnapshot snapshot();
+
+    /**
+     * @brief Обнуляет метрики всех потоков.
+     *
+     * Записи, идущие одновременно со сбросом, могут потеряться.
+     */
+    static void reset();
+
+    /**
+     * @brief Включает замер задержки каждого шага.
+     *
+     * По умолчанию выключен: два чтения часов на шаг сопоставимы со
+     * стоимостью самого шага интерпретатора.
+     * @param on Замерять ли шаги.
+     */
+    static void setStepTiming(bool on);
+
+    /**
+     * @brief Включён ли замер шагов.
+     * @return true, если включён (и метрики собраны в программу).
+     */
+    static bool stepTiming();
+
+    /**
+     * @brief Печатает снимок: строка на счётчик и перцентили непустых гистограмм.
+     * @param s Снимок.
+     * @param out Поток вывода.
+     * @param book Книга рецептов для названий блюд или nullptr.
+     */
+    static void writeText(const MetricsSnapshot& s, ostream& out, const RecipeBook* book);
+
+    /* ----- Запись (горячий путь) ----- */
+
+    static void count(MetricCounter c, uint64_t n = 1);                ///< Прибавляет к счётчику.
+    static uint64_t now();                                             ///< Монотонные часы, нс (0 без метрик).
+    static void dish(int recipe, uint64_t startNs, KitchenError error); ///< Итог блюда с задержкой от startNs.
+    static void dishAborted(int recipe, uint64_t startNs);             ///< Блюдо прервано исключением.
+    static void step(RecipeOp op, uint64_t ns);                        ///< Задержка шага.
+};
+
+#if !KITCHEN_METRICS
+
+inline MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot s{};
+    s.recipes.resize(METRIC_RECIPES);
+    s.steps.resize(METRIC_OPS);
+    return s;
+}
+inline void Metrics::reset() {}
+inline void Metrics::setStepTiming(bool) {}
+inline bool Metrics::stepTiming() { return false; }
+inline void Metrics::count(MetricCounter, uint64_t) {}
+inline uint64_t Metrics::now() { return 0; }
+inline void Metrics::dish(int, uint64_t, KitchenError) {}
+inline void Metrics::dishAborted(int, uint64_t) {}
+inline void Metrics::step(RecipeOp, uint64_t) {}
+
+#endif
@@ -0,0 +1,288 @@
+/**
+ * @file montecarlo.cpp
+ * @brief Реализация симуляции «что если» по репликам кухни.
+ */
+
+#include "montecarlo.hpp"
+#include "eventlog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace {
+
+/// Поломка или затупление инструмента в момент at.
+struct ToolFailure {
+    double       at;    ///< Момент отказа, с.
+    KitchenTool* tool;  ///< Инструмент.
+    bool         knife; ///< Нож (тупится, а не ломается).
+};
+
+/// Добавляет значение в гистограмму.
+void addValue(HistogramSnapshot& h, uint64_t v) {
+    ++h.buckets[HistogramSnapshot::bucketOf(v)];
+    ++h.count;
+    h.sum += v;
+    if (v > h.max) h.max = v;
+}
+
+/// Добавляет гистограмму from к to.
+void addHistogram(HistogramSnapshot& to, const HistogramSnapshot& from) {
+    for (unsigned b = 0; b < HistogramSnapshot::BUCKETS; ++b) to.buckets[b] += from.buckets[b];
+    to.count += from.count;
+    to.sum += from.sum;
+    if (from.max > to.max) to.max = from.max;
+}
+
+/// Отказ из-за нехватки продуктов.
+bool isStockOut(KitchenError e) {
+    return e == KitchenError::NotEnoughIngredient || e == KitchenError::IngredientNotFound;
+}
+
+/// Итоги одного потока.
+struct ThreadTotals {
+    HistogramSnapshot waits; ///< Ожидания заказов.
+    exception_ptr     error; ///< Ошибка сборки мира или сценария.
+};
+
+} // namespace
+
+/* ===== SimRandom ===== */
+
+SimRandom::SimRandom(uint64_t seed) : s() {
+    for (uint64_t& word : s) word = splitMix(seed);
+}
+
+uint64_t SimRandom::splitMix(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double SimRandom::uniform() {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+double SimRandom::uniform(double lo, double hi) {
+    return lo + (hi - lo) * uniform();
+}
+
+double SimRandom::exponential(double rate) {
+    return -log1p(-uniform()) / rate;
+}
+
+/* ===== WhatIfScenario ===== */
+
+WhatIfScenario WhatIfScenario::standard(const char* kitchen, const char* recipes) {
+    return WhatIfScenario{kitchen, recipes, 8 * 3600, 12.0, 0.5, 1.5, 1.0 / 200.0, 1.0 / 40.0, 1, {}};
+}
+
+/* ===== WhatIfReplica ===== */
+
+double WhatIfReplica::ordersPerHour(long long horizon) const {
+    long long span = makespan > horizon ? makespan : horizon;
+    return span > 0 ? done * 3600.0 / static_cast<double>(span) : 0.0;
+}
+
+/* ===== WhatIfReport ===== */
+
+double WhatIfReport::stockOutRate() const {
+    return orders ? static_cast<double>(stockOuts) / static_cast<double>(orders) : 0.0;
+}
+
+double WhatIfReport::throughputQuantile(double q) const {
+    if (replicas.empty()) return 0.0;
+    vector<double> rates;
+    rates.reserve(replicas.size());
+    for (const WhatIfReplica& r : replicas) rates.push_back(r.ordersPerHour(horizon));
+    sort(rates.begin(), rates.end());
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    return rates[static_cast<size_t>(q * static_cast<double>(rates.size() - 1))];
+}
+
+double WhatIfReport::meanThroughput() const {
+    if (replicas.empty()) return 0.0;
+    double total = 0.0;
+    for (const WhatIfReplica& r : replicas) total += r.ordersPerHour(horizon);
+    return total / static_cast<double>(replicas.size());
+}
+
+void WhatIfReport::write(const WhatIfReport& report, ostream& out) {
+    out << "Реплик: " << report.replicas.size() << ", смена " << report.horizon << " с\n";
+    out << "Заказов: " << report.orders << ", приготовлено " << report.done
+        << ", не удалось " << report.failed << ", отклонено " << report.rejected << "\n";
+    out << "Блюд в час: среднее " << report.meanThroughput()
+        << ", p10 " << report.throughputQuantile(0.1)
+        << ", p50 " << report.throughputQuantile(0.5)
+        << ", p90 " << report.throughputQuantile(0.9) << "\n";
+    out << "Нехватка продуктов: " << report.stockOutRate() * 100.0 << " % заказов\n";
+    out << "Поломок инструментов: " << report.toolFailures << "\n";
+    out << "Просроченных партий: " << report.expiredLots << "\n";
+    out << "Ожидание, с: среднее " << report.waits.mean()
+        << ", p50 " << report.waits.percentile(0.5)
+        << ", p90 " << report.waits.percentile(0.9)
+        << ", p99 " << report.waits.percentile(0.99)
+        << ", max " << report.waits.max << "\n";
+}
+
+/* ===== WhatIfSimulator ===== */
+
+WhatIfSimulator::WhatIfSimulator(const WhatIfScenario& s) : scenario(s) {}
+
+const WhatIfScenario& WhatIfSimulator::getScenario() const {
+    return scenario;
+}
+
+uint64_t WhatIfSimulator::replicaSeed(uint64_t seed, int index) {
+    uint64_t x = seed ^ (static_cast<uint64_t>(index) * 0xD1B54A32D192ED03ull);
+    return SimRandom::splitMix(x);
+}
+
+WhatIfReplica WhatIfSimulator::runReplica(KitchenWorld& w, uint64_t seed, HistogramSnapshot& waits) const {
+    w.build(scenario.kitchen, scenario.recipes);
+    const int dishes = w.dishCount();
+    if (!scenario.dishWeights.empty() && scenario.dishWeights.size() != static_cast<size_t>(dishes)) {
+        throw StorageException("Dish weights do not match the recipe book");
+    }
+    SimRandom rng(seed);
+    WhatIfReplica r{seed, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    // Запасы и моменты отказов инструментов — в порядке описания кухни.
+    vector<ToolFailure> failures;
+    for (size_t i = 0; i < w.size(); ++i) {
+        WorldHandle h = w.handleAt(i);
+        if (Ingredient* ing = w.ingredient(h)) {
+            long long mg = ing->getMilligrams();
+            long long target = llround(static_cast<double>(mg) * rng.uniform(scenario.stockLow, scenario.stockHigh));
+            if (target < mg)      ing->tryReserve(mg - target);
+            else if (target > mg) ing->addAmount(static_cast<double>(target - mg) / 1000.0);
+        } else if (KitchenTool* t = w.tool(h)) {
+            bool knife = w.kindOf(h) == WorldEntity::Knife;
+            double rate = (knife ? scenario.dullsPerHour : scenario.breaksPerHour) / 3600.0;
+            if (rate <= 0.0) continue;
+            double at = rng.exponential(rate);
+            if (at < static_cast<double>(scenario.horizon)) failures.push_back(ToolFailure{at, t, knife});
+        }
+    }
+    sort(failures.begin(), failures.end(),
+         [](const ToolFailure& a, const ToolFailure& b) { return a.at < b.at; });
+
+    double totalWeight = 0.0;
+    for (double wgt : scenario.dishWeights) totalWeight += wgt;
+
+    NullSink quiet;
+    vector<unique_ptr<Cook>> cooks;
+    for (int i = 0; i < (scenario.cooks > 0 ? scenario.cooks : 1); ++i) {
+        cooks.emplace_back(new Cook("Повар"));
+        cooks.back()->setSink(&quiet);
+    }
+
+    const FeasibilityIndex* index = w.getBook().getFeasibility();
+    ExpiryIndex* expiry = w.getExpiry();
+    const double rate = scenario.ordersPerHour / 3600.0;
+    size_t nextFailure = 0;
+    double arrival = rate > 0.0 && dishes > 0 ? rng.exponential(rate) : static_cast<double>(scenario.horizon);
+    while (arrival < static_cast<double>(scenario.horizon)) {
+        int dish = 0;
+        if (totalWeight > 0.0) {
+            double pick = rng.uniform() * totalWeight;
+            while (dish + 1 < dishes && pick >= scenario.dishWeights[static_cast<size_t>(dish)]) {
+                pick -= scenario.dishWeights[static_cast<size_t>(dish)];
+                ++dish;
+            }
+        } else {
+            dish = static_cast<int>(rng.uniform() * dishes);
+        }
+        double arrivedAt = arrival;
+        long long at = static_cast<long long>(arrival);
+        arrival += rng.exponential(rate);
+        ++r.orders;
+
+        // Заказ берёт повар, который освободится раньше всех.
+        Cook* ck = cooks[0].get();
+        for (const auto& c : cooks) {
+            if (c->getClock().now() < ck->getClock().now()) ck = c.get();
+        }
+        SimClock& clock = ck->getClock();
+        if (clock.now() < at) clock.runUntil(at);
+        long long start = clock.now();
+        long long wait = start - at;
+        addValue(waits, static_cast<uint64_t>(wait));
+        if (wait > r.maxWait) r.maxWait = wait;
+
+        if (expiry) r.expiredLots += static_cast<int>(expiry->expire(start));
+
+        double startAt = start > at ? static_cast<double>(start) : arrivedAt;
+        while (nextFailure < failures.size() && failures[nextFailure].at <= startAt) {
+            const ToolFailure& f = failures[nextFailure++];
+            if (f.knife) static_cast<Knife*>(f.tool)->dull();
+            else         f.tool->breakTool();
+            ++r.toolFailures;
+        }
+
+        RecipeDish* d = w.dishAt(dish);
+        if (!d->canCook()) {
+            ++r.rejected;
+            if (index && isStockOut(index->whyNot(dish).error)) ++r.stockOuts;
+            continue;
+        }
+        CookStatus st = d->tryCookWith(ck);
+        if (st.ok()) {
+            ++r.done;
+        } else {
+            ++r.failed;
+            if (isStockOut(st.error)) ++r.stockOuts;
+        }
+        if (clock.now() > r.makespan) r.makespan = clock.now();
+    }
+    return r;
+}
+
+WhatIfReport WhatIfSimulator::run(int replicas, uint64_t seed, int threads) const {
+    if (replicas < 0) replicas = 0;
+    if (threads < 1) threads = static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+    if (threads > replicas) threads = replicas > 0 ? replicas : 1;
+
+    WhatIfReport report{};
+    report.replicas.resize(static_cast<size_t>(replicas));
+    report.horizon = scenario.horizon;
+    vector<ThreadTotals> totals(static_cast<size_t>(threads));
+
+    // Поток t прогоняет реплики t, t + threads, …: у каждого свой мир и свои итоги.
+    auto work = [&](int t) {
+        ThreadTotals& mine = totals[static_cast<size_t>(t)];
+        try {
+            KitchenWorld w;
+            for (int i = t; i < replicas; i += threads) {
+                report.replicas[static_cast<size_t>(i)] = runReplica(w, replicaSeed(seed, i), mine.waits);
+            }
+        } catch (...) {
+            mine.error = current_exception();
+        }
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work, t);
+    work(0);
+    for (thread& th : pool) th.join();
+
+    for (const ThreadTotals& t : totals) {
+        if (t.error) rethrow_exception(t.error);
+        addHistogram(report.waits, t.waits);
+    }
+    for (const WhatIfReplica& r : report.replicas) {
+        report.orders += r.orders;
+        report.done += r.done;
+        report.failed += r.failed;
+        report.rejected += r.rejected;
+        report.stockOuts += r.stockOuts;
+        report.toolFailures += r.toolFailures;
+        report.expiredLots += r.expiredLots;
+    }
+    return report;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file montecarlo.hpp
+ * @brief Симуляция «что если» методом Монте-Карло: тысячи смен кухни для оценки мощностей.
+ *
+ * Menu::run() и OrderStream проходят один заданный сценарий. Чтобы
+ * понять, хватит ли кухне поваров и запасов на смену, нужно много смен
+ * с разным потоком заказов, разными остатками и случайными поломками.
+ * WhatIfSimulator прогоняет независимые копии кухни (реплики):
+ * - заказы прибывают пуассоновским потоком с интенсивностью
+ *   ordersPerHour, блюдо выбирается по весам dishWeights;
+ * - запас каждого ингредиента умножается на случайный множитель из
+ *   [stockLow, stockHigh];
+ * - каждый инструмент ломается (KitchenTool::breakTool()), а нож
+ *   тупится (Knife::dull()) в случайный момент смены — экспоненциальное
+ *   время до отказа с интенсивностью breaksPerHour / dullsPerHour;
+ * - партии ингредиентов со сроком хранения (shelf, expiry.hpp) портятся
+ *   по ходу смены: перед началом каждого заказа просрочка списывается.
+ *
+ * Реплика — это KitchenWorld, собранный по описанию, и cooks поваров.
+ * Заказ берёт повар, который раньше всех освободится; ожидание — время от
+ * поступления до начала готовки. Блюдо, которое в момент начала
+ * приготовить заведомо нельзя (Dish::canCook()), отклоняется, как в
+ * OrderStream. Сломавшийся инструмент выходит из строя для всех
+ * последующих начатых блюд; повара реплики готовят по очереди на одних
+ * часах, поэтому аренда инструментов между ними не моделируется.
+ *
+ * Реплики распределяются по потокам, у каждого потока — свой мир,
+ * свои повара и свои итоги; общего изменяемого состояния между потоками
+ * нет, поэтому прогон масштабируется по ядрам. Случайность реплики
+ * задаётся только её номером и общим зерном (replicaSeed()), а итоги
+ * складываются в целых числах, поэтому отчёт не зависит от числа
+ * потоков и повторяется при том же зерне.
+ */
+
+#pragma once
+
+#include "metrics.hpp"
+#include "world.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class SimRandom
+ * @brief Генератор псевдослучайных чисел xoshiro256** (одинаковый на всех платформах).
+ *
+ * Распределения стандартной библиотеки зависят от реализации: то же
+ * зерно в другой сборке даёт другую последовательность. SimRandom
+ * вычисляет их сам, поэтому реплика повторяется где угодно.
+ */
+class SimRandom {
+private:
+    uint64_t s[4]; ///< Состояние.
+
+    /// Циклический сдвиг влево.
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    /**
+     * @brief Создаёт генератор (состояние разворачивается из зерна через SplitMix64).
+     * @param seed Зерно.
+     */
+    explicit SimRandom(uint64_t seed);
+
+    /**
+     * @brief Шаг SplitMix64: перемешивает 64-битное значение.
+     * @param x Значение (продвигается на шаг).
+     * @return Перемешанные биты.
+     */
+    static uint64_t splitMix(uint64_t& x);
+
+    /**
+     * @brief Следующее 64-битное число.
+     * @return Равномерно распределённые биты.
+     */
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Равномерное число из [0, 1).
+     * @return Число с 53 значащими битами.
+     */
+    double uniform();
+
+    /**
+     * @brief Равномерное число из [lo, hi).
+     * @param lo Нижняя граница.
+     * @param hi Верхняя граница.
+     * @return Число.
+     */
+    double uniform(double lo, double hi);
+
+    /**
+     * @brief Экспоненциально распределённое время до события.
+     * @param rate Интенсивность (событий в единицу времени, > 0).
+     * @return Время.
+     */
+    double exponential(double rate);
+};
+
+/**
+ * @struct WhatIfScenario
+ * @brief Условия смены, общие для всех реплик.
+ */
+struct WhatIfScenario {
+    const char*    kitchen;       ///< Описание кухни (см. world.hpp).
+    const char*    recipes;       ///< Рецепты (см. recipe.hpp).
+    long long      horizon;       ///< Длительность приёма заказов, с.
+    double         ordersPerHour; ///< Средний поток заказов.
+    double         stockLow;      ///< Наименьший множитель запаса.
+    double         stockHigh;     ///< Наибольший множитель запаса.
+    double         breaksPerHour; ///< Интенсивность поломки одного инструмента (кроме ножей).
+    double         dullsPerHour;  ///< Интенсивность затупления одного ножа.
+    int            cooks;         ///< Поваров в смене.
+    vector<double> dishWeights;   ///< Веса блюд по номеру рецепта (пусто — поровну).
+
+    /**
+     * @brief Смена по умолчанию: 8 часов, 12 заказов в час, один повар.
+     *
+     * Запасы — от половины до полутора от описания, инструмент ломается в
+     * среднем раз в 200 часов, нож тупится раз в 40 часов.
+     * @param kitchen Описание кухни.
+     * @param recipes Рецепты.
+     * @return Сценарий.
+     */
+    static WhatIfScenario standard(const char* kitchen, const char* recipes);
+};
+
+/**
+ * @struct WhatIfReplica
+ * @brief Итог одной реплики.
+ */
+struct WhatIfReplica {
+    uint64_t  seed;         ///< Зерно реплики.
+    int       orders;       ///< Поступило заказов.
+    int       done;         ///< Приготовлено.
+    int       failed;       ///< Начато, но не приготовлено.
+    int       rejected;     ///< Отклонено (блюдо нельзя приготовить).
+    int       stockOuts;    ///< Не приготовлено или отклонено из-за нехватки продуктов.
+    int       toolFailures; ///< Инструментов сломалось или затупилось за смену.
+    int       expiredLots;  ///< Партий списано как просроченные.
+    long long makespan;     ///< Готовность последнего блюда, с.
+    long long maxWait;      ///< Наибольшее ожидание заказа, с.
+
+    /**
+     * @brief Пропускная способность реплики.
+     * @param horizon Длительность приёма заказов, с.
+     * @return Приготовленных блюд в час (по большему из horizon и makespan).
+     */
+    double ordersPerHour(long long horizon) const;
+};
+
+/**
+ * @struct WhatIfReport
+ * @brief Итоги всех реплик.
+ */
+struct WhatIfReport {
+    vector<WhatIfReplica> replicas;     ///< Реплики по номеру.
+    long long             horizon;      ///< Длительность приёма заказов, с.
+    long long             orders;       ///< Поступило заказов.
+    long long             done;         ///< Приготовлено.
+    long long             failed;       ///< Не приготовлено.
+    long long             rejected;     ///< Отклонено.
+    long long             stockOuts;    ///< Отказов из-за нехватки продуктов.
+    long long             toolFailures; ///< Поломок и затуплений.
+    long long             expiredLots;  ///< Просроченных партий.
+    HistogramSnapshot     waits;        ///< Распределение ожидания заказов (значения — секунды).
+
+    /**
+     * @brief Доля заказов, сорвавшихся из-за нехватки продуктов.
+     * @return stockOuts / orders (0 без заказов).
+     */
+    double stockOutRate() const;
+
+    /**
+     * @brief Квантиль пропускной способности по репликам.
+     * @param q Доля (0…1).
+     * @return Блюд в час у реплики с рангом q (0 без реплик).
+     */
+    double throughputQuantile(double q) const;
+
+    /**
+     * @brief Средняя пропускная способность.
+     * @return Блюд в час, среднее по репликам.
+     */
+    double meanThroughput() const;
+
+    /**
+     * @brief Печатает сводку: пропускная способность, отказы, ожидание.
+     * @param report Итоги.
+     * @param out Поток вывода.
+     */
+    static void write(const WhatIfReport& report, ostream& out);
+};
+
+/**
+ * @class WhatIfSimulator
+ * @brief Параллельный прогон реплик сценария.
+ */
+class WhatIfSimulator {
+private:
+    WhatIfScenario scenario; ///< Условия смены.
+
+public:
+    /**
+     * @brief Создаёт симулятор сценария.
+     * @param s Сценарий (тексты описания и рецептов должны жить дольше симулятора).
+     */
+    explicit WhatIfSimulator(const WhatIfScenario& s);
+
+    /**
+     * @brief Условия смены.
+     * @return Сценарий.
+     */
+    const WhatIfScenario& getScenario() const;
+
+    /**
+     * @brief Зерно реплики.
+     * @param seed Общее зерно прогона.
+     * @param index Номер реплики.
+     * @return Зерно, зависящее только от seed и index.
+     */
+    static uint64_t replicaSeed(uint64_t seed, int index);
+
+    /**
+     * @brief Прогоняет одну реплику.
+     * @param w Мир (пересобирается по описанию сценария).
+     * @param seed Зерно реплики.
+     * @param waits Гистограмма, в которую добавляются ожидания заказов.
+     * @return Итог реплики.
+     * @throw RecipeFormatException при ошибке в описании или рецептах.
+     * @throw StorageException если число весов не совпадает с числом рецептов.
+     */
+    WhatIfReplica runReplica(KitchenWorld& w, uint64_t seed, HistogramSnapshot& waits) const;
+
+    /**
+     * @brief Прогоняет реплики на нескольких потоках.
+     * @param replicas Число реплик.
+     * @param seed Общее зерно.
+     * @param threads Число потоков (< 1 — по числу ядер).
+     * @return Итоги (одинаковые при любом threads).
+     * @throw RecipeFormatException при ошибке в описании или рецептах.
+     * @throw StorageException если число весов не совпадает с числом рецептов.
+     */
+    WhatIfReport run(int replicas, uint64_t seed, int threads = 0) const;
+};
@@ -0,0 +1,308 @@
+/**
+ * @file orders.cpp
+ * @brief Реализация неинтерактивного потока заказов.
+ */
+
+#include "orders.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+/**
+ * @struct Pipeline
+ * @brief Стадии конвейера: проверка и отправка в движок, затем сбор итогов.
+ */
+struct Pipeline {
+    const Menu&          menu;    ///< Меню.
+    KitchenEngine&       engine;  ///< Движок.
+    OrderStreamReport    report;  ///< Итоги.
+    OrderScanner         scanner; ///< Разбор.
+    vector<ParsedOrder>  batch;   ///< Записи текущего блока.
+    CostModel*           costs;   ///< Допуск по сроку или nullptr.
+    long long            sla;     ///< Срок готовности, с.
+
+    Pipeline(const Menu& m, KitchenEngine& e, CostModel* c, long long s)
+        : menu(m), engine(e), report{{}, 0, 0, 0, {0, 0}}, scanner(), batch(), costs(c), sla(s) {}
+
+    static OrderSummary rejected(const ParsedOrder& o, OrderReject why) {
+        short dish = o.dish > 0 && o.dish < 0x7FFF ? static_cast<short>(o.dish) : 0;
+        return OrderSummary{0, 0, o.line, dish, OrderOutcome::Rejected, why, KitchenError::None, -1};
+    }
+
+    /// Проверяет записи блока и отправляет принятые заказы в движок.
+    void dispatch() {
+        for (const ParsedOrder& o : batch) {
+            Dish* d = nullptr;
+            OrderReject why = checkOrder(menu, o, d);
+            if (why != OrderReject::None) {
+                report.orders.push_back(rejected(o, why));
+                continue;
+            }
+            for (long long i = 0; i < o.count; ++i) {
+                long long cost = 0;
+                if (costs && !costs->admit(static_cast<int>(o.dish), sla, cost)) {
+                    report.orders.push_back(rejected(o, OrderReject::OverSla));
+                    continue;
+                }
+                int id = engine.submit(d, cost);
+                report.orders.push_back(OrderSummary{0, id, o.line, static_cast<short>(o.dish),
+                                                     OrderOutcome::Done, OrderReject::None,
+                                                     KitchenError::None, -1});
+            }
+        }
+        batch.clear();
+    }
+
+    /// Разбирает блок байтов и сразу отправляет его заказы.
+    bool feed(const char* p, size_t n) {
+        bool more = scanner.feed(p, p + n, batch);
+        dispatch();
+        return more;
+    }
+
+    /// Дожидается движка и переносит итоги в сводку.
+    OrderStreamReport finish() {
+        scanner.finish(batch);
+        dispatch();
+        engine.waitAll();
+        vector<OrderResult> results = engine.collectResults();
+
+        // Номера заказов одного отправителя возрастают — сводим слиянием.
+        auto r = results.begin();
+        for (OrderSummary& s : report.orders) {
+            if (s.outcome == OrderOutcome::Rejected) {
+                ++report.rejected;
+                continue;
+            }
+            while (r != results.end() && r->orderId < s.orderId) ++r;
+            if (r == results.end() || r->orderId != s.orderId) {
+                s.outcome = OrderOutcome::Failed;
+                s.error   = KitchenError::Storage;
+            } else {
+                s.simSeconds = r->simSeconds;
+                s.worker     = static_cast<signed char>(r->worker);
+                report.nutrition += r->nutrition;
+                if (!r->ok) {
+                    s.outcome = OrderOutcome::Failed;
+                    s.error   = r->status.ok() ? KitchenError::Storage : r->status.error;
+                }
+            }
+            if (s.outcome == OrderOutcome::Done) ++report.done;
+            else                                 ++report.failed;
+        }
+        return std::move(report);
+    }
+};
+
+} // namespace
+
+/* ===== OrderScanner ===== */
+
+OrderScanner::OrderScanner()
+    : state(State::Gap), line(1), tokenLine(1), dish(0), count(0),
+      hasCount(false), ended(false), mark(0), at(0) {}
+
+bool OrderScanner::isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';';
+}
+
+long long OrderScanner::accumulate(long long v, char c) {
+    v = v * 10 + (c - '0');
+    return v > LIMIT ? LIMIT : v;
+}
+
+void OrderScanner::flush(vector<ParsedOrder>& out) {
+    switch (state) {
+    case State::Dish:
+        if (dish == 0) ended = true;
+        else           out.push_back(ParsedOrder{tokenLine, dish, 1, false, at});
+        break;
+    case State::Count:
+        out.push_back(ParsedOrder{tokenLine, dish, count, !hasCount, at});
+        break;
+    case State::Time:
+        // '@' без цифр — испорченная запись.
+        if (hasCount) at = mark;
+        else          out.push_back(ParsedOrder{tokenLine, 0, 0, true, at});
+        break;
+    case State::Junk:
+        out.push_back(ParsedOrder{tokenLine, 0, 0, true, at});
+        break;
+    case State::Gap:
+    case State::Comment:
+        break;
+    }
+    state = State::Gap;
+}
+
+bool OrderScanner::feed(const char* p, const char* end, vector<ParsedOrder>& out) {
+    for (; p != end && !ended; ++p) {
+        char c = *p;
+        if (state == State::Comment) {
+            if (c == '\n') {
+                state = State::Gap;
+                ++line;
+            }
+            continue;
+        }
+        if (isSeparator(c) || c == '#') {
+            flush(out);
+            if (c == '#') state = State::Comment;
+            if (c == '\n') ++line;
+            continue;
+        }
+        bool digit = c >= '0' && c <= '9';
+        switch (state) {
+        case State::Gap:
+            tokenLine = line;
+            if (digit) {
+                state = State::Dish;
+                dish  = c - '0';
+            } else if (c == '@') {
+                state    = State::Time;
+                mark     = 0;
+                hasCount = false;
+            } else {
+                state = State::Junk;
+            }
+            break;
+        case State::Dish:
+            if (digit) {
+                dish = accumulate(dish, c);
+            } else if (c == 'x' || c == 'X' || c == '*') {
+                state    = State::Count;
+                count    = 0;
+                hasCount = false;
+            } else {
+                state = State::Junk;
+            }
+            break;
+        case State::Count:
+            if (digit) {
+                count    = accumulate(count, c);
+                hasCount = true;
+            } else {
+                state = State::Junk;
+            }
+            break;
+        case State::Time:
+            if (digit) {
+                mark     = accumulate(mark, c);
+                hasCount = true;
+            } else {
+                state = State::Junk;
+            }
+            break;
+        case State::Junk:
+        case State::Comment:
+            break;
+        }
+    }
+    return !ended;
+}
+
+void OrderScanner::finish(vector<ParsedOrder>& out) {
+    if (!ended) flush(out);
+}
+
+bool OrderScanner::isEnded() const {
+    return ended;
+}
+
+/* ===== Проверка и имена ===== */
+
+OrderReject checkOrder(const Menu& menu, const ParsedOrder& o, Dish*& dish) {
+    dish = nullptr;
+    if (o.bad) return OrderReject::Syntax;
+    Dish* d = o.dish <= static_cast<long long>(menu.size())
+            ? menu.dishAt(static_cast<int>(o.dish)) : nullptr;
+    if (!d) return OrderReject::NoSuchDish;
+    if (o.count < 1 || o.count > OrderStream::MAX_COUNT) return OrderReject::BadCount;
+    if (!d->canCook()) return OrderReject::Unavailable;
+    dish = d;
+    return OrderReject::None;
+}
+
+const char* orderOutcomeName(OrderOutcome o) {
+    switch (o) {
+    case OrderOutcome::Done:     return "done";
+    case OrderOutcome::Failed:   return "failed";
+    case OrderOutcome::Rejected: return "rejected";
+    }
+    return "?";
+}
+
+const char* orderRejectName(OrderReject r) {
+    switch (r) {
+    case OrderReject::None:        return "-";
+    case OrderReject::Syntax:      return "syntax";
+    case OrderReject::NoSuchDish:  return "no_such_dish";
+    case OrderReject::BadCount:    return "bad_count";
+    case OrderReject::Unavailable: return "unavailable";
+    case OrderReject::OverSla:     return "over_sla";
+    }
+    return "?";
+}
+
+const char* kitchenErrorName(KitchenError e) {
+    switch (e) {
+    case KitchenError::None:                return "-";
+    case KitchenError::IngredientNotFound:  return "ingredient_not_found";
+    case KitchenError::NotEnoughIngredient: return "not_enough_ingredient";
+    case KitchenError::ToolNotAvailable:    return "tool_not_available";
+    case KitchenError::InvalidTemperature:  return "invalid_temperature";
+    case KitchenError::TimerNotSet:         return "timer_not_set";
+    case KitchenError::Overcooked:          return "overcooked";
+    case KitchenError::Undercooked:         return "undercooked";
+    case KitchenError::Storage:             return "storage";
+    }
+    return "?";
+}
+
+/* ===== OrderStream ===== */
+
+OrderStream::OrderStream(const Menu& m, KitchenEngine& e)
+    : menu(m), engine(e), costs(nullptr), sla(0) {}
+
+void OrderStream::setAdmission(CostModel* m, long long slaSeconds) {
+    costs = m;
+    sla = slaSeconds;
+}
+
+OrderStreamReport OrderStream::run(istream& in) {
+    Pipeline p(menu, engine, costs, sla);
+    unique_ptr<char[]> buffer(new char[CHUNK]);
+    while (in) {
+        in.read(buffer.get(), static_cast<streamsize>(CHUNK));
+        size_t n = static_cast<size_t>(in.gcount());
+        if (n == 0) break;
+        if (!p.feed(buffer.get(), n)) break;
+    }
+    return p.finish();
+}
+
+OrderStreamReport OrderStream::run(const char* data, size_t size) {
+    Pipeline p(menu, engine, costs, sla);
+    for (size_t at = 0; at < size; at += CHUNK) {
+        if (!p.feed(data + at, min(CHUNK, size - at))) break;
+    }
+    return p.finish();
+}
+
+void OrderStream::writeSummary(const OrderStreamReport& report, ostream& out) {
+    out << "# заказ строка блюдо итог время_с причина\n";
+    for (const OrderSummary& s : report.orders) {
+        if (s.orderId) out << s.orderId;
+        else           out << '-';
+        out << ' ' << s.line << ' ' << s.dish << ' ' << orderOutcomeName(s.outcome) << ' '
+            << s.simSeconds << ' '
+            << (s.outcome == OrderOutcome::Rejected ? orderRejectName(s.reject) : kitchenErrorName(s.error))
+            << '\n';
+    }
+    out << "Итого: приготовлено " << report.done << ", не удалось " << report.failed
+        << ", отклонено " << report.rejected << "\n";
+    out << "Израсходовано: " << report.nutrition.kcal() << " ккал, себестоимость "
+        << report.nutrition.cost() << "\n";
+}
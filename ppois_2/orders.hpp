@@ -0,0 +1,253 @@
+/**
+ * @file orders.hpp
+ * @brief Неинтерактивный режим меню: поток заказов без диалога с пользователем.
+ *
+ * Вместо цикла cin >> choice заказы читаются пачкой из файла, канала или
+ * буфера в памяти. Поток обрабатывается конвейером: очередной блок байтов
+ * разбирается вручную (без форматного ввода iostream), заказы блока
+ * проверяются по меню и сразу отправляются в KitchenEngine, а работники
+ * движка готовят их, пока читается и разбирается следующий блок.
+ *
+ * Формат потока: номера пунктов меню (как в Menu::show()), разделённые
+ * пробелами, переводами строк, ',' или ';'. Запись NxK (или N*K) — K
+ * заказов блюда N. '#' — комментарий до конца строки, 0 — конец потока.
+ * Запись @T — отметка времени: следующие заказы поступили на T-й секунде
+ * смены (так записываются синтетические трассы, см. synthetic.hpp).
+ * OrderStream и OrderServer готовят заказы сразу и отметки не ждут.
+ * @code
+ * # утренние заказы
+ * 1 3 3
+ * 5x4, 2
+ * @3600 7 2x3
+ * @endcode
+ * Заказ блюда, которое сейчас заведомо не приготовить (Dish::canCook():
+ * не хватает продуктов на порцию или нужный инструмент непригоден),
+ * отклоняется при проверке и в движок не попадает. Проверка видит запасы
+ * на момент отправки блока: заказы, ещё стоящие в очереди движка, в ней
+ * не учтены. С допуском по сроку (setAdmission(), costmodel.hpp) эта
+ * очередь учтена: заказ, который CostModel не обещает приготовить к
+ * сроку, отклоняется с причиной over_sla.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+#include "engine.hpp"
+#include "costmodel.hpp"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @enum OrderOutcome
+ * @brief Итог заказа из потока.
+ */
+enum class OrderOutcome : unsigned char {
+    Done,     ///< Блюдо приготовлено.
+    Failed,   ///< Заказ принят, но приготовить не удалось (см. error).
+    Rejected  ///< Заказ отклонён при проверке и в движок не попал.
+};
+
+/**
+ * @enum OrderReject
+ * @brief Причина отклонения заказа при разборе или проверке.
+ */
+enum class OrderReject : unsigned char {
+    None,       ///< Заказ принят.
+    Syntax,     ///< Запись не разобрана.
+    NoSuchDish, ///< Нет такого пункта меню.
+    BadCount,   ///< Недопустимое число повторов.
+    Unavailable, ///< Блюдо сейчас не приготовить (Dish::canCook()).
+    OverSla      ///< Заказ не будет готов в срок (CostModel::admit()).
+};
+
+/**
+ * @struct OrderSummary
+ * @brief Краткий итог одного заказа (24 байта).
+ */
+struct OrderSummary {
+    long long    simSeconds; ///< Симулированное время приготовления.
+    int          orderId;    ///< Номер заказа в движке (0 — отклонён).
+    unsigned     line;       ///< Строка потока, где записан заказ.
+    short        dish;       ///< Номер пункта меню.
+    OrderOutcome outcome;    ///< Итог.
+    OrderReject  reject;     ///< Причина отклонения.
+    KitchenError error;      ///< Код отказа при приготовлении.
+    signed char  worker;     ///< Номер повара-работника (-1 — не готовился).
+};
+
+/**
+ * @struct OrderStreamReport
+ * @brief Итог обработки потока заказов.
+ */
+struct OrderStreamReport {
+    vector<OrderSummary> orders;    ///< Итоги в порядке записи в потоке.
+    long long            done;      ///< Приготовлено.
+    long long            failed;    ///< Не удалось приготовить.
+    long long            rejected;  ///< Отклонено при проверке.
+    NutritionTotals      nutrition; ///< Калории и себестоимость израсходованного заказами (см. ledger.hpp).
+};
+
+/**
+ * @struct ParsedOrder
+ * @brief Запись потока после разбора.
+ */
+struct ParsedOrder {
+    unsigned  line;  ///< Строка потока.
+    long long dish;  ///< Номер пункта меню.
+    long long count; ///< Число повторов.
+    bool      bad;   ///< Запись не разобрана.
+    long long at;    ///< Момент поступления по последней отметке @, с (0 — без отметок).
+};
+
+/**
+ * @class OrderScanner
+ * @brief Разбор потока заказов по байтам (состояние сохраняется между блоками).
+ *
+ * Запись может прийти частями в соседних блоках: незаконченная запись
+ * дописывается следующим вызовом feed().
+ */
+class OrderScanner {
+private:
+    enum class State : unsigned char { Gap, Dish, Count, Time, Comment, Junk };
+
+    static const long long LIMIT = 1000000000LL; ///< Потолок для накопления числа.
+
+    State     state;     ///< Текущее состояние.
+    unsigned  line;      ///< Текущая строка.
+    unsigned  tokenLine; ///< Строка начала записи.
+    long long dish;      ///< Номер блюда.
+    long long count;     ///< Число повторов.
+    bool      hasCount;  ///< В записи есть цифры после 'x'.
+    bool      ended;     ///< Встречен заказ 0.
+    long long mark;      ///< Читаемая отметка времени.
+    long long at;        ///< Текущая отметка времени.
+
+    /// Символ-разделитель записей.
+    static bool isSeparator(char c);
+
+    /// Дописывает цифру к числу (с потолком LIMIT).
+    static long long accumulate(long long v, char c);
+
+    /// Завершает текущую запись.
+    void flush(vector<ParsedOrder>& out);
+
+public:
+    /**
+     * @brief Создаёт разбор с начала потока (строка 1).
+     */
+    OrderScanner();
+
+    /**
+     * @brief Разбирает блок байтов, добавляя законченные записи в out.
+     * @param p Начало блока.
+     * @param end Конец блока.
+     * @param out Куда добавить записи.
+     * @return false, если встречен заказ 0 (остаток потока не читается).
+     */
+    bool feed(const char* p, const char* end, vector<ParsedOrder>& out);
+
+    /**
+     * @brief Завершает последнюю запись в конце потока.
+     * @param out Куда добавить запись.
+     */
+    void finish(vector<ParsedOrder>& out);
+
+    /**
+     * @brief Встречен ли заказ 0.
+     * @return true, если поток закончен.
+     */
+    bool isEnded() const;
+};
+
+/**
+ * @brief Проверяет запись по меню (как при отправке блока в движок).
+ * @param menu Меню.
+ * @param o Разобранная запись.
+ * @param dish Блюдо принятой записи (nullptr у отклонённой).
+ * @return OrderReject::None или причина отклонения.
+ */
+OrderReject checkOrder(const Menu& menu, const ParsedOrder& o, Dish*& dish);
+
+/**
+ * @brief Имя итога для сводки.
+ * @param o Итог.
+ * @return "done", "failed" или "rejected".
+ */
+const char* orderOutcomeName(OrderOutcome o);
+
+/**
+ * @brief Имя причины отклонения для сводки.
+ * @param r Причина.
+ * @return Например, "no_such_dish" ("-" для None).
+ */
+const char* orderRejectName(OrderReject r);
+
+/**
+ * @brief Имя кода отказа для сводки.
+ * @param e Код.
+ * @return Например, "not_enough_ingredient" ("-" для None).
+ */
+const char* kitchenErrorName(KitchenError e);
+
+/**
+ * @class OrderStream
+ * @brief Конвейер «разбор → проверка → готовка» для потока заказов.
+ *
+ * Движок на время run() должен получать заказы только от этого объекта:
+ * итоги забираются через KitchenEngine::collectResults().
+ */
+class OrderStream {
+private:
+    const Menu&    menu;   ///< Меню (номера пунктов).
+    KitchenEngine& engine; ///< Движок, который готовит заказы.
+    CostModel*     costs;  ///< Модель стоимости для допуска или nullptr.
+    long long      sla;    ///< Срок готовности при допуске, с.
+
+public:
+    static constexpr size_t CHUNK     = 64 * 1024; ///< Размер блока чтения, байт.
+    static constexpr int    MAX_COUNT = 10000;     ///< Наибольшее K в записи NxK.
+
+    /**
+     * @brief Создаёт конвейер над меню и движком.
+     * @param m Меню.
+     * @param e Движок заказов.
+     */
+    OrderStream(const Menu& m, KitchenEngine& e);
+
+    /**
+     * @brief Включает допуск по сроку: заказ, который не будет готов за
+     *        slaSeconds, отклоняется с причиной OrderReject::OverSla.
+     *
+     * Движку нужно передать ту же модель (KitchenEngine::setCostModel()),
+     * иначе очередь модели не убывает.
+     * @param m Модель стоимости или nullptr (без допуска).
+     * @param slaSeconds Срок готовности, симулированные секунды.
+     */
+    void setAdmission(CostModel* m, long long slaSeconds);
+
+    /**
+     * @brief Обрабатывает поток заказов до конца (или до заказа 0).
+     * @param in Поток с заказами (читается блоками через read()).
+     * @return Итоги всех заказов.
+     */
+    OrderStreamReport run(istream& in);
+
+    /**
+     * @brief Обрабатывает заказы из буфера в памяти.
+     * @param data Текст заказов.
+     * @param size Длина текста.
+     * @return Итоги всех заказов.
+     */
+    OrderStreamReport run(const char* data, size_t size);
+
+    /**
+     * @brief Печатает итоги: строка на заказ и общая сводка.
+     * @param report Итоги.
+     * @param out Поток вывода.
+     */
+    static void writeSummary(const OrderStreamReport& report, ostream& out);
+};
@@ -0,0 +1,225 @@
+/**
+ * @file planner.cpp
+ * @brief Реализация планирования заказов по мощностям кухни.
+ */
+
+#include "planner.hpp"
+#include "schedule.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+#include <utility>
+
+namespace {
+
+/// Пул, в который попадает арендуемый рецептом ресурс, или -1.
+int poolOf(const RecipeKitchen& k, const RecipeStep& s) {
+    switch (s.kind) {
+    case ResourceKind::Stove: return static_cast<int>(PlanResource::Burner);
+    case ResourceKind::Oven:  return static_cast<int>(PlanResource::Oven);
+    case ResourceKind::Ingredient:
+    case ResourceKind::Timer: return -1;
+    default:
+        break;
+    }
+    ResourceKind tk = k.toolKind(s.target);
+    if (tk == ResourceKind::Pan) return static_cast<int>(PlanResource::Pan);
+    if (tk == ResourceKind::Pot) return static_cast<int>(PlanResource::Pot);
+    return -1;
+}
+
+/// Хватает ли единиц free на потребность need.
+bool fits(const int* need, const int* free) {
+    for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+        if (need[r] > free[r]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/* ===== PlannerCapacity ===== */
+
+PlannerCapacity PlannerCapacity::of(const RecipeKitchen& k, int cooks) {
+    PlannerCapacity c{};
+    c[PlanResource::Cook] = cooks;
+    for (size_t i = 0; i < k.stoveCount(); ++i) {
+        c[PlanResource::Burner] += k.stove(static_cast<unsigned short>(i))->getBurners();
+    }
+    c[PlanResource::Oven] = static_cast<int>(k.ovenCount());
+    for (size_t i = 0; i < k.toolCount(); ++i) {
+        ResourceKind tk = k.toolKind(static_cast<unsigned short>(i));
+        if (tk == ResourceKind::Pan) ++c[PlanResource::Pan];
+        if (tk == ResourceKind::Pot) ++c[PlanResource::Pot];
+    }
+    return c;
+}
+
+/* ===== ResourceUsage ===== */
+
+double ResourceUsage::utilization(long long makespan) const {
+    if (capacity <= 0 || makespan <= 0) return 0.0;
+    return static_cast<double>(busySeconds) / (static_cast<double>(capacity) * static_cast<double>(makespan));
+}
+
+/* ===== CapacityPlan ===== */
+
+PlanResource CapacityPlan::bottleneck() const {
+    unsigned best = 0;
+    for (unsigned r = 1; r < PLAN_RESOURCES; ++r) {
+        if (resources[r].waitSeconds > resources[best].waitSeconds) best = r;
+    }
+    return static_cast<PlanResource>(best);
+}
+
+double CapacityPlan::ordersPerHour() const {
+    if (makespan <= 0) return 0.0;
+    return static_cast<double>(orders.size() - static_cast<size_t>(infeasible)) * 3600.0
+           / static_cast<double>(makespan);
+}
+
+/* ===== CapacityPlanner ===== */
+
+CapacityPlanner::CapacityPlanner(const RecipeBook& b, const PlannerCapacity& c)
+    : book(b), capacity(c), demands(static_cast<size_t>(b.size())) {
+    const RecipeKitchen& k = book.getKitchen();
+    for (int id = 0; id < book.size(); ++id) {
+        RecipeDemand& d = demands[static_cast<size_t>(id)];
+        d = RecipeDemand{};
+        d.units[static_cast<unsigned>(PlanResource::Cook)] = 1;
+        const RecipeStep* steps = book.stepsOf(id);
+        for (unsigned i = 0; i < book.stepCount(id); ++i) {
+            if (steps[i].op != RecipeOp::Lease) continue;
+            int pool = poolOf(k, steps[i]);
+            if (pool >= 0) ++d.units[pool];
+        }
+        d.seconds = RecipePlan(book, id).predictedMakespan();
+    }
+}
+
+const RecipeDemand& CapacityPlanner::demandOf(int recipe) const {
+    return demands[static_cast<size_t>(recipe)];
+}
+
+const PlannerCapacity& CapacityPlanner::getCapacity() const {
+    return capacity;
+}
+
+CapacityPlan CapacityPlanner::plan(const vector<PlanOrder>& orders) const {
+    CapacityPlan out{};
+    out.orders.resize(orders.size());
+    for (unsigned r = 0; r < PLAN_RESOURCES; ++r) out.resources[r].capacity = capacity.units[r];
+
+    vector<unsigned> arrivals;
+    arrivals.reserve(orders.size());
+    for (unsigned i = 0; i < orders.size(); ++i) {
+        const PlanOrder& o = orders[i];
+        bool known = o.recipe >= 0 && o.recipe < static_cast<int>(demands.size());
+        bool ok = known && fits(demands[static_cast<size_t>(o.recipe)].units, capacity.units);
+        out.orders[i] = PlannedOrder{o.recipe, o.release, o.deadline, -1, -1, ok, false};
+        if (ok) arrivals.push_back(i);
+        else    ++out.infeasible;
+    }
+    stable_sort(arrivals.begin(), arrivals.end(), [&orders](unsigned a, unsigned b) {
+        return orders[a].release < orders[b].release;
+    });
+
+    // Готовые заказы — по сроку, затем по поступлению и порядку во входе.
+    auto edf = [&orders](unsigned a, unsigned b) {
+        if (orders[a].deadline != orders[b].deadline) return orders[a].deadline < orders[b].deadline;
+        if (orders[a].release != orders[b].release) return orders[a].release < orders[b].release;
+        return a < b;
+    };
+    set<unsigned, decltype(edf)> ready(edf);
+    priority_queue<pair<long long, unsigned>, vector<pair<long long, unsigned>>,
+                   greater<pair<long long, unsigned>>> running;
+
+    int free[PLAN_RESOURCES];
+    for (unsigned r = 0; r < PLAN_RESOURCES; ++r) free[r] = capacity.units[r];
+    vector<long long> waiting(demands.size(), 0);  // ждущих заказов по рецептам
+    vector<unsigned>  blockedAt(demands.size(), 0); // номер прохода, где рецепт не поместился
+    unsigned pass = 0;
+
+    size_t next = 0;
+    long long t = arrivals.empty() ? 0 : orders[arrivals[0]].release;
+    while (next < arrivals.size() || !ready.empty() || !running.empty()) {
+        for (; next < arrivals.size() && orders[arrivals[next]].release <= t; ++next) {
+            ready.insert(arrivals[next]);
+            ++waiting[static_cast<size_t>(orders[arrivals[next]].recipe)];
+        }
+
+        // Списочное планирование: запускаем по порядку сроков всех, кто помещается.
+        // Свободных единиц по ходу прохода только меньше, поэтому не поместившийся
+        // рецепт до конца прохода больше не проверяется.
+        ++pass;
+        for (auto it = ready.begin(); it != ready.end() && free[static_cast<unsigned>(PlanResource::Cook)] > 0;) {
+            size_t rec = static_cast<size_t>(orders[*it].recipe);
+            const RecipeDemand& d = demands[rec];
+            if (blockedAt[rec] == pass || !fits(d.units, free)) {
+                blockedAt[rec] = pass;
+                ++it;
+                continue;
+            }
+            PlannedOrder& p = out.orders[*it];
+            p.start  = t;
+            p.finish = t + d.seconds;
+            for (unsigned r = 0; r < PLAN_RESOURCES; ++r) free[r] -= d.units[r];
+            running.push(make_pair(p.finish, *it));
+            --waiting[rec];
+            it = ready.erase(it);
+        }
+        for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+            out.resources[r].peakInUse = max(out.resources[r].peakInUse, capacity.units[r] - free[r]);
+        }
+
+        // Ждущие заказы без запущенных невозможны: на пустой кухне помещается любой
+        // выполнимый заказ. Поэтому следующее событие есть, пока цикл не кончился.
+        bool more = next < arrivals.size();
+        if (!more && running.empty()) break;
+        long long nt = more ? orders[arrivals[next]].release : running.top().first;
+        if (!running.empty()) nt = min(nt, running.top().first);
+
+        // До следующего события занятость и очередь не меняются.
+        long long dt = nt - t;
+        long long queue[PLAN_RESOURCES] = {};
+        for (size_t rec = 0; rec < waiting.size(); ++rec) {
+            if (!waiting[rec]) continue;
+            for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+                if (demands[rec].units[r] > free[r]) queue[r] += waiting[rec];
+            }
+        }
+        for (unsigned r = 0; r < PLAN_RESOURCES; ++r) {
+            ResourceUsage& u = out.resources[r];
+            u.busySeconds += static_cast<long long>(capacity.units[r] - free[r]) * dt;
+            u.waitSeconds += queue[r] * dt;
+            u.maxQueue = max(u.maxQueue, static_cast<int>(queue[r]));
+        }
+
+        t = nt;
+        while (!running.empty() && running.top().first <= t) {
+            const RecipeDemand& d = demands[static_cast<size_t>(orders[running.top().second].recipe)];
+            for (unsigned r = 0; r < PLAN_RESOURCES; ++r) free[r] += d.units[r];
+            running.pop();
+        }
+    }
+
+    for (PlannedOrder& p : out.orders) {
+        if (!p.feasible) continue;
+        p.late = p.finish > p.deadline;
+        out.makespan = max(out.makespan, p.finish);
+        out.totalWait += p.start - p.release;
+        if (p.late) {
+            ++out.missed;
+            out.totalLateness += p.finish - p.deadline;
+        }
+    }
+    return out;
+}
+
+CapacityPlan CapacityPlanner::planWithExtra(const vector<PlanOrder>& orders, PlanResource r, int extra) const {
+    CapacityPlanner more(*this);
+    more.capacity[r] += extra;
+    return more.plan(orders);
+}
@@ -0,0 +1,195 @@
+/**
+ * @file planner.hpp
+ * @brief Планирование пачки заказов по мощностям кухни.
+ *
+ * Stove знает только счётчик занятых конфорок, Oven — одну выпечку, а
+ * KitchenEngine берёт заказы в порядке поступления. CapacityPlanner заранее
+ * раскладывает набор заказов по пулам ресурсов (повара, конфорки, духовки,
+ * сковороды, кастрюли) списочным планированием: в каждый момент, когда
+ * освобождается ресурс или поступает заказ, из готовых заказов по порядку
+ * сроков (earliest deadline first) запускаются все, кому хватает ресурсов.
+ *
+ * Потребность рецепта берётся из его программы: каждый lease плиты — одна
+ * конфорка, lease духовки, сковороды или кастрюли — одна единица пула,
+ * плюс один повар. Длительность — предсказание RecipePlan. Ресурсы
+ * держатся всё время блюда, как при аренде EquipmentLease.
+ *
+ * По каждому пулу считаются загрузка и ожидание: сколько заказо-секунд
+ * заказы простояли из-за нехватки этого ресурса. planWithExtra() повторяет
+ * план с дополнительной единицей пула и показывает, окупается ли она.
+ */
+
+#pragma once
+
+#include "recipe.hpp"
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * @enum PlanResource
+ * @brief Пул ресурсов, по которому планируются заказы.
+ */
+enum class PlanResource : unsigned char {
+    Cook,   ///< Повар (нужен каждому заказу).
+    Burner, ///< Конфорка любой плиты.
+    Oven,   ///< Духовка.
+    Pan,    ///< Сковорода.
+    Pot     ///< Кастрюля.
+};
+
+static const unsigned PLAN_RESOURCES = 5; ///< Число пулов PlanResource.
+
+/**
+ * @struct PlannerCapacity
+ * @brief Число единиц каждого пула.
+ */
+struct PlannerCapacity {
+    int units[PLAN_RESOURCES]; ///< Единиц пула (по номеру PlanResource).
+
+    /**
+     * @brief Мощности кухни рецептов.
+     * @param k Справочник ресурсов.
+     * @param cooks Число поваров.
+     * @return Конфорки всех плит, духовки, сковороды и кастрюли справочника.
+     */
+    static PlannerCapacity of(const RecipeKitchen& k, int cooks);
+
+    /// Единиц пула r.
+    int& operator[](PlanResource r) { return units[static_cast<unsigned>(r)]; }
+    /// Единиц пула r.
+    int operator[](PlanResource r) const { return units[static_cast<unsigned>(r)]; }
+};
+
+/**
+ * @struct PlanOrder
+ * @brief Заказ для планирования.
+ */
+struct PlanOrder {
+    int       recipe;   ///< Номер рецепта в книге.
+    long long release;  ///< Когда заказ поступил, с.
+    long long deadline; ///< К какому моменту блюдо должно быть готово, с.
+};
+
+/**
+ * @struct PlannedOrder
+ * @brief Место заказа в плане.
+ */
+struct PlannedOrder {
+    int       recipe;   ///< Номер рецепта.
+    long long release;  ///< Поступление.
+    long long deadline; ///< Срок.
+    long long start;    ///< Запуск (-1, если заказ не выполнить).
+    long long finish;   ///< Готовность (-1, если заказ не выполнить).
+    bool      feasible; ///< Кухне хватает ресурсов на рецепт.
+    bool      late;     ///< Готов позже срока.
+};
+
+/**
+ * @struct ResourceUsage
+ * @brief Загрузка и очередь одного пула.
+ */
+struct ResourceUsage {
+    int       capacity;    ///< Единиц в пуле.
+    int       peakInUse;   ///< Наибольшее число занятых единиц.
+    int       maxQueue;    ///< Наибольшее число заказов, ждущих этот ресурс.
+    long long busySeconds; ///< Единице-секунды занятости.
+    long long waitSeconds; ///< Заказо-секунды ожидания из-за нехватки этого ресурса.
+
+    /**
+     * @brief Доля занятости пула.
+     * @param makespan Длительность плана.
+     * @return busySeconds / (capacity × makespan), 0 для пустого плана.
+     */
+    double utilization(long long makespan) const;
+};
+
+/**
+ * @struct CapacityPlan
+ * @brief Итог планирования набора заказов.
+ */
+struct CapacityPlan {
+    vector<PlannedOrder> orders;                    ///< Заказы в порядке входа.
+    ResourceUsage        resources[PLAN_RESOURCES]; ///< Пулы (по номеру PlanResource).
+    long long            makespan;                  ///< Готовность последнего заказа.
+    long long            totalWait;                 ///< Сумма ожиданий start − release.
+    long long            totalLateness;             ///< Сумма опозданий.
+    int                  missed;                    ///< Заказов позже срока.
+    int                  infeasible;                ///< Заказов, которые не выполнить.
+
+    /// Загрузка пула r.
+    const ResourceUsage& operator[](PlanResource r) const { return resources[static_cast<unsigned>(r)]; }
+
+    /**
+     * @brief Пул, из-за которого заказы стояли дольше всего.
+     * @return Ресурс с наибольшим waitSeconds (Cook, если ожиданий не было).
+     */
+    PlanResource bottleneck() const;
+
+    /**
+     * @brief Пропускная способность плана.
+     * @return Выполненных заказов в час симулированного времени.
+     */
+    double ordersPerHour() const;
+};
+
+/**
+ * @struct RecipeDemand
+ * @brief Что нужно рецепту на всё время приготовления.
+ */
+struct RecipeDemand {
+    int       units[PLAN_RESOURCES]; ///< Единиц каждого пула.
+    long long seconds;               ///< Длительность блюда, с.
+};
+
+/**
+ * @class CapacityPlanner
+ * @brief Списочное планирование заказов по сроку (EDF) с учётом мощностей.
+ */
+class CapacityPlanner {
+private:
+    const RecipeBook&    book;     ///< Книга рецептов.
+    PlannerCapacity      capacity; ///< Мощности кухни.
+    vector<RecipeDemand> demands;  ///< Потребности рецептов книги.
+
+public:
+    /**
+     * @brief Создаёт планировщик и считает потребности всех рецептов книги.
+     * @param b Книга рецептов.
+     * @param c Мощности кухни.
+     */
+    CapacityPlanner(const RecipeBook& b, const PlannerCapacity& c);
+
+    /**
+     * @brief Потребность рецепта.
+     * @param recipe Номер рецепта.
+     * @return Единицы пулов и длительность.
+     */
+    const RecipeDemand& demandOf(int recipe) const;
+
+    /**
+     * @brief Мощности, по которым строится план.
+     * @return Число единиц пулов.
+     */
+    const PlannerCapacity& getCapacity() const;
+
+    /**
+     * @brief Строит план.
+     *
+     * Заказ с неизвестным рецептом или с потребностью больше пула
+     * помечается как невыполнимый и ресурсы не занимает.
+     * @param orders Заказы (в любом порядке).
+     * @return План и загрузка пулов.
+     */
+    CapacityPlan plan(const vector<PlanOrder>& orders) const;
+
+    /**
+     * @brief Строит план с дополнительными единицами одного пула.
+     * @param orders Заказы.
+     * @param r Пул.
+     * @param extra Сколько единиц добавить.
+     * @return План при увеличенной мощности.
+     */
+    CapacityPlan planWithExtra(const vector<PlanOrder>& orders, PlanResource r, int extra) const;
+};
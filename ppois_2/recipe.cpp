@@ -0,0 +1,1227 @@
+/**
+ * @file recipe.cpp
+ * @brief Загрузка табличных рецептов и их интерпретатор.
+ */
+
+#include "recipe.hpp"
+#include "engine.hpp"
+#include "inventory.hpp"
+#include "eventlog.hpp"
+#include "schedule.hpp"
+#include "metrics.hpp"
+#include "feasibility.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+/// Битовая маска типов ресурсов.
+constexpr unsigned kindBit(ResourceKind k) {
+    return 1u << static_cast<unsigned>(k);
+}
+
+constexpr unsigned ANY_TOOL = kindBit(ResourceKind::Tool) | kindBit(ResourceKind::Knife)
+                            | kindBit(ResourceKind::Board) | kindBit(ResourceKind::Pan)
+                            | kindBit(ResourceKind::Pot) | kindBit(ResourceKind::Mixer)
+                            | kindBit(ResourceKind::Masher);
+
+constexpr unsigned LEASABLE = ANY_TOOL | kindBit(ResourceKind::Oven) | kindBit(ResourceKind::Stove);
+
+/**
+ * @struct OpSpec
+ * @brief Описание операции в тексте рецепта.
+ *
+ * operands: 'R' — ресурс, 'V' — вещественное число, 'A' — целое число;
+ * строчная буква — необязательный операнд.
+ */
+struct OpSpec {
+    const char* word;     ///< Ключевое слово.
+    RecipeOp    op;       ///< Код операции.
+    const char* operands; ///< Операнды.
+    unsigned    kinds;    ///< Допустимые типы ресурса.
+    bool        needText; ///< Текст обязателен.
+};
+
+const OpSpec OPS[] = {
+    {"say",         RecipeOp::Say,         "",    0,                                true},
+    {"warn",        RecipeOp::Warn,        "R",   ANY_TOOL,                         true},
+    {"require",     RecipeOp::Require,     "Rv",  ANY_TOOL,                         false},
+    {"lease",       RecipeOp::Lease,       "R",   LEASABLE,                         false},
+    {"acquire",     RecipeOp::Acquire,     "",    0,                                false},
+    {"reserve",     RecipeOp::Reserve,     "RV",  kindBit(ResourceKind::Ingredient), false},
+    {"take",        RecipeOp::Take,        "",    0,                                false},
+    {"commit",      RecipeOp::Commit,      "",    0,                                false},
+    {"plug",        RecipeOp::PlugIn,      "R",   kindBit(ResourceKind::Mixer),     false},
+    {"mix",         RecipeOp::Mix,         "R",   kindBit(ResourceKind::Mixer),     false},
+    {"mash",        RecipeOp::Mash,        "R",   kindBit(ResourceKind::Masher),    false},
+    {"use",         RecipeOp::Use,         "R",   ANY_TOOL,                         false},
+    {"burner_on",   RecipeOp::BurnerOn,    "R",   kindBit(ResourceKind::Stove),     false},
+    {"burner_off",  RecipeOp::BurnerOff,   "R",   kindBit(ResourceKind::Stove),     false},
+    {"heat",        RecipeOp::HeatPan,     "R",   kindBit(ResourceKind::Pan),       false},
+    {"cool",        RecipeOp::CoolPan,     "R",   kindBit(ResourceKind::Pan),       false},
+    {"boil",        RecipeOp::StartBoil,   "R",   kindBit(ResourceKind::Pot),       false},
+    {"unboil",      RecipeOp::StopBoil,    "R",   kindBit(ResourceKind::Pot),       false},
+    {"preheat",     RecipeOp::Preheat,     "RVA", kindBit(ResourceKind::Oven),      false},
+    {"bake",        RecipeOp::Bake,        "R",   kindBit(ResourceKind::Oven),      false},
+    {"hold",        RecipeOp::Hold,        "RA",  kindBit(ResourceKind::Timer),     false},
+    {"after",       RecipeOp::After,       "A",   0,                                true},
+    {"overcooked",  RecipeOp::Overcooked,  "A",   0,                                false},
+    {"undercooked", RecipeOp::Undercooked, "A",   0,                                false},
+};
+
+const OpSpec* findOp(const string& word) {
+    for (const OpSpec& s : OPS) {
+        if (word == s.word) return &s;
+    }
+    return nullptr;
+}
+
+[[noreturn]] void formatError(int line, const string& what) {
+    string msg = "Рецепт, строка " + to_string(line) + ": " + what;
+    throw RecipeFormatException(msg.c_str());
+}
+
+string trim(const string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == string::npos) return string();
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+void replaceAll(string& s, const string& from, const string& to) {
+    for (size_t p = s.find(from); p != string::npos; p = s.find(from, p + to.size())) {
+        s.replace(p, from.size(), to);
+    }
+}
+
+/**
+ * @struct Draft
+ * @brief Рецепты, разобранные из одного текста, до добавления в книгу.
+ */
+struct Draft {
+    vector<RecipeStep> steps;   ///< Шаги (смещения — относительно черновика).
+    string             texts;   ///< Пул текстов черновика.
+    vector<string>     names;   ///< Названия.
+    vector<unsigned>   firsts;  ///< Первый шаг каждого рецепта.
+    vector<unsigned>   counts;  ///< Число шагов каждого рецепта.
+};
+
+/// Разбирает одну строку шага и добавляет её в черновик.
+void parseStep(const string& line, int lineNo, const RecipeKitchen& kitchen, Draft& d) {
+    string head = line;
+    string text;
+    bool   hasText = false;
+    size_t bar = line.find('|');
+    if (bar != string::npos) {
+        head = line.substr(0, bar);
+        text = line.substr(bar + 1);
+        if (!text.empty() && text[0] == ' ') text.erase(0, 1);
+        hasText = true;
+    }
+
+    istringstream tokens(head);
+    string word;
+    tokens >> word;
+    const OpSpec* spec = findOp(word);
+    if (!spec) formatError(lineNo, "неизвестная операция '" + word + "'");
+
+    RecipeStep st{spec->op, ResourceKind::Ingredient, 0, 0, 0.0, 0, 0, RecipeStep::NO_SPLIT};
+    for (const char* o = spec->operands; *o; ++o) {
+        string tok;
+        if (!(tokens >> tok)) {
+            if (*o >= 'a') break;
+            formatError(lineNo, "не хватает операндов у '" + word + "'");
+        }
+        if (*o == 'R') {
+            if (!kitchen.find(tok, st.kind, st.target)) {
+                formatError(lineNo, "неизвестный ресурс '" + tok + "'");
+            }
+            if (!(spec->kinds & kindBit(st.kind))) {
+                formatError(lineNo, "ресурс '" + tok + "' не подходит для '" + word + "'");
+            }
+        } else {
+            char* end = nullptr;
+            double v = strtod(tok.c_str(), &end);
+            if (end == tok.c_str() || *end != '\0') {
+                formatError(lineNo, "ожидалось число вместо '" + tok + "'");
+            }
+            if (*o == 'A') st.arg = static_cast<int>(v);
+            else           st.value = v;
+        }
+    }
+    string extra;
+    if (tokens >> extra) formatError(lineNo, "лишний операнд '" + extra + "'");
+    if (spec->needText && !hasText) formatError(lineNo, "у '" + word + "' нет текста");
+
+    if (hasText) {
+        size_t m = text.find("%m");
+        if (m != string::npos) {
+            text.erase(m, 2);
+            st.split = static_cast<unsigned short>(m);
+        }
+        if (text.size() >= 0xFFFF) formatError(lineNo, "слишком длинный текст");
+        st.text    = static_cast<unsigned>(d.texts.size());
+        st.textLen = static_cast<unsigned short>(text.size());
+        d.texts += text;
+        d.texts += '\0';
+    }
+    d.steps.push_back(st);
+}
+
+/// Добавляет шаг этапа: stage <имя> [after <этап>…].
+void parseStage(const string& line, int lineNo, vector<string>& stages, Draft& d) {
+    istringstream tokens(line);
+    string word, name, tok;
+    tokens >> word >> name;
+    if (name.empty() || name == "after") formatError(lineNo, "у этапа нет имени");
+    if (find(stages.begin(), stages.end(), name) != stages.end()) {
+        formatError(lineNo, "этап уже описан: " + name);
+    }
+    if (stages.size() >= RecipePlan::MAX_STAGES) formatError(lineNo, "слишком много этапов");
+
+    unsigned deps = 0;
+    if (tokens >> tok) {
+        if (tok != "after") formatError(lineNo, "ожидалось after вместо '" + tok + "'");
+        while (tokens >> tok) {
+            auto it = find(stages.begin(), stages.end(), tok);
+            if (it == stages.end()) formatError(lineNo, "неизвестный этап '" + tok + "'");
+            deps |= 1u << (it - stages.begin());
+        }
+        if (!deps) formatError(lineNo, "after без этапов");
+    }
+
+    RecipeStep st{RecipeOp::Stage, ResourceKind::Ingredient, static_cast<unsigned short>(stages.size()),
+                  static_cast<int>(deps), 0.0, static_cast<unsigned>(d.texts.size()),
+                  static_cast<unsigned short>(name.size()), RecipeStep::NO_SPLIT};
+    d.texts += name;
+    d.texts += '\0';
+    d.steps.push_back(st);
+    stages.push_back(name);
+}
+
+/// Аренда и резерв — дело пролога: внутри этапа они запрещены.
+void checkStageStep(const Draft& d, int lineNo) {
+    switch (d.steps.back().op) {
+    case RecipeOp::Lease:
+    case RecipeOp::Acquire:
+    case RecipeOp::Reserve:
+    case RecipeOp::Take:
+    case RecipeOp::Commit:
+        formatError(lineNo, "аренда и резерв внутри этапа не поддерживаются");
+    default:
+        break;
+    }
+}
+
+/// Текст шага или сообщение по умолчанию.
+const char* messageOf(const RecipeBook& book, const RecipeStep& s, const char* fallback) {
+    return s.textLen ? book.textOf(s) : fallback;
+}
+
+
+long long waitTimer(SimClock& clock, Timer* t) {
+    long long startedAt = clock.now();
+    clock.onTimerFinished(t, nullptr);
+    clock.run();
+    return clock.now() - startedAt;
+}
+
+long long waitOvenOff(SimClock& clock, Oven* o) {
+    long long startedAt = clock.now();
+    clock.onOvenOff(o, nullptr);
+    clock.run();
+    return clock.now() - startedAt;
+}
+
+/**
+ * @struct RecipeRun
+ * @brief Состояние одного исполнения рецепта (или партии).
+ */
+struct RecipeRun {
+    const RecipeBook&  book;        ///< Книга рецептов.
+    RecipeKitchen&     k;           ///< Кухня.
+    SimClock&          clock;       ///< Часы повара.
+    int                portions;    ///< Порций в партии (множитель резерва).
+    EquipmentLease     lease;       ///< Аренда оборудования.
+    StockReservation   stock;       ///< Резерв ингредиентов.
+    long long          lastWait;    ///< Длительность последнего ожидания.
+    bool               repeatPass;  ///< Повторный проход тела партии.
+    const RecipeStep*  lastPreheat; ///< Последний шаг разогрева духовки.
+    const RecipeStep*  first;       ///< Первый шаг рецепта.
+    LogContext&        log;         ///< Журнал текущего потока.
+    CookStatus         status;      ///< Причина отказа, если exec() вернул false.
+    unsigned           stepsRun;    ///< Исполнено шагов (в метрики — при выходе).
+    bool               timeSteps;   ///< Замерять ли шаги (Metrics::stepTiming() на старте).
+
+    RecipeRun(const RecipeBook& b, int id, SimClock& c, int n)
+        : book(b), k(b.getKitchen()), clock(c), portions(n), lease(), stock(),
+          lastWait(0), repeatPass(false), lastPreheat(nullptr),
+          first(b.stepsOf(id)), log(logContext()), status(CookStatus::success()),
+          stepsRun(0), timeSteps(Metrics::stepTiming()) {
+        // Таймеры шагов hold арендуются вместе с оборудованием рецепта.
+        const RecipeStep* end = first + b.stepCount(id);
+        for (const RecipeStep* s = first; s != end; ++s) {
+            if (s->op == RecipeOp::Hold) lease.add(k.timer(s->target));
+        }
+    }
+
+    ~RecipeRun() {
+        Metrics::count(MetricCounter::StepsRun, stepsRun);
+    }
+
+    /// Запоминает отказ на шаге s; виновник — ресурс шага (если он есть).
+    bool fail(const RecipeStep* s, KitchenError e, const char* msg, bool hasCulprit = true) {
+        status = CookStatus{e, s->kind, hasCulprit ? s->target : CookStatus::NO_CULPRIT,
+                            static_cast<unsigned short>(s - first), msg};
+        return false;
+    }
+
+    /// Отказ шага take: виновник — ингредиент, которого не хватило.
+    bool failShortage(const RecipeStep* s) {
+        fail(s, KitchenError::NotEnoughIngredient, "Not enough ingredient", false);
+        const Ingredient* missing = stock.getShortage();
+        for (const RecipeStep* r = first; r != s; ++r) {
+            if (r->op == RecipeOp::Reserve && k.ingredient(r->target) == missing) {
+                status.kind    = ResourceKind::Ingredient;
+                status.culprit = r->target;
+                break;
+            }
+        }
+        return false;
+    }
+
+    /// При повторном проходе партии выполняются только ожидания и сообщения.
+    static bool repeatsInPass(RecipeOp op) {
+        return op == RecipeOp::Say || op == RecipeOp::Hold || op == RecipeOp::Bake
+            || op == RecipeOp::After || op == RecipeOp::Overcooked
+            || op == RecipeOp::Undercooked;
+    }
+
+    /**
+     * Исполняет один шаг. Обычные отказы не бросают исключений:
+     * шаг возвращает false, а причина остаётся в status.
+     */
+    bool exec(const RecipeStep* s) {
+        if (repeatPass && !repeatsInPass(s->op)) return true;
+        ++stepsRun;
+        if (!timeSteps) return execStep(s);
+        uint64_t t0 = Metrics::now();
+        bool ok = execStep(s);
+        Metrics::step(s->op, Metrics::now() - t0);
+        return ok;
+    }
+
+    /// Тело exec() без учёта метрик.
+    bool execStep(const RecipeStep* s) {
+        if (log.sink) log.step = static_cast<unsigned short>(s - first);
+
+        switch (s->op) {
+        case RecipeOp::Say:
+            if (!logEvent(EventKind::StepText, static_cast<double>(lastWait / 60))) {
+                book.printText(*s, lastWait / 60, cout);
+            }
+            break;
+
+        case RecipeOp::Warn: {
+            KitchenTool* t = k.tool(s->target);
+            bool ok = t->isAvailable();
+            if (k.toolKind(s->target) == ResourceKind::Board) {
+                ok = static_cast<CuttingBoard*>(t)->isSafeForBread();
+            } else if (k.toolKind(s->target) == ResourceKind::Knife) {
+                ok = static_cast<Knife*>(t)->canCut();
+            }
+            if (!ok && !logEvent(EventKind::StepText, static_cast<double>(lastWait / 60))) {
+                book.printText(*s, lastWait / 60, cout);
+            }
+            break;
+        }
+
+        case RecipeOp::Require: {
+            KitchenTool* t = k.tool(s->target);
+            ResourceKind kind = k.toolKind(s->target);
+            if (kind == ResourceKind::Pot && s->value > 0.0) {
+                if (!static_cast<Pot*>(t)->canBoil(s->value)) {
+                    return fail(s, KitchenError::NotEnoughIngredient,
+                                messageOf(book, *s, "Кастрюля слишком маленькая"));
+                }
+            } else if (kind == ResourceKind::Knife) {
+                if (!static_cast<Knife*>(t)->canCut()) {
+                    return fail(s, KitchenError::ToolNotAvailable, messageOf(book, *s, "Нож недоступен"));
+                }
+            } else if (!t->isAvailable()) {
+                return fail(s, KitchenError::ToolNotAvailable, messageOf(book, *s, "Инструмент недоступен"));
+            }
+            break;
+        }
+
+        case RecipeOp::Lease:
+            if (s->kind == ResourceKind::Oven)       lease.add(k.oven(s->target));
+            else if (s->kind == ResourceKind::Stove) lease.add(k.stove(s->target));
+            else                                     lease.add(k.tool(s->target));
+            break;
+
+        case RecipeOp::Acquire:
+            lease.acquire();
+            break;
+
+        case RecipeOp::Reserve:
+            stock.add(k.ingredient(s->target), s->value * portions);
+            break;
+
+        case RecipeOp::Take:
+            if (!stock.tryReserve()) return failShortage(s);
+            break;
+
+        case RecipeOp::Commit:
+            stock.commit();
+            break;
+
+        case RecipeOp::PlugIn:
+            if (!static_cast<Mixer*>(k.tool(s->target))->plugIn()) {
+                return fail(s, KitchenError::ToolNotAvailable,
+                            messageOf(book, *s, "Миксер не включён в розетку"));
+            }
+            break;
+
+        case RecipeOp::Mix: {
+            Mixer* m = static_cast<Mixer*>(k.tool(s->target));
+            if (m->isPluggedIn() && !m->isAvailable()) {
+                return fail(s, KitchenError::ToolNotAvailable, "Mixer is not available");
+            }
+            m->mix();
+            break;
+        }
+
+        case RecipeOp::Mash: {
+            PotatoMasher* m = static_cast<PotatoMasher*>(k.tool(s->target));
+            if (!m->isAvailable()) {
+                return fail(s, KitchenError::ToolNotAvailable, "Potato masher is not available");
+            }
+            m->mash();
+            break;
+        }
+
+        case RecipeOp::Use:
+            if (!k.tool(s->target)->tryUse()) {
+                return fail(s, KitchenError::ToolNotAvailable,
+                            "Tool not usable (unavailable, dirty, or broken)");
+            }
+            break;
+
+        case RecipeOp::BurnerOn:
+            k.stove(s->target)->turnOnBurner();
+            break;
+
+        case RecipeOp::BurnerOff:
+            k.stove(s->target)->turnOffBurner();
+            break;
+
+        case RecipeOp::HeatPan: {
+            Pan* p = static_cast<Pan*>(k.tool(s->target));
+            if (!p->isAvailable()) return fail(s, KitchenError::ToolNotAvailable, "Pan not available");
+            p->heatUp();
+            break;
+        }
+
+        case RecipeOp::CoolPan:
+            static_cast<Pan*>(k.tool(s->target))->coolDown();
+            break;
+
+        case RecipeOp::StartBoil: {
+            Pot* p = static_cast<Pot*>(k.tool(s->target));
+            if (!p->isAvailable()) return fail(s, KitchenError::ToolNotAvailable, "Pot not available");
+            p->startBoil();
+            break;
+        }
+
+        case RecipeOp::StopBoil:
+            static_cast<Pot*>(k.tool(s->target))->stopBoil();
+            break;
+
+        case RecipeOp::Preheat: {
+            if (s->value <= 0.0 || s->value > 300.0) {
+                return fail(s, KitchenError::InvalidTemperature, "Invalid oven temperature");
+            }
+            if (s->arg <= 0) {
+                return fail(s, KitchenError::TimerNotSet, "Timer minutes must be > 0");
+            }
+            lastPreheat = s;
+            Oven* o = k.oven(s->target);
+            o->closeDoor();
+            o->preheat(s->value);
+            o->setTimerMinutes(s->arg);
+            break;
+        }
+
+        case RecipeOp::Bake: {
+            Oven* o = k.oven(s->target);
+            if (repeatPass && !o->isOn() && lastPreheat) {
+                o->preheat(lastPreheat->value);
+                o->setTimerMinutes(lastPreheat->arg);
+            }
+            if (o->secondsUntilOff() < 0) {
+                return fail(s, KitchenError::TimerNotSet, "Oven baking timer is not running");
+            }
+            lastWait = waitOvenOff(clock, o);
+            logEvent(EventKind::WaitDone, static_cast<double>(lastWait));
+            break;
+        }
+
+        case RecipeOp::Hold: {
+            if (s->arg <= 0) return fail(s, KitchenError::TimerNotSet, "Timer seconds must be > 0");
+            if (!lease.isHeld()) lease.acquire();   // рецепт без шага acquire
+            Timer* t = k.timer(s->target);
+            t->start(s->arg);
+            lastWait = waitTimer(clock, t);
+            logEvent(EventKind::WaitDone, static_cast<double>(lastWait));
+            break;
+        }
+
+        case RecipeOp::After: {
+            // Захваты не больше двух указателей: function<> хранит их без выделения памяти.
+            if (log.sink) {
+                unsigned dish = log.dish;
+                unsigned short step = log.step;
+                // Приёмник и часы — из контекста потока на момент срабатывания:
+                // события часов выполняет тот же поток, а приёмник, снятый
+                // раньше, мог уже закрыться вместе со своей областью.
+                clock.schedule(s->arg, [dish, step] {
+                    const LogContext& ctx = logContext();
+                    if (!ctx.sink) return;
+                    KitchenEvent e{ctx.clock ? ctx.clock->now() : 0, 0.0, dish, step,
+                                   EventKind::StepText, 0};
+                    ctx.sink->record(e);
+                });
+            } else {
+                const RecipeBook* b = &book;
+                const RecipeStep* step = s;
+                clock.schedule(s->arg, [b, step] { b->printText(*step, 0, cout); });
+            }
+            break;
+        }
+
+        case RecipeOp::Overcooked:
+            if (lastWait / 60 > s->arg) {
+                return fail(s, KitchenError::Overcooked, messageOf(book, *s, "Блюдо передержано"), false);
+            }
+            break;
+
+        case RecipeOp::Undercooked:
+            if (lastWait / 60 < s->arg) {
+                return fail(s, KitchenError::Undercooked, messageOf(book, *s, "Блюдо недоготовлено"), false);
+            }
+            break;
+
+        case RecipeOp::Stage:
+        case RecipeOp::Join:
+            // Границы этапов важны только планировщику (Cook::cookScheduled()).
+            break;
+        }
+        return true;
+    }
+};
+
+/**
+ * @struct StageScheduler
+ * @brief Исполнение этапов рецепта по событиям часов повара.
+ *
+ * Этап исполняется до первого ожидания; таймер или духовка регистрируются
+ * в часах, и продолжение этапа приходит событием, а тем временем
+ * запускаются другие готовые этапы. Этапы с общим инструментом, духовкой
+ * или таймером не пересекаются, конфорки плиты считаются по аренде пролога.
+ */
+struct StageScheduler {
+    /**
+     * @struct BurnerUse
+     * @brief Спрос этапа на конфорки одной плиты.
+     */
+    struct BurnerUse {
+        unsigned short stove; ///< Индекс плиты.
+        int            count; ///< Число конфорок.
+    };
+
+    RecipeRun&                 run;      ///< Исполнение рецепта.
+    const RecipePlan&          plan;     ///< План этапов.
+    const RecipeStep*          steps;    ///< Шаги рецепта.
+    long long                  origin;   ///< Начало блюда по часам.
+    vector<StageTiming>&       timings;  ///< Фактические времена этапов.
+    vector<unsigned>           next;     ///< Следующий шаг каждого этапа.
+    vector<long long>          waits;    ///< Последнее ожидание каждого этапа (%m).
+    vector<vector<unsigned>>   claims;   ///< Исключительные ресурсы каждого этапа.
+    vector<vector<BurnerUse>>  burners;  ///< Конфорки каждого этапа.
+    vector<BurnerUse>          spare;    ///< Свободные конфорки плит рецепта.
+    vector<unsigned>           held;     ///< Занятые ресурсы.
+    unsigned                   started;  ///< Маска запущенных этапов.
+    unsigned                   done;     ///< Маска завершённых этапов.
+    int                        running;  ///< Этапов в работе.
+    bool                       failed;   ///< Этап остановился с ошибкой (см. run.status).
+    shared_ptr<bool>           alive;    ///< Ложь после выхода: отложенные события игнорируются.
+
+    /// Ключ исключительного ресурса шага или 0, если шаг такого не трогает.
+    static unsigned claimOf(const RecipeStep& s) {
+        switch (s.op) {
+        case RecipeOp::Say:
+        case RecipeOp::After:
+        case RecipeOp::Overcooked:
+        case RecipeOp::Undercooked:
+        case RecipeOp::BurnerOn:
+        case RecipeOp::BurnerOff:
+            return 0;
+        default:
+            break;
+        }
+        unsigned cat = 0;
+        if (s.kind == ResourceKind::Oven)       cat = 2;
+        else if (s.kind == ResourceKind::Timer) cat = 3;
+        else if (kindBit(s.kind) & ANY_TOOL)    cat = 1;
+        return cat ? (cat << 16) | s.target : 0;
+    }
+
+    static void addBurners(vector<BurnerUse>& v, unsigned short stove, int n) {
+        for (BurnerUse& b : v) {
+            if (b.stove == stove) {
+                b.count += n;
+                return;
+            }
+        }
+        v.push_back(BurnerUse{stove, n});
+    }
+
+    StageScheduler(RecipeRun& r, const RecipePlan& p, const RecipeStep* s, long long at,
+                   vector<StageTiming>& out)
+        : run(r), plan(p), steps(s), origin(at), timings(out), next(), waits(), claims(), burners(),
+          spare(), held(), started(0), done(0), running(0), failed(false), alive(make_shared<bool>(true)) {
+        const vector<PlanStage>& st = plan.stages();
+        next.resize(st.size());
+        waits.assign(st.size(), 0);
+        claims.resize(st.size());
+        burners.resize(st.size());
+        for (size_t i = 0; i < st.size(); ++i) {
+            next[i] = st[i].first;
+            for (unsigned j = st[i].first; j < st[i].first + st[i].count; ++j) {
+                unsigned key = claimOf(steps[j]);
+                if (key && find(claims[i].begin(), claims[i].end(), key) == claims[i].end()) {
+                    claims[i].push_back(key);
+                }
+                if (steps[j].op == RecipeOp::BurnerOn) addBurners(burners[i], steps[j].target, 1);
+            }
+            long long predicted = plan.prologueSeconds() + st[i].earliestStart;
+            timings.push_back(StageTiming{st[i].name, predicted, predicted + st[i].duration, -1, -1,
+                                          st[i].critical});
+        }
+        // Конфорки: сколько арендовано в прологе минус уже включённые там.
+        for (unsigned j = 0; j < plan.prologueSteps(); ++j) {
+            if (steps[j].op == RecipeOp::Lease && steps[j].kind == ResourceKind::Stove) {
+                addBurners(spare, steps[j].target, 1);
+            } else if (steps[j].op == RecipeOp::BurnerOn) {
+                addBurners(spare, steps[j].target, -1);
+            } else if (steps[j].op == RecipeOp::BurnerOff) {
+                addBurners(spare, steps[j].target, 1);
+            }
+        }
+    }
+
+    ~StageScheduler() {
+        *alive = false;
+    }
+
+    int freeBurners(unsigned short stove) const {
+        for (const BurnerUse& b : spare) {
+            if (b.stove == stove) return b.count;
+        }
+        return run.k.stove(stove)->freeBurners();
+    }
+
+    bool canStart(unsigned i) const {
+        const PlanStage& st = plan.stages()[i];
+        if ((st.deps & done) != st.deps) return false;
+        for (unsigned key : claims[i]) {
+            if (find(held.begin(), held.end(), key) != held.end()) return false;
+        }
+        if (running == 0) return true;   // один этап идёт всегда, даже если конфорок не хватает
+        for (const BurnerUse& b : burners[i]) {
+            if (b.count > freeBurners(b.stove)) return false;
+        }
+        return true;
+    }
+
+    /// Запускает все готовые этапы в порядке приоритета.
+    void launch() {
+        for (unsigned i : plan.launchOrder()) {
+            if (failed) return;
+            if ((started & (1u << i)) || !canStart(i)) continue;
+            started |= 1u << i;
+            ++running;
+            held.insert(held.end(), claims[i].begin(), claims[i].end());
+            for (const BurnerUse& b : burners[i]) addBurners(spare, b.stove, -b.count);
+            timings[i].start = run.clock.now() - origin;
+            advance(i);
+        }
+    }
+
+    void finish(unsigned i) {
+        done |= 1u << i;
+        --running;
+        for (unsigned key : claims[i]) held.erase(find(held.begin(), held.end(), key));
+        for (const BurnerUse& b : burners[i]) addBurners(spare, b.stove, b.count);
+        timings[i].finish = run.clock.now() - origin;
+        launch();
+    }
+
+    /// Продолжение этапа i после ожидания, начатого в момент at.
+    SimClock::Action resume(unsigned i, long long at, unsigned short step) {
+        StageScheduler* self = this;
+        shared_ptr<bool> guard = alive;
+        return [self, guard, i, at, step] {
+            if (!*guard || self->failed) return;
+            self->waits[i] = self->run.clock.now() - at;
+            if (self->run.log.sink) self->run.log.step = step;
+            logEvent(EventKind::WaitDone, static_cast<double>(self->waits[i]));
+            self->advance(i);
+        };
+    }
+
+    /// Исполняет этап i до следующего ожидания или до конца.
+    void advance(unsigned i) {
+        const PlanStage& st = plan.stages()[i];
+        const unsigned end = st.first + st.count;
+        run.lastWait = waits[i];
+        while (next[i] < end) {
+            const RecipeStep* s = steps + next[i]++;
+            unsigned short step = static_cast<unsigned short>(s - run.first);
+            if (s->op == RecipeOp::Hold) {
+                if (run.log.sink) run.log.step = step;
+                if (s->arg <= 0) {
+                    failed = !run.fail(s, KitchenError::TimerNotSet, "Timer seconds must be > 0");
+                    return;
+                }
+                if (!run.lease.isHeld()) run.lease.acquire();
+                Timer* t = run.k.timer(s->target);
+                t->start(s->arg);
+                run.clock.onTimerFinished(t, resume(i, run.clock.now(), step));
+                return;
+            }
+            if (s->op == RecipeOp::Bake) {
+                if (run.log.sink) run.log.step = step;
+                Oven* o = run.k.oven(s->target);
+                if (o->secondsUntilOff() < 0) {
+                    failed = !run.fail(s, KitchenError::TimerNotSet, "Oven baking timer is not running");
+                    return;
+                }
+                run.clock.onOvenOff(o, resume(i, run.clock.now(), step));
+                return;
+            }
+            if (!run.exec(s)) {
+                failed = true;
+                return;
+            }
+        }
+        finish(i);
+    }
+};
+
+/**
+ * @struct DishMetrics
+ * @brief Замер блюда для метрик: итог и задержка от создания до finish().
+ *
+ * Если finish() не вызван (вылетело исключение), блюдо считается прерванным.
+ */
+struct DishMetrics {
+    int      id;    ///< Номер рецепта.
+    uint64_t start; ///< Начало, нс.
+    bool     done;  ///< finish() уже вызван.
+
+    explicit DishMetrics(int i) : id(i), start(Metrics::now()), done(false) {}
+
+    CookStatus finish(const CookStatus& st) {
+        Metrics::dish(id, start, st.error);
+        done = true;
+        return st;
+    }
+
+    ~DishMetrics() {
+        if (!done) Metrics::dishAborted(id, start);
+    }
+};
+
+/// Бросает исключение по статусу; для нехватки продукта называет ингредиент.
+void raise(const RecipeBook& book, const CookStatus& st) {
+    if (st.error == KitchenError::NotEnoughIngredient && st.kind == ResourceKind::Ingredient
+        && st.culprit != CookStatus::NO_CULPRIT) {
+        string msg = string("Not enough ingredient: ") + book.getKitchen().ingredient(st.culprit)->getName();
+        throw NotEnoughIngredientException(msg.c_str());
+    }
+    st.throwIfFailed();
+}
+
+} // namespace
+
+const char* recipeOpName(RecipeOp op) {
+    if (op == RecipeOp::Stage) return "stage";
+    if (op == RecipeOp::Join)  return "join";
+    for (const OpSpec& s : OPS) {
+        if (s.op == op) return s.word;
+    }
+    return "?";
+}
+
+/* ===== RecipeKitchen ===== */
+
+void RecipeKitchen::addKey(const char* key, ResourceKind kind, size_t index) {
+    if (!key || !*key) {
+        throw RecipeFormatException("Пустое имя ресурса кухни");
+    }
+    if (index >= 0xFFFF) {
+        throw RecipeFormatException("Слишком много ресурсов одного типа");
+    }
+    if (!byKey.emplace(key, Entry{kind, static_cast<unsigned short>(index)}).second) {
+        string msg = string("Ресурс уже зарегистрирован: ") + key;
+        throw RecipeFormatException(msg.c_str());
+    }
+}
+
+void RecipeKitchen::addTool(const char* key, KitchenTool* t, ResourceKind kind) {
+    if (!t) throw ToolNotAvailableException("Tool is not set for recipe kitchen");
+    addKey(key, kind, tools.size());
+    tools.push_back(t);
+    toolKinds.push_back(kind);
+}
+
+void RecipeKitchen::add(const char* key, Ingredient* i) {
+    if (!i) throw IngredientNotFoundException("Ingredient is not set for recipe kitchen");
+    addKey(key, ResourceKind::Ingredient, ingredients.size());
+    ingredients.push_back(i);
+}
+
+void RecipeKitchen::add(const char* key, KitchenTool* t)  { addTool(key, t, ResourceKind::Tool); }
+void RecipeKitchen::add(const char* key, Knife* k)        { addTool(key, k, ResourceKind::Knife); }
+void RecipeKitchen::add(const char* key, CuttingBoard* b) { addTool(key, b, ResourceKind::Board); }
+void RecipeKitchen::add(const char* key, Pan* p)          { addTool(key, p, ResourceKind::Pan); }
+void RecipeKitchen::add(const char* key, Pot* p)          { addTool(key, p, ResourceKind::Pot); }
+void RecipeKitchen::add(const char* key, Mixer* m)        { addTool(key, m, ResourceKind::Mixer); }
+void RecipeKitchen::add(const char* key, PotatoMasher* m) { addTool(key, m, ResourceKind::Masher); }
+
+void RecipeKitchen::add(const char* key, Oven* o) {
+    if (!o) throw ToolNotAvailableException("Oven is not set for recipe kitchen");
+    addKey(key, ResourceKind::Oven, ovens.size());
+    ovens.push_back(o);
+}
+
+void RecipeKitchen::add(const char* key, Stove* s) {
+    if (!s) throw ToolNotAvailableException("Stove is not set for recipe kitchen");
+    addKey(key, ResourceKind::Stove, stoves.size());
+    stoves.push_back(s);
+}
+
+void RecipeKitchen::add(const char* key, Timer* t) {
+    if (!t) throw TimerNotSetException("Timer is not set for recipe kitchen");
+    addKey(key, ResourceKind::Timer, timers.size());
+    timers.push_back(t);
+}
+
+void RecipeKitchen::clear() {
+    byKey.clear();
+    ingredients.clear();
+    tools.clear();
+    toolKinds.clear();
+    ovens.clear();
+    stoves.clear();
+    timers.clear();
+}
+
+bool RecipeKitchen::find(const string& key, ResourceKind& kind, unsigned short& index) const {
+    auto it = byKey.find(key);
+    if (it == byKey.end()) return false;
+    kind  = it->second.kind;
+    index = it->second.index;
+    return true;
+}
+
+/* ===== RecipeBook ===== */
+
+RecipeBook::RecipeBook(RecipeKitchen* k)
+    : kitchen(k), steps(), texts(), names(), recipes(), feasibility(nullptr) {
+    if (!k) throw RecipeFormatException("Recipe book needs a kitchen");
+}
+
+int RecipeBook::load(istream& in) {
+    Draft d;
+    string line;
+    int lineNo = 0;
+    bool inRecipe = false;
+    int repeatCount = 0;
+    int repeatLine = 0;
+    vector<pair<int, string>> repeatBody;
+    vector<string> stages;
+    bool joined = false;
+
+    while (getline(in, line)) {
+        ++lineNo;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        string word = line.substr(0, line.find_first_of(" \t"));
+        if (repeatCount > 0) {
+            if (word != "done") {
+                if (word == "repeat") formatError(lineNo, "вложенный repeat не поддерживается");
+                if (word == "stage" || word == "join") formatError(lineNo, "этап внутри repeat не поддерживается");
+                repeatBody.push_back({lineNo, line});
+                continue;
+            }
+            for (int i = 1; i <= repeatCount; ++i) {
+                for (const auto& body : repeatBody) {
+                    string l = body.second;
+                    replaceAll(l, "%i", to_string(i));
+                    parseStep(l, body.first, *kitchen, d);
+                    if (!stages.empty() && !joined) checkStageStep(d, body.first);
+                }
+            }
+            repeatCount = 0;
+            repeatBody.clear();
+            continue;
+        }
+
+        if (word == "recipe") {
+            if (inRecipe) formatError(lineNo, "рецепт не закрыт через end");
+            string title = trim(line.substr(word.size()));
+            if (title.empty()) formatError(lineNo, "у рецепта нет названия");
+            d.names.push_back(title);
+            d.firsts.push_back(static_cast<unsigned>(d.steps.size()));
+            inRecipe = true;
+            stages.clear();
+            joined = false;
+        } else if (word == "end") {
+            if (!inRecipe) formatError(lineNo, "end вне рецепта");
+            d.counts.push_back(static_cast<unsigned>(d.steps.size()) - d.firsts.back());
+            inRecipe = false;
+        } else if (!inRecipe) {
+            formatError(lineNo, "шаг вне рецепта");
+        } else if (word == "repeat") {
+            char* end = nullptr;
+            string n = trim(line.substr(word.size()));
+            long count = strtol(n.c_str(), &end, 10);
+            if (n.empty() || *end != '\0' || count < 1) formatError(lineNo, "repeat ждёт число повторов");
+            repeatCount = static_cast<int>(count);
+            repeatLine = lineNo;
+        } else if (word == "done") {
+            formatError(lineNo, "done без repeat");
+        } else if (word == "stage") {
+            if (joined) formatError(lineNo, "stage после join");
+            parseStage(line, lineNo, stages, d);
+        } else if (word == "join") {
+            if (stages.empty() || joined) formatError(lineNo, "join без открытых этапов");
+            d.steps.push_back(RecipeStep{RecipeOp::Join, ResourceKind::Ingredient, 0, 0, 0.0, 0, 0,
+                                         RecipeStep::NO_SPLIT});
+            joined = true;
+        } else {
+            parseStep(line, lineNo, *kitchen, d);
+            if (!stages.empty() && !joined) checkStageStep(d, lineNo);
+        }
+    }
+    if (repeatCount > 0) formatError(repeatLine, "repeat не закрыт через done");
+    if (inRecipe) formatError(lineNo, "рецепт не закрыт через end");
+
+    unsigned stepBase = static_cast<unsigned>(steps.size());
+    unsigned textBase = static_cast<unsigned>(texts.size());
+    for (RecipeStep& s : d.steps) s.text += textBase;
+    steps.insert(steps.end(), d.steps.begin(), d.steps.end());
+    texts += d.texts;
+    for (size_t i = 0; i < d.names.size(); ++i) {
+        names.push_back(d.names[i]);
+        unsigned staged = 0;
+        for (unsigned j = 0; j < d.counts[i]; ++j) {
+            if (d.steps[d.firsts[i] + j].op == RecipeOp::Stage) ++staged;
+        }
+        recipes.push_back(Info{names.back().c_str(), stepBase + d.firsts[i], d.counts[i], staged});
+    }
+    return static_cast<int>(d.names.size());
+}
+
+int RecipeBook::loadString(const char* text) {
+    istringstream in(text ? text : "");
+    return load(in);
+}
+
+void RecipeBook::clear() {
+    steps.clear();
+    texts.clear();
+    names.clear();
+    recipes.clear();
+    feasibility = nullptr;
+}
+
+int RecipeBook::size() const {
+    return static_cast<int>(recipes.size());
+}
+
+int RecipeBook::find(const string& name) const {
+    for (size_t i = 0; i < recipes.size(); ++i) {
+        if (name == recipes[i].name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const char* RecipeBook::name(int id) const {
+    return recipes.at(static_cast<size_t>(id)).name;
+}
+
+const RecipeStep* RecipeBook::stepsOf(int id) const {
+    return steps.data() + recipes.at(static_cast<size_t>(id)).first;
+}
+
+unsigned RecipeBook::stepCount(int id) const {
+    return recipes.at(static_cast<size_t>(id)).count;
+}
+
+unsigned RecipeBook::stageCount(int id) const {
+    return recipes.at(static_cast<size_t>(id)).stages;
+}
+
+const char* RecipeBook::textOf(const RecipeStep& s) const {
+    return texts.data() + s.text;
+}
+
+void RecipeBook::printText(const RecipeStep& s, long long minutes, ostream& os) const {
+    const char* t = textOf(s);
+    if (s.split == RecipeStep::NO_SPLIT) {
+        os.write(t, s.textLen);
+    } else {
+        os.write(t, s.split);
+        os << minutes;
+        os.write(t + s.split, s.textLen - s.split);
+    }
+    os << '\n';
+}
+
+RecipeKitchen& RecipeBook::getKitchen() const {
+    return *kitchen;
+}
+
+FeasibilityIndex* RecipeBook::getFeasibility() const {
+    return feasibility;
+}
+
+void RecipeBook::setFeasibility(FeasibilityIndex* f) {
+    feasibility = f;
+}
+
+/* ===== RecipeDish ===== */
+
+RecipeDish::RecipeDish(const RecipeBook* b, int id, Cook* ck)
+    : Dish(b ? b->name(id) : "?"), book(b), recipe(id), chef(ck) {
+    if (!b) throw RecipeFormatException("Recipe dish needs a book");
+}
+
+void RecipeDish::cook() {
+    if (!chef) throw ToolNotAvailableException("Нет повара для блюда");
+    cookWith(chef);
+}
+
+void RecipeDish::cookWith(Cook* ck) {
+    if (book->stageCount(recipe)) ck->cookScheduled(*book, recipe);
+    else                          ck->cookRecipe(*book, recipe);
+}
+
+CookStatus RecipeDish::tryCookWith(Cook* ck) {
+    if (!book->stageCount(recipe)) return ck->tryCookRecipe(*book, recipe);
+    ScheduleReport report;
+    return ck->tryCookScheduled(*book, recipe, report);
+}
+
+bool RecipeDish::canCook() const {
+    const FeasibilityIndex* f = book->getFeasibility();
+    return !f || recipe >= f->size() || f->canCook(recipe);
+}
+
+int RecipeDish::getRecipe() const {
+    return recipe;
+}
+
+BatchResult RecipeDish::cookBatch(int portions) {
+    if (!chef) throw ToolNotAvailableException("Нет повара для блюда");
+    return chef->cookBatch(*book, recipe, portions);
+}
+
+ScheduleReport RecipeDish::cookScheduled() {
+    if (!chef) throw ToolNotAvailableException("Нет повара для блюда");
+    return chef->cookScheduled(*book, recipe);
+}
+
+/* ===== Cook (интерпретатор рецептов) ===== */
+
+void Cook::cookRecipe(const RecipeBook& book, int id) {
+    raise(book, tryCookRecipe(book, id));
+}
+
+CookStatus Cook::tryCookRecipe(const RecipeBook& book, int id) {
+    DishMetrics metrics(id);
+    LogScope scope(sink, static_cast<unsigned>(id), &clock);
+    LedgerDish account(id);
+    if (!logEvent(EventKind::DishStarted, 1.0)) {
+        cout << "\n=== Готовим блюдо: " << book.name(id) << " ===\n";
+    }
+
+    RecipeRun run(book, id, clock, 1);
+    const RecipeStep* s   = book.stepsOf(id);
+    const RecipeStep* end = s + book.stepCount(id);
+    try {
+        for (; s != end; ++s) {
+            if (!run.exec(s)) {
+                logEvent(EventKind::DishFailed);
+                return metrics.finish(run.status);
+            }
+        }
+    } catch (...) {
+        logEvent(EventKind::DishFailed);
+        throw;
+    }
+    logEvent(EventKind::DishDone);
+    return metrics.finish(CookStatus::success());
+}
+
+BatchResult Cook::cookBatch(const RecipeBook& book, int id, int portions) {
+    BatchResult res{0, 0, 0, {}};
+    raise(book, tryCookBatch(book, id, portions, res));
+    return res;
+}
+
+CookStatus Cook::tryCookBatch(const RecipeBook& book, int id, int portions, BatchResult& res) {
+    res = BatchResult{0, 0, 0, {}};
+    if (portions < 1) return CookStatus::success();
+    DishMetrics metrics(id);
+
+    const RecipeStep* steps = book.stepsOf(id);
+    const unsigned    count = book.stepCount(id);
+    RecipeKitchen&    k     = book.getKitchen();
+
+    // Сколько порций помещается в одну закладку: ограничивают только
+    // рабочие объёмы кастрюль (require pot <литры>).
+    int perPass = portions;
+    for (unsigned i = 0; i < count; ++i) {
+        const RecipeStep& s = steps[i];
+        if (s.op != RecipeOp::Require || s.value <= 0.0) continue;
+        if (k.toolKind(s.target) != ResourceKind::Pot) continue;
+        Pot* pot = static_cast<Pot*>(k.tool(s.target));
+        int fit = 0;
+        while (fit < perPass && pot->canBoil(s.value * (fit + 1))) ++fit;
+        perPass = fit;
+        if (perPass == 0) {
+            return metrics.finish(CookStatus{KitchenError::NotEnoughIngredient, ResourceKind::Pot, s.target,
+                                             static_cast<unsigned short>(i),
+                                             "Кастрюля слишком маленькая для партии"});
+        }
+    }
+
+    // Тело партии — от первого до последнего ожидания включительно.
+    unsigned firstWait = count;
+    unsigned lastWait  = count;
+    for (unsigned i = 0; i < count; ++i) {
+        if (steps[i].op == RecipeOp::Hold || steps[i].op == RecipeOp::Bake) {
+            if (firstWait == count) firstWait = i;
+            lastWait = i;
+        }
+    }
+
+    LogScope scope(sink, static_cast<unsigned>(id), &clock);
+    LedgerDish account(id);
+    if (!logEvent(EventKind::DishStarted, static_cast<double>(portions))) {
+        cout << "\n=== Готовим партию: " << book.name(id)
+             << ", порций: " << portions << " ===\n";
+    }
+
+    RecipeRun run(book, id, clock, portions);
+    long long startedAt = clock.now();
+    res.readySeconds.reserve(static_cast<size_t>(portions));
+
+    auto failed = [&]() {
+        res.portions     = static_cast<int>(res.readySeconds.size());
+        res.totalSeconds = clock.now() - startedAt;
+        logEvent(EventKind::DishFailed);
+        return metrics.finish(run.status);
+    };
+
+    for (unsigned i = 0; i < firstWait; ++i) {
+        if (!run.exec(steps + i)) return failed();
+    }
+
+    int passes = firstWait == count ? 1 : (portions + perPass - 1) / perPass;
+    for (int p = 0; p < passes; ++p) {
+        run.repeatPass = p > 0;
+        if (firstWait != count) {
+            for (unsigned i = firstWait; i <= lastWait; ++i) {
+                if (!run.exec(steps + i)) return failed();
+            }
+        }
+        int inPass = min(perPass, portions - p * perPass);
+        res.readySeconds.insert(res.readySeconds.end(), static_cast<size_t>(inPass),
+                                clock.now() - startedAt);
+        res.passes = p + 1;
+    }
+    run.repeatPass = false;
+
+    if (firstWait != count) {
+        for (unsigned i = lastWait + 1; i < count; ++i) {
+            if (!run.exec(steps + i)) return failed();
+        }
+    }
+
+    res.portions     = portions;
+    res.totalSeconds = clock.now() - startedAt;
+    logEvent(EventKind::DishDone, static_cast<double>(portions));
+    return metrics.finish(CookStatus::success());
+}
+
+ScheduleReport Cook::cookScheduled(const RecipeBook& book, int id) {
+    ScheduleReport res{0, 0, 0, {}};
+    raise(book, tryCookScheduled(book, id, res));
+    return res;
+}
+
+CookStatus Cook::tryCookScheduled(const RecipeBook& book, int id, ScheduleReport& res) {
+    RecipePlan plan(book, id);
+    res = ScheduleReport{plan.predictedMakespan(), plan.sequentialSeconds(), 0, {}};
+    res.stages.reserve(plan.stages().size());
+
+    DishMetrics metrics(id);
+    LogScope scope(sink, static_cast<unsigned>(id), &clock);
+    LedgerDish account(id);
+    if (!logEvent(EventKind::DishStarted, 1.0)) {
+        cout << "\n=== Готовим блюдо: " << book.name(id) << " ===\n";
+    }
+
+    RecipeRun run(book, id, clock, 1);
+    const RecipeStep* steps     = book.stepsOf(id);
+    const unsigned    count     = book.stepCount(id);
+    const long long   startedAt = clock.now();
+
+    auto failed = [&]() {
+        res.actualMakespan = clock.now() - startedAt;
+        logEvent(EventKind::DishFailed);
+        return metrics.finish(run.status);
+    };
+
+    try {
+        for (unsigned i = 0; i < plan.prologueSteps(); ++i) {
+            if (!run.exec(steps + i)) return failed();
+        }
+        if (!plan.stages().empty()) {
+            StageScheduler sched(run, plan, steps, startedAt, res.stages);
+            sched.launch();
+            clock.run();
+            if (sched.failed) return failed();
+        }
+        for (unsigned i = plan.epilogueStart(); i < count; ++i) {
+            if (!run.exec(steps + i)) return failed();
+        }
+    } catch (...) {
+        logEvent(EventKind::DishFailed);
+        throw;
+    }
+
+    res.actualMakespan = clock.now() - startedAt;
+    logEvent(EventKind::DishDone);
+    return metrics.finish(CookStatus::success());
+}
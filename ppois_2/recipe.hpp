@@ -0,0 +1,387 @@
+/**
+ * @file recipe.hpp
+ * @brief Табличные рецепты: программа шагов и её интерпретатор.
+ *
+ * Рецепт описывается не отдельным методом Cook::cookXxx, а короткой
+ * программой шагов (зарезервировать ингредиент, арендовать инструмент,
+ * разогреть, выдержать по таймеру, освободить). Программы всех рецептов
+ * лежат подряд в одном массиве RecipeStep, а Cook::cookRecipe() исполняет
+ * их одним switch по коду операции. Рецепты читаются из текста, поэтому
+ * новое блюдо в меню не требует перекомпиляции.
+ *
+ * Формат текста (по строке на шаг, '#' — комментарий):
+ * @code
+ * recipe Паста с соусом
+ *   lease pastaPot
+ *   lease stove
+ *   acquire
+ *   reserve pasta 100
+ *   take
+ *   hold pastaTimer 600
+ *   say | Прошло %m мин варки пасты...
+ * end
+ * @endcode
+ * Строка шага: <операция> [ресурс] [число] [число] [| текст]. В тексте
+ * %m заменяется на минуты последнего ожидания, а %i внутри блока
+ * repeat N … done — на номер повтора (блок разворачивается при загрузке).
+ * Строки stage <имя> [after <этап>…] и join делят рецепт на этапы,
+ * которые могут идти одновременно (см. schedule.hpp). Таймеры шагов hold
+ * арендуются вместе с оборудованием на шаге acquire, а если его нет —
+ * перед первым hold.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+
+#include <deque>
+#include <istream>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @class RecipeFormatException
+ * @brief Исключение: ошибка в тексте рецепта.
+ */
+class RecipeFormatException : public runtime_error {
+public:
+    /**
+     * @brief Создаёт исключение с текстом ошибки.
+     * @param msg Сообщение об ошибке.
+     */
+    RecipeFormatException(const char* msg) : runtime_error(msg) {}
+};
+
+/**
+ * @enum RecipeOp
+ * @brief Код операции шага рецепта.
+ */
+enum class RecipeOp : unsigned char {
+    Say,         ///< Вывести текст.
+    Warn,        ///< Вывести текст, если инструмент непригоден.
+    Require,     ///< Проверить инструмент (value — объём для кастрюли).
+    Lease,       ///< Добавить оборудование в аренду.
+    Acquire,     ///< Получить аренду целиком.
+    Reserve,     ///< Добавить ингредиент (value граммов) в резерв.
+    Take,        ///< Списать резерв целиком.
+    Commit,      ///< Подтвердить резерв.
+    PlugIn,      ///< Включить миксер в сеть.
+    Mix,         ///< Смешать миксером.
+    Mash,        ///< Размять толкушкой.
+    Use,         ///< Использовать инструмент (useTool()).
+    BurnerOn,    ///< Включить конфорку.
+    BurnerOff,   ///< Выключить конфорку.
+    HeatPan,     ///< Разогреть сковороду.
+    CoolPan,     ///< Остудить сковороду.
+    StartBoil,   ///< Поставить кастрюлю на огонь.
+    StopBoil,    ///< Снять кастрюлю с огня.
+    Preheat,     ///< Закрыть дверцу, разогреть до value и завести таймер на arg минут.
+    Bake,        ///< Ждать выключения духовки по таймеру.
+    Hold,        ///< Завести таймер на arg секунд и ждать его.
+    After,       ///< Запланировать текст через arg секунд.
+    Overcooked,  ///< Ошибка, если последнее ожидание дольше arg минут.
+    Undercooked, ///< Ошибка, если последнее ожидание короче arg минут.
+    Stage,       ///< Начало этапа target; arg — маска этапов after, текст — название.
+    Join         ///< Конец этапов: дальше шаги идут после всех этапов.
+};
+
+/**
+ * @brief Ключевое слово операции в тексте рецепта.
+ * @param op Операция.
+ * @return Слово ("hold", "stage", …).
+ */
+const char* recipeOpName(RecipeOp op);
+
+/**
+ * @struct RecipeStep
+ * @brief Один шаг программы рецепта (24 байта, без указателей).
+ */
+struct RecipeStep {
+    RecipeOp       op;      ///< Операция.
+    ResourceKind   kind;    ///< Тип ресурса target.
+    unsigned short target;  ///< Индекс ресурса в RecipeKitchen.
+    int            arg;     ///< Целый параметр (секунды, минуты).
+    double         value;   ///< Вещественный параметр (граммы, градусы, литры).
+    unsigned       text;    ///< Смещение текста в пуле книги.
+    unsigned short textLen; ///< Длина текста.
+    unsigned short split;   ///< Позиция вставки минут (%m) или NO_SPLIT.
+
+    static const unsigned short NO_SPLIT = 0xFFFF; ///< В тексте нет %m.
+};
+
+/**
+ * @class RecipeKitchen
+ * @brief Справочник ресурсов кухни, доступных рецептам по имени.
+ *
+ * Имена разрешаются в индексы один раз, при загрузке рецептов; во время
+ * приготовления интерпретатор обращается к ресурсам по индексу.
+ */
+class RecipeKitchen {
+private:
+    /**
+     * @struct Entry
+     * @brief Запись справочника.
+     */
+    struct Entry {
+        ResourceKind   kind;  ///< Тип ресурса.
+        unsigned short index; ///< Индекс в массиве своего типа.
+    };
+
+    unordered_map<string, Entry> byKey;       ///< Ресурсы по имени.
+    vector<Ingredient*>          ingredients; ///< Ингредиенты.
+    vector<KitchenTool*>         tools;       ///< Инструменты.
+    vector<ResourceKind>         toolKinds;   ///< Тип каждого инструмента.
+    vector<Oven*>                ovens;       ///< Духовки.
+    vector<Stove*>               stoves;      ///< Плиты.
+    vector<Timer*>               timers;      ///< Таймеры.
+
+    /// Регистрирует инструмент указанного типа.
+    void addTool(const char* key, KitchenTool* t, ResourceKind kind);
+
+    /// Регистрирует имя ресурса.
+    void addKey(const char* key, ResourceKind kind, size_t index);
+
+public:
+    void add(const char* key, Ingredient* i);   ///< Регистрирует ингредиент.
+    void add(const char* key, KitchenTool* t);  ///< Регистрирует инструмент.
+    void add(const char* key, Knife* k);        ///< Регистрирует нож.
+    void add(const char* key, CuttingBoard* b); ///< Регистрирует доску.
+    void add(const char* key, Pan* p);          ///< Регистрирует сковороду.
+    void add(const char* key, Pot* p);          ///< Регистрирует кастрюлю.
+    void add(const char* key, Mixer* m);        ///< Регистрирует миксер.
+    void add(const char* key, PotatoMasher* m); ///< Регистрирует толкушку.
+    void add(const char* key, Oven* o);         ///< Регистрирует духовку.
+    void add(const char* key, Stove* s);        ///< Регистрирует плиту.
+    void add(const char* key, Timer* t);        ///< Регистрирует таймер.
+
+    /**
+     * @brief Забывает все ресурсы (книги, привязанные к кухне, становятся недействительными).
+     */
+    void clear();
+
+    /**
+     * @brief Ищет ресурс по имени.
+     * @param key Имя ресурса.
+     * @param kind Куда записать тип.
+     * @param index Куда записать индекс.
+     * @return false, если ресурс не зарегистрирован.
+     */
+    bool find(const string& key, ResourceKind& kind, unsigned short& index) const;
+
+    Ingredient*  ingredient(unsigned short i) const { return ingredients[i]; } ///< Ингредиент по индексу.
+    KitchenTool* tool(unsigned short i) const { return tools[i]; }             ///< Инструмент по индексу.
+    ResourceKind toolKind(unsigned short i) const { return toolKinds[i]; }     ///< Тип инструмента.
+    Oven*        oven(unsigned short i) const { return ovens[i]; }             ///< Духовка по индексу.
+    Stove*       stove(unsigned short i) const { return stoves[i]; }           ///< Плита по индексу.
+    Timer*       timer(unsigned short i) const { return timers[i]; }           ///< Таймер по индексу.
+
+    size_t ingredientCount() const { return ingredients.size(); } ///< Число ингредиентов.
+    size_t toolCount() const { return tools.size(); }   ///< Число инструментов.
+    size_t ovenCount() const { return ovens.size(); }   ///< Число духовок.
+    size_t stoveCount() const { return stoves.size(); } ///< Число плит.
+};
+
+class FeasibilityIndex; ///< Индекс выполнимости рецептов (см. feasibility.hpp)
+
+/**
+ * @class RecipeBook
+ * @brief Набор рецептов, скомпилированных в общий массив шагов.
+ *
+ * Книга привязана к одной кухне: имена ресурсов в тексте разрешаются
+ * в индексы её справочника.
+ */
+class RecipeBook {
+private:
+    /**
+     * @struct Info
+     * @brief Место рецепта в общем массиве шагов.
+     */
+    struct Info {
+        const char* name;  ///< Название блюда.
+        unsigned    first;  ///< Индекс первого шага.
+        unsigned    count;  ///< Число шагов.
+        unsigned    stages; ///< Число этапов (stage).
+    };
+
+    RecipeKitchen*     kitchen; ///< Кухня, к которой привязаны шаги.
+    vector<RecipeStep> steps;   ///< Шаги всех рецептов подряд.
+    string             texts;   ///< Пул текстов шагов.
+    deque<string>      names;   ///< Названия блюд (адреса стабильны).
+    vector<Info>       recipes; ///< Рецепты.
+    FeasibilityIndex*  feasibility; ///< Индекс выполнимости или nullptr.
+
+public:
+    /**
+     * @brief Создаёт пустую книгу для кухни.
+     * @param k Справочник ресурсов кухни.
+     */
+    explicit RecipeBook(RecipeKitchen* k);
+
+    /**
+     * @brief Загружает рецепты из потока.
+     * @param in Текст рецептов.
+     * @return Сколько рецептов добавлено.
+     * @throw RecipeFormatException при ошибке в тексте (книга не меняется).
+     */
+    int load(istream& in);
+
+    /**
+     * @brief Загружает рецепты из строки.
+     * @param text Текст рецептов.
+     * @return Сколько рецептов добавлено.
+     * @throw RecipeFormatException при ошибке в тексте (книга не меняется).
+     */
+    int loadString(const char* text);
+
+    /**
+     * @brief Удаляет все рецепты (блюда RecipeDish этой книги становятся недействительными).
+     */
+    void clear();
+
+    /**
+     * @brief Число рецептов.
+     * @return Размер книги.
+     */
+    int size() const;
+
+    /**
+     * @brief Ищет рецепт по названию.
+     * @param name Название блюда.
+     * @return Номер рецепта или -1.
+     */
+    int find(const string& name) const;
+
+    /**
+     * @brief Название блюда.
+     * @param id Номер рецепта.
+     * @return Строка с названием.
+     */
+    const char* name(int id) const;
+
+    /**
+     * @brief Первый шаг рецепта.
+     * @param id Номер рецепта.
+     * @return Указатель на непрерывный массив шагов рецепта.
+     */
+    const RecipeStep* stepsOf(int id) const;
+
+    /**
+     * @brief Число шагов рецепта.
+     * @param id Номер рецепта.
+     * @return Длина программы.
+     */
+    unsigned stepCount(int id) const;
+
+    /**
+     * @brief Число этапов рецепта.
+     * @param id Номер рецепта.
+     * @return 0 для рецепта без stage.
+     */
+    unsigned stageCount(int id) const;
+
+    /**
+     * @brief Текст шага.
+     * @param s Шаг.
+     * @return Указатель на начало текста (длина — s.textLen).
+     */
+    const char* textOf(const RecipeStep& s) const;
+
+    /**
+     * @brief Печатает текст шага, подставляя минуты на место %m.
+     * @param s Шаг.
+     * @param minutes Минуты последнего ожидания.
+     * @param os Поток вывода.
+     */
+    void printText(const RecipeStep& s, long long minutes, ostream& os) const;
+
+    /**
+     * @brief Кухня, к которой привязана книга.
+     * @return Справочник ресурсов.
+     */
+    RecipeKitchen& getKitchen() const;
+
+    /**
+     * @brief Индекс выполнимости, построенный по книге.
+     * @return Индекс или nullptr (clear() отвязывает индекс; рецептов, загруженных после его построения, он не знает).
+     */
+    FeasibilityIndex* getFeasibility() const;
+
+    /**
+     * @brief Привязывает индекс выполнимости (вызывает FeasibilityIndex).
+     * @param f Индекс или nullptr.
+     */
+    void setFeasibility(FeasibilityIndex* f);
+};
+
+struct ScheduleReport; ///< Итог по плану этапов (см. schedule.hpp)
+
+/**
+ * @struct BatchResult
+ * @brief Итог приготовления партии порций (см. Cook::cookBatch()).
+ */
+struct BatchResult {
+    int               portions;     ///< Приготовлено порций.
+    int               passes;       ///< Число закладок (проходов тела рецепта).
+    long long         totalSeconds; ///< Симулированное время всей партии.
+    vector<long long> readySeconds; ///< Когда готова каждая порция (от начала партии).
+};
+
+/**
+ * @class RecipeDish
+ * @brief Блюдо, приготовление которого описано программой в RecipeBook.
+ *
+ * Рецепт с этапами готовится по плану (Cook::cookScheduled()), остальные —
+ * шаг за шагом.
+ */
+class RecipeDish : public Dish {
+private:
+    const RecipeBook* book;   ///< Книга рецептов.
+    int               recipe; ///< Номер рецепта в книге.
+    Cook*             chef;   ///< Повар.
+
+public:
+    /**
+     * @brief Конструктор блюда по рецепту.
+     * @param b Книга рецептов.
+     * @param id Номер рецепта.
+     * @param ck Повар.
+     */
+    RecipeDish(const RecipeBook* b, int id, Cook* ck);
+
+    /**
+     * @brief Просит повара исполнить рецепт.
+     * @throw ToolNotAvailableException если chef == nullptr.
+     */
+    void cook() override;
+    void cookWith(Cook* ck) override;
+    CookStatus tryCookWith(Cook* ck) override;
+
+    /**
+     * @brief Можно ли приготовить порцию прямо сейчас (по индексу выполнимости книги).
+     * @return true, если индекса нет или он не видит препятствий.
+     */
+    bool canCook() const override;
+
+    /**
+     * @brief Номер рецепта в книге.
+     * @return Номер, с которым блюдо создано.
+     */
+    int getRecipe() const;
+
+    /**
+     * @brief Готовит партию порций силами своего повара.
+     * @param portions Число порций.
+     * @return Итог партии.
+     * @throw ToolNotAvailableException если chef == nullptr.
+     */
+    BatchResult cookBatch(int portions);
+
+    /**
+     * @brief Готовит блюдо по плану этапов силами своего повара.
+     * @return Предсказанная и фактическая длительность.
+     * @throw ToolNotAvailableException если chef == nullptr.
+     */
+    ScheduleReport cookScheduled();
+};
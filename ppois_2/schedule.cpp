@@ -0,0 +1,112 @@
+/**
+ * @file schedule.cpp
+ * @brief Построение графа этапов рецепта и критического пути.
+ */
+
+#include "schedule.hpp"
+
+#include <algorithm>
+
+/* ===== RecipePlan ===== */
+
+long long RecipePlan::waitOf(const RecipeStep* steps, unsigned i) {
+    const RecipeStep& s = steps[i];
+    if (s.op == RecipeOp::Hold) return s.arg > 0 ? s.arg : 0;
+    if (s.op != RecipeOp::Bake) return 0;
+    // Выпечка длится столько, сколько задано последним разогревом этой духовки.
+    for (unsigned j = i; j > 0; --j) {
+        const RecipeStep& p = steps[j - 1];
+        if (p.op == RecipeOp::Preheat && p.target == s.target) return p.arg > 0 ? p.arg * 60LL : 0;
+    }
+    return 0;
+}
+
+RecipePlan::RecipePlan(const RecipeBook& book, int id)
+    : stageList(), priority(), prologueEnd(0), epilogueBegin(0),
+      prologueWait(0), epilogueWait(0), critical(0), total(0) {
+    const RecipeStep* steps = book.stepsOf(id);
+    const unsigned    count = book.stepCount(id);
+
+    prologueEnd   = count;
+    epilogueBegin = count;
+    for (unsigned i = 0; i < count; ++i) {
+        if (steps[i].op == RecipeOp::Stage) {
+            if (stageList.empty()) prologueEnd = i;
+            if (!stageList.empty()) stageList.back().count = i - stageList.back().first;
+            stageList.push_back(PlanStage{book.textOf(steps[i]), i + 1, 0,
+                                          static_cast<unsigned>(steps[i].arg), 0, 0, 0, false});
+        } else if (steps[i].op == RecipeOp::Join) {
+            epilogueBegin = i + 1;
+            if (!stageList.empty()) stageList.back().count = i - stageList.back().first;
+        }
+        total += waitOf(steps, i);
+    }
+    if (!stageList.empty() && epilogueBegin == count) {
+        stageList.back().count = count - stageList.back().first;
+    }
+
+    for (unsigned i = 0; i < prologueEnd; ++i) prologueWait += waitOf(steps, i);
+    for (unsigned i = epilogueBegin; i < count; ++i) epilogueWait += waitOf(steps, i);
+
+    // Зависимости ссылаются только на этапы выше, поэтому порядок описания —
+    // уже топологический: ранние старты считаются проходом вперёд, хвосты — назад.
+    for (PlanStage& st : stageList) {
+        for (unsigned j = 0; j < st.count; ++j) st.duration += waitOf(steps, st.first + j);
+    }
+    for (size_t i = 0; i < stageList.size(); ++i) {
+        PlanStage& st = stageList[i];
+        for (size_t d = 0; d < i; ++d) {
+            if (st.deps & (1u << d)) {
+                st.earliestStart = max(st.earliestStart, stageList[d].earliestStart + stageList[d].duration);
+            }
+        }
+        critical = max(critical, st.earliestStart + st.duration);
+    }
+    for (size_t i = stageList.size(); i > 0; --i) {
+        PlanStage& st = stageList[i - 1];
+        long long after = 0;
+        for (size_t n = i; n < stageList.size(); ++n) {
+            if (stageList[n].deps & (1u << (i - 1))) after = max(after, stageList[n].tail);
+        }
+        st.tail = st.duration + after;
+        st.critical = st.earliestStart + st.tail == critical;
+    }
+
+    priority.resize(stageList.size());
+    for (unsigned i = 0; i < priority.size(); ++i) priority[i] = i;
+    stable_sort(priority.begin(), priority.end(), [this](unsigned a, unsigned b) {
+        return stageList[a].tail > stageList[b].tail;
+    });
+}
+
+const vector<PlanStage>& RecipePlan::stages() const {
+    return stageList;
+}
+
+const vector<unsigned>& RecipePlan::launchOrder() const {
+    return priority;
+}
+
+unsigned RecipePlan::prologueSteps() const {
+    return prologueEnd;
+}
+
+unsigned RecipePlan::epilogueStart() const {
+    return epilogueBegin;
+}
+
+long long RecipePlan::prologueSeconds() const {
+    return prologueWait;
+}
+
+long long RecipePlan::criticalPath() const {
+    return critical;
+}
+
+long long RecipePlan::predictedMakespan() const {
+    return prologueWait + critical + epilogueWait;
+}
+
+long long RecipePlan::sequentialSeconds() const {
+    return total;
+}
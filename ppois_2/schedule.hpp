@@ -0,0 +1,172 @@
+/**
+ * @file schedule.hpp
+ * @brief Рецепт как граф этапов: критический путь и параллельное исполнение.
+ *
+ * Обычный рецепт исполняется строго по порядку: нарезали, сварили, сделали
+ * соус. Этапы (stage) позволяют описать зависимости явно: этап начинается,
+ * когда готовы этапы из его списка after, а независимые этапы на разном
+ * оборудовании идут одновременно — пока кастрюля доходит до кипения,
+ * сковорода уже греет соус.
+ * @code
+ * recipe Паста с соусом
+ *   lease pastaPot
+ *   lease pan
+ *   lease stove
+ *   lease stove
+ *   acquire
+ *   reserve pasta 100
+ *   take
+ *   stage pasta
+ *     burner_on stove
+ *     boil pastaPot
+ *     hold pastaTimer 600
+ *   stage sauce
+ *     burner_on stove
+ *     heat pan
+ *     hold sauceTimer 300
+ *   stage serve after pasta sauce
+ *     say | Подаём пасту с соусом
+ *   join
+ *   commit
+ * end
+ * @endcode
+ * Шаги до первого stage (пролог: аренда, резерв) и после join (эпилог)
+ * исполняются последовательно. В этапах нельзя арендовать оборудование и
+ * резервировать продукты — это делает пролог для всего рецепта сразу.
+ *
+ * RecipePlan разбирает программу рецепта на этапы, оценивает их
+ * длительность по ожиданиям (hold, bake) и находит критический путь.
+ * Cook::cookScheduled() исполняет этапы по плану и сравнивает
+ * предсказанную длительность с фактической.
+ */
+
+#pragma once
+
+#include "recipe.hpp"
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct PlanStage
+ * @brief Этап рецепта в плане.
+ */
+struct PlanStage {
+    const char* name;          ///< Название этапа.
+    unsigned    first;         ///< Первый шаг этапа (от начала рецепта).
+    unsigned    count;         ///< Число шагов этапа.
+    unsigned    deps;          ///< Маска этапов, которые должны завершиться раньше.
+    long long   duration;      ///< Оценка длительности, с.
+    long long   earliestStart; ///< Самый ранний старт без учёта оборудования (от конца пролога).
+    long long   tail;          ///< Самый длинный путь от старта этапа до конца графа.
+    bool        critical;      ///< Этап лежит на критическом пути.
+};
+
+/**
+ * @struct StageTiming
+ * @brief Предсказанное и фактическое время этапа (от начала блюда).
+ */
+struct StageTiming {
+    const char* name;            ///< Название этапа.
+    long long   predictedStart;  ///< Предсказанный старт.
+    long long   predictedFinish; ///< Предсказанное завершение.
+    long long   start;           ///< Фактический старт.
+    long long   finish;          ///< Фактическое завершение.
+    bool        critical;        ///< На критическом пути.
+};
+
+/**
+ * @struct ScheduleReport
+ * @brief Итог приготовления блюда по плану (см. Cook::cookScheduled()).
+ */
+struct ScheduleReport {
+    long long           predictedMakespan; ///< Предсказание: пролог + критический путь + эпилог.
+    long long           sequentialSeconds; ///< Сколько заняло бы исполнение шагов по порядку.
+    long long           actualMakespan;    ///< Фактическое симулированное время блюда.
+    vector<StageTiming> stages;            ///< Этапы в порядке описания.
+};
+
+/**
+ * @class RecipePlan
+ * @brief Граф этапов одного рецепта с оценками длительности.
+ *
+ * Рецепт без этапов даёт план без этапов: всё исполняется как пролог.
+ */
+class RecipePlan {
+private:
+    vector<PlanStage> stageList;       ///< Этапы в порядке описания.
+    vector<unsigned>  priority;        ///< Номера этапов по убыванию tail (порядок запуска).
+    unsigned          prologueEnd;     ///< Первый шаг после пролога.
+    unsigned          epilogueBegin;   ///< Первый шаг эпилога.
+    long long         prologueWait;    ///< Ожидания пролога.
+    long long         epilogueWait;    ///< Ожидания эпилога.
+    long long         critical;        ///< Длина критического пути этапов.
+    long long         total;           ///< Сумма всех ожиданий рецепта.
+
+public:
+    static const unsigned MAX_STAGES = 32; ///< Наибольшее число этапов рецепта.
+
+    /**
+     * @brief Строит план рецепта.
+     * @param book Книга рецептов.
+     * @param id Номер рецепта.
+     */
+    RecipePlan(const RecipeBook& book, int id);
+
+    /**
+     * @brief Этапы рецепта.
+     * @return Этапы в порядке описания.
+     */
+    const vector<PlanStage>& stages() const;
+
+    /**
+     * @brief Порядок запуска готовых этапов (сначала самые длинные хвосты).
+     * @return Номера этапов.
+     */
+    const vector<unsigned>& launchOrder() const;
+
+    /**
+     * @brief Граница пролога.
+     * @return Номер первого шага после пролога.
+     */
+    unsigned prologueSteps() const;
+
+    /**
+     * @brief Начало эпилога.
+     * @return Номер первого шага эпилога (равен числу шагов, если эпилога нет).
+     */
+    unsigned epilogueStart() const;
+
+    /**
+     * @brief Ожидания пролога.
+     * @return Секунды до запуска этапов.
+     */
+    long long prologueSeconds() const;
+
+    /**
+     * @brief Длина критического пути этапов.
+     * @return Секунды.
+     */
+    long long criticalPath() const;
+
+    /**
+     * @brief Предсказанная длительность блюда при параллельных этапах.
+     * @return Секунды.
+     */
+    long long predictedMakespan() const;
+
+    /**
+     * @brief Длительность при исполнении шагов строго по порядку.
+     * @return Секунды.
+     */
+    long long sequentialSeconds() const;
+
+    /**
+     * @brief Оценка ожидания, которое вносит шаг (hold, bake).
+     * @param steps Шаги рецепта.
+     * @param i Номер шага.
+     * @return Секунды (0 для мгновенных шагов).
+     */
+    static long long waitOf(const RecipeStep* steps, unsigned i);
+};
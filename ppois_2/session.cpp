@@ -0,0 +1,233 @@
+/**
+ * @file session.cpp
+ * @brief Реализация записи и воспроизведения сеанса кухни.
+ */
+
+#include "session.hpp"
+#include "snapshot.hpp"
+#include "orders.hpp"
+#include "eventlog.hpp"
+#include "montecarlo.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+static_assert(sizeof(SessionHeader) == 48, "SessionHeader layout");
+static_assert(sizeof(SessionEvent) == 32, "SessionEvent layout");
+
+namespace {
+
+/// Исход заказа при воспроизведении, ждущий записанного итога.
+struct ReplayedOrder {
+    int          dish;   ///< Пункт меню.
+    int          worker; ///< Повар-работник.
+    KitchenError error;  ///< Код итога.
+    long long    at;     ///< Часы повара по окончании, с.
+};
+
+} // namespace
+
+/* ===== SessionRecorder ===== */
+
+SessionRecorder::SessionRecorder(const char* path, const char* kitchen, const char* recipes,
+                                 const KitchenWorld& world, const Menu& menu, int workerCount)
+    : file(nullptr), fileLock(), slots(), workers(workerCount < 1 ? 1 : workerCount),
+      numbers(), nextSeq(0), failed(false) {
+    vector<unsigned char> image = WorldSnapshot::capture(world);
+    SessionHeader h{SESSION_MAGIC, SESSION_VERSION, static_cast<uint32_t>(workers), 0,
+                    strlen(kitchen), strlen(recipes), image.size(), WorldSnapshot::fingerprint(world)};
+    file = fopen(path, "wb");
+    if (!file) {
+        throw StorageException("Не удалось создать журнал сеанса");
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, file) == 1
+           && fwrite(kitchen, 1, h.kitchenBytes, file) == h.kitchenBytes
+           && fwrite(recipes, 1, h.recipesBytes, file) == h.recipesBytes
+           && fwrite(image.data(), 1, image.size(), file) == image.size()
+           && fflush(file) == 0;
+    if (!ok) {
+        fclose(file);
+        throw StorageException("Не удалось записать заголовок журнала сеанса");
+    }
+    slots.reset(new Slot[static_cast<size_t>(workers) + 1]);
+    for (int i = 0; i <= workers; ++i) {
+        slots[static_cast<size_t>(i)].events.reserve(BLOCK_EVENTS);
+    }
+    for (size_t i = 1; i <= menu.size(); ++i) {
+        numbers[menu.dishAt(static_cast<int>(i))] = static_cast<int>(i);
+    }
+}
+
+SessionRecorder::~SessionRecorder() {
+    flush();
+    fclose(file);
+}
+
+void SessionRecorder::append(int slot, SessionEvent e) {
+    Slot& s = slots[static_cast<size_t>(slot)];
+    e.seq = nextSeq.fetch_add(1, memory_order_relaxed);
+    s.events.push_back(e);
+    if (s.events.size() >= BLOCK_EVENTS) writeSlot(s);
+}
+
+void SessionRecorder::writeSlot(Slot& s) {
+    if (s.events.empty()) return;
+    {
+        lock_guard<mutex> g(fileLock);
+        if (fwrite(s.events.data(), sizeof(SessionEvent), s.events.size(), file) != s.events.size()) {
+            failed.store(true, memory_order_relaxed);
+        }
+    }
+    s.events.clear();
+}
+
+void SessionRecorder::started(int worker, int order, const Dish* dish, long long at) {
+    auto it = numbers.find(dish);
+    append(worker, SessionEvent{0, at, order, it == numbers.end() ? 0 : it->second,
+                                static_cast<unsigned short>(worker), SessionEventKind::Start,
+                                KitchenError::None, 0});
+}
+
+void SessionRecorder::finished(int worker, const OrderResult& r, long long at) {
+    append(worker, SessionEvent{0, at, r.orderId, 0, static_cast<unsigned short>(worker),
+                                SessionEventKind::Finish, r.status.error, 0});
+}
+
+void SessionRecorder::seed(uint64_t seed, int replicas) {
+    append(workers, SessionEvent{0, static_cast<long long>(seed), replicas, 0, 0,
+                                 SessionEventKind::Seed, KitchenError::None, 0});
+}
+
+bool SessionRecorder::flush() {
+    for (int i = 0; i <= workers; ++i) writeSlot(slots[static_cast<size_t>(i)]);
+    lock_guard<mutex> g(fileLock);
+    if (fflush(file) != 0) failed.store(true, memory_order_relaxed);
+    return !failed.load(memory_order_relaxed);
+}
+
+uint64_t SessionRecorder::events() const {
+    return nextSeq.load(memory_order_relaxed);
+}
+
+/* ===== SessionLog ===== */
+
+SessionLog SessionLog::read(const char* path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw StorageException("Не удалось открыть журнал сеанса");
+    }
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    SessionLog log;
+    if (bytes.size() < sizeof(SessionHeader)) {
+        throw StorageException("Журнал сеанса короче заголовка");
+    }
+    memcpy(&log.header, bytes.data(), sizeof(SessionHeader));
+    const SessionHeader& h = log.header;
+    if (h.magic != SESSION_MAGIC || h.version != SESSION_VERSION) {
+        throw StorageException("Файл не является журналом сеанса этой версии");
+    }
+    size_t pos = sizeof(SessionHeader);
+    size_t rest = bytes.size() - pos;
+    if (h.workers < 1 || h.kitchenBytes > rest || h.recipesBytes > rest - h.kitchenBytes
+        || h.snapshotBytes > rest - h.kitchenBytes - h.recipesBytes) {
+        throw StorageException("Заголовок журнала сеанса повреждён");
+    }
+    log.kitchen.assign(bytes, pos, h.kitchenBytes);
+    pos += h.kitchenBytes;
+    log.recipes.assign(bytes, pos, h.recipesBytes);
+    pos += h.recipesBytes;
+    log.snapshot.assign(bytes.begin() + static_cast<ptrdiff_t>(pos),
+                        bytes.begin() + static_cast<ptrdiff_t>(pos + h.snapshotBytes));
+    pos += h.snapshotBytes;
+
+    size_t count = (bytes.size() - pos) / sizeof(SessionEvent);
+    log.truncated = (bytes.size() - pos) % sizeof(SessionEvent);
+    log.events.resize(count);
+    if (count > 0) memcpy(log.events.data(), bytes.data() + pos, count * sizeof(SessionEvent));
+    sort(log.events.begin(), log.events.end(),
+         [](const SessionEvent& a, const SessionEvent& b) { return a.seq < b.seq; });
+    return log;
+}
+
+/* ===== SessionReplay ===== */
+
+ReplayReport SessionReplay::run(const SessionLog& log, ostream* out) {
+    ReplayReport rep{0, 0, 0, 0, 0, 0, {}};
+    // Меню сеанса — блюда мира по порядку (как в main), пункт i — dishAt(i - 1).
+    KitchenWorld world;
+    world.build(log.kitchen.c_str(), log.recipes.c_str());
+    if (!log.snapshot.empty()) {
+        WorldSnapshot::apply(world, log.snapshot.data(), log.snapshot.size());
+    }
+    NullSink quiet;
+    vector<unique_ptr<Cook>> cooks;
+    for (uint32_t i = 0; i < log.header.workers; ++i) {
+        cooks.push_back(make_unique<Cook>("Повар"));
+        cooks.back()->setSink(&quiet);
+    }
+
+    unordered_map<int, ReplayedOrder> pending;
+    for (const SessionEvent& e : log.events) {
+        switch (e.kind) {
+        case SessionEventKind::Start: {
+            if (e.dish < 1 || e.dish > world.dishCount() || e.worker >= cooks.size()) {
+                throw StorageException("Событие журнала ссылается на несуществующий пункт или повара");
+            }
+            Cook& ck = *cooks[e.worker];
+            // Работник движка списывает просрочку перед заказом — по тем же часам.
+            if (ExpiryIndex* x = world.getExpiry()) x->expire(e.at);
+            CookStatus st = CookStatus::success();
+            try {
+                st = world.dishAt(e.dish - 1)->tryCookWith(&ck);
+            } catch (const exception&) {
+                st = CookStatus::failure(KitchenError::Storage);
+            }
+            pending[e.order] = ReplayedOrder{e.dish, e.worker, st.error, ck.getClock().now()};
+            ++rep.orders;
+            if (st.ok()) ++rep.done;
+            else         ++rep.failed;
+            break;
+        }
+        case SessionEventKind::Finish: {
+            auto it = pending.find(e.order);
+            if (it == pending.end()) break;
+            const ReplayedOrder& r = it->second;
+            if (r.error == e.error && r.at == e.at) {
+                ++rep.matched;
+            } else {
+                rep.mismatches.push_back(ReplayMismatch{e.order, r.dish, r.worker, e.error, r.error, e.at, r.at});
+            }
+            pending.erase(it);
+            break;
+        }
+        case SessionEventKind::Seed: {
+            WhatIfSimulator sim(WhatIfScenario::standard(log.kitchen.c_str(), log.recipes.c_str()));
+            WhatIfReport report = sim.run(e.order, static_cast<uint64_t>(e.at));
+            if (out) WhatIfReport::write(report, *out);
+            ++rep.simulations;
+            break;
+        }
+        }
+    }
+    rep.unfinished = static_cast<long long>(pending.size());
+    return rep;
+}
+
+void SessionReplay::writeReport(const ReplayReport& report, ostream& out) {
+    out << "Воспроизведено заказов: " << report.orders << ", совпало с записью: " << report.matched
+        << ", расхождений: " << report.mismatches.size() << "\n"
+        << "Приготовлено: " << report.done << ", не удалось: " << report.failed << "\n";
+    if (report.unfinished > 0) {
+        out << "Не закончено в записи: " << report.unfinished << "\n";
+    }
+    if (report.simulations > 0) {
+        out << "Повторено симуляций смен: " << report.simulations << "\n";
+    }
+    for (const ReplayMismatch& m : report.mismatches) {
+        out << "  заказ " << m.order << " (пункт " << m.dish << ", повар " << m.worker + 1
+            << "): записано " << kitchenErrorName(m.recorded) << " на " << m.recordedAt
+            << " с, воспроизведено " << kitchenErrorName(m.replayed) << " на " << m.replayedAt << " с\n";
+    }
+}
@@ -0,0 +1,265 @@
+/**
+ * @file session.hpp
+ * @brief Запись сеанса кухни и её детерминированное воспроизведение.
+ *
+ * Если сервис закончил смену передержанным мясом, сырым печеньем или
+ * нехваткой продуктов, по сводке этого не повторить: неизвестно, в каком
+ * порядке повара брали заказы и что было на складе. SessionRecorder пишет
+ * всё, от чего зависит исход, в двоичный журнал, который только
+ * дописывается:
+ * @code
+ * SessionHeader                 48 байт
+ * описание кухни                kitchenBytes байт (world.hpp)
+ * книга рецептов                recipesBytes байт (recipe.hpp)
+ * образ состояния               snapshotBytes байт (snapshot.hpp, тёплый старт)
+ * SessionEvent × N              по 32 байта
+ * @endcode
+ * События: повар начал заказ (пункт меню, момент по часам повара),
+ * закончил его (код итога, момент), запущена симуляция смен (зерно и
+ * число реплик). Часы поваров симулированные, поэтому событие часов
+ * полностью определяется порядком заказов: хранить каждое из них не нужно.
+ *
+ * Запись дешёвая и постоянная на событие: работник берёт атомарный
+ * порядковый номер и кладёт 32 байта в свой буфер; буфер уходит в файл
+ * целым блоком под мьютексом, когда заполнится, и в flush(). Блоки разных
+ * работников перемежаются, порядок восстанавливается по номерам. Оборванная
+ * при падении последняя запись при чтении отбрасывается.
+ *
+ * SessionReplay собирает кухню по описаниям из журнала, применяет образ и
+ * исполняет заказы на одном потоке в порядке начала, каждый — у «своего»
+ * повара, без вывода и без ожиданий. Как и работник движка
+ * (KitchenEngine::setExpiry()), перед каждым заказом оно списывает
+ * просрочку на момент начала из журнала, поэтому отдельных событий для
+ * сроков годности нет. Итог и часы каждого заказа сверяются
+ * с записанными. С одним работником воспроизведение точное; с несколькими оно
+ * точное, пока заказы, шедшие одновременно, не делили продукты и
+ * оборудование, а иначе первое расхождение указывает, где порядок
+ * повлиял на исход.
+ */
+
+#pragma once
+
+#include "world.hpp"
+#include "engine.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+static const uint32_t SESSION_MAGIC   = 0x5345534Bu; ///< "KSES".
+static const uint32_t SESSION_VERSION = 1;           ///< Версия формата журнала.
+
+/**
+ * @struct SessionHeader
+ * @brief Заголовок журнала сеанса.
+ */
+struct SessionHeader {
+    uint32_t magic;         ///< SESSION_MAGIC.
+    uint32_t version;       ///< SESSION_VERSION.
+    uint32_t workers;       ///< Поваров-работников в сеансе.
+    uint32_t reserved;      ///< Не используется (0).
+    uint64_t kitchenBytes;  ///< Длина описания кухни.
+    uint64_t recipesBytes;  ///< Длина книги рецептов.
+    uint64_t snapshotBytes; ///< Длина образа состояния (0 — кухня по описанию).
+    uint64_t fingerprint;   ///< Отпечаток кухни (WorldSnapshot::fingerprint()).
+};
+
+/**
+ * @enum SessionEventKind
+ * @brief Тип события сеанса.
+ */
+enum class SessionEventKind : unsigned char {
+    Start,  ///< Повар начал заказ.
+    Finish, ///< Повар закончил заказ.
+    Seed    ///< Запущена симуляция смен.
+};
+
+/**
+ * @struct SessionEvent
+ * @brief Событие журнала (32 байта).
+ */
+struct SessionEvent {
+    uint64_t         seq;      ///< Порядковый номер события в сеансе.
+    long long        at;       ///< Момент по часам повара, с (Seed — зерно).
+    int              order;    ///< Номер заказа (Seed — число реплик).
+    int              dish;     ///< Пункт меню (с 1).
+    unsigned short   worker;   ///< Повар-работник.
+    SessionEventKind kind;     ///< Тип события.
+    KitchenError     error;    ///< Код итога (Finish).
+    unsigned         reserved; ///< Не используется (0).
+};
+
+/**
+ * @class SessionRecorder
+ * @brief Запись сеанса в журнал (подключается к KitchenEngine::setRecorder()).
+ *
+ * started() и finished() вызывает только поток работника со своим
+ * номером, seed() — управляющий поток; flush() — когда работники не
+ * готовят (после KitchenEngine::waitAll()).
+ */
+class SessionRecorder {
+private:
+    /**
+     * @struct Slot
+     * @brief Буфер событий одного потока.
+     */
+    struct alignas(64) Slot {
+        vector<SessionEvent> events; ///< Ещё не записанные события.
+    };
+
+    FILE*                              file;     ///< Журнал.
+    mutex                              fileLock; ///< Защищает запись блоков в файл.
+    unique_ptr<Slot[]>                 slots;    ///< Буферы: работники и управляющий поток.
+    int                                workers;  ///< Число работников.
+    unordered_map<const Dish*, int>    numbers;  ///< Блюдо → пункт меню.
+    alignas(64) atomic<uint64_t>       nextSeq;  ///< Номер следующего события.
+    atomic<bool>                       failed;   ///< Запись в файл не удалась.
+
+    /// Кладёт событие в буфер потока и отправляет полный буфер в файл.
+    void append(int slot, SessionEvent e);
+
+    /// Записывает буфер в файл.
+    void writeSlot(Slot& s);
+
+public:
+    static const size_t BLOCK_EVENTS = 2048; ///< Событий в блоке записи (64 КиБ).
+
+    /**
+     * @brief Создаёт журнал и пишет в него заголовок и начальное состояние.
+     * @param path Путь к журналу (перезаписывается).
+     * @param kitchen Описание кухни, по которому собран мир.
+     * @param recipes Книга рецептов.
+     * @param world Мир в начальном состоянии сеанса.
+     * @param menu Меню сеанса (номера пунктов).
+     * @param workerCount Число поваров-работников.
+     * @throw StorageException если журнал не создаётся.
+     */
+    SessionRecorder(const char* path, const char* kitchen, const char* recipes,
+                    const KitchenWorld& world, const Menu& menu, int workerCount);
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    /// Дописывает буферы и закрывает журнал.
+    ~SessionRecorder();
+
+    /**
+     * @brief Повар начал заказ.
+     * @param worker Номер работника.
+     * @param order Номер заказа.
+     * @param dish Блюдо.
+     * @param at Часы повара, с.
+     */
+    void started(int worker, int order, const Dish* dish, long long at);
+
+    /**
+     * @brief Повар закончил заказ.
+     * @param worker Номер работника.
+     * @param r Итог заказа.
+     * @param at Часы повара, с.
+     */
+    void finished(int worker, const OrderResult& r, long long at);
+
+    /**
+     * @brief Запущена симуляция смен (montecarlo.hpp).
+     * @param seed Зерно.
+     * @param replicas Число реплик.
+     */
+    void seed(uint64_t seed, int replicas);
+
+    /**
+     * @brief Дописывает буферы всех потоков в файл.
+     * @return false, если запись в файл не удалась.
+     */
+    bool flush();
+
+    /**
+     * @brief Сколько событий записано.
+     * @return Событий с начала сеанса.
+     */
+    uint64_t events() const;
+};
+
+/**
+ * @struct SessionLog
+ * @brief Прочитанный журнал сеанса.
+ */
+struct SessionLog {
+    SessionHeader         header;    ///< Заголовок.
+    string                kitchen;   ///< Описание кухни.
+    string                recipes;   ///< Книга рецептов.
+    vector<unsigned char> snapshot;  ///< Образ начального состояния (может быть пуст).
+    vector<SessionEvent>  events;    ///< События по порядку.
+    size_t                truncated; ///< Отброшенный оборванный хвост, байт.
+
+    /**
+     * @brief Читает журнал.
+     * @param path Путь к журналу.
+     * @return Журнал с событиями, упорядоченными по номеру.
+     * @throw StorageException если файла нет или заголовок повреждён.
+     */
+    static SessionLog read(const char* path);
+};
+
+/**
+ * @struct ReplayMismatch
+ * @brief Заказ, исход которого при воспроизведении другой.
+ */
+struct ReplayMismatch {
+    int          order;    ///< Номер заказа.
+    int          dish;     ///< Пункт меню.
+    int          worker;   ///< Повар-работник.
+    KitchenError recorded; ///< Записанный код итога.
+    KitchenError replayed; ///< Код итога при воспроизведении.
+    long long    recordedAt; ///< Записанные часы повара по окончании, с.
+    long long    replayedAt; ///< Часы повара по окончании при воспроизведении, с.
+};
+
+/**
+ * @struct ReplayReport
+ * @brief Итог воспроизведения.
+ */
+struct ReplayReport {
+    long long              orders;      ///< Воспроизведено заказов.
+    long long              matched;     ///< Совпало с записью.
+    long long              done;        ///< Приготовлено при воспроизведении.
+    long long              failed;      ///< Не приготовлено при воспроизведении.
+    long long              unfinished;  ///< Начатых, но не законченных в записи.
+    long long              simulations; ///< Повторено симуляций смен.
+    vector<ReplayMismatch> mismatches;  ///< Расхождения по порядку начала.
+};
+
+/**
+ * @class SessionReplay
+ * @brief Воспроизведение журнала сеанса.
+ */
+class SessionReplay {
+public:
+    /**
+     * @brief Исполняет сеанс заново и сверяет исходы.
+     *
+     * Симуляции смен повторяются с записанным зерном, их сводка
+     * печатается в out (как у --simulate).
+     * @param log Журнал.
+     * @param out Поток для сводок симуляций или nullptr.
+     * @return Итог воспроизведения.
+     * @throw RecipeFormatException если описания в журнале не разбираются.
+     * @throw StorageException если события ссылаются на несуществующие пункты или поваров.
+     */
+    static ReplayReport run(const SessionLog& log, ostream* out = nullptr);
+
+    /**
+     * @brief Печатает итог: число заказов, совпадения и расхождения.
+     * @param report Итог.
+     * @param out Поток вывода.
+     */
+    static void writeReport(const ReplayReport& report, ostream& out);
+};
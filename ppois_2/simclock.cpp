@@ -0,0 +1,147 @@
+/**
+ * @file simclock.cpp
+ * @brief Реализация дискретно-событийных часов симуляции.
+ */
+
+#include "simclock.hpp"
+#include "kitchen.hpp"
+
+#include <algorithm>
+
+namespace {
+
+template <typename T, typename List>
+void attachTo(List& list, T* obj) {
+    if (!obj) return;
+    for (auto& a : list) {
+        if (a.obj == obj) {
+            a.refs++;
+            return;
+        }
+    }
+    list.push_back({obj, 1});
+}
+
+template <typename T, typename List>
+void detachFrom(List& list, T* obj) {
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i].obj == obj) {
+            if (--list[i].refs <= 0) {
+                list.erase(list.begin() + static_cast<long>(i));
+            }
+            return;
+        }
+    }
+}
+
+} // namespace
+
+SimClock::SimClock()
+    : current(0), nextSeq(0) {}
+
+long long SimClock::now() const {
+    return current;
+}
+
+void SimClock::advance(long long delta) {
+    if (delta <= 0) return;
+    current += delta;
+    for (auto& a : timers) {
+        a.obj->tick(static_cast<int>(delta));
+    }
+    for (auto& a : ovens) {
+        a.obj->tick(static_cast<int>(delta));
+    }
+}
+
+void SimClock::schedule(long long delay, Action action) {
+    scheduleAt(current + (delay > 0 ? delay : 0), std::move(action));
+}
+
+void SimClock::push(long long at, Action action, Timer* t, Oven* o) {
+    if (at < current) at = current;
+    events.push_back(Event{at, nextSeq++, std::move(action), t, o});
+    push_heap(events.begin(), events.end(), Later());
+}
+
+void SimClock::scheduleAt(long long at, Action action) {
+    push(at, std::move(action), nullptr, nullptr);
+}
+
+void SimClock::attach(Timer* t) {
+    attachTo(timers, t);
+}
+
+void SimClock::detach(Timer* t) {
+    detachFrom(timers, t);
+}
+
+void SimClock::attach(Oven* o) {
+    attachTo(ovens, o);
+}
+
+void SimClock::detach(Oven* o) {
+    detachFrom(ovens, o);
+}
+
+void SimClock::onTimerFinished(Timer* t, Action action) {
+    if (!t) {
+        throw TimerNotSetException("Timer is not set for clock event");
+    }
+    // Таймер записан в самом событии: действие не оборачивается, и пустое
+    // действие не выделяет памяти.
+    attach(t);
+    int left = t->remaining();
+    push(current + (left > 0 ? left : 0), std::move(action), t, nullptr);
+}
+
+void SimClock::onOvenOff(Oven* o, Action action) {
+    if (!o) {
+        throw TimerNotSetException("Oven is not set for clock event");
+    }
+    int left = o->secondsUntilOff();
+    if (left < 0) {
+        throw TimerNotSetException("Oven baking timer is not running");
+    }
+    attach(o);
+    push(current + (left > 0 ? left : 0), std::move(action), nullptr, o);
+}
+
+void SimClock::onOvenTemperature(Oven* o, double temp, Action action) {
+    if (!o) {
+        throw InvalidTemperatureException("Oven is not set for clock event");
+    }
+    int left = o->secondsUntilTemperature(temp);
+    if (left < 0) {
+        throw InvalidTemperatureException("Oven never reaches requested temperature");
+    }
+    attach(o);
+    push(current + (left > 0 ? left : 0), std::move(action), nullptr, o);
+}
+
+bool SimClock::step() {
+    if (events.empty()) return false;
+    pop_heap(events.begin(), events.end(), Later());
+    Event ev = std::move(events.back());
+    events.pop_back();
+    advance(ev.at - current);
+    if (ev.timer) detach(ev.timer);
+    if (ev.oven) detach(ev.oven);
+    if (ev.action) ev.action();
+    return true;
+}
+
+void SimClock::run() {
+    while (step()) {}
+}
+
+void SimClock::runUntil(long long at) {
+    while (!events.empty() && events.front().at <= at) {
+        step();
+    }
+    advance(at - current);
+}
+
+size_t SimClock::pending() const {
+    return events.size();
+}
@@ -0,0 +1,186 @@
+/**
+ * @file simclock.hpp
+ * @brief Дискретно-событийные часы симуляции кухни.
+ *
+ * Вместо пошагового цикла tick() с фиксированным шагом время продвигается
+ * сразу к ближайшему событию из очереди с приоритетом. Таймеры и духовки
+ * регистрируют в часах моменты завершения и достижения температуры, поэтому
+ * стоимость ожидания зависит от числа событий, а не от длительности варки.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+class Timer;
+class Oven;
+
+/**
+ * @class SimClock
+ * @brief Планировщик событий симуляции (очередь пробуждений по времени).
+ *
+ * Хранит текущее симулированное время в секундах и очередь событий.
+ * Присоединённые таймеры и духовки продвигаются одним вызовом tick()
+ * на всю разницу между соседними событиями.
+ */
+class SimClock {
+public:
+    /// Действие, выполняемое при наступлении события.
+    using Action = function<void()>;
+
+private:
+    /**
+     * @struct Event
+     * @brief Запланированное событие: момент времени и действие.
+     */
+    struct Event {
+        long long          at;     ///< Момент наступления (секунды симуляции).
+        unsigned long long seq;    ///< Порядковый номер для стабильного порядка при равном времени.
+        Action             action; ///< Действие (может быть пустым).
+        Timer*             timer;  ///< Таймер, который отсоединяется при наступлении, или nullptr.
+        Oven*              oven;   ///< Духовка, которая отсоединяется при наступлении, или nullptr.
+    };
+
+    /// Сравнение для min-кучи: раньше по времени, при равенстве — по порядку постановки.
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            if (a.at != b.at) return a.at > b.at;
+            return a.seq > b.seq;
+        }
+    };
+
+    vector<Event> events; ///< Очередь событий: min-куча по Later (ёмкость переиспользуется).
+
+    /**
+     * @struct Attached
+     * @brief Присоединённый объект со счётчиком регистраций.
+     */
+    template <typename T>
+    struct Attached {
+        T*  obj;  ///< Продвигаемый объект.
+        int refs; ///< Сколько регистраций удерживают объект в часах.
+    };
+
+    vector<Attached<Timer>> timers; ///< Таймеры, которые продвигают часы.
+    vector<Attached<Oven>>  ovens;  ///< Духовки, которые продвигают часы.
+    long long          current;   ///< Текущее время симуляции.
+    unsigned long long nextSeq;   ///< Следующий порядковый номер события.
+
+    /**
+     * @brief Продвигает время и все присоединённые объекты на delta секунд.
+     * @param delta Приращение (>0).
+     */
+    void advance(long long delta);
+
+    /// Ставит событие в очередь.
+    void push(long long at, Action action, Timer* t, Oven* o);
+
+public:
+    /**
+     * @brief Создаёт часы с нулевым временем и пустой очередью.
+     */
+    SimClock();
+
+    /**
+     * @brief Текущее время симуляции.
+     * @return Секунды с момента создания часов.
+     */
+    long long now() const;
+
+    /**
+     * @brief Планирует событие через delay секунд от текущего момента.
+     * @param delay Задержка в секундах (отрицательная трактуется как 0).
+     * @param action Действие при наступлении события.
+     */
+    void schedule(long long delay, Action action);
+
+    /**
+     * @brief Планирует событие на абсолютный момент времени.
+     * @param at Момент времени (если в прошлом — событие наступит сразу).
+     * @param action Действие при наступлении события.
+     */
+    void scheduleAt(long long at, Action action);
+
+    /**
+     * @brief Присоединяет таймер: часы будут продвигать его при движении времени.
+     *
+     * Повторное присоединение увеличивает счётчик регистраций, таймер
+     * отсоединяется после такого же числа вызовов detach().
+     * @param t Таймер (nullptr игнорируется).
+     */
+    void attach(Timer* t);
+
+    /**
+     * @brief Снимает одну регистрацию таймера.
+     * @param t Таймер.
+     */
+    void detach(Timer* t);
+
+    /**
+     * @brief Присоединяет духовку: часы будут продвигать её при движении времени.
+     * @param o Духовка (nullptr игнорируется).
+     */
+    void attach(Oven* o);
+
+    /**
+     * @brief Снимает одну регистрацию духовки.
+     * @param o Духовка.
+     */
+    void detach(Oven* o);
+
+    /**
+     * @brief Регистрирует момент завершения запущенного таймера.
+     *
+     * Таймер присоединяется к часам и отсоединяется в момент завершения,
+     * после чего вызывается action.
+     * @param t Таймер (должен быть запущен через Timer::start()).
+     * @param action Действие после завершения таймера.
+     * @throw TimerNotSetException если t == nullptr.
+     */
+    void onTimerFinished(Timer* t, Action action);
+
+    /**
+     * @brief Регистрирует момент автоматического выключения духовки по таймеру.
+     * @param o Духовка (включённая, с установленным таймером выпечки).
+     * @param action Действие после выключения.
+     * @throw TimerNotSetException если духовка выключена или таймер не задан.
+     */
+    void onOvenOff(Oven* o, Action action);
+
+    /**
+     * @brief Регистрирует момент достижения духовкой температуры temp.
+     *
+     * Духовка остаётся присоединённой до наступления события.
+     * @param o Духовка (включённая).
+     * @param temp Пороговая температура.
+     * @param action Действие при достижении порога.
+     * @throw InvalidTemperatureException если порог недостижим по текущему профилю.
+     */
+    void onOvenTemperature(Oven* o, double temp, Action action);
+
+    /**
+     * @brief Обрабатывает ближайшее событие.
+     * @return false, если очередь пуста.
+     */
+    bool step();
+
+    /**
+     * @brief Обрабатывает события, пока очередь не опустеет.
+     */
+    void run();
+
+    /**
+     * @brief Обрабатывает все события до момента at и переводит часы на at.
+     * @param at Абсолютный момент времени.
+     */
+    void runUntil(long long at);
+
+    /**
+     * @brief Количество ожидающих событий.
+     * @return Размер очереди.
+     */
+    size_t pending() const;
+};
@@ -0,0 +1,81 @@
+/**
+ * @file smallvec.hpp
+ * @brief Вектор с встроенным буфером: первые N элементов — без выделения памяти.
+ *
+ * Аренда оборудования и резерв продуктов создаются на каждый заказ, а
+ * набор в них почти всегда маленький: кастрюля и конфорка, два-три
+ * ингредиента. vector под такой набор — это выделение памяти на каждом
+ * push_back() первых элементов и освобождение в деструкторе, то есть
+ * несколько обращений к распределителю на каждое блюдо. SmallVector
+ * хранит первые N элементов в самом объекте и переходит в кучу, только
+ * если набор больше.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+using namespace std;
+
+/**
+ * @class SmallVector
+ * @brief Последовательность тривиально копируемых элементов со встроенным буфером.
+ *
+ * @tparam T Тип элемента (тривиально копируемый: указатели, записи из чисел).
+ * @tparam N Сколько элементов помещается без выделения памяти.
+ */
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(is_trivially_copyable<T>::value, "SmallVector holds trivially copyable values");
+    static_assert(N > 0, "SmallVector needs inline capacity");
+
+private:
+    T               inlineItems[N]; ///< Встроенный буфер (читаются только первые count).
+    unique_ptr<T[]> heap;           ///< Буфер в куче, если элементов больше N.
+    T*              items;          ///< Текущий буфер.
+    size_t          count;          ///< Число элементов.
+    size_t          room;           ///< Ёмкость текущего буфера.
+
+    /// Переносит элементы в буфер вдвое больше.
+    void grow() {
+        unique_ptr<T[]> bigger(new T[room * 2]);
+        memcpy(static_cast<void*>(bigger.get()), items, count * sizeof(T));
+        heap  = std::move(bigger);
+        items = heap.get();
+        room *= 2;
+    }
+
+public:
+    SmallVector() : heap(), items(inlineItems), count(0), room(N) {}
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    /// Добавляет элемент в конец.
+    void push_back(const T& v) {
+        if (count == room) grow();
+        items[count++] = v;
+    }
+
+    /// Удаляет все элементы (ёмкость сохраняется).
+    void clear() {
+        count = 0;
+    }
+
+    size_t size() const { return count; }                  ///< Число элементов.
+    bool empty() const { return count == 0; }              ///< Пуст ли.
+    size_t capacity() const { return room; }               ///< Ёмкость без нового выделения.
+    bool onHeap() const { return items != inlineItems; }   ///< Элементы вынесены в кучу.
+
+    T& operator[](size_t i) { return items[i]; }             ///< Элемент по номеру.
+    const T& operator[](size_t i) const { return items[i]; } ///< Элемент по номеру.
+    T& back() { return items[count - 1]; }                   ///< Последний элемент.
+
+    T* begin() { return items; }                     ///< Начало.
+    T* end() { return items + count; }               ///< Конец.
+    const T* begin() const { return items; }         ///< Начало.
+    const T* end() const { return items + count; }   ///< Конец.
+};
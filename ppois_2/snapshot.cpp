@@ -0,0 +1,598 @@
+/**
+ * @file snapshot.cpp
+ * @brief Реализация снимков состояния кухни и фоновых контрольных точек.
+ */
+
+#include "snapshot.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'K', 'S', 'N', 'A', 'P', 0, 0, 0};
+
+const size_t RECORD_BYTES[SNAPSHOT_SECTIONS] = {
+    sizeof(IngredientRecord), sizeof(ToolRecord), sizeof(OvenRecord), sizeof(StoveRecord), sizeof(TimerRecord),
+    sizeof(ExpiryRecord), sizeof(LotRecord)
+};
+
+static_assert(sizeof(SnapshotHeader) == 72, "Snapshot header layout changed");
+static_assert(sizeof(LotRecord) == 24, "Lot record layout changed");
+static_assert(sizeof(OvenRecord) <= sizeof(DeltaRecord::data), "Delta record is too small");
+static_assert(sizeof(DeltaFrame) % 8 == 0 && sizeof(DeltaRecord) % 8 == 0, "Delta layout must stay aligned");
+
+/// FNV-1a, 64 бита.
+uint64_t fnv(const void* data, size_t n, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/// Раздел снимка для типа объекта или -1, если состояния у него нет.
+int sectionOf(WorldEntity kind) {
+    switch (kind) {
+    case WorldEntity::Ingredient: return static_cast<int>(SnapshotSection::Ingredient);
+    case WorldEntity::Knife:
+    case WorldEntity::Board:
+    case WorldEntity::Pan:
+    case WorldEntity::Pot:
+    case WorldEntity::Mixer:
+    case WorldEntity::Masher:     return static_cast<int>(SnapshotSection::Tool);
+    case WorldEntity::Oven:       return static_cast<int>(SnapshotSection::Oven);
+    case WorldEntity::Stove:      return static_cast<int>(SnapshotSection::Stove);
+    case WorldEntity::Timer:      return static_cast<int>(SnapshotSection::Timer);
+    default:                      return -1;
+    }
+}
+
+/**
+ * @struct Layout
+ * @brief Объекты мира по разделам снимка.
+ */
+struct Layout {
+    vector<WorldHandle> items[SNAPSHOT_SECTIONS]; ///< Дескрипторы по разделам.
+    uint64_t            fingerprint;              ///< Отпечаток.
+
+    explicit Layout(const KitchenWorld& w) : items(), fingerprint(14695981039346656037ULL) {
+        for (size_t i = 0; i < w.size(); ++i) {
+            WorldHandle h = w.handleAt(i);
+            WorldEntity kind = w.kindOf(h);
+            int sec = sectionOf(kind);
+            if (sec < 0) continue;
+            items[sec].push_back(h);
+            const char* key = w.keyOf(h);
+            fingerprint = fnv(&kind, sizeof kind, fingerprint);
+            fingerprint = fnv(key, strlen(key) + 1, fingerprint);
+        }
+    }
+
+    /// Размер образа без разделов Expiry и Lot.
+    size_t bytes() const {
+        size_t n = sizeof(SnapshotHeader);
+        for (unsigned s = 0; s < SNAPSHOT_SECTIONS; ++s) n += items[s].size() * RECORD_BYTES[s];
+        return n;
+    }
+};
+
+/// Смещения разделов в образе по счётчикам заголовка.
+void sectionOffsets(const SnapshotHeader& h, size_t* at) {
+    size_t off = sizeof(SnapshotHeader);
+    for (unsigned s = 0; s < SNAPSHOT_SECTIONS; ++s) {
+        at[s] = off;
+        off += static_cast<size_t>(h.counts[s]) * RECORD_BYTES[s];
+    }
+}
+
+/// Проверяет заголовок образа; при check — и контрольную сумму записей.
+SnapshotHeader readHeader(const void* data, size_t size, bool check) {
+    SnapshotHeader h;
+    if (!data || size < sizeof h) {
+        throw StorageException("Kitchen snapshot is truncated");
+    }
+    memcpy(&h, data, sizeof h);
+    if (memcmp(h.magic, MAGIC, sizeof MAGIC) != 0 || h.headerBytes != sizeof h) {
+        throw StorageException("Not a kitchen snapshot");
+    }
+    if (h.version != SNAPSHOT_VERSION) {
+        throw StorageException("Unsupported kitchen snapshot version");
+    }
+    size_t at[SNAPSHOT_SECTIONS];
+    sectionOffsets(h, at);
+    size_t end = at[SNAPSHOT_SECTIONS - 1]
+                 + static_cast<size_t>(h.counts[SNAPSHOT_SECTIONS - 1]) * RECORD_BYTES[SNAPSHOT_SECTIONS - 1];
+    if (end != size) {
+        throw StorageException("Kitchen snapshot is truncated");
+    }
+    if (check && fnv(static_cast<const unsigned char*>(data) + sizeof h, size - sizeof h) != h.checksum) {
+        throw StorageException("Kitchen snapshot is corrupted");
+    }
+    return h;
+}
+
+} // namespace
+
+/* ===== WorldSnapshot ===== */
+
+uint64_t WorldSnapshot::fingerprint(const KitchenWorld& w) {
+    return Layout(w).fingerprint;
+}
+
+vector<unsigned char> WorldSnapshot::capture(const KitchenWorld& w, uint64_t sequence) {
+    Layout lay(w);
+    const ExpiryIndex* index = w.getExpiry();
+    vector<LotRecord> lots;
+    if (index) {
+        const vector<WorldHandle>& ings = lay.items[static_cast<unsigned>(SnapshotSection::Ingredient)];
+        for (uint32_t i = 0; i < ings.size(); ++i) {
+            const Ingredient* ing = w.ingredient(ings[i]);
+            if (!index->tracks(*ing)) continue;
+            for (const StockLot& l : index->lots(*ing)) lots.push_back(LotRecord{i, 0, l.mg, l.expiresAt});
+        }
+    }
+
+    SnapshotHeader h{};
+    memcpy(h.magic, MAGIC, sizeof MAGIC);
+    h.version     = SNAPSHOT_VERSION;
+    h.headerBytes = sizeof h;
+    h.fingerprint = lay.fingerprint;
+    h.sequence    = sequence;
+    for (unsigned s = 0; s < SNAPSHOT_SECTIONS; ++s) h.counts[s] = static_cast<uint32_t>(lay.items[s].size());
+    h.counts[static_cast<unsigned>(SnapshotSection::Expiry)] = index ? 1 : 0;
+    h.counts[static_cast<unsigned>(SnapshotSection::Lot)]    = static_cast<uint32_t>(lots.size());
+    vector<unsigned char> image(lay.bytes() + (index ? sizeof(ExpiryRecord) : 0) + lots.size() * sizeof(LotRecord), 0);
+
+    unsigned char* p = image.data() + sizeof h;
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Ingredient)]) {
+        IngredientRecord r{};
+        r.mg = w.ingredient(hd)->getMilligrams();
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Tool)]) {
+        const KitchenTool* t = w.tool(hd);
+        ToolRecord r{};
+        r.durability = t->getDurability();
+        r.clean      = t->isClean();
+        r.available  = t->isAvailable();
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Oven)]) {
+        const Oven* o = w.oven(hd);
+        OvenRecord r{};
+        r.temperature = o->temperature;
+        r.startTemp   = o->profile.startTemp;
+        r.targetTemp  = o->profile.targetTemp;
+        r.duration    = o->profile.duration;
+        r.elapsed     = o->elapsedSeconds;
+        r.timer       = timerRecord(o->bakingTimer);
+        r.on          = o->on;
+        r.doorClosed  = o->doorClosed;
+        r.gradual     = o->profile.gradual;
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Stove)]) {
+        const Stove* st = w.stove(hd);
+        StoveRecord r{};
+        r.activeBurners = st->activeBurners.load(memory_order_relaxed);
+        r.on            = st->on.load(memory_order_relaxed);
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Timer)]) {
+        TimerRecord r = timerRecord(*w.timer(hd));
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    if (index) {
+        ExpiryRecord r{index->now()};
+        memcpy(p, &r, sizeof r);
+        p += sizeof r;
+    }
+    if (!lots.empty()) memcpy(p, lots.data(), lots.size() * sizeof(LotRecord));
+
+    h.checksum = fnv(image.data() + sizeof h, image.size() - sizeof h);
+    memcpy(image.data(), &h, sizeof h);
+    return image;
+}
+
+uint64_t WorldSnapshot::apply(KitchenWorld& w, const void* data, size_t size) {
+    SnapshotHeader h = readHeader(data, size, true);
+    Layout lay(w);
+    if (h.fingerprint != lay.fingerprint) {
+        throw StorageException("Kitchen snapshot was taken from a different kitchen");
+    }
+    ExpiryIndex* index = w.getExpiry();
+    for (unsigned s = 0; s < static_cast<unsigned>(SnapshotSection::Expiry); ++s) {
+        if (h.counts[s] != lay.items[s].size()) {
+            throw StorageException("Kitchen snapshot was taken from a different kitchen");
+        }
+    }
+    if (h.counts[static_cast<unsigned>(SnapshotSection::Expiry)] != (index ? 1u : 0u)) {
+        throw StorageException("Kitchen snapshot was taken from a different kitchen");
+    }
+    const vector<WorldHandle>& ings = lay.items[static_cast<unsigned>(SnapshotSection::Ingredient)];
+
+    const unsigned char* p = static_cast<const unsigned char*>(data) + sizeof h;
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Ingredient)]) {
+        IngredientRecord r;
+        memcpy(&r, p, sizeof r);
+        p += sizeof r;
+        Ingredient* ing = w.ingredient(hd);
+        long long cur = ing->getMilligrams();
+        if (r.mg > cur)      ing->restore(r.mg - cur);
+        else if (r.mg < cur) ing->tryReserve(cur - r.mg);
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Tool)]) {
+        ToolRecord r;
+        memcpy(&r, p, sizeof r);
+        p += sizeof r;
+        KitchenTool* t = w.tool(hd);
+        if (ToolRegistry* reg = t->registry) {
+            InventoryWrite iw(reg->versions, InventorySlot::Tool, t->slot);
+            size_t   wd = t->slot / ToolRegistry::WORD_BITS;
+            uint64_t b  = uint64_t(1) << (t->slot % ToolRegistry::WORD_BITS);
+            if (r.clean) reg->cleanBits[wd].fetch_or(b, memory_order_relaxed);
+            else         reg->cleanBits[wd].fetch_and(~b, memory_order_relaxed);
+            if (r.available && r.durability > 0) reg->availBits[wd].fetch_or(b, memory_order_relaxed);
+            else             reg->availBits[wd].fetch_and(~b, memory_order_relaxed);
+            reg->durability[t->slot] = r.durability;
+        } else {
+            t->clean      = r.clean != 0;
+            t->available  = r.available != 0;
+            t->durability = r.durability;
+        }
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Oven)]) {
+        OvenRecord r;
+        memcpy(&r, p, sizeof r);
+        p += sizeof r;
+        Oven* o = w.oven(hd);
+        o->temperature        = r.temperature;
+        o->profile.startTemp  = r.startTemp;
+        o->profile.targetTemp = r.targetTemp;
+        o->profile.duration   = r.duration;
+        o->profile.gradual    = r.gradual != 0;
+        o->elapsedSeconds     = r.elapsed;
+        o->on                 = r.on != 0;
+        o->doorClosed         = r.doorClosed != 0;
+        restoreTimer(o->bakingTimer, r.timer);
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Stove)]) {
+        StoveRecord r;
+        memcpy(&r, p, sizeof r);
+        p += sizeof r;
+        Stove* st = w.stove(hd);
+        st->activeBurners.store(r.activeBurners, memory_order_relaxed);
+        st->on.store(r.on != 0, memory_order_relaxed);
+    }
+    for (WorldHandle hd : lay.items[static_cast<unsigned>(SnapshotSection::Timer)]) {
+        TimerRecord r;
+        memcpy(&r, p, sizeof r);
+        p += sizeof r;
+        restoreTimer(*w.timer(hd), r);
+    }
+    if (index) {
+        // Партии ложатся на уже восстановленный запас.
+        ExpiryRecord clock;
+        memcpy(&clock, p, sizeof clock);
+        p += sizeof clock;
+        vector<ShelfLot> lots;
+        for (uint32_t i = 0; i < h.counts[static_cast<unsigned>(SnapshotSection::Lot)]; ++i) {
+            LotRecord r;
+            memcpy(&r, p, sizeof r);
+            p += sizeof r;
+            Ingredient* ing = r.ingredient < ings.size() ? w.ingredient(ings[r.ingredient]) : nullptr;
+            if (!ing || !index->tracks(*ing)) {
+                throw StorageException("Kitchen snapshot lot has no tracked ingredient");
+            }
+            lots.push_back(ShelfLot{ing, StockLot{r.mg, r.expiresAt}});
+        }
+        index->rebuild(clock.clock, lots);
+    }
+    return h.sequence;
+}
+
+void WorldSnapshot::writeFile(const vector<unsigned char>& image, const char* path) {
+    string tmp = string(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        throw StorageException("Cannot create kitchen snapshot file");
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size();
+    ok = fflush(f) == 0 && ok;
+    ok = fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path) != 0) {
+        remove(tmp.c_str());
+        throw StorageException("Cannot write kitchen snapshot file");
+    }
+}
+
+bool WorldSnapshot::load(KitchenWorld& w, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) return false;
+        throw StorageException("Cannot open kitchen snapshot file");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        close(fd);
+        throw StorageException("Kitchen snapshot is truncated");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    // MAP_PRIVATE: кадры журнала меняют только свою копию страниц, файл не трогается.
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw StorageException("Cannot map kitchen snapshot file");
+    }
+    try {
+        unsigned char* image = static_cast<unsigned char*>(map);
+        readHeader(image, size, true);
+        ifstream log(string(path) + ".delta", ios::binary);
+        if (log) {
+            vector<char> bytes((istreambuf_iterator<char>(log)), istreambuf_iterator<char>());
+            replay(image, size, bytes.data(), bytes.size());
+        }
+        apply(w, image, size);
+    } catch (...) {
+        munmap(map, size);
+        throw;
+    }
+    munmap(map, size);
+    return true;
+}
+
+vector<unsigned char> WorldSnapshot::diff(const vector<unsigned char>& from,
+                                          const vector<unsigned char>& to,
+                                          uint64_t baseSequence) {
+    SnapshotHeader a = readHeader(from.data(), from.size(), false);
+    SnapshotHeader b = readHeader(to.data(), to.size(), false);
+    if (a.fingerprint != b.fingerprint || from.size() != to.size()) {
+        throw StorageException("Kitchen snapshots were taken from different kitchens");
+    }
+
+    vector<unsigned char> out(sizeof(DeltaFrame), 0);
+    size_t at[SNAPSHOT_SECTIONS];
+    sectionOffsets(b, at);
+    uint32_t records = 0;
+    for (unsigned s = 0; s < SNAPSHOT_SECTIONS; ++s) {
+        for (uint32_t i = 0; i < b.counts[s]; ++i) {
+            size_t off = at[s] + i * RECORD_BYTES[s];
+            if (memcmp(from.data() + off, to.data() + off, RECORD_BYTES[s]) == 0) continue;
+            DeltaRecord r{};
+            r.section = static_cast<uint8_t>(s);
+            r.index   = i;
+            memcpy(r.data, to.data() + off, RECORD_BYTES[s]);
+            const unsigned char* rp = reinterpret_cast<const unsigned char*>(&r);
+            out.insert(out.end(), rp, rp + sizeof r);
+            ++records;
+        }
+    }
+    if (records == 0) return vector<unsigned char>();
+
+    DeltaFrame f{};
+    f.magic        = DELTA_MAGIC;
+    f.records      = records;
+    f.baseSequence = baseSequence;
+    f.sequence     = b.sequence;
+    f.checksum     = fnv(out.data() + sizeof f, out.size() - sizeof f);
+    memcpy(out.data(), &f, sizeof f);
+    return out;
+}
+
+size_t WorldSnapshot::replay(unsigned char* image, size_t imageSize, const void* log, size_t logSize) {
+    SnapshotHeader h = readHeader(image, imageSize, false);
+    size_t at[SNAPSHOT_SECTIONS];
+    sectionOffsets(h, at);
+
+    const uint64_t base = h.sequence;
+    const unsigned char* p   = static_cast<const unsigned char*>(log);
+    const unsigned char* end = p + logSize;
+    size_t applied = 0;
+    while (static_cast<size_t>(end - p) >= sizeof(DeltaFrame)) {
+        DeltaFrame f;
+        memcpy(&f, p, sizeof f);
+        size_t body = static_cast<size_t>(f.records) * sizeof(DeltaRecord);
+        if (f.magic != DELTA_MAGIC || body > static_cast<size_t>(end - p) - sizeof f
+            || fnv(p + sizeof f, body) != f.checksum) {
+            break; // оборванный или испорченный хвост
+        }
+        const unsigned char* rp = p + sizeof f;
+        p += sizeof f + body;
+        if (f.baseSequence != base) continue; // кадр от предыдущего полного снимка
+
+        for (uint32_t i = 0; i < f.records; ++i, rp += sizeof(DeltaRecord)) {
+            DeltaRecord r;
+            memcpy(&r, rp, sizeof r);
+            if (r.section >= SNAPSHOT_SECTIONS || r.index >= h.counts[r.section]) continue;
+            memcpy(image + at[r.section] + r.index * RECORD_BYTES[r.section], r.data, RECORD_BYTES[r.section]);
+        }
+        h.sequence = f.sequence;
+        ++applied;
+    }
+    h.checksum = fnv(image + sizeof h, imageSize - sizeof h);
+    memcpy(image, &h, sizeof h);
+    return applied;
+}
+
+uint64_t WorldSnapshot::lastSequence(const char* path) {
+    ifstream file(path, ios::binary);
+    if (!file) return 0;
+    vector<unsigned char> image((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    try {
+        readHeader(image.data(), image.size(), true);
+    } catch (const StorageException&) {
+        return 0;
+    }
+    ifstream log(string(path) + ".delta", ios::binary);
+    if (log) {
+        vector<char> bytes((istreambuf_iterator<char>(log)), istreambuf_iterator<char>());
+        replay(image.data(), image.size(), bytes.data(), bytes.size());
+    }
+    return readHeader(image.data(), image.size(), false).sequence;
+}
+
+TimerRecord WorldSnapshot::timerRecord(const Timer& t) {
+    TimerRecord r{};
+    if (const TimerBank* bank = t.bank) {
+        r.seconds = bank->seconds[t.slot];
+        r.elapsed = bank->elapsed[t.slot];
+        r.running = bank->isRunning(t.slot);
+    } else {
+        r.seconds = t.seconds;
+        r.elapsed = t.elapsed;
+        r.running = t.running;
+    }
+    return r;
+}
+
+void WorldSnapshot::restoreTimer(Timer& t, const TimerRecord& r) {
+    if (TimerBank* bank = t.bank) {
+        size_t   wd = t.slot / TimerBank::WORD_BITS;
+        uint64_t b  = TimerBank::bit(t.slot);
+        bank->seconds[t.slot] = r.seconds;
+        bank->elapsed[t.slot] = r.elapsed;
+        if (r.running) bank->runningBits[wd].fetch_or(b, memory_order_relaxed);
+        else           bank->runningBits[wd].fetch_and(~b, memory_order_relaxed);
+    } else {
+        t.seconds = r.seconds;
+        t.elapsed = r.elapsed;
+        t.running = r.running != 0;
+    }
+}
+
+/* ===== CheckpointWriter ===== */
+
+CheckpointWriter::CheckpointWriter(const char* p, unsigned every)
+    : path(p), deltaPath(string(p) + ".delta"), compactEvery(every < 1 ? 1 : every),
+      lock(), wake(), idle(), pending(), hasPending(false), busy(false), stopping(false),
+      failed(false), sequence(WorldSnapshot::lastSequence(p)), fullWrites(0), deltaWrites(0),
+      worker() {
+    worker = thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        lock_guard<mutex> g(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void CheckpointWriter::submit(vector<unsigned char> image) {
+    {
+        lock_guard<mutex> g(lock);
+        pending    = std::move(image);
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+bool CheckpointWriter::flush() {
+    unique_lock<mutex> g(lock);
+    idle.wait(g, [this] { return !hasPending && !busy; });
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+size_t CheckpointWriter::snapshotsWritten() {
+    lock_guard<mutex> g(lock);
+    return fullWrites;
+}
+
+size_t CheckpointWriter::deltasWritten() {
+    lock_guard<mutex> g(lock);
+    return deltaWrites;
+}
+
+void CheckpointWriter::run() {
+    vector<unsigned char> last;   // последний записанный образ
+    uint64_t              base = 0; // номер полного снимка, к которому пишется журнал
+    unsigned              frames = 0;
+    long long             journalBytes = 0; // сколько байт журнала записано этим потоком
+    for (;;) {
+        vector<unsigned char> image;
+        uint64_t seq;
+        {
+            unique_lock<mutex> g(lock);
+            wake.wait(g, [this] { return hasPending || stopping; });
+            if (!hasPending) return;
+            image      = std::move(pending);
+            hasPending = false;
+            busy       = true;
+            seq        = ++sequence;
+        }
+
+        bool ok = true, full = false, delta = false;
+        try {
+            SnapshotHeader h;
+            if (image.size() < sizeof h) throw StorageException("Kitchen snapshot is truncated");
+            memcpy(&h, image.data(), sizeof h);
+            h.sequence = seq;
+            memcpy(image.data(), &h, sizeof h);
+
+            uint64_t lastPrint = 0;
+            if (!last.empty()) memcpy(&lastPrint, last.data() + offsetof(SnapshotHeader, fingerprint), sizeof lastPrint);
+            // Журнал другой длины, чем записано, оборван или испорчен: кадр после
+            // такого хвоста replay() не прочитает, поэтому пишется полный снимок.
+            struct stat st;
+            long long journal = stat(deltaPath.c_str(), &st) == 0 ? static_cast<long long>(st.st_size) : 0;
+            if (last.empty() || frames >= compactEvery || last.size() != image.size() || lastPrint != h.fingerprint
+                || journal != journalBytes) {
+                WorldSnapshot::writeFile(image, path.c_str());
+                FILE* f = fopen(deltaPath.c_str(), "wb"); // старый журнал относится к прежнему снимку
+                if (f) fclose(f);
+                base   = seq;
+                frames = 0;
+                journalBytes = 0;
+                full   = true;
+            } else {
+                vector<unsigned char> frame = WorldSnapshot::diff(last, image, base);
+                if (!frame.empty()) {
+                    FILE* f = fopen(deltaPath.c_str(), "ab");
+                    if (!f) throw StorageException("Cannot open kitchen snapshot journal");
+                    bool wrote = fwrite(frame.data(), 1, frame.size(), f) == frame.size();
+                    wrote = fflush(f) == 0 && wrote;
+                    wrote = fsync(fileno(f)) == 0 && wrote;
+                    wrote = fclose(f) == 0 && wrote;
+                    if (!wrote) throw StorageException("Cannot write kitchen snapshot journal");
+                    journalBytes += static_cast<long long>(frame.size());
+                    ++frames;
+                    delta = true;
+                }
+            }
+            last = std::move(image);
+        } catch (const exception&) {
+            // В журнале мог остаться оборванный кадр: следующая точка — полный снимок.
+            last.clear();
+            ok = false;
+        }
+
+        {
+            lock_guard<mutex> g(lock);
+            busy = false;
+            if (!ok) failed = true;
+            if (full)  ++fullWrites;
+            if (delta) ++deltaWrites;
+        }
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,329 @@
+/**
+ * @file snapshot.hpp
+ * @brief Снимок состояния кухни: быстрый тёплый старт и инкрементальные контрольные точки.
+ *
+ * Описание кухни (world.hpp) задаёт только начальное состояние; всё, что
+ * накопилось за работу, — остатки продуктов, прочность и чистота
+ * инструментов, духовки, плиты и таймеры — при выходе терялось.
+ * WorldSnapshot сохраняет это состояние в компактный двоичный файл:
+ * @code
+ * SnapshotHeader                          72 байта
+ * IngredientRecord × counts[Ingredient]   по 8 байт
+ * ToolRecord       × counts[Tool]         по 8 байт
+ * OvenRecord       × counts[Oven]         по 56 байт
+ * StoveRecord      × counts[Stove]        по 8 байт
+ * TimerRecord      × counts[Timer]        по 16 байт
+ * ExpiryRecord     × counts[Expiry]       по 8 байт (0 или 1)
+ * LotRecord        × counts[Lot]          по 24 байта
+ * @endcode
+ * Записи идут в порядке объектов описания, поэтому файл не требует
+ * разбора: load() отображает его в память (mmap) и применяет записи на
+ * месте. Отпечаток (fingerprint()) — хэш типов и ключей объектов с
+ * состоянием; снимок другой кухни не применяется. Если у кухни есть
+ * сроки годности (expiry.hpp), снимок хранит время индекса и остатки
+ * партий каждого отслеживаемого ингредиента. После тёплого старта
+ * продукты портятся в те же моменты, что и без перезапуска. Рецепты, единицы и
+ * повара в отпечаток не входят: новую книгу рецептов можно загрузить на
+ * старые запасы.
+ *
+ * Контрольные точки пишет CheckpointWriter в фоновом потоке: повар
+ * только снимает образ (capture(), копирование нескольких байт на объект),
+ * а сравнение с записанным и запись на диск идут вне горячего пути. В
+ * файл <путь>.delta дописываются только изменившиеся записи (DeltaFrame
+ * и DeltaRecord); время от времени журнал сворачивается в новый полный
+ * снимок. Оборванный при падении хвост журнала при загрузке отбрасывается.
+ *
+ * Снимок снимается, когда повара не готовят: аренды и шаги рецептов в
+ * процессе в состояние не входят.
+ */
+
+#pragma once
+
+#include "world.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @enum SnapshotSection
+ * @brief Раздел снимка (тип записей).
+ */
+enum class SnapshotSection : unsigned char {
+    Ingredient, ///< Запасы ингредиентов.
+    Tool,       ///< Инструменты всех видов.
+    Oven,       ///< Духовки.
+    Stove,      ///< Плиты.
+    Timer,      ///< Таймеры.
+    Expiry,     ///< Время индекса сроков годности (запись есть, если индекс есть).
+    Lot         ///< Остатки партий (число зависит от состояния, а не от описания).
+};
+
+static const unsigned SNAPSHOT_SECTIONS = 7; ///< Число разделов.
+static const uint32_t SNAPSHOT_VERSION  = 2; ///< Версия формата.
+
+/**
+ * @struct SnapshotHeader
+ * @brief Заголовок файла снимка.
+ */
+struct SnapshotHeader {
+    char     magic[8];                  ///< "KSNAP\0\0\0".
+    uint32_t version;                   ///< SNAPSHOT_VERSION.
+    uint32_t headerBytes;               ///< sizeof(SnapshotHeader).
+    uint64_t fingerprint;               ///< Отпечаток кухни.
+    uint64_t sequence;                  ///< Номер образа (растёт с каждой контрольной точкой).
+    uint64_t checksum;                  ///< FNV-1a записей после заголовка.
+    uint32_t counts[SNAPSHOT_SECTIONS]; ///< Записей в разделах.
+    uint32_t reserved;                  ///< Ноль.
+};
+
+/// Запас ингредиента.
+struct IngredientRecord {
+    int64_t mg; ///< Запас в миллиграммах.
+};
+
+/// Состояние инструмента.
+struct ToolRecord {
+    int32_t durability; ///< Прочность.
+    uint8_t clean;      ///< Чистый.
+    uint8_t available;  ///< Доступен.
+    uint8_t pad[2];     ///< Ноль.
+};
+
+/// Состояние таймера.
+struct TimerRecord {
+    int32_t seconds; ///< Заданное время.
+    int32_t elapsed; ///< Прошло.
+    uint8_t running; ///< Запущен.
+    uint8_t pad[7];  ///< Ноль.
+};
+
+/// Состояние духовки.
+struct OvenRecord {
+    double      temperature; ///< Текущая температура.
+    double      startTemp;   ///< Начало профиля нагрева.
+    double      targetTemp;  ///< Цель профиля нагрева.
+    int32_t     duration;    ///< Длительность нагрева, с.
+    int32_t     elapsed;     ///< Прошло с начала нагрева, с.
+    TimerRecord timer;       ///< Таймер выпечки.
+    uint8_t     on;          ///< Включена.
+    uint8_t     doorClosed;  ///< Дверца закрыта.
+    uint8_t     gradual;     ///< Плавный нагрев.
+    uint8_t     pad[5];      ///< Ноль.
+};
+
+/// Время индекса сроков годности.
+struct ExpiryRecord {
+    int64_t clock; ///< Момент последнего ExpiryIndex::expire(), с.
+};
+
+/// Остаток партии отслеживаемого ингредиента.
+struct LotRecord {
+    uint32_t ingredient; ///< Номер записи в разделе Ingredient.
+    uint32_t pad;        ///< Ноль.
+    int64_t  mg;         ///< Остаток, мг.
+    int64_t  expiresAt;  ///< Момент порчи, с.
+};
+
+/// Состояние плиты.
+struct StoveRecord {
+    int32_t activeBurners; ///< Включённых конфорок.
+    uint8_t on;            ///< Плита включена.
+    uint8_t pad[3];        ///< Ноль.
+};
+
+/**
+ * @struct DeltaFrame
+ * @brief Заголовок одной контрольной точки в журнале изменений.
+ */
+struct DeltaFrame {
+    uint32_t magic;        ///< DELTA_MAGIC.
+    uint32_t records;      ///< Записей DeltaRecord за заголовком.
+    uint64_t baseSequence; ///< Номер полного снимка, к которому относится кадр.
+    uint64_t sequence;     ///< Номер образа после применения кадра.
+    uint64_t checksum;     ///< FNV-1a записей кадра.
+};
+
+/**
+ * @struct DeltaRecord
+ * @brief Новое значение одной записи снимка.
+ */
+struct DeltaRecord {
+    uint8_t  section;  ///< SnapshotSection.
+    uint8_t  pad[3];   ///< Ноль.
+    uint32_t index;    ///< Номер записи в разделе.
+    uint8_t  data[56]; ///< Запись раздела (начало массива).
+};
+
+/**
+ * @class WorldSnapshot
+ * @brief Запись и восстановление состояния KitchenWorld.
+ */
+class WorldSnapshot {
+private:
+    /// Состояние таймера (в банке или в самом объекте).
+    static TimerRecord timerRecord(const Timer& t);
+
+    /// Восстанавливает состояние таймера.
+    static void restoreTimer(Timer& t, const TimerRecord& r);
+
+public:
+    static const uint32_t DELTA_MAGIC = 0x544C444Bu; ///< "KDLT".
+
+    /**
+     * @brief Отпечаток кухни: типы и ключи объектов с состоянием.
+     * @param w Мир.
+     * @return 64-битный хэш.
+     */
+    static uint64_t fingerprint(const KitchenWorld& w);
+
+    /**
+     * @brief Снимает образ состояния (в формате файла снимка).
+     * @param w Мир (повара не готовят).
+     * @param sequence Номер образа для заголовка.
+     * @return Байты снимка.
+     */
+    static vector<unsigned char> capture(const KitchenWorld& w, uint64_t sequence = 0);
+
+    /**
+     * @brief Применяет образ к миру.
+     * @param w Мир, собранный по тому же описанию.
+     * @param data Начало образа.
+     * @param size Размер образа.
+     * @return Номер образа.
+     * @throw StorageException если образ повреждён или снят с другой кухни.
+     */
+    static uint64_t apply(KitchenWorld& w, const void* data, size_t size);
+
+    /**
+     * @brief Записывает полный снимок (через временный файл и rename()).
+     * @param image Образ из capture().
+     * @param path Путь к файлу.
+     * @throw StorageException при ошибке записи.
+     */
+    static void writeFile(const vector<unsigned char>& image, const char* path);
+
+    /**
+     * @brief Восстанавливает мир из снимка path и журнала path.delta.
+     *
+     * Снимок отображается в память и применяется на месте, затем
+     * применяются кадры журнала, относящиеся к этому снимку. Повреждённый
+     * кадр и всё после него отбрасываются.
+     * @param w Мир, собранный по тому же описанию.
+     * @param path Путь к снимку.
+     * @return false, если файла снимка нет (мир не меняется).
+     * @throw StorageException если снимок повреждён или снят с другой кухни.
+     */
+    static bool load(KitchenWorld& w, const char* path);
+
+    /**
+     * @brief Кадр журнала: записи образа to, отличающиеся от образа from.
+     * @param from Предыдущий образ (та же кухня).
+     * @param to Новый образ.
+     * @param baseSequence Номер полного снимка, к которому пишется журнал.
+     * @return Байты кадра (DeltaFrame и записи) или пустой вектор, если изменений нет.
+     * @throw StorageException если образы сняты с разных кухонь.
+     */
+    static vector<unsigned char> diff(const vector<unsigned char>& from,
+                                      const vector<unsigned char>& to,
+                                      uint64_t baseSequence);
+
+    /**
+     * @brief Применяет к образу кадры журнала, относящиеся к нему.
+     *
+     * Кадры другого полного снимка пропускаются; на первом повреждённом
+     * или оборванном кадре чтение журнала заканчивается.
+     * @param image Образ (меняется на месте; заголовок получает номер и контрольную сумму).
+     * @param imageSize Размер образа.
+     * @param log Содержимое журнала.
+     * @param logSize Размер журнала.
+     * @return Сколько кадров применено.
+     * @throw StorageException если образ повреждён.
+     */
+    static size_t replay(unsigned char* image, size_t imageSize, const void* log, size_t logSize);
+
+    /**
+     * @brief Номер последнего образа в снимке path и его журнале.
+     * @param path Путь к снимку.
+     * @return Номер или 0, если снимка нет.
+     */
+    static uint64_t lastSequence(const char* path);
+};
+
+/**
+ * @class CheckpointWriter
+ * @brief Фоновая запись контрольных точек.
+ *
+ * submit() только ставит образ в очередь из одного места: если поток не
+ * успел записать предыдущий, новый его заменяет (писать промежуточное
+ * состояние незачем). Первая запись — полный снимок; дальше в журнал
+ * пишутся изменения, а каждые compactEvery кадров журнал сворачивается в
+ * новый полный снимок. После ошибки записи или если длина журнала не
+ * совпадает с записанной (оборванный или испорченный хвост), следующая
+ * точка тоже пишется полным снимком: кадры после плохого хвоста
+ * replay() не читает.
+ */
+class CheckpointWriter {
+private:
+    string                path;          ///< Путь к снимку.
+    string                deltaPath;     ///< Путь к журналу.
+    unsigned              compactEvery;  ///< Кадров журнала до сворачивания.
+    mutex                 lock;          ///< Защищает очередь и счётчики.
+    condition_variable    wake;          ///< Новый образ или остановка.
+    condition_variable    idle;          ///< Очередь записана.
+    vector<unsigned char> pending;       ///< Образ, ждущий записи.
+    bool                  hasPending;    ///< pending заполнен.
+    bool                  busy;          ///< Поток пишет образ.
+    bool                  stopping;      ///< Деструктор ждёт поток.
+    bool                  failed;        ///< Была ошибка записи после последнего flush().
+    uint64_t              sequence;      ///< Номер следующего образа.
+    size_t                fullWrites;    ///< Записано полных снимков.
+    size_t                deltaWrites;   ///< Записано кадров журнала.
+    thread                worker;        ///< Фоновый поток.
+
+    /// Цикл фонового потока.
+    void run();
+
+public:
+    /**
+     * @brief Запускает фоновый поток.
+     * @param p Путь к снимку (журнал — p + ".delta").
+     * @param every Кадров журнала до сворачивания в полный снимок (>=1).
+     */
+    explicit CheckpointWriter(const char* p, unsigned every = 64);
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /// Дописывает последнюю контрольную точку и останавливает поток.
+    ~CheckpointWriter();
+
+    /**
+     * @brief Ставит образ в очередь на запись (не ждёт диска).
+     * @param image Образ из WorldSnapshot::capture().
+     */
+    void submit(vector<unsigned char> image);
+
+    /**
+     * @brief Ждёт, пока поставленный образ будет записан.
+     * @return false, если после прошлого вызова была ошибка записи.
+     */
+    bool flush();
+
+    /**
+     * @brief Число записанных полных снимков.
+     * @return Количество.
+     */
+    size_t snapshotsWritten();
+
+    /**
+     * @brief Число записанных кадров журнала.
+     * @return Количество.
+     */
+    size_t deltasWritten();
+};
@@ -0,0 +1,240 @@
+/**
+ * @file synthetic.cpp
+ * @brief Реализация синтетических кухонь и трасс заказов.
+ */
+
+#include "synthetic.hpp"
+#include "kitchen.hpp"
+#include "orders.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+/// Проверяет размеры кухни.
+void checkSpec(const SyntheticSpec& s) {
+    if (s.ingredients < 1 || s.stations < 1 || s.stoves < 1 || s.burners < 1 || s.dishes < 1) {
+        throw StorageException("Синтетической кухне нужны ингредиенты, места, плиты и блюда");
+    }
+    if (s.minReserves < 1 || s.maxReserves < s.minReserves || s.maxReserves > s.ingredients) {
+        throw StorageException("Некорректное число ингредиентов в синтетическом рецепте");
+    }
+    if (s.stockGrams < 1 || s.holdSeconds < 1 || s.perishableShare < 0.0 || s.perishableShare > 1.0) {
+        throw StorageException("Некорректные запасы или выдержка синтетической кухни");
+    }
+}
+
+/// Проверяет параметры трассы.
+void checkTrace(const TraceSpec& s) {
+    if (s.dishes < 1 || s.horizon < 1 || !(s.ordersPerHour > 0.0) || s.zipf < 0.0) {
+        throw StorageException("Некорректные параметры трассы заказов");
+    }
+    for (const RushWindow& r : s.rushes) {
+        if (r.to <= r.from || !(r.factor >= 1.0)) {
+            throw StorageException("Некорректные часы пик трассы заказов");
+        }
+    }
+}
+
+/// Случайное целое из [lo, hi].
+int pick(SimRandom& rnd, int lo, int hi) {
+    return lo + static_cast<int>(rnd.next() % static_cast<uint64_t>(hi - lo + 1));
+}
+
+} // namespace
+
+/* ===== SyntheticSpec ===== */
+
+SyntheticSpec SyntheticSpec::standard() {
+    SyntheticSpec s;
+    s.ingredients     = 2000;
+    s.stations        = 256;
+    s.stoves          = 32;
+    s.burners         = 8;
+    s.dishes          = 1000;
+    s.minReserves     = 3;
+    s.maxReserves     = 8;
+    s.stockGrams      = 1000000;
+    s.perishableShare = 0.4;
+    s.holdSeconds     = 900;
+    return s;
+}
+
+/* ===== SyntheticKitchen ===== */
+
+void SyntheticKitchen::writeKitchen(const SyntheticSpec& spec, uint64_t seed, ostream& out) {
+    checkSpec(spec);
+    SimRandom rnd(seed);
+    out << "# synthetic kitchen: " << spec.ingredients << " ingredients, " << spec.stations
+        << " stations, " << spec.stoves << " stoves, seed " << seed << "\n"
+        << "unit g 1\n";
+    for (int i = 0; i < spec.ingredients; ++i) {
+        out << "ingredient ing" << i << ' ' << spec.stockGrams << " g " << pick(rnd, 10, 900);
+        if (rnd.uniform() < spec.perishableShare) {
+            out << " perishable price " << pick(rnd, 50, 1500) << " shelf " << pick(rnd, 24, 720);
+        } else {
+            out << " price " << pick(rnd, 50, 1500);
+        }
+        out << "\n";
+    }
+    for (int k = 0; k < spec.stations; ++k) {
+        out << "pot pot" << k << " 4\n"
+            << "timer timer" << k << "\n";
+    }
+    for (int k = 0; k < spec.stoves; ++k) {
+        out << "stove stove" << k << ' ' << spec.burners << "\n";
+    }
+    out << "cook chef\n";
+}
+
+void SyntheticKitchen::writeRecipes(const SyntheticSpec& spec, uint64_t seed, ostream& out) {
+    checkSpec(spec);
+    // Свой поток случайности: рецепты не зависят от того, писалась ли кухня.
+    SimRandom rnd(seed ^ 0x5eedc0ffee5eedULL);
+    vector<int> chosen;
+    chosen.reserve(static_cast<size_t>(spec.maxReserves));
+    for (int d = 0; d < spec.dishes; ++d) {
+        int station = d % spec.stations;
+        int stove = station % spec.stoves;
+        out << "recipe Блюдо " << (d + 1) << "\n"
+            << "    lease pot" << station << "\n"
+            << "    lease stove" << stove << "\n"
+            << "    acquire\n";
+        chosen.clear();
+        int reserves = pick(rnd, spec.minReserves, spec.maxReserves);
+        while (static_cast<int>(chosen.size()) < reserves) {
+            int ing = pick(rnd, 0, spec.ingredients - 1);
+            if (find(chosen.begin(), chosen.end(), ing) != chosen.end()) continue;
+            chosen.push_back(ing);
+            out << "    reserve ing" << ing << ' ' << pick(rnd, 10, 200) << "\n";
+        }
+        out << "    take\n"
+            << "    burner_on stove" << stove << "\n"
+            << "    hold timer" << station << ' ' << pick(rnd, 1, static_cast<int>(spec.holdSeconds)) << "\n"
+            << "    commit\n"
+            << "    burner_off stove" << stove << "\n"
+            << "end\n";
+    }
+}
+
+string SyntheticKitchen::kitchen(const SyntheticSpec& spec, uint64_t seed) {
+    ostringstream out;
+    writeKitchen(spec, seed, out);
+    return out.str();
+}
+
+string SyntheticKitchen::recipes(const SyntheticSpec& spec, uint64_t seed) {
+    ostringstream out;
+    writeRecipes(spec, seed, out);
+    return out.str();
+}
+
+/* ===== TraceSpec ===== */
+
+TraceSpec TraceSpec::standard(int dishes) {
+    TraceSpec s;
+    s.dishes        = dishes;
+    s.horizon       = 12 * 3600;
+    s.ordersPerHour = 2000.0;
+    s.zipf          = 1.1;
+    s.rushes        = {{2 * 3600, 4 * 3600, 3.0}, {8 * 3600, 10 * 3600, 4.0}};
+    return s;
+}
+
+/* ===== OrderTraceGenerator ===== */
+
+vector<double> OrderTraceGenerator::popularity(int dishes, double zipf, uint64_t seed) {
+    if (dishes < 1 || zipf < 0.0) {
+        throw StorageException("Некорректные параметры популярности блюд");
+    }
+    // Ранги раздаются блюдам случайной перестановкой, чтобы самым
+    // популярным не оказывался всегда первый пункт меню.
+    SimRandom rnd(seed);
+    vector<int> rank(static_cast<size_t>(dishes));
+    for (int i = 0; i < dishes; ++i) rank[static_cast<size_t>(i)] = i;
+    for (int i = dishes - 1; i > 0; --i) {
+        swap(rank[static_cast<size_t>(i)], rank[static_cast<size_t>(pick(rnd, 0, i))]);
+    }
+    vector<double> w(static_cast<size_t>(dishes));
+    double total = 0.0;
+    for (int i = 0; i < dishes; ++i) {
+        w[static_cast<size_t>(i)] = 1.0 / pow(static_cast<double>(rank[static_cast<size_t>(i)] + 1), zipf);
+        total += w[static_cast<size_t>(i)];
+    }
+    for (double& x : w) x /= total;
+    return w;
+}
+
+OrderTraceGenerator::OrderTraceGenerator(const TraceSpec& s, uint64_t seed)
+    : spec(s), rnd(seed ^ 0x7ace0f0dd5ULL), cdf(), clock(0.0), peak(0.0) {
+    checkTrace(spec);
+    // Популярность берёт своё зерно, прибытия — своё.
+    cdf = popularity(spec.dishes, spec.zipf, seed);
+    for (size_t i = 1; i < cdf.size(); ++i) cdf[i] += cdf[i - 1];
+    double factor = 1.0;
+    for (const RushWindow& r : spec.rushes) factor = max(factor, r.factor);
+    peak = spec.ordersPerHour * factor / 3600.0;
+}
+
+double OrderTraceGenerator::rateAt(double t) const {
+    double factor = 1.0;
+    for (const RushWindow& r : spec.rushes) {
+        if (t >= static_cast<double>(r.from) && t < static_cast<double>(r.to)) factor = max(factor, r.factor);
+    }
+    return spec.ordersPerHour * factor / 3600.0;
+}
+
+bool OrderTraceGenerator::next(TraceOrder& o) {
+    // Прореживание: кандидаты идут с наибольшей интенсивностью, и каждый
+    // принимается с вероятностью rate(t) / peak.
+    for (;;) {
+        clock += rnd.exponential(peak);
+        if (clock >= static_cast<double>(spec.horizon)) {
+            clock = static_cast<double>(spec.horizon);
+            return false;
+        }
+        if (rnd.uniform() * peak < rateAt(clock)) break;
+    }
+    double u = rnd.uniform();
+    size_t dish = static_cast<size_t>(upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    if (dish >= cdf.size()) dish = cdf.size() - 1;
+    o.at = static_cast<long long>(clock);
+    o.dish = static_cast<int>(dish) + 1;
+    return true;
+}
+
+long long OrderTraceGenerator::write(const TraceSpec& s, uint64_t seed, ostream& out) {
+    OrderTraceGenerator gen(s, seed);
+    out << "# synthetic orders: " << s.dishes << " dishes, " << s.horizon << " s, seed " << seed << "\n";
+    long long orders = 0;
+    long long second = -1;
+    int dish = 0;
+    long long run = 0;
+    auto flushRun = [&]() {
+        if (run == 0) return;
+        out << ' ';
+        out << dish;
+        if (run > 1) out << 'x' << run;
+    };
+    TraceOrder o;
+    while (gen.next(o)) {
+        ++orders;
+        if (o.at == second && o.dish == dish && run < OrderStream::MAX_COUNT) {
+            ++run;
+            continue;
+        }
+        flushRun();
+        if (o.at != second) {
+            if (second >= 0) out << "\n";
+            out << '@' << o.at;
+            second = o.at;
+        }
+        dish = o.dish;
+        run = 1;
+    }
+    flushRun();
+    if (second >= 0) out << "\n";
+    return orders;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file synthetic.hpp
+ * @brief Синтетические кухни и трассы заказов для нагрузочных замеров.
+ *
+ * DEFAULT_KITCHEN — это десяток продуктов и одна плита; на нём не видно,
+ * где кухня упирается при тысячах ингредиентов, сотнях рабочих мест и
+ * неравномерном потоке заказов. SyntheticKitchen пишет описание кухни
+ * (world.hpp) и книгу рецептов (recipe.hpp) заданного размера, а
+ * OrderTraceGenerator — трассу заказов в формате потока заказов
+ * (orders.hpp) с отметками времени @T. Все три текста читаются
+ * построчно, поэтому их можно генерировать и разбирать потоком, не
+ * держа целиком в памяти, и подавать прямо в --kitchen, файл рецептов и
+ * --orders.
+ *
+ * Кухня: ingredients ингредиентов, stations рабочих мест (кастрюля и
+ * таймер), stoves плит по burners конфорок, dishes рецептов. Рецепт
+ * арендует кастрюлю своего места и конфорку плиты, резервирует от
+ * minReserves до maxReserves случайных ингредиентов и выдерживает таймер
+ * места. Таймер места используется только под арендой его кастрюли, а
+ * кастрюля не изнашивается (рецепт не кипятит), поэтому длинная трасса
+ * упирается в аренду и запасы, а не в поломки.
+ *
+ * Трасса: популярность блюд по закону Ципфа (блюдо ранга r заказывают
+ * пропорционально 1 / r^zipf; ранги случайно перемешаны по блюдам),
+ * поступление — неоднородный пуассоновский поток: ordersPerHour вне
+ * часов пик и в factor раз больше внутри окон RushWindow.
+ *
+ * Одно и то же зерно даёт одинаковые тексты на любой платформе
+ * (SimRandom, montecarlo.hpp).
+ */
+
+#pragma once
+
+#include "montecarlo.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct SyntheticSpec
+ * @brief Размеры синтетической кухни.
+ */
+struct SyntheticSpec {
+    int       ingredients;     ///< Ингредиентов.
+    int       stations;        ///< Рабочих мест (кастрюля и таймер).
+    int       stoves;          ///< Плит.
+    int       burners;         ///< Конфорок на плите.
+    int       dishes;          ///< Рецептов.
+    int       minReserves;     ///< Наименьшее число ингредиентов в рецепте.
+    int       maxReserves;     ///< Наибольшее число ингредиентов в рецепте.
+    long long stockGrams;      ///< Запас каждого ингредиента, г.
+    double    perishableShare; ///< Доля скоропортящихся ингредиентов (со сроком shelf).
+    long long holdSeconds;     ///< Наибольшая выдержка таймера в рецепте, с.
+
+    /**
+     * @brief Кухня по умолчанию: 2000 ингредиентов, 256 мест, 32 плиты по 8 конфорок, 1000 рецептов.
+     * @return Размеры.
+     */
+    static SyntheticSpec standard();
+};
+
+/**
+ * @class SyntheticKitchen
+ * @brief Описание кухни и книга рецептов по SyntheticSpec.
+ */
+class SyntheticKitchen {
+public:
+    /**
+     * @brief Пишет описание кухни (формат world.hpp).
+     * @param spec Размеры.
+     * @param seed Зерно.
+     * @param out Поток вывода.
+     * @throw StorageException если размеры некорректны.
+     */
+    static void writeKitchen(const SyntheticSpec& spec, uint64_t seed, ostream& out);
+
+    /**
+     * @brief Пишет книгу рецептов (формат recipe.hpp).
+     * @param spec Размеры (те же, что у кухни).
+     * @param seed Зерно.
+     * @param out Поток вывода.
+     * @throw StorageException если размеры некорректны.
+     */
+    static void writeRecipes(const SyntheticSpec& spec, uint64_t seed, ostream& out);
+
+    /**
+     * @brief Описание кухни строкой.
+     * @param spec Размеры.
+     * @param seed Зерно.
+     * @return Текст для KitchenWorld::build().
+     */
+    static string kitchen(const SyntheticSpec& spec, uint64_t seed);
+
+    /**
+     * @brief Книга рецептов строкой.
+     * @param spec Размеры.
+     * @param seed Зерно.
+     * @return Текст для KitchenWorld::build().
+     */
+    static string recipes(const SyntheticSpec& spec, uint64_t seed);
+};
+
+/**
+ * @struct RushWindow
+ * @brief Часы пик: поток заказов в factor раз сильнее.
+ */
+struct RushWindow {
+    long long from;   ///< Начало окна, с от начала смены.
+    long long to;     ///< Конец окна (не включая), с.
+    double    factor; ///< Множитель потока (≥ 1).
+};
+
+/**
+ * @struct TraceSpec
+ * @brief Параметры трассы заказов.
+ */
+struct TraceSpec {
+    int                dishes;        ///< Пунктов меню (заказы — номера 1…dishes).
+    long long          horizon;       ///< Длительность смены, с.
+    double             ordersPerHour; ///< Поток вне часов пик.
+    double             zipf;          ///< Показатель закона Ципфа (0 — поровну).
+    vector<RushWindow> rushes;        ///< Часы пик.
+
+    /**
+     * @brief Смена по умолчанию: 12 часов, 2000 заказов в час, zipf 1.1, обед ×3 и ужин ×4.
+     * @param dishes Пунктов меню.
+     * @return Параметры.
+     */
+    static TraceSpec standard(int dishes);
+};
+
+/**
+ * @struct TraceOrder
+ * @brief Заказ трассы.
+ */
+struct TraceOrder {
+    long long at;   ///< Момент поступления, с.
+    int       dish; ///< Пункт меню (с 1).
+};
+
+/**
+ * @class OrderTraceGenerator
+ * @brief Поток заказов трассы по одному, без хранения всей трассы.
+ */
+class OrderTraceGenerator {
+private:
+    TraceSpec      spec;  ///< Параметры.
+    SimRandom      rnd;   ///< Случайность.
+    vector<double> cdf;   ///< Накопленная популярность по номеру блюда.
+    double         clock; ///< Момент последнего кандидата, с.
+    double         peak;  ///< Наибольшая интенсивность, заказов в секунду.
+
+    /// Интенсивность потока в момент t, заказов в секунду.
+    double rateAt(double t) const;
+
+public:
+    /**
+     * @brief Создаёт генератор трассы.
+     * @param s Параметры.
+     * @param seed Зерно.
+     * @throw StorageException если параметры некорректны.
+     */
+    OrderTraceGenerator(const TraceSpec& s, uint64_t seed);
+
+    /**
+     * @brief Следующий заказ.
+     * @param o Куда записать заказ.
+     * @return false, если смена закончилась.
+     */
+    bool next(TraceOrder& o);
+
+    /**
+     * @brief Популярность блюд по закону Ципфа с перемешанными рангами.
+     * @param dishes Число блюд.
+     * @param zipf Показатель.
+     * @param seed Зерно (то же, что у генератора, даёт его же популярность).
+     * @return Веса по номеру блюда (с 0), сумма — 1; годятся для WhatIfScenario::dishWeights.
+     */
+    static vector<double> popularity(int dishes, double zipf, uint64_t seed);
+
+    /**
+     * @brief Пишет трассу в формате потока заказов (orders.hpp).
+     *
+     * Строка на каждую секунду, в которую были заказы: @T и номера блюд,
+     * подряд идущие заказы одного блюда — записью NxK.
+     * @param s Параметры.
+     * @param seed Зерно.
+     * @param out Поток вывода.
+     * @return Число заказов.
+     * @throw StorageException если параметры некорректны.
+     */
+    static long long write(const TraceSpec& s, uint64_t seed, ostream& out);
+};
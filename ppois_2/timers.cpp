@@ -0,0 +1,189 @@
+/**
+ * @file timers.cpp
+ * @brief Реализация банка таймеров.
+ */
+
+#include "timers.hpp"
+
+#include <bit>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+/// Упаковывает 64 байта-флага (0 или 1) в биты слова: по байту маски на умножение.
+uint64_t packFlags(const unsigned char* flags) {
+    uint64_t mask = 0;
+    for (unsigned k = 0; k < 64; k += 8) {
+        uint64_t v = 0;
+        for (unsigned i = 0; i < 8; ++i) v |= uint64_t(flags[k + i]) << (8 * i);
+        mask |= ((v * 0x0102040810204080ULL) >> 56) << k;
+    }
+    return mask;
+}
+
+/// Обратное packFlags(): бит j слова — в байт-флаг flags[j].
+void spreadFlags(uint64_t bits, unsigned char* flags) {
+    for (unsigned k = 0; k < 64; k += 8) {
+        uint64_t v = ((bits >> k) & 0xFF) * 0x0101010101010101ULL;
+        v = (((v & 0x8040201008040201ULL) + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+        memcpy(flags + k, &v, sizeof v);
+    }
+}
+
+} // namespace
+
+/* ===== TimerBank ===== */
+
+TimerBank::TimerBank(size_t capacity)
+    : slots((capacity + WORD_BITS - 1) / WORD_BITS * WORD_BITS),
+      words(slots / WORD_BITS),
+      count(0),
+      usedBits(new uint64_t[words]()),
+      runningBits(new atomic<uint64_t>[words]),
+      finishedBits(new uint64_t[words]()),
+      seconds(new int[slots]()),
+      elapsed(new int[slots]()),
+      views(new Timer*[slots]()) {
+    for (size_t w = 0; w < words; ++w) {
+        runningBits[w].store(0, memory_order_relaxed);
+    }
+}
+
+TimerBank::~TimerBank() {
+    for (size_t i = 0; i < slots; ++i) {
+        if (views[i]) detach(views[i]);
+    }
+}
+
+unsigned TimerBank::attach(Timer* t) {
+    if (!t) {
+        throw StorageException("Only timers can be attached to a timer bank");
+    }
+    if (t->bank) {
+        throw StorageException("Timer is already attached to a bank");
+    }
+    for (size_t w = 0; w < words; ++w) {
+        if (usedBits[w] == ~uint64_t(0)) continue;
+        unsigned slot = static_cast<unsigned>(w * WORD_BITS) + static_cast<unsigned>(countr_one(usedBits[w]));
+        uint64_t b = bit(slot);
+
+        usedBits[w] |= b;
+        if (t->running) runningBits[w].fetch_or(b, memory_order_relaxed);
+        seconds[slot] = t->seconds;
+        elapsed[slot] = t->elapsed;
+        views[slot] = t;
+        t->bank = this;
+        t->slot = slot;
+        ++count;
+        return slot;
+    }
+    throw StorageException("Timer bank is full");
+}
+
+void TimerBank::detach(Timer* t) {
+    if (!t || t->bank != this) return;
+    unsigned slot = t->slot;
+    size_t w = slot / WORD_BITS;
+    uint64_t b = bit(slot);
+
+    t->running = (runningBits[w].load(memory_order_relaxed) & b) != 0;
+    t->seconds = seconds[slot];
+    t->elapsed = elapsed[slot];
+    t->bank    = nullptr;
+
+    usedBits[w] &= ~b;
+    runningBits[w].fetch_and(~b, memory_order_relaxed);
+    finishedBits[w] &= ~b;
+    seconds[slot] = 0;
+    elapsed[slot] = 0;
+    views[slot] = nullptr;
+    --count;
+}
+
+size_t TimerBank::size() const {
+    return count;
+}
+
+size_t TimerBank::capacity() const {
+    return slots;
+}
+
+Timer* TimerBank::timerAt(unsigned slot) const {
+    return slot < slots ? views[slot] : nullptr;
+}
+
+size_t TimerBank::tickAll(int delta) {
+    size_t fired = 0;
+    for (size_t w = 0; w < words; ++w) {
+        finishedBits[w] = 0;
+        uint64_t run = runningBits[w].load(memory_order_relaxed);
+        if (!run || delta <= 0) continue;
+
+        // Всё слово за проход: у остановленных таймеров шаг нулевой. Шаг не больше
+        // остатка, поэтому elapsed не переполняется и не превышает seconds.
+        unsigned char sel[WORD_BITS];
+        unsigned char fin[WORD_BITS];
+        spreadFlags(run, sel);
+        const int* s = seconds.get() + w * WORD_BITS;
+        int*       e = elapsed.get() + w * WORD_BITS;
+        for (unsigned j = 0; j < WORD_BITS; ++j) {
+            int rem  = s[j] - e[j];
+            int step = delta < rem ? delta : rem;
+            e[j] += sel[j] ? step : 0;
+            fin[j] = static_cast<unsigned char>(sel[j] & (delta >= rem));
+        }
+        uint64_t done = packFlags(fin);
+        if (!done) continue;
+        runningBits[w].fetch_and(~done, memory_order_relaxed);
+        finishedBits[w] = done;
+        fired += static_cast<size_t>(popcount(done));
+    }
+    return fired;
+}
+
+uint64_t TimerBank::finishedWord(size_t w) const {
+    return w < words ? finishedBits[w] : 0;
+}
+
+size_t TimerBank::wordCount() const {
+    return words;
+}
+
+size_t TimerBank::collectFinished(vector<Timer*>& out) const {
+    size_t before = out.size();
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t m = finishedBits[w]; m; m &= m - 1) {
+            out.push_back(views[w * WORD_BITS + static_cast<size_t>(countr_zero(m))]);
+        }
+    }
+    return out.size() - before;
+}
+
+size_t TimerBank::runningCount() const {
+    size_t n = 0;
+    for (size_t w = 0; w < words; ++w) {
+        n += static_cast<size_t>(popcount(runningBits[w].load(memory_order_relaxed)));
+    }
+    return n;
+}
+
+int TimerBank::nextFinish() const {
+    int best = INT_MAX;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t run = runningBits[w].load(memory_order_relaxed);
+        if (!run) continue;
+        unsigned char sel[WORD_BITS];
+        spreadFlags(run, sel);
+        const int* s = seconds.get() + w * WORD_BITS;
+        const int* e = elapsed.get() + w * WORD_BITS;
+        int m = INT_MAX;
+        for (unsigned j = 0; j < WORD_BITS; ++j) {
+            int keep = -static_cast<int>(sel[j]); // 0 или все единицы
+            int rem  = ((s[j] - e[j]) & keep) | (INT_MAX & ~keep);
+            m = rem < m ? rem : m;
+        }
+        best = m < best ? m : best;
+    }
+    return best == INT_MAX ? -1 : best;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file timers.hpp
+ * @brief Банк таймеров: параллельные массивы и пакетное продвижение времени.
+ *
+ * Timer хранит длительность, прошедшее время и признак работы в самом
+ * объекте, и tick() продвигает один таймер за вызов; чтобы узнать, какие
+ * таймеры сработали, нужно спросить isFinished() у каждого. TimerBank
+ * держит те же поля по номеру слота: длительности и прошедшее время — в
+ * плотных массивах int, признак работы — в битовом множестве по 64 таймера
+ * в слове. tickAll() продвигает все запущенные таймеры одним проходом без
+ * ветвлений (компилятор векторизует его) и возвращает сработавшие как
+ * битовую маску.
+ *
+ * Подключённый таймер (attach()) становится представлением своего слота:
+ * его методы читают и меняют состояние в банке. Таймеры вне банка
+ * работают как раньше.
+ *
+ * Признак работы меняется атомарно, поэтому разные таймеры одного слова
+ * можно запускать из разных потоков. tickAll() и запросы по всему банку
+ * вызывает тот, кто ведёт время, пока таймеры никто не запускает.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class TimerBank
+ * @brief Состояние таймеров в параллельных массивах (structure of arrays).
+ */
+class TimerBank {
+private:
+    static constexpr size_t WORD_BITS = 64; ///< Таймеров в слове битового множества.
+
+    size_t                         slots;        ///< Ёмкость (кратна WORD_BITS).
+    size_t                         words;        ///< Слов в каждом битовом множестве.
+    size_t                         count;        ///< Подключено таймеров.
+    unique_ptr<uint64_t[]>         usedBits;     ///< Слот занят таймером.
+    unique_ptr<atomic<uint64_t>[]> runningBits;  ///< Таймер запущен.
+    unique_ptr<uint64_t[]>         finishedBits; ///< Сработали при последнем tickAll().
+    unique_ptr<int[]>              seconds;      ///< Заданное время по слотам.
+    unique_ptr<int[]>              elapsed;      ///< Прошедшее время по слотам.
+    unique_ptr<Timer*[]>           views;        ///< Подключённые объекты.
+
+    friend class WorldSnapshot;
+
+    static uint64_t bit(unsigned slot) {
+        return uint64_t(1) << (slot % WORD_BITS);
+    }
+
+public:
+    /**
+     * @brief Создаёт пустой банк.
+     * @param capacity Наибольшее число таймеров (округляется вверх до 64).
+     */
+    explicit TimerBank(size_t capacity);
+
+    TimerBank(const TimerBank&) = delete;
+    TimerBank& operator=(const TimerBank&) = delete;
+
+    /// Отключает все таймеры (их состояние возвращается в объекты).
+    ~TimerBank();
+
+    /**
+     * @brief Подключает таймер: его состояние переносится в банк.
+     * @param t Таймер (не подключённый к другому банку).
+     * @return Номер слота.
+     * @throw StorageException если банк заполнен или t уже подключён.
+     */
+    unsigned attach(Timer* t);
+
+    /**
+     * @brief Отключает таймер: состояние копируется обратно в объект.
+     * @param t Таймер этого банка (иначе ничего не делает).
+     */
+    void detach(Timer* t);
+
+    /**
+     * @brief Число подключённых таймеров.
+     * @return Количество.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Ёмкость банка.
+     * @return Наибольшее число таймеров.
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Таймер в слоте.
+     * @param slot Номер слота.
+     * @return Таймер или nullptr для свободного слота.
+     */
+    Timer* timerAt(unsigned slot) const;
+
+    /**
+     * @brief Продвигает все запущенные таймеры на delta секунд.
+     *
+     * Сработавшие таймеры останавливаются, как после Timer::tick(), и
+     * попадают в маску finishedWord() до следующего вызова.
+     * @param delta Приращение времени (при <=0 ничего не меняется, маска очищается).
+     * @return Сколько таймеров сработало.
+     */
+    size_t tickAll(int delta);
+
+    /**
+     * @brief Слово маски сработавших при последнем tickAll().
+     * @param w Номер слова (слоты w·64 … w·64+63).
+     * @return Биты сработавших слотов.
+     */
+    uint64_t finishedWord(size_t w) const;
+
+    /**
+     * @brief Число слов в масках банка.
+     * @return capacity() / 64.
+     */
+    size_t wordCount() const;
+
+    /**
+     * @brief Собирает таймеры, сработавшие при последнем tickAll().
+     * @param out Куда добавить таймеры (в порядке слотов).
+     * @return Сколько добавлено.
+     */
+    size_t collectFinished(vector<Timer*>& out) const;
+
+    /**
+     * @brief Число запущенных таймеров.
+     * @return Количество.
+     */
+    size_t runningCount() const;
+
+    /**
+     * @brief Через сколько секунд сработает ближайший таймер.
+     *
+     * Позволяет сразу вызвать tickAll() на нужную величину, не продвигая
+     * время по секунде.
+     * @return Наименьший остаток среди запущенных или -1, если таких нет.
+     */
+    int nextFinish() const;
+
+    /* ----- Операции над одним слотом (для Timer) ----- */
+
+    /// Запускает таймер (см. Timer::start()).
+    void start(unsigned slot, int s) {
+        seconds[slot] = s;
+        elapsed[slot] = 0;
+        runningBits[slot / WORD_BITS].fetch_or(bit(slot), memory_order_relaxed);
+    }
+
+    /// Продвигает один таймер (см. Timer::tick()).
+    void tick(unsigned slot, int delta) {
+        uint64_t b = bit(slot);
+        if (delta <= 0 || !(runningBits[slot / WORD_BITS].load(memory_order_relaxed) & b)) return;
+        int rem = seconds[slot] - elapsed[slot];
+        if (delta >= rem) {
+            elapsed[slot] = seconds[slot];
+            runningBits[slot / WORD_BITS].fetch_and(~b, memory_order_relaxed);
+        } else {
+            elapsed[slot] += delta;
+        }
+    }
+
+    /// Запущен ли таймер.
+    bool isRunning(unsigned slot) const {
+        return runningBits[slot / WORD_BITS].load(memory_order_relaxed) & bit(slot);
+    }
+
+    /// Завершился ли таймер.
+    bool isFinished(unsigned slot) const {
+        return !isRunning(slot) && elapsed[slot] >= seconds[slot] && seconds[slot] > 0;
+    }
+
+    /// Остаток времени запущенного таймера.
+    int remaining(unsigned slot) const {
+        return isRunning(slot) ? seconds[slot] - elapsed[slot] : 0;
+    }
+};
@@ -0,0 +1,225 @@
+/**
+ * @file tools.cpp
+ * @brief Реализация реестра состояния инструментов.
+ */
+
+#include "tools.hpp"
+
+#include <bit>
+
+/* ===== ToolRegistry ===== */
+
+ToolRegistry::ToolRegistry(size_t capacity)
+    : slots((capacity + WORD_BITS - 1) / WORD_BITS * WORD_BITS),
+      words(slots / WORD_BITS),
+      count(0),
+      usedBits(new atomic<uint64_t>[words]),
+      cleanBits(new atomic<uint64_t>[words]),
+      availBits(new atomic<uint64_t>[words]),
+      busyBits(new atomic<uint64_t>[words]),
+      kindBits(new uint64_t[KIND_COUNT * words]()),
+      durability(new int[slots]()),
+      views(new KitchenTool*[slots]()),
+      versions(nullptr) {
+    for (size_t w = 0; w < words; ++w) {
+        usedBits[w].store(0, memory_order_relaxed);
+        cleanBits[w].store(0, memory_order_relaxed);
+        availBits[w].store(0, memory_order_relaxed);
+        busyBits[w].store(0, memory_order_relaxed);
+    }
+}
+
+ToolRegistry::~ToolRegistry() {
+    for (size_t i = 0; i < slots; ++i) {
+        if (views[i]) detach(views[i]);
+    }
+}
+
+int ToolRegistry::kindIndex(ResourceKind kind) {
+    switch (kind) {
+    case ResourceKind::Tool:   return 0;
+    case ResourceKind::Knife:  return 1;
+    case ResourceKind::Board:  return 2;
+    case ResourceKind::Pan:    return 3;
+    case ResourceKind::Pot:    return 4;
+    case ResourceKind::Mixer:  return 5;
+    case ResourceKind::Masher: return 6;
+    default:                   return -1;
+    }
+}
+
+unsigned ToolRegistry::attach(KitchenTool* t, ResourceKind kind) {
+    int k = kindIndex(kind);
+    if (!t || k < 0) {
+        throw StorageException("Only kitchen tools can be attached to a tool registry");
+    }
+    if (t->registry) {
+        throw StorageException("Tool is already attached to a registry");
+    }
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t used = usedBits[w].load(memory_order_relaxed);
+        if (used == ~uint64_t(0)) continue;
+        unsigned slot = static_cast<unsigned>(w * WORD_BITS) + static_cast<unsigned>(countr_one(used));
+        uint64_t b = bit(slot);
+        InventoryWrite iw(versions, InventorySlot::Tool, slot);
+
+        usedBits[w].fetch_or(b, memory_order_relaxed);
+        if (t->clean)     cleanBits[w].fetch_or(b, memory_order_relaxed);
+        if (t->available && t->durability > 0) availBits[w].fetch_or(b, memory_order_relaxed);
+        if (t->busy.load(memory_order_acquire)) busyBits[w].fetch_or(b, memory_order_relaxed);
+        kindBits[static_cast<size_t>(k) * words + w] |= b;
+        durability[slot] = t->durability;
+        views[slot] = t;
+        t->registry = this;
+        t->slot = slot;
+        ++count;
+        return slot;
+    }
+    throw StorageException("Tool registry is full");
+}
+
+void ToolRegistry::detach(KitchenTool* t) {
+    if (!t || t->registry != this) return;
+    unsigned slot = t->slot;
+    size_t w = slot / WORD_BITS;
+    uint64_t b = bit(slot);
+    InventoryWrite iw(versions, InventorySlot::Tool, slot);
+
+    t->clean      = (cleanBits[w].load(memory_order_relaxed) & b) != 0;
+    t->available  = (availBits[w].load(memory_order_relaxed) & b) != 0;
+    t->busy.store((busyBits[w].load(memory_order_acquire) & b) != 0, memory_order_release);
+    t->durability = durability[slot];
+    t->registry   = nullptr;
+
+    usedBits[w].fetch_and(~b, memory_order_relaxed);
+    cleanBits[w].fetch_and(~b, memory_order_relaxed);
+    availBits[w].fetch_and(~b, memory_order_relaxed);
+    busyBits[w].fetch_and(~b, memory_order_relaxed);
+    for (unsigned k = 0; k < KIND_COUNT; ++k) {
+        kindBits[k * words + w] &= ~b;
+    }
+    durability[slot] = 0;
+    views[slot] = nullptr;
+    --count;
+}
+
+size_t ToolRegistry::size() const {
+    return count;
+}
+
+size_t ToolRegistry::capacity() const {
+    return slots;
+}
+
+KitchenTool* ToolRegistry::toolAt(unsigned slot) const {
+    return slot < slots ? views[slot] : nullptr;
+}
+
+uint64_t ToolRegistry::durabilityMask(size_t w, int min) const {
+    // Сравнения — плотный цикл без ветвлений (векторизуется), затем каждые
+    // 8 флагов-байтов упаковываются в байт маски одним умножением.
+    const int* d = durability.get() + w * WORD_BITS;
+    unsigned char flags[WORD_BITS];
+    for (unsigned j = 0; j < WORD_BITS; ++j) {
+        flags[j] = static_cast<unsigned char>(d[j] >= min);
+    }
+    uint64_t mask = 0;
+    for (unsigned k = 0; k < WORD_BITS; k += 8) {
+        uint64_t v = 0;
+        for (unsigned i = 0; i < 8; ++i) v |= uint64_t(flags[k + i]) << (8 * i);
+        mask |= ((v * 0x0102040810204080ULL) >> 56) << k;
+    }
+    return mask;
+}
+
+uint64_t ToolRegistry::match(size_t w, const ToolQuery& q) const {
+    uint64_t m = cleanBits[w].load(memory_order_relaxed) & availBits[w].load(memory_order_relaxed);
+    if (q.onlyFree) m &= ~busyBits[w].load(memory_order_acquire);
+    if (!q.anyKind) {
+        int k = kindIndex(q.kind);
+        m &= k < 0 ? 0 : kindBits[static_cast<size_t>(k) * words + w];
+    }
+    if (m) m &= durabilityMask(w, q.minDurability > 1 ? q.minDurability : 1);
+    return m;
+}
+
+KitchenTool* ToolRegistry::findFirst(const ToolQuery& q) const {
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t m = match(w, q);
+        if (m) return views[w * WORD_BITS + static_cast<size_t>(countr_zero(m))];
+    }
+    return nullptr;
+}
+
+size_t ToolRegistry::countMatching(const ToolQuery& q) const {
+    size_t n = 0;
+    for (size_t w = 0; w < words; ++w) {
+        n += static_cast<size_t>(popcount(match(w, q)));
+    }
+    return n;
+}
+
+size_t ToolRegistry::collect(const ToolQuery& q, vector<KitchenTool*>& out) const {
+    size_t before = out.size();
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t m = match(w, q); m; m &= m - 1) {
+            out.push_back(views[w * WORD_BITS + static_cast<size_t>(countr_zero(m))]);
+        }
+    }
+    return out.size() - before;
+}
+
+uint64_t ToolRegistry::usableIn(size_t w, uint64_t mask) const {
+    // Прочность не читается: при нулевой прочности признак доступности всегда снят.
+    if (w >= words) return 0;
+    return availBits[w].load(memory_order_relaxed) & cleanBits[w].load(memory_order_relaxed) & mask;
+}
+
+void ToolRegistry::cleanAll() {
+    if (versions) {
+        for (size_t w = 0; w < words; ++w) {
+            for (uint64_t m = usedBits[w].load(memory_order_relaxed); m; m &= m - 1) {
+                clean(static_cast<unsigned>(w * WORD_BITS) + static_cast<unsigned>(countr_zero(m)));
+            }
+        }
+        return;
+    }
+    for (size_t w = 0; w < words; ++w) {
+        cleanBits[w].store(usedBits[w].load(memory_order_relaxed), memory_order_relaxed);
+    }
+}
+
+size_t ToolRegistry::wear(const ToolQuery& q, int uses) {
+    if (uses < 0) uses = 0;
+    size_t worn = 0;
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t m = match(w, q);
+        if (!m) continue;
+        if (versions) {
+            // По слоту: каждое изменение должно попасть в версии.
+            for (uint64_t r = m; r; r &= r - 1) {
+                unsigned slot = static_cast<unsigned>(w * WORD_BITS) + static_cast<unsigned>(countr_zero(r));
+                InventoryWrite iw(versions, InventorySlot::Tool, slot);
+                int v = durability[slot] - uses;
+                durability[slot] = v < 0 ? 0 : v;
+                if (durability[slot] == 0) availBits[w].fetch_and(~bit(slot), memory_order_relaxed);
+            }
+            worn += static_cast<size_t>(popcount(m));
+            continue;
+        }
+        // Уменьшаем всё слово сразу: у неподходящих слотов вычитается 0.
+        unsigned char sel[WORD_BITS];
+        for (unsigned j = 0; j < WORD_BITS; ++j) {
+            sel[j] = static_cast<unsigned char>((m >> j) & 1);
+        }
+        int* d = durability.get() + w * WORD_BITS;
+        for (unsigned j = 0; j < WORD_BITS; ++j) {
+            int v = d[j] - sel[j] * uses;
+            d[j] = v < 0 ? 0 : v;
+        }
+        uint64_t broken = m & ~durabilityMask(w, 1);
+        if (broken) availBits[w].fetch_and(~broken, memory_order_relaxed);
+        worn += static_cast<size_t>(popcount(m));
+    }
+    return worn;
+}
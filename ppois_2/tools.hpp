@@ -0,0 +1,269 @@
+/**
+ * @file tools.hpp
+ * @brief Реестр состояния инструментов: параллельные массивы и битовые множества.
+ *
+ * KitchenTool хранит чистоту, доступность, занятость и прочность в самом
+ * объекте, поэтому поиск подходящего инструмента — это обход объектов с
+ * вызовом isAvailable() у каждого. ToolRegistry держит те же поля
+ * раздельно, по номеру слота: признаки — в битовых множествах по 64
+ * инструмента в слове, прочность — в плотном массиве int. Запрос «чистая
+ * свободная сковорода с прочностью не ниже N» сводится к AND нескольких
+ * слов и сравнению 64 прочностей подряд (цикл без ветвлений, который
+ * компилятор векторизует), а пакетные операции обрабатывают слово за раз.
+ *
+ * Подключённый инструмент (attach()) становится представлением своего
+ * слота: его методы читают и меняют состояние в реестре. Инструменты вне
+ * реестра работают как раньше.
+ *
+ * Занятость (аренда) меняется атомарно и безопасна из любых потоков.
+ * Запросы и пакетные операции читают прочность без синхронизации: их
+ * вызывает планировщик, пока повара инструментами не пользуются.
+ * С подключёнными версиями (versions.hpp) каждое изменение слота
+ * копируется в атомарное состояние версий, а пакетные операции идут по
+ * слотам.
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct ToolQuery
+ * @brief Условие поиска инструментов в реестре.
+ *
+ * Подходят чистые доступные инструменты с прочностью не ниже minDurability;
+ * при onlyFree — ещё и не арендованные.
+ */
+struct ToolQuery {
+    ResourceKind kind;          ///< Тип инструмента (если не anyKind).
+    bool         anyKind;       ///< Любой тип.
+    bool         onlyFree;      ///< Только не арендованные.
+    int          minDurability; ///< Наименьшая прочность (не меньше 1).
+
+    /**
+     * @brief Любой пригодный инструмент.
+     * @param minDurability Наименьшая прочность.
+     * @return Условие.
+     */
+    static ToolQuery any(int minDurability = 1) {
+        return ToolQuery{ResourceKind::Tool, true, true, minDurability};
+    }
+
+    /**
+     * @brief Пригодный инструмент заданного типа.
+     * @param kind Тип (Tool, Knife, Board, Pan, Pot, Mixer, Masher).
+     * @param minDurability Наименьшая прочность.
+     * @return Условие.
+     */
+    static ToolQuery of(ResourceKind kind, int minDurability = 1) {
+        return ToolQuery{kind, false, true, minDurability};
+    }
+};
+
+/**
+ * @class ToolRegistry
+ * @brief Состояние инструментов в параллельных массивах (structure of arrays).
+ */
+class ToolRegistry {
+public:
+    static constexpr size_t   WORD_BITS  = 64; ///< Инструментов в слове битового множества.
+
+private:
+    static constexpr unsigned KIND_COUNT = 7;  ///< Типов инструментов (Tool … Masher).
+
+    size_t                          slots;     ///< Ёмкость (кратна WORD_BITS).
+    size_t                          words;     ///< Слов в каждом битовом множестве.
+    size_t                          count;     ///< Подключено инструментов.
+    unique_ptr<atomic<uint64_t>[]>  usedBits;  ///< Слот занят инструментом.
+    unique_ptr<atomic<uint64_t>[]>  cleanBits; ///< Инструмент чистый.
+    unique_ptr<atomic<uint64_t>[]>  availBits; ///< Инструмент доступен.
+    unique_ptr<atomic<uint64_t>[]>  busyBits;  ///< Инструмент арендован.
+    unique_ptr<uint64_t[]>          kindBits;  ///< Множество слотов каждого типа (KIND_COUNT × words).
+    unique_ptr<int[]>               durability;///< Прочность по слотам.
+    unique_ptr<KitchenTool*[]>      views;     ///< Подключённые объекты.
+    InventoryVersions*              versions;  ///< Версии состояния (versions.hpp) или nullptr.
+
+    friend class WorldSnapshot;
+    friend class InventoryVersions;
+
+    static uint64_t bit(unsigned slot) {
+        return uint64_t(1) << (slot % WORD_BITS);
+    }
+
+    /// Номер типа в kindBits или -1, если это не инструмент.
+    static int kindIndex(ResourceKind kind);
+
+    /// Маска слов w, где прочность не ниже min.
+    uint64_t durabilityMask(size_t w, int min) const;
+
+    /// Маска слотов слова w, подходящих под условие.
+    uint64_t match(size_t w, const ToolQuery& q) const;
+
+public:
+    /**
+     * @brief Создаёт пустой реестр.
+     * @param capacity Наибольшее число инструментов (округляется вверх до 64).
+     */
+    explicit ToolRegistry(size_t capacity);
+
+    ToolRegistry(const ToolRegistry&) = delete;
+    ToolRegistry& operator=(const ToolRegistry&) = delete;
+
+    /// Отключает все инструменты (их состояние возвращается в объекты).
+    ~ToolRegistry();
+
+    /**
+     * @brief Подключает инструмент: его состояние переносится в реестр.
+     * @param t Инструмент (не подключённый к другому реестру).
+     * @param kind Тип для запросов (Tool, Knife, Board, Pan, Pot, Mixer, Masher).
+     * @return Номер слота.
+     * @throw StorageException если реестр заполнен, тип не инструментальный или t уже подключён.
+     */
+    unsigned attach(KitchenTool* t, ResourceKind kind);
+
+    /**
+     * @brief Отключает инструмент: состояние копируется обратно в объект.
+     * @param t Инструмент этого реестра (иначе ничего не делает).
+     */
+    void detach(KitchenTool* t);
+
+    /**
+     * @brief Число подключённых инструментов.
+     * @return Количество.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Ёмкость реестра.
+     * @return Наибольшее число инструментов.
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Инструмент в слоте.
+     * @param slot Номер слота.
+     * @return Инструмент или nullptr для свободного слота.
+     */
+    KitchenTool* toolAt(unsigned slot) const;
+
+    /**
+     * @brief Первый инструмент, подходящий под условие.
+     * @param q Условие.
+     * @return Инструмент или nullptr.
+     */
+    KitchenTool* findFirst(const ToolQuery& q) const;
+
+    /**
+     * @brief Сколько инструментов подходит под условие.
+     * @param q Условие.
+     * @return Количество.
+     */
+    size_t countMatching(const ToolQuery& q) const;
+
+    /**
+     * @brief Собирает все подходящие инструменты.
+     * @param q Условие.
+     * @param out Куда добавить инструменты (в порядке слотов).
+     * @return Сколько добавлено.
+     */
+    size_t collect(const ToolQuery& q, vector<KitchenTool*>& out) const;
+
+    /**
+     * @brief Какие из заданных слотов слова пригодны к работе.
+     *
+     * Пригоден чистый доступный инструмент (как isAvailable(): у
+     * инструмента с нулевой прочностью признак доступности снят); аренда
+     * не учитывается. Безопасно во время работы поваров.
+     * @param w Номер слова (слот / WORD_BITS).
+     * @param mask Проверяемые слоты слова.
+     * @return Подмножество mask.
+     */
+    uint64_t usableIn(size_t w, uint64_t mask) const;
+
+    /**
+     * @brief Моет все инструменты реестра.
+     */
+    void cleanAll();
+
+    /**
+     * @brief Изнашивает все подходящие инструменты на uses использований.
+     *
+     * Прочность уменьшается (не ниже нуля); инструмент с нулевой прочностью
+     * становится недоступным, как после useTool().
+     * @param q Условие.
+     * @param uses Число использований (не меньше 0).
+     * @return Сколько инструментов изношено.
+     */
+    size_t wear(const ToolQuery& q, int uses);
+
+    /* ----- Операции над одним слотом (для KitchenTool) ----- */
+
+    /// Использует инструмент один раз (см. KitchenTool::tryUse()).
+    bool tryUse(unsigned slot) {
+        InventoryWrite iw(versions, InventorySlot::Tool, slot);
+        size_t w = slot / WORD_BITS;
+        uint64_t b = bit(slot);
+        if (!(availBits[w].load(memory_order_relaxed) & cleanBits[w].load(memory_order_relaxed) & b)
+            || durability[slot] <= 0) {
+            return false;
+        }
+        if (--durability[slot] <= 0) {
+            durability[slot] = 0;
+            availBits[w].fetch_and(~b, memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /// Моет инструмент.
+    void clean(unsigned slot) {
+        InventoryWrite iw(versions, InventorySlot::Tool, slot);
+        cleanBits[slot / WORD_BITS].fetch_or(bit(slot), memory_order_relaxed);
+    }
+
+    /// Ломает инструмент.
+    void breakTool(unsigned slot) {
+        InventoryWrite iw(versions, InventorySlot::Tool, slot);
+        availBits[slot / WORD_BITS].fetch_and(~bit(slot), memory_order_relaxed);
+        durability[slot] = 0;
+    }
+
+    /// Доступен, чист и имеет ресурс.
+    bool isAvailable(unsigned slot) const {
+        size_t w = slot / WORD_BITS;
+        return (availBits[w].load(memory_order_relaxed) & cleanBits[w].load(memory_order_relaxed) & bit(slot))
+               && durability[slot] > 0;
+    }
+
+    /// Чистый.
+    bool isClean(unsigned slot) const {
+        return cleanBits[slot / WORD_BITS].load(memory_order_relaxed) & bit(slot);
+    }
+
+    /// Остаточная прочность.
+    int durabilityOf(unsigned slot) const {
+        return durability[slot];
+    }
+
+    /// Арендует инструмент, если он свободен.
+    bool tryLease(unsigned slot) {
+        uint64_t b = bit(slot);
+        return !(busyBits[slot / WORD_BITS].fetch_or(b, memory_order_acquire) & b);
+    }
+
+    /// Возвращает аренду.
+    void releaseLease(unsigned slot) {
+        busyBits[slot / WORD_BITS].fetch_and(~bit(slot), memory_order_release);
+    }
+
+    /// Арендован ли инструмент.
+    bool isBusy(unsigned slot) const {
+        return busyBits[slot / WORD_BITS].load(memory_order_acquire) & bit(slot);
+    }
+};
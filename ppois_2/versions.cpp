@@ -0,0 +1,357 @@
+/**
+ * @file versions.cpp
+ * @brief Реализация версий запасов и инструментов.
+ */
+
+#include "versions.hpp"
+
+#include <functional>
+#include <thread>
+
+namespace {
+
+/**
+ * @struct WriterShard
+ * @brief Секция записи потока: 0 — вне секции, иначе эпоха снимка + 1.
+ */
+struct alignas(64) WriterShard {
+    atomic<uint64_t> section{0}; ///< Эпоха, в которую открыта секция.
+};
+
+/**
+ * @struct WriterRegistry
+ * @brief Секции всех потоков процесса.
+ *
+ * Слот завершившегося потока переходит следующему новому потоку.
+ */
+struct WriterRegistry {
+    mutex                           lock;   ///< Защищает списки.
+    vector<unique_ptr<WriterShard>> shards; ///< Все слоты.
+    vector<WriterShard*>            spare;  ///< Слоты завершившихся потоков.
+};
+
+WriterRegistry& writers() {
+    static WriterRegistry r;
+    return r;
+}
+
+/**
+ * @struct WriterState
+ * @brief Секция текущего потока.
+ */
+struct WriterState {
+    WriterShard* shard  = nullptr; ///< Слот потока.
+    int          depth  = 0;       ///< Вложенность InventoryScope.
+    bool         active = false;   ///< Секция открыта.
+    uint64_t     epoch  = 0;       ///< Эпоха открытой секции.
+
+    ~WriterState() {
+        if (!shard) return;
+        WriterRegistry& r = writers();
+        lock_guard<mutex> g(r.lock);
+        r.spare.push_back(shard);
+    }
+};
+
+thread_local WriterState writer;
+
+atomic<uint64_t> captureEpoch{1}; ///< Эпоха снимков процесса.
+mutex            captureLock;     ///< Публикации всех версий идут по одной.
+
+WriterShard& shardOf(WriterState& w) {
+    if (w.shard) return *w.shard;
+    WriterRegistry& r = writers();
+    lock_guard<mutex> g(r.lock);
+    if (!r.spare.empty()) {
+        w.shard = r.spare.back();
+        r.spare.pop_back();
+    } else {
+        r.shards.emplace_back(new WriterShard());
+        w.shard = r.shards.back().get();
+    }
+    return *w.shard;
+}
+
+void enter(WriterState& w) {
+    WriterShard& s = shardOf(w);
+    uint64_t e = captureEpoch.load(memory_order_seq_cst);
+    // Отметка должна стать видна раньше, чем снимок этой эпохи начнёт ждать секции.
+    while (true) {
+        s.section.store(e + 1, memory_order_seq_cst);
+        uint64_t now = captureEpoch.load(memory_order_seq_cst);
+        if (now == e) break;
+        e = now;
+    }
+    w.epoch  = e;
+    w.active = true;
+}
+
+void leave(WriterState& w) {
+    w.shard->section.store(0, memory_order_release);
+    w.active = false;
+}
+
+constexpr uint64_t TOOL_CLEAN     = 1ULL << 32; ///< Бит чистоты в упакованном состоянии.
+constexpr uint64_t TOOL_AVAILABLE = 1ULL << 33; ///< Бит доступности.
+
+} // namespace
+
+/* ===== InventoryWrite ===== */
+
+void InventoryWrite::begin() {
+    WriterState& w = writer;
+    owner = !w.active && w.depth == 0;
+    if (!w.active) enter(w);
+    uint64_t cap = versions->capturing.load(memory_order_seq_cst);
+    if (cap && w.epoch >= cap) {
+        // Прежнее значение сохраняется, когда записи старых секций уже сделаны.
+        while (versions->ready.load(memory_order_acquire) < cap) this_thread::yield();
+        versions->claim(kind, slot, cap);
+    }
+}
+
+void InventoryWrite::end() {
+    if (kind == InventorySlot::Tool) versions->storeTool(slot);
+    if (owner) leave(writer);
+}
+
+/* ===== InventoryScope ===== */
+
+InventoryScope::InventoryScope() {
+    ++writer.depth;
+}
+
+InventoryScope::~InventoryScope() {
+    WriterState& w = writer;
+    if (--w.depth == 0 && w.active) leave(w);
+}
+
+/* ===== InventoryVersion ===== */
+
+long long InventoryVersion::milligrams(size_t i) const {
+    return i < stockMg.size() ? stockMg[i] : 0;
+}
+
+bool InventoryVersion::usable(size_t slot) const {
+    if (slot >= tools.size()) return false;
+    const ToolRecord& r = tools[slot];
+    return r.clean && r.available && r.durability > 0;
+}
+
+/* ===== InventoryVersions ===== */
+
+InventoryVersions::InventoryVersions(KitchenWorld& w)
+    : ingredients(), registry(&w.getTools()), toolSlots(0), stockCells(), toolCells(), toolState(),
+      capturing(0), ready(0), current(nullptr), readEpoch(1), readers(new ReaderSlot[READER_SLOTS]),
+      lock(), retired(), sequence(0) {
+    RecipeKitchen& k = w.getKitchen();
+    if (registry->versions) {
+        throw StorageException("Инструменты уже подключены к другим версиям");
+    }
+    for (size_t i = 0; i < k.ingredientCount(); ++i) {
+        if (k.ingredient(static_cast<unsigned short>(i))->versions) {
+            throw StorageException("Ингредиент уже подключён к другим версиям");
+        }
+    }
+    toolSlots = registry->capacity();
+    stockCells.reset(new Cell[k.ingredientCount()]);
+    toolCells.reset(new Cell[toolSlots]);
+    toolState.reset(new atomic<uint64_t>[toolSlots]);
+    for (size_t i = 0; i < k.ingredientCount(); ++i) {
+        Ingredient* ing = k.ingredient(static_cast<unsigned short>(i));
+        ing->versions    = this;
+        ing->versionSlot = static_cast<unsigned>(i);
+        ingredients.push_back(ing);
+        stockCells[i].tag.store(0, memory_order_relaxed);
+        stockCells[i].saved.store(0, memory_order_relaxed);
+    }
+    for (size_t s = 0; s < toolSlots; ++s) {
+        toolCells[s].tag.store(0, memory_order_relaxed);
+        toolCells[s].saved.store(0, memory_order_relaxed);
+        toolState[s].store(packTool(s), memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < READER_SLOTS; ++i) readers[i].pinned.store(0, memory_order_relaxed);
+    registry->versions = this;
+    publish();
+}
+
+InventoryVersions::~InventoryVersions() {
+    for (Ingredient* ing : ingredients) {
+        if (ing) ing->versions = nullptr;
+    }
+    registry->versions = nullptr;
+    delete current.load(memory_order_relaxed);
+    for (const Retired& r : retired) delete r.version;
+}
+
+void InventoryVersions::detach(Ingredient* ing) {
+    ingredients[ing->versionSlot] = nullptr;
+    ing->versions = nullptr;
+}
+
+uint64_t InventoryVersions::packTool(size_t slot) const {
+    const ToolRegistry& r = *registry;
+    size_t   w = slot / ToolRegistry::WORD_BITS;
+    uint64_t b = ToolRegistry::bit(static_cast<unsigned>(slot));
+    if (!(r.usedBits[w].load(memory_order_relaxed) & b)) return 0;
+    uint64_t p = static_cast<uint32_t>(r.durability[slot]);
+    if (r.cleanBits[w].load(memory_order_relaxed) & b) p |= TOOL_CLEAN;
+    if (r.availBits[w].load(memory_order_relaxed) & b) p |= TOOL_AVAILABLE;
+    return p;
+}
+
+long long InventoryVersions::live(InventorySlot kind, size_t slot) const {
+    if (kind == InventorySlot::Tool) {
+        return static_cast<long long>(toolState[slot].load(memory_order_acquire));
+    }
+    const Ingredient* ing = ingredients[slot];
+    return ing ? ing->stockMg.load(memory_order_acquire) : 0;
+}
+
+InventoryVersions::Cell& InventoryVersions::cellOf(InventorySlot kind, size_t slot) const {
+    return kind == InventorySlot::Tool ? toolCells[slot] : stockCells[slot];
+}
+
+void InventoryVersions::claim(InventorySlot kind, size_t slot, uint64_t cap) {
+    Cell& c = cellOf(kind, slot);
+    uint64_t t = c.tag.load(memory_order_acquire);
+    while (true) {
+        if (t == 2 * cap) return;
+        if (t == 2 * cap + 1) {
+            // Значение сохраняет другой писатель.
+            this_thread::yield();
+            t = c.tag.load(memory_order_acquire);
+            continue;
+        }
+        if (c.tag.compare_exchange_weak(t, 2 * cap + 1, memory_order_seq_cst)) break;
+    }
+    c.saved.store(live(kind, slot), memory_order_relaxed);
+    c.tag.store(2 * cap, memory_order_release);
+}
+
+long long InventoryVersions::frozen(InventorySlot kind, size_t slot, uint64_t cap) const {
+    Cell& c = cellOf(kind, slot);
+    while (true) {
+        uint64_t t = c.tag.load(memory_order_seq_cst);
+        if (t == 2 * cap) return c.saved.load(memory_order_relaxed);
+        if (t == 2 * cap + 1) {
+            this_thread::yield();
+            continue;
+        }
+        // Значение взято до первой записи эпохи, если за чтение его никто не сохранил.
+        long long v = live(kind, slot);
+        if (c.tag.load(memory_order_seq_cst) == t) return v;
+    }
+}
+
+void InventoryVersions::storeTool(size_t slot) {
+    if (slot < toolSlots) toolState[slot].store(packTool(slot), memory_order_release);
+}
+
+uint64_t InventoryVersions::publish() {
+    if (writer.active) {
+        throw StorageException("Публикация версии внутри секции записи");
+    }
+    lock_guard<mutex> order(captureLock);
+    uint64_t cap = captureEpoch.load(memory_order_relaxed) + 1;
+    capturing.store(cap, memory_order_seq_cst);
+    captureEpoch.store(cap, memory_order_seq_cst);
+
+    vector<WriterShard*> open;
+    {
+        WriterRegistry& r = writers();
+        lock_guard<mutex> g(r.lock);
+        for (const unique_ptr<WriterShard>& s : r.shards) open.push_back(s.get());
+    }
+    for (WriterShard* s : open) {
+        while (true) {
+            uint64_t e = s->section.load(memory_order_seq_cst);
+            if (e == 0 || e > cap) break;
+            this_thread::yield();
+        }
+    }
+    ready.store(cap, memory_order_release);
+
+    unique_ptr<InventoryVersion> v(new InventoryVersion());
+    v->stockMg.resize(ingredients.size());
+    for (size_t i = 0; i < ingredients.size(); ++i) {
+        v->stockMg[i] = frozen(InventorySlot::Stock, i, cap);
+    }
+    v->tools.resize(toolSlots);
+    for (size_t s = 0; s < toolSlots; ++s) {
+        uint64_t p = static_cast<uint64_t>(frozen(InventorySlot::Tool, s, cap));
+        ToolRecord& r = v->tools[s];
+        r.durability = static_cast<int32_t>(static_cast<uint32_t>(p));
+        r.clean      = (p & TOOL_CLEAN) != 0;
+        r.available  = (p & TOOL_AVAILABLE) != 0;
+        r.pad[0] = r.pad[1] = 0;
+    }
+    capturing.store(0, memory_order_seq_cst);
+
+    lock_guard<mutex> g(lock);
+    v->sequence = ++sequence;
+    InventoryVersion* old = current.exchange(v.release(), memory_order_seq_cst);
+    uint64_t epoch = readEpoch.fetch_add(1, memory_order_seq_cst);
+    if (old) retired.push_back(Retired{old, epoch});
+    reclaim();
+    return sequence;
+}
+
+uint64_t InventoryVersions::latest() const {
+    return current.load(memory_order_acquire)->sequence;
+}
+
+size_t InventoryVersions::retainedVersions() {
+    lock_guard<mutex> g(lock);
+    reclaim();
+    return retired.size();
+}
+
+void InventoryVersions::reclaim() {
+    uint64_t oldest = readEpoch.load(memory_order_seq_cst);
+    for (unsigned i = 0; i < READER_SLOTS; ++i) {
+        uint64_t p = readers[i].pinned.load(memory_order_seq_cst);
+        if (p && p - 1 < oldest) oldest = p - 1;
+    }
+    // Версию эпохи e заменили, когда эпоха стала e + 1: её держат только читатели эпох ≤ e.
+    size_t kept = 0;
+    for (const Retired& r : retired) {
+        if (r.epoch < oldest) delete r.version;
+        else                  retired[kept++] = r;
+    }
+    retired.resize(kept);
+}
+
+unsigned InventoryVersions::pin(const InventoryVersion*& out) {
+    unsigned place = static_cast<unsigned>(hash<thread::id>()(this_thread::get_id()) % READER_SLOTS);
+    uint64_t e = readEpoch.load(memory_order_seq_cst);
+    for (unsigned tries = 0;; ++tries) {
+        uint64_t expected = 0;
+        if (readers[place].pinned.compare_exchange_strong(expected, e + 1, memory_order_seq_cst)) break;
+        place = (place + 1) % READER_SLOTS;
+        if (tries % READER_SLOTS == READER_SLOTS - 1) this_thread::yield();
+    }
+    // Эпоха могла смениться до отметки: тогда освобождение её не учло.
+    while (true) {
+        uint64_t now = readEpoch.load(memory_order_seq_cst);
+        if (now == e) break;
+        e = now;
+        readers[place].pinned.store(e + 1, memory_order_seq_cst);
+    }
+    out = current.load(memory_order_seq_cst);
+    return place;
+}
+
+void InventoryVersions::unpin(unsigned place) {
+    readers[place].pinned.store(0, memory_order_release);
+}
+
+/* ===== InventoryView ===== */
+
+InventoryView::InventoryView(InventoryVersions& v) : owner(&v), version(nullptr), place(0) {
+    place = owner->pin(version);
+}
+
+InventoryView::~InventoryView() {
+    owner->unpin(place);
+}
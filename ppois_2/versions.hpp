@@ -0,0 +1,233 @@
+/**
+ * @file versions.hpp
+ * @brief Версии запасов и инструментов: согласованное чтение, пока повара готовят.
+ *
+ * Запасы — атомарные счётчики (Ingredient::tryReserve()), состояние
+ * инструментов — слова ToolRegistry. Каждое значение по отдельности
+ * читается безопасно, но обход всех подряд даёт смесь моментов: резерв
+ * рецепта, списавший одно и ещё не списавший другое, виден наполовину.
+ * Сводкам, проверке выполнимости и планировщику нужен один момент
+ * времени для всей кухни, а останавливать поваров ради этого нельзя.
+ *
+ * InventoryVersions подключается к ингредиентам и реестру инструментов
+ * мира и публикует неизменяемые версии InventoryVersion:
+ * - запись — короткая секция потока (одно изменение запаса или
+ *   инструмента, весь StockReservation::tryReserve() или cancel()).
+ *   Поток отмечает секцию в своём слоте, без блокировок и общих RMW;
+ * - publish() объявляет новую эпоху снимка и ждёт только секций, начатых
+ *   до неё (их длина — несколько CAS). Секции новой эпохи перед первым
+ *   изменением значения сохраняют его прежнее значение (копирование при
+ *   записи, одна CAS на значение за снимок), и снимок, проходя по кухне,
+ *   берёт сохранённое значение там, где оно есть. Получается состояние
+ *   ровно на момент объявления эпохи, а повара не ждут снимок;
+ * - читатель (InventoryView) закрепляет текущую версию на время чтения:
+ *   объявляет эпоху чтения в своём слоте и берёт указатель. Старая
+ *   версия освобождается, когда её не может держать ни один читатель
+ *   (освобождение по эпохам, как в RCU).
+ *
+ * В версию входят запасы ингредиентов справочника (по индексу
+ * RecipeKitchen) и состояние слотов ToolRegistry (прочность, чистота,
+ * доступность). Состояние инструмента дублируется в атомарное слово
+ * версии при каждом изменении через реестр, поэтому снимок не читает
+ * неатомарную прочность реестра. Аренды, духовки, плиты и таймеры в
+ * версию не входят.
+ *
+ * Секции записи (InventoryWrite, InventoryScope) объявлены в kitchen.hpp:
+ * их открывают Ingredient, ToolRegistry и StockReservation. Без
+ * подключённых версий запись стоит одной проверки указателя.
+ * Подключать и отключать версии, как и собирать мир, — когда повара не
+ * готовят; версии должны быть уничтожены раньше мира.
+ */
+
+#pragma once
+
+#include "world.hpp"
+#include "snapshot.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct InventoryVersion
+ * @brief Неизменяемое состояние запасов и инструментов на один момент.
+ */
+struct InventoryVersion {
+    uint64_t           sequence; ///< Номер версии (с 1).
+    vector<long long>  stockMg;  ///< Запас по индексу ингредиента RecipeKitchen, мг.
+    vector<ToolRecord> tools;    ///< Состояние по слоту ToolRegistry (пустой слот — нули).
+
+    /**
+     * @brief Запас ингредиента.
+     * @param i Индекс в RecipeKitchen.
+     * @return Миллиграммы (0 у неизвестного индекса).
+     */
+    long long milligrams(size_t i) const;
+
+    /**
+     * @brief Пригоден ли инструмент слота: чист, доступен и с ресурсом.
+     * @param slot Слот ToolRegistry.
+     * @return false у пустого или неизвестного слота.
+     */
+    bool usable(size_t slot) const;
+};
+
+/**
+ * @class InventoryVersions
+ * @brief Публикация версий запасов и инструментов мира и их освобождение.
+ */
+class InventoryVersions {
+private:
+    /**
+     * @struct Cell
+     * @brief Значение для снимка: сохранённое прежнее значение и его эпоха.
+     *
+     * tag == 2·e — в эпоху e сохранено saved; tag == 2·e + 1 — сохраняется.
+     */
+    struct Cell {
+        atomic<uint64_t>  tag;   ///< Эпоха сохранения.
+        atomic<long long> saved; ///< Значение до первой записи эпохи.
+    };
+
+    /**
+     * @struct ReaderSlot
+     * @brief Место читателя: 0 — свободно, иначе эпоха чтения + 1.
+     */
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> pinned; ///< Закреплённая эпоха.
+    };
+
+    /**
+     * @struct Retired
+     * @brief Заменённая версия, ждущая освобождения.
+     */
+    struct Retired {
+        InventoryVersion* version; ///< Версия.
+        uint64_t          epoch;   ///< Эпоха чтения, после которой её никто не берёт.
+    };
+
+    vector<Ingredient*>            ingredients; ///< Подключённые ингредиенты (nullptr — отключён).
+    ToolRegistry*                  registry;    ///< Реестр инструментов.
+    size_t                         toolSlots;   ///< Слотов реестра.
+    unique_ptr<Cell[]>             stockCells;  ///< Сохранённые запасы.
+    unique_ptr<Cell[]>             toolCells;   ///< Сохранённые состояния инструментов.
+    unique_ptr<atomic<uint64_t>[]> toolState;   ///< Текущее состояние инструментов (упакованное).
+    alignas(64) atomic<uint64_t>   capturing;   ///< Эпоха снимка в работе (0 — снимка нет).
+    atomic<uint64_t>               ready;       ///< Последняя эпоха, чьи старые секции закончились.
+    alignas(64) atomic<InventoryVersion*> current; ///< Текущая версия.
+    atomic<uint64_t>               readEpoch;   ///< Эпоха чтения (растёт с каждой публикацией).
+    unique_ptr<ReaderSlot[]>       readers;     ///< Места читателей.
+    mutex                          lock;        ///< Защищает retired и порядок публикаций.
+    vector<Retired>                retired;     ///< Заменённые версии.
+    uint64_t                       sequence;    ///< Номер последней версии.
+
+    friend class InventoryWrite;
+    friend class InventoryView;
+    friend class Ingredient;
+    friend class ToolRegistry;
+
+    /// Упаковывает состояние слота реестра.
+    uint64_t packTool(size_t slot) const;
+
+    /// Текущее значение: запас или упакованное состояние инструмента.
+    long long live(InventorySlot kind, size_t slot) const;
+
+    /// Ячейка значения.
+    Cell& cellOf(InventorySlot kind, size_t slot) const;
+
+    /// Сохраняет прежнее значение для снимка эпохи cap (вызывает писатель).
+    void claim(InventorySlot kind, size_t slot, uint64_t cap);
+
+    /// Значение на момент эпохи cap (вызывает снимок).
+    long long frozen(InventorySlot kind, size_t slot, uint64_t cap) const;
+
+    /// Обновляет упакованное состояние инструмента после записи.
+    void storeTool(size_t slot);
+
+    /// Закрепляет версию за читателем; возвращает место.
+    unsigned pin(const InventoryVersion*& out);
+
+    /// Освобождает место читателя.
+    void unpin(unsigned place);
+
+    /// Освобождает версии, которые уже никто не может держать (под lock).
+    void reclaim();
+
+    /// Отключает ингредиент (из его деструктора).
+    void detach(Ingredient* ing);
+
+public:
+    static const unsigned READER_SLOTS = 64; ///< Одновременных читателей (лишние ждут места).
+
+    /**
+     * @brief Подключается к ингредиентам и инструментам мира и публикует первую версию.
+     * @param w Мир (повара не готовят).
+     * @throw StorageException если ингредиент или реестр уже подключены к другим версиям.
+     */
+    explicit InventoryVersions(KitchenWorld& w);
+
+    InventoryVersions(const InventoryVersions&) = delete;
+    InventoryVersions& operator=(const InventoryVersions&) = delete;
+
+    /// Отключается от мира и освобождает все версии (читателей быть не должно).
+    ~InventoryVersions();
+
+    /**
+     * @brief Снимает состояние кухни и делает его текущей версией.
+     *
+     * Можно вызывать из любого потока, пока повара готовят; публикации
+     * всех версий процесса идут по одной. Ждёт только записей, начатых
+     * до вызова.
+     * @return Номер новой версии.
+     */
+    uint64_t publish();
+
+    /**
+     * @brief Номер текущей версии.
+     * @return Номер (с 1).
+     */
+    uint64_t latest() const;
+
+    /**
+     * @brief Сколько заменённых версий ещё не освобождено.
+     * @return Версий, которые могут держать читатели.
+     */
+    size_t retainedVersions();
+};
+
+/**
+ * @class InventoryView
+ * @brief Закреплённая версия: читается без блокировок, пока объект жив.
+ *
+ * Публикация нового состояния не меняет закреплённую версию и не ждёт
+ * читателя.
+ */
+class InventoryView {
+private:
+    InventoryVersions*      owner;   ///< Версии.
+    const InventoryVersion* version; ///< Закреплённая версия.
+    unsigned                place;   ///< Место читателя.
+
+public:
+    /**
+     * @brief Закрепляет текущую версию.
+     * @param v Версии.
+     */
+    explicit InventoryView(InventoryVersions& v);
+
+    InventoryView(const InventoryView&) = delete;
+    InventoryView& operator=(const InventoryView&) = delete;
+
+    /// Отпускает версию.
+    ~InventoryView();
+
+    /// Закреплённая версия.
+    const InventoryVersion& operator*() const { return *version; }
+
+    /// Доступ к полям версии.
+    const InventoryVersion* operator->() const { return version; }
+};
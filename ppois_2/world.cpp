@@ -0,0 +1,526 @@
+/**
+ * @file world.cpp
+ * @brief Сборка кухни по описанию в одной арене.
+ */
+
+#include "world.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+
+/**
+ * @struct KindSpec
+ * @brief Слово описания и тип объекта.
+ */
+struct KindSpec {
+    const char* word;   ///< Ключевое слово.
+    WorldEntity kind;   ///< Тип объекта.
+    size_t      bytes;  ///< Размер объекта.
+};
+
+const KindSpec KINDS[] = {
+    {"unit",       WorldEntity::Unit,       sizeof(Unit)},
+    {"ingredient", WorldEntity::Ingredient, sizeof(Ingredient)},
+    {"knife",      WorldEntity::Knife,      sizeof(Knife)},
+    {"board",      WorldEntity::Board,      sizeof(CuttingBoard)},
+    {"pan",        WorldEntity::Pan,        sizeof(Pan)},
+    {"pot",        WorldEntity::Pot,        sizeof(Pot)},
+    {"mixer",      WorldEntity::Mixer,      sizeof(Mixer)},
+    {"masher",     WorldEntity::Masher,     sizeof(PotatoMasher)},
+    {"oven",       WorldEntity::Oven,       sizeof(Oven)},
+    {"stove",      WorldEntity::Stove,      sizeof(Stove)},
+    {"timer",      WorldEntity::Timer,      sizeof(Timer)},
+    {"cook",       WorldEntity::Cook,       sizeof(Cook)},
+};
+
+[[noreturn]] void worldError(unsigned line, const string& what) {
+    string msg = "Кухня, строка " + to_string(line) + ": " + what;
+    throw RecipeFormatException(msg.c_str());
+}
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/// Следующее слово в [p, end): пропускает пробелы, возвращает false в конце.
+bool nextToken(const char*& p, const char* end, const char*& tok, size_t& len) {
+    while (p != end && isBlank(*p)) ++p;
+    if (p == end) return false;
+    tok = p;
+    while (p != end && !isBlank(*p)) ++p;
+    len = static_cast<size_t>(p - tok);
+    return true;
+}
+
+bool tokenIs(const char* tok, size_t len, const char* word) {
+    return strlen(word) == len && memcmp(tok, word, len) == 0;
+}
+
+double tokenNumber(const char* tok, size_t len, unsigned line) {
+    char buf[64];
+    if (len >= sizeof(buf)) worldError(line, "слишком длинное число");
+    memcpy(buf, tok, len);
+    buf[len] = '\0';
+    char* end = nullptr;
+    double v = strtod(buf, &end);
+    if (end == buf || *end != '\0') worldError(line, "ожидалось число вместо '" + string(tok, len) + "'");
+    return v;
+}
+
+/// Сколько рецептов в тексте (строки, начинающиеся со слова recipe).
+int countRecipes(const char* text) {
+    int n = 0;
+    for (const char* p = text; p && *p; ) {
+        while (isBlank(*p)) ++p;
+        if (strncmp(p, "recipe", 6) == 0 && (isBlank(p[6]) || p[6] == '\n' || p[6] == '\0')) ++n;
+        const char* nl = strchr(p, '\n');
+        p = nl ? nl + 1 : nullptr;
+    }
+    return n;
+}
+
+} // namespace
+
+/* ===== KitchenWorld ===== */
+
+KitchenWorld::KitchenWorld()
+    : arena(),
+      capacity(0),
+      used(0),
+      entities(),
+      dtors(),
+      specs(),
+      generation(0),
+      tools(new ToolRegistry(0)),
+      timerBank(new TimerBank(0)),
+      kitchen(),
+      book(&kitchen),
+      feasibility(),
+      expiry(),
+      chef(nullptr),
+      dishes(nullptr),
+      dishTotal(0) {}
+
+KitchenWorld::~KitchenWorld() {
+    teardown();
+}
+
+void* KitchenWorld::allocate(size_t n) {
+    n = aligned(n);
+    if (used + n > capacity) {
+        throw StorageException("Kitchen world arena is exhausted");
+    }
+    void* p = arena.get() + used;
+    used += n;
+    return p;
+}
+
+const char* KitchenWorld::copyString(const char* s, size_t n) {
+    char* p = static_cast<char*>(allocate(n + 1));
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+unsigned KitchenWorld::offsetOf(const void* p) const {
+    return static_cast<unsigned>(static_cast<const unsigned char*>(p) - arena.get());
+}
+
+WorldHandle KitchenWorld::addEntity(WorldEntity kind, const void* obj, const char* key) {
+    if (entities.size() >= 0xFFFFFFu) {
+        throw StorageException("Too many objects in kitchen world");
+    }
+    entities.push_back(Entity{key, offsetOf(obj), kind});
+    return ((generation & 0xFFu) << 24) | static_cast<unsigned>(entities.size() - 1);
+}
+
+size_t KitchenWorld::parse(const char* config) {
+    specs.clear();
+    size_t bytes = 0;
+    unsigned lineNo = 0;
+    const char* text = config ? config : "";
+    vector<int> units;              // спецификации единиц: ингредиент ищет свою только среди них
+    unordered_set<string_view> keys; // занятые ключи (проверка без прохода по всем specs)
+
+    for (const char* line = text; *line; ) {
+        ++lineNo;
+        const char* nl   = strchr(line, '\n');
+        const char* end  = nl ? nl : line + strlen(line);
+        const char* next = nl ? nl + 1 : end;
+
+        const char* hash = static_cast<const char*>(memchr(line, '#', static_cast<size_t>(end - line)));
+        if (hash) end = hash;
+        const char* bar  = static_cast<const char*>(memchr(line, '|', static_cast<size_t>(end - line)));
+        const char* head = bar ? bar : end;
+
+        const char* p = line;
+        const char* tok = nullptr;
+        size_t len = 0;
+        if (!nextToken(p, head, tok, len)) {
+            line = next;
+            continue;
+        }
+        const KindSpec* ks = nullptr;
+        for (const KindSpec& k : KINDS) {
+            if (tokenIs(tok, len, k.word)) ks = &k;
+        }
+        if (!ks) worldError(lineNo, "неизвестный объект '" + string(tok, len) + "'");
+
+        Spec s{ks->kind, lineNo, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, -1, false};
+        if (!nextToken(p, head, tok, len)) worldError(lineNo, "нет ключа");
+        s.keyAt  = static_cast<unsigned>(tok - text);
+        s.keyLen = static_cast<unsigned>(len);
+        if (!keys.insert(string_view(tok, len)).second) {
+            worldError(lineNo, "ключ уже занят: " + string(tok, len));
+        }
+        s.nameAt  = s.keyAt;
+        s.nameLen = s.keyLen;
+        if (bar) {
+            const char* n = bar + 1;
+            const char* e = end;
+            while (n != e && isBlank(*n)) ++n;
+            while (e != n && isBlank(e[-1])) --e;
+            if (n != e) {
+                s.nameAt  = static_cast<unsigned>(n - text);
+                s.nameLen = static_cast<unsigned>(e - n);
+            }
+        }
+
+        switch (s.kind) {
+        case WorldEntity::Unit:
+            if (!nextToken(p, head, tok, len)) worldError(lineNo, "у единицы нет числа граммов");
+            s.number = tokenNumber(tok, len, lineNo);
+            if (nextToken(p, head, tok, len)) {
+                if (!tokenIs(tok, len, "liquid")) worldError(lineNo, "ожидалось liquid");
+                s.flag = true;
+            }
+            break;
+        case WorldEntity::Ingredient: {
+            if (!nextToken(p, head, tok, len)) worldError(lineNo, "у ингредиента нет количества");
+            s.number = tokenNumber(tok, len, lineNo);
+            if (!nextToken(p, head, tok, len)) worldError(lineNo, "у ингредиента нет единицы");
+            for (int u : units) {
+                if (specs[static_cast<size_t>(u)].keyLen == len
+                    && memcmp(text + specs[static_cast<size_t>(u)].keyAt, tok, len) == 0) {
+                    s.unit = u;
+                }
+            }
+            if (s.unit < 0) worldError(lineNo, "неизвестная единица '" + string(tok, len) + "'");
+            while (nextToken(p, head, tok, len)) {
+                if (tokenIs(tok, len, "perishable")) {
+                    s.flag = true;
+                } else if (tokenIs(tok, len, "price")) {
+                    if (!nextToken(p, head, tok, len)) worldError(lineNo, "после price нет цены");
+                    s.price = tokenNumber(tok, len, lineNo);
+                    if (s.price < 0.0) worldError(lineNo, "цена не может быть отрицательной");
+                } else if (tokenIs(tok, len, "shelf")) {
+                    if (!nextToken(p, head, tok, len)) worldError(lineNo, "после shelf нет срока");
+                    s.shelf = tokenNumber(tok, len, lineNo);
+                    if (s.shelf <= 0.0) worldError(lineNo, "срок хранения должен быть положительным");
+                } else {
+                    s.extra = tokenNumber(tok, len, lineNo);
+                }
+            }
+            break;
+        }
+        case WorldEntity::Pan:
+        case WorldEntity::Pot:
+        case WorldEntity::Stove:
+            s.number = s.kind == WorldEntity::Pan ? 24.0 : s.kind == WorldEntity::Pot ? 2.0 : 4.0;
+            if (nextToken(p, head, tok, len)) s.number = tokenNumber(tok, len, lineNo);
+            break;
+        default:
+            break;
+        }
+        if (nextToken(p, head, tok, len)) worldError(lineNo, "лишний параметр '" + string(tok, len) + "'");
+
+        bytes += aligned(ks->bytes) + aligned(s.keyLen + 1);
+        if (s.nameAt != s.keyAt) bytes += aligned(s.nameLen + 1);
+        if (s.kind == WorldEntity::Unit) units.push_back(static_cast<int>(specs.size()));
+        specs.push_back(s);
+        line = next;
+    }
+    return bytes;
+}
+
+void KitchenWorld::build(const char* config, const char* recipes) {
+    teardown();
+
+    size_t need = parse(config);
+    int recipeCount = countRecipes(recipes);
+    need += aligned(sizeof(RecipeDish) * static_cast<size_t>(recipeCount));
+    if (need > capacity) {
+        arena.reset(new unsigned char[need]);
+        capacity = need;
+    }
+    entities.reserve(specs.size() + static_cast<size_t>(recipeCount));
+    size_t toolCount = 0;
+    size_t timerCount = 0;
+    for (const Spec& s : specs) {
+        if (s.kind >= WorldEntity::Knife && s.kind <= WorldEntity::Masher) ++toolCount;
+        if (s.kind == WorldEntity::Timer) ++timerCount;
+    }
+    if (toolCount > tools->capacity()) tools.reset(new ToolRegistry(toolCount));
+    if (timerCount > timerBank->capacity()) timerBank.reset(new TimerBank(timerCount));
+
+    const char* text = config ? config : "";
+    int ordinal[static_cast<int>(WorldEntity::Dish) + 1] = {};
+    try {
+        for (const Spec& s : specs) {
+            const char* key  = copyString(text + s.keyAt, s.keyLen);
+            const char* name = s.nameAt == s.keyAt ? key : copyString(text + s.nameAt, s.nameLen);
+            const int   id   = ++ordinal[static_cast<int>(s.kind)]; // номера объектов одного типа с 1
+            switch (s.kind) {
+            case WorldEntity::Unit:
+                addEntity(s.kind, make<Unit>(name, s.number, s.flag, id), key);
+                break;
+            case WorldEntity::Ingredient: {
+                Unit* u = static_cast<Unit*>(lookup(((generation & 0xFFu) << 24)
+                                                    | static_cast<unsigned>(s.unit), WorldEntity::Unit));
+                Ingredient* ing = make<Ingredient>(name, Quantity(s.number, u, false, id), s.extra, s.flag);
+                ing->setPrice(s.price);
+                if (s.shelf > 0.0) {
+                    if (!expiry) expiry.reset(new ExpiryIndex());
+                    long long life = llround(s.shelf * 3600.0);
+                    expiry->track(*ing, life > 0 ? life : 1);
+                }
+                kitchen.add(key, ing);
+                addEntity(s.kind, ing, key);
+                break;
+            }
+            case WorldEntity::Knife: {
+                Knife* k = make<Knife>(name, true, 20, id);
+                tools->attach(k, ResourceKind::Knife);
+                kitchen.add(key, k);
+                addEntity(s.kind, k, key);
+                break;
+            }
+            case WorldEntity::Board: {
+                CuttingBoard* b = make<CuttingBoard>(name, true, false, id);
+                tools->attach(b, ResourceKind::Board);
+                kitchen.add(key, b);
+                addEntity(s.kind, b, key);
+                break;
+            }
+            case WorldEntity::Pan: {
+                Pan* pan = make<Pan>(name, s.number, true, false);
+                tools->attach(pan, ResourceKind::Pan);
+                kitchen.add(key, pan);
+                addEntity(s.kind, pan, key);
+                break;
+            }
+            case WorldEntity::Pot: {
+                Pot* pot = make<Pot>(name, s.number, true, false);
+                tools->attach(pot, ResourceKind::Pot);
+                kitchen.add(key, pot);
+                addEntity(s.kind, pot, key);
+                break;
+            }
+            case WorldEntity::Mixer: {
+                Mixer* m = make<Mixer>(name, false);
+                tools->attach(m, ResourceKind::Mixer);
+                kitchen.add(key, m);
+                addEntity(s.kind, m, key);
+                break;
+            }
+            case WorldEntity::Masher: {
+                PotatoMasher* m = make<PotatoMasher>(name, id);
+                tools->attach(m, ResourceKind::Masher);
+                kitchen.add(key, m);
+                addEntity(s.kind, m, key);
+                break;
+            }
+            case WorldEntity::Oven: {
+                Oven* o = make<Oven>(0.0, false, true);
+                kitchen.add(key, o);
+                addEntity(s.kind, o, key);
+                break;
+            }
+            case WorldEntity::Stove: {
+                Stove* st = make<Stove>(static_cast<int>(s.number), 0, true, false);
+                kitchen.add(key, st);
+                addEntity(s.kind, st, key);
+                break;
+            }
+            case WorldEntity::Timer: {
+                Timer* t = make<Timer>(0, false, 0, id);
+                timerBank->attach(t);
+                kitchen.add(key, t);
+                addEntity(s.kind, t, key);
+                break;
+            }
+            case WorldEntity::Cook: {
+                Cook* ck = make<Cook>(name);
+                if (!chef) chef = ck;
+                addEntity(s.kind, ck, key);
+                break;
+            }
+            case WorldEntity::Dish:
+                break;
+            }
+        }
+
+        if (recipes) book.loadString(recipes);
+        if (book.size() > recipeCount) {
+            throw RecipeFormatException("Рецептов больше, чем строк recipe");
+        }
+        if (book.size() > 0) {
+            dishes = static_cast<RecipeDish*>(allocate(sizeof(RecipeDish) * static_cast<size_t>(book.size())));
+            for (int i = 0; i < book.size(); ++i) {
+                RecipeDish* d = new (dishes + i) RecipeDish(&book, i, chef);
+                dtors.push_back(Dtor{[](void* q) { static_cast<RecipeDish*>(q)->~RecipeDish(); }, offsetOf(d)});
+                addEntity(WorldEntity::Dish, d, book.name(i));
+                ++dishTotal;
+            }
+        }
+        feasibility.reset(new FeasibilityIndex(book));
+    } catch (...) {
+        teardown();
+        throw;
+    }
+}
+
+void KitchenWorld::teardown() {
+    feasibility.reset();
+    expiry.reset();
+    for (size_t i = dtors.size(); i > 0; --i) {
+        dtors[i - 1].destroy(arena.get() + dtors[i - 1].offset);
+    }
+    dtors.clear();
+    entities.clear();
+    book.clear();
+    kitchen.clear();
+    used      = 0;
+    chef      = nullptr;
+    dishes    = nullptr;
+    dishTotal = 0;
+    ++generation;
+}
+
+void* KitchenWorld::lookup(WorldHandle h, WorldEntity kind) const {
+    size_t index = h & 0xFFFFFFu;
+    if ((h >> 24) != (generation & 0xFFu) || index >= entities.size()) return nullptr;
+    const Entity& e = entities[index];
+    if (e.kind != kind) return nullptr;
+    return arena.get() + e.offset;
+}
+
+WorldHandle KitchenWorld::find(const char* key) const {
+    if (!key) return NO_HANDLE;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        if (strcmp(entities[i].key, key) == 0) {
+            return ((generation & 0xFFu) << 24) | static_cast<unsigned>(i);
+        }
+    }
+    return NO_HANDLE;
+}
+
+WorldEntity KitchenWorld::kindOf(WorldHandle h) const {
+    size_t index = h & 0xFFFFFFu;
+    if ((h >> 24) != (generation & 0xFFu) || index >= entities.size()) {
+        throw StorageException("Invalid kitchen world handle");
+    }
+    return entities[index].kind;
+}
+
+WorldHandle KitchenWorld::handleAt(size_t index) const {
+    if (index >= entities.size()) return NO_HANDLE;
+    return ((generation & 0xFFu) << 24) | static_cast<unsigned>(index);
+}
+
+const char* KitchenWorld::keyOf(WorldHandle h) const {
+    size_t index = h & 0xFFFFFFu;
+    if ((h >> 24) != (generation & 0xFFu) || index >= entities.size()) {
+        throw StorageException("Invalid kitchen world handle");
+    }
+    return entities[index].key;
+}
+
+Unit* KitchenWorld::unit(WorldHandle h) const {
+    return static_cast<Unit*>(lookup(h, WorldEntity::Unit));
+}
+
+Ingredient* KitchenWorld::ingredient(WorldHandle h) const {
+    return static_cast<Ingredient*>(lookup(h, WorldEntity::Ingredient));
+}
+
+KitchenTool* KitchenWorld::tool(WorldHandle h) const {
+    if (void* p = lookup(h, WorldEntity::Knife))  return static_cast<Knife*>(p);
+    if (void* p = lookup(h, WorldEntity::Board))  return static_cast<CuttingBoard*>(p);
+    if (void* p = lookup(h, WorldEntity::Pan))    return static_cast<Pan*>(p);
+    if (void* p = lookup(h, WorldEntity::Pot))    return static_cast<Pot*>(p);
+    if (void* p = lookup(h, WorldEntity::Mixer))  return static_cast<Mixer*>(p);
+    if (void* p = lookup(h, WorldEntity::Masher)) return static_cast<PotatoMasher*>(p);
+    return nullptr;
+}
+
+Oven* KitchenWorld::oven(WorldHandle h) const {
+    return static_cast<Oven*>(lookup(h, WorldEntity::Oven));
+}
+
+Stove* KitchenWorld::stove(WorldHandle h) const {
+    return static_cast<Stove*>(lookup(h, WorldEntity::Stove));
+}
+
+Timer* KitchenWorld::timer(WorldHandle h) const {
+    return static_cast<Timer*>(lookup(h, WorldEntity::Timer));
+}
+
+Cook* KitchenWorld::cook(WorldHandle h) const {
+    return static_cast<Cook*>(lookup(h, WorldEntity::Cook));
+}
+
+RecipeDish* KitchenWorld::dish(WorldHandle h) const {
+    return static_cast<RecipeDish*>(lookup(h, WorldEntity::Dish));
+}
+
+size_t KitchenWorld::size() const {
+    return entities.size();
+}
+
+size_t KitchenWorld::arenaUsed() const {
+    return used;
+}
+
+size_t KitchenWorld::arenaCapacity() const {
+    return capacity;
+}
+
+int KitchenWorld::dishCount() const {
+    return dishTotal;
+}
+
+RecipeDish* KitchenWorld::dishAt(int id) const {
+    if (id < 0 || id >= dishTotal) return nullptr;
+    return dishes + id;
+}
+
+Cook* KitchenWorld::getCook() const {
+    return chef;
+}
+
+ToolRegistry& KitchenWorld::getTools() {
+    return *tools;
+}
+
+TimerBank& KitchenWorld::getTimerBank() {
+    return *timerBank;
+}
+
+ExpiryIndex* KitchenWorld::getExpiry() const {
+    return expiry.get();
+}
+
+RecipeKitchen& KitchenWorld::getKitchen() {
+    return kitchen;
+}
+
+RecipeBook& KitchenWorld::getBook() {
+    return book;
+}
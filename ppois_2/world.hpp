@@ -0,0 +1,319 @@
+/**
+ * @file world.hpp
+ * @brief Кухня целиком: все объекты в одной арене, доступ по 32-битным дескрипторам.
+ *
+ * KitchenWorld строит кухню по текстовому описанию: единицы измерения,
+ * ингредиенты, инструменты, плиты, таймеры, повар и блюда книги рецептов
+ * размещаются подряд в одном непрерывном блоке памяти. Размер блока
+ * вычисляется заранее, поэтому сборка делает одно выделение, а повторная
+ * сборка (teardown() + build()) переиспользует уже выделенный блок —
+ * тысячи кухень для серий симуляций создаются без потока мелких new/delete.
+ *
+ * Формат описания (по строке на объект, '#' — комментарий до конца строки, после '|' —
+ * отображаемое имя, по умолчанию совпадает с ключом):
+ * @code
+ * unit       g 1                       # граммов в единице [liquid]
+ * ingredient chicken 1000 g 215 perishable price 320 shelf 48 | Курица
+ * knife      knife | Шеф-нож
+ * board      board
+ * pan        pan 26                    # диаметр, см
+ * pot        soupPot 3                 # объём, л
+ * mixer      mixer
+ * masher     masher
+ * oven       oven
+ * stove      stove 4                   # число конфорок
+ * timer      soupTimer
+ * cook       chef | Главный повар
+ * @endcode
+ * Ингредиенты: <ключ> <количество> <единица> [калорийность] [perishable] [price <цена>]
+ * [shelf <часы>]; калорийность — ккал на 100 г, цена — за килограмм (для
+ * ledger.hpp), shelf — срок хранения: запас такого ингредиента ведётся
+ * партиями в ExpiryIndex мира (getExpiry(), expiry.hpp), начальная
+ * партия портится через shelf часов от начала симуляции.
+ * Единица должна быть описана раньше ингредиента. Ключи всех ресурсов,
+ * кроме единиц и поваров, регистрируются в RecipeKitchen мира и доступны
+ * рецептам. Инструменты подключаются к ToolRegistry мира (getTools()),
+ * таймеры — к TimerBank мира (getTimerBank()), а по книге рецептов
+ * строится FeasibilityIndex (getBook().getFeasibility()).
+ */
+
+#pragma once
+
+#include "kitchen.hpp"
+#include "recipe.hpp"
+#include "tools.hpp"
+#include "timers.hpp"
+#include "feasibility.hpp"
+#include "expiry.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @brief Дескриптор объекта мира: 24 бита — индекс, 8 бит — поколение.
+ *
+ * Поколение меняется при каждой разборке мира, поэтому дескриптор
+ * предыдущей сборки не указывает на объект новой.
+ */
+typedef unsigned WorldHandle;
+
+/**
+ * @enum WorldEntity
+ * @brief Тип объекта мира.
+ */
+enum class WorldEntity : unsigned char {
+    Unit,       ///< Единица измерения.
+    Ingredient, ///< Ингредиент.
+    Knife,      ///< Нож.
+    Board,      ///< Разделочная доска.
+    Pan,        ///< Сковорода.
+    Pot,        ///< Кастрюля.
+    Mixer,      ///< Миксер.
+    Masher,     ///< Толкушка.
+    Oven,       ///< Духовка.
+    Stove,      ///< Плита.
+    Timer,      ///< Таймер.
+    Cook,       ///< Повар.
+    Dish        ///< Блюдо RecipeDish.
+};
+
+/**
+ * @class KitchenWorld
+ * @brief Кухня, собранная по описанию в одной арене.
+ */
+class KitchenWorld {
+private:
+    /**
+     * @struct Entity
+     * @brief Запись таблицы объектов.
+     */
+    struct Entity {
+        const char* key;    ///< Ключ (в арене; у блюд — название в книге).
+        unsigned    offset; ///< Смещение объекта в арене.
+        WorldEntity kind;   ///< Тип объекта.
+    };
+
+    /**
+     * @struct Spec
+     * @brief Разобранная строка описания (до размещения в арене).
+     */
+    struct Spec {
+        WorldEntity kind;    ///< Тип объекта.
+        unsigned    line;    ///< Строка описания.
+        unsigned    keyAt;   ///< Начало ключа в тексте.
+        unsigned    keyLen;  ///< Длина ключа.
+        unsigned    nameAt;  ///< Начало отображаемого имени в тексте.
+        unsigned    nameLen; ///< Длина отображаемого имени.
+        double      number;  ///< Числовой параметр (граммы, диаметр, объём, конфорки).
+        double      extra;   ///< Калорийность ингредиента.
+        double      price;   ///< Цена ингредиента за кг.
+        double      shelf;   ///< Срок хранения ингредиента, ч (0 — без партий).
+        int         unit;    ///< Индекс спецификации единицы для ингредиента.
+        bool        flag;    ///< liquid / perishable.
+    };
+
+    /**
+     * @struct Dtor
+     * @brief Деструктор объекта в арене.
+     */
+    struct Dtor {
+        void   (*destroy)(void*); ///< Вызов деструктора.
+        unsigned offset;          ///< Смещение объекта.
+    };
+
+    unique_ptr<unsigned char[]> arena;      ///< Непрерывный блок объектов.
+    size_t                      capacity;   ///< Размер блока.
+    size_t                      used;       ///< Занято байт.
+    vector<Entity>              entities;   ///< Таблица объектов (индекс — часть дескриптора).
+    vector<Dtor>                dtors;      ///< Нетривиальные деструкторы в порядке создания.
+    vector<Spec>                specs;      ///< Черновик разбора (ёмкость переиспользуется).
+    unsigned                    generation; ///< Поколение дескрипторов.
+    unique_ptr<ToolRegistry>    tools;      ///< Состояние инструментов мира (переиспользуется).
+    unique_ptr<TimerBank>       timerBank;  ///< Состояние таймеров мира (переиспользуется).
+    RecipeKitchen               kitchen;    ///< Справочник ресурсов для рецептов.
+    RecipeBook                  book;       ///< Книга рецептов мира.
+    unique_ptr<FeasibilityIndex> feasibility; ///< Индекс выполнимости книги (строится после сборки).
+    unique_ptr<ExpiryIndex>     expiry;     ///< Партии ингредиентов со сроком хранения или пусто.
+    Cook*                       chef;       ///< Первый повар описания.
+    RecipeDish*                 dishes;     ///< Блюда книги (подряд в арене).
+    int                         dishTotal;  ///< Число блюд.
+
+    /// Выравнивание объектов в арене.
+    static constexpr size_t ALIGN = alignof(max_align_t);
+
+    /// Округляет размер до выравнивания арены.
+    static size_t aligned(size_t n) {
+        return (n + ALIGN - 1) & ~(ALIGN - 1);
+    }
+
+    /// Выделяет n байт из арены.
+    void* allocate(size_t n);
+
+    /// Копирует строку в арену и возвращает её.
+    const char* copyString(const char* s, size_t n);
+
+    /// Размещает объект в арене и регистрирует его деструктор.
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(alignof(T) <= ALIGN, "Arena alignment is too small");
+        void* p = allocate(sizeof(T));
+        T* obj = new (p) T(std::forward<Args>(args)...);
+        if (!is_trivially_destructible<T>::value) {
+            dtors.push_back(Dtor{[](void* q) { static_cast<T*>(q)->~T(); }, offsetOf(obj)});
+        }
+        return obj;
+    }
+
+    /// Добавляет объект в таблицу и возвращает его дескриптор.
+    WorldHandle addEntity(WorldEntity kind, const void* obj, const char* key);
+
+    /// Смещение объекта в арене.
+    unsigned offsetOf(const void* p) const;
+
+    /// Разбирает описание в specs и возвращает нужный размер арены (без блюд).
+    size_t parse(const char* config);
+
+    /// Объект по дескриптору, если тип совпадает.
+    void* lookup(WorldHandle h, WorldEntity kind) const;
+
+public:
+    static const WorldHandle NO_HANDLE = 0xFFFFFFFFu; ///< Нет такого объекта.
+
+    /**
+     * @brief Создаёт пустой мир.
+     */
+    KitchenWorld();
+
+    KitchenWorld(const KitchenWorld&) = delete;
+    KitchenWorld& operator=(const KitchenWorld&) = delete;
+
+    /// Разбирает мир.
+    ~KitchenWorld();
+
+    /**
+     * @brief Собирает мир по описанию (предыдущая сборка разбирается).
+     *
+     * Блюда RecipeDish создаются для каждого рецепта книги и готовятся
+     * первым поваром описания (или без повара, если поваров нет).
+     * @param config Описание кухни.
+     * @param recipes Текст рецептов (nullptr — без рецептов).
+     * @throw RecipeFormatException при ошибке в описании или рецептах (мир остаётся пустым).
+     */
+    void build(const char* config, const char* recipes = nullptr);
+
+    /**
+     * @brief Разбирает мир; выделенный блок сохраняется для следующей сборки.
+     */
+    void teardown();
+
+    /**
+     * @brief Ищет объект по ключу.
+     * @param key Ключ из описания.
+     * @return Дескриптор или NO_HANDLE.
+     */
+    WorldHandle find(const char* key) const;
+
+    /**
+     * @brief Тип объекта.
+     * @param h Дескриптор.
+     * @return Тип.
+     * @throw StorageException если дескриптор недействителен.
+     */
+    WorldEntity kindOf(WorldHandle h) const;
+
+    /**
+     * @brief Дескриптор объекта по номеру в таблице.
+     * @param index Номер (0 … size()-1, в порядке описания).
+     * @return Дескриптор или NO_HANDLE.
+     */
+    WorldHandle handleAt(size_t index) const;
+
+    /**
+     * @brief Ключ объекта.
+     * @param h Дескриптор.
+     * @return Ключ из описания (у блюд — название рецепта).
+     * @throw StorageException если дескриптор недействителен.
+     */
+    const char* keyOf(WorldHandle h) const;
+
+    Unit*         unit(WorldHandle h) const;       ///< Единица или nullptr.
+    Ingredient*   ingredient(WorldHandle h) const; ///< Ингредиент или nullptr.
+    KitchenTool*  tool(WorldHandle h) const;       ///< Любой инструмент или nullptr.
+    Oven*         oven(WorldHandle h) const;       ///< Духовка или nullptr.
+    Stove*        stove(WorldHandle h) const;      ///< Плита или nullptr.
+    Timer*        timer(WorldHandle h) const;      ///< Таймер или nullptr.
+    Cook*         cook(WorldHandle h) const;       ///< Повар или nullptr.
+    RecipeDish*   dish(WorldHandle h) const;       ///< Блюдо или nullptr.
+
+    /**
+     * @brief Число объектов мира.
+     * @return Размер таблицы объектов.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Сколько байт арены занято текущей сборкой.
+     * @return Занятый объём.
+     */
+    size_t arenaUsed() const;
+
+    /**
+     * @brief Размер выделенного блока арены.
+     * @return Ёмкость.
+     */
+    size_t arenaCapacity() const;
+
+    /**
+     * @brief Число блюд (по одному на рецепт книги).
+     * @return Количество блюд.
+     */
+    int dishCount() const;
+
+    /**
+     * @brief Блюдо по номеру рецепта.
+     * @param id Номер рецепта в книге.
+     * @return Блюдо.
+     */
+    RecipeDish* dishAt(int id) const;
+
+    /**
+     * @brief Первый повар описания.
+     * @return Повар или nullptr.
+     */
+    Cook* getCook() const;
+
+    /**
+     * @brief Реестр состояния инструментов мира.
+     * @return Ссылка на реестр.
+     */
+    ToolRegistry& getTools();
+
+    /**
+     * @brief Банк состояния таймеров мира.
+     * @return Ссылка на банк.
+     */
+    TimerBank& getTimerBank();
+
+    /**
+     * @brief Партии ингредиентов со сроком хранения.
+     * @return Индекс или nullptr, если ни у одного ингредиента нет shelf.
+     */
+    ExpiryIndex* getExpiry() const;
+
+    /**
+     * @brief Справочник ресурсов мира.
+     * @return Ссылка на справочник.
+     */
+    RecipeKitchen& getKitchen();
+
+    /**
+     * @brief Книга рецептов мира.
+     * @return Ссылка на книгу.
+     */
+    RecipeBook& getBook();
+};